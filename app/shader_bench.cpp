@@ -0,0 +1,279 @@
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include "myImplement/shader.h"
+#include "myImplement/shader_loader.h"
+#include "myImplement/shader_preprocessor.h"
+#include "myImplement/shader_permutations.h"
+#include "myImplement/config.h"
+#include "myImplement/errorno.h"
+#include "myImplement/headless.h"
+#include "myImplement/render_target.h"
+#include "myImplement/frame_globals.h"
+#include "myImplement/bench_report.h"
+#include "myImplement/image_io.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// other utilities this benchmark will use
+unsigned int createScreenQuad(int width, int height, unsigned int& VBO);
+bool measure(ShaderLoader& loader, FrameGlobals& globals, const std::string& vertexPath, const std::string& fragmentPath,
+             const ShaderDefines& defines, const std::vector<glm::ivec2>& resolutions, BenchReport& report, BenchResult prototype);
+
+// ! ================================== main ==================================
+// shader_bench [config] [--baseline report.json] [--output report.json]
+int main(int argc, char** argv)
+{
+    std::string configPath = "../config/bench.yaml";
+    std::string baselinePath;
+    std::string outputPath;
+    const char* usage = "usage: shader_bench [config] [--baseline report.json] [--output report.json]";
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+        {
+            std::cout << usage << std::endl;
+            return 0;
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && hasValue)
+            baselinePath = argv[++i];
+        else if (strcmp(argv[i], "--output") == 0 && hasValue)
+            outputPath = argv[++i];
+        else if (argv[i][0] == '-')
+        {
+            const bool takesValue = strcmp(argv[i], "--baseline") == 0 || strcmp(argv[i], "--output") == 0;
+            std::cout << "ERROR::BENCH:: " << (takesValue ? "no value for " : "unknown option ") << argv[i] << std::endl
+                      << usage << std::endl;
+            return EMPTY_CONF;
+        }
+        else
+            configPath = argv[i];
+    }
+    YAMLconfig config;
+    try
+    {
+        config.loadFile(configPath.c_str());
+    }
+    catch (const YAML::Exception& e)
+    {
+        std::cout << "ERROR::BENCH:: cannot load " << configPath << ": " << e.what() << std::endl;
+        return EMPTY_CONF;
+    }
+    if (!config.isLoaded())
+    {
+        std::cout << "ERROR::BENCH:: " << configPath << " holds no settings" << std::endl;
+        return EMPTY_CONF;
+    }
+    if (baselinePath.empty())
+        baselinePath = config.getValue<std::string>("baseline", "");
+    if (outputPath.empty())
+        outputPath = config.getValue<std::string>("output", "../output/bench.json");
+    // find out now whether the report can be written, not after the whole run
+    const size_t slash = outputPath.find_last_of("/\\");
+    if ((slash != std::string::npos && slash > 0 && !ensureDirectory(outputPath.substr(0, slash))) ||
+        !std::ofstream(outputPath, std::ios::out | std::ios::app))
+    {
+        std::cout << "ERROR::BENCH:: cannot write " << outputPath << std::endl;
+        return FAIL_WRIT;
+    }
+
+    BenchReport report;
+    report.warmup = std::max(config.getValue<int>("warmup", 10), 0);
+    report.frames = std::max(config.getValue<int>("frames", 60), 1);
+    report.timeStart = config.getValue<float>("time_start", 0.0f);
+    report.timeStep = config.getValue<float>("time_step", 1.0f / 60.0f);
+    const std::string vertexPath = config.getValue<std::string>("vertex", "../shader/shader_vert/shadertoy_common_vs.glsl");
+    const std::vector<std::string> shaders = config.getValue<std::vector<std::string>>("shaders", std::vector<std::string>());
+    std::vector<glm::ivec2> resolutions;
+    for (const std::vector<int>& size : config.getValue<std::vector<std::vector<int>>>("resolutions", std::vector<std::vector<int>>(1, std::vector<int>{ 800, 450 })))
+    {
+        if (size.size() == 2 && size[0] > 0 && size[1] > 0)
+            resolutions.push_back(glm::ivec2(size[0], size[1]));
+    }
+    if (shaders.empty() || resolutions.empty())
+    {
+        std::cout << "ERROR::BENCH:: " << configPath << " lists no shaders or no resolutions" << std::endl;
+        return EMPTY_CONF;
+    }
+
+    HeadlessContext context;
+    if (!context.create(3, 3))
+        return FAIL_CTXT;
+    if (!gladLoadGLLoader(HeadlessContext::getProcLoader()))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return FAIL_CTXT;
+    }
+    report.renderer = (const char*)glGetString(GL_RENDERER);
+    std::cout << "bench renderer: " << report.renderer << std::endl;
+
+    // no program cache: compile times are part of the report
+    ShaderPreprocessor preprocessor(config.getValue<std::string>("library", "../shader/shader_lib"));
+    Shader::setPreprocessor(&preprocessor);
+    // a shader with quality tiers is measured at each of them
+    QualityTiers tiers;
+    const std::string qualityPath = config.getValue<std::string>("quality", "");
+    if (!qualityPath.empty() && !tiers.load(qualityPath))
+        std::cout << "ERROR::QUALITY:: " << tiers.getError() << std::endl;
+    ShaderLoader loader;
+    FrameGlobals globals;
+    if (!globals.create())
+        return FAIL_CTXT;
+
+    bool built = true;
+    for (const std::string& fragmentPath : shaders)
+    {
+        BenchResult prototype;
+        const size_t slash = fragmentPath.find_last_of('/');
+        prototype.shader = slash == std::string::npos ? fragmentPath : fragmentPath.substr(slash + 1);
+        if (tiers.definesFor(fragmentPath, 0).empty())
+        {
+            built = measure(loader, globals, vertexPath, fragmentPath, ShaderDefines(), resolutions, report, prototype) && built;
+            continue;
+        }
+        for (int tier = 0; tier < tiers.getCount(); ++tier)
+        {
+            prototype.tier = tiers.getName(tier);
+            built = measure(loader, globals, vertexPath, fragmentPath, tiers.definesFor(fragmentPath, tier), resolutions, report, prototype) && built;
+        }
+    }
+
+    if (!report.write(outputPath))
+    {
+        std::cout << "ERROR::BENCH:: cannot write " << outputPath << std::endl;
+        return FAIL_WRIT;
+    }
+    std::cout << "bench: " << report.results.size() << " results written to " << outputPath << std::endl;
+    if (!built)
+        return FAIL_SHDR;
+    if (baselinePath.empty())
+        return 0;
+
+    // compare mode: the exit code tells a script whether anything got slower
+    BenchReport baseline;
+    std::string error;
+    if (!baseline.load(baselinePath, error))
+    {
+        std::cout << "ERROR::BENCH:: " << error << std::endl;
+        return EMPTY_FILE;
+    }
+    if (baseline.renderer != report.renderer)
+        std::cout << "bench: the baseline was measured on " << baseline.renderer << ", timings may not compare" << std::endl;
+    const BenchComparison comparison = compareBench(report, baseline, config.getValue<float>("threshold", 0.1f));
+    for (const std::string& line : comparison.lines)
+        std::cout << "  " << line << std::endl;
+    std::cout << "bench against " << baselinePath << ": " << comparison.summary() << std::endl;
+    return comparison.regressions > 0 ? FAIL_PERF : 0;
+}
+
+bool measure(ShaderLoader& loader, FrameGlobals& globals, const std::string& vertexPath, const std::string& fragmentPath,
+             const ShaderDefines& defines, const std::vector<glm::ivec2>& resolutions, BenchReport& report, BenchResult prototype)
+{
+    // one program at a time, so the time is this program's alone
+    const std::chrono::steady_clock::time_point requested = std::chrono::steady_clock::now();
+    ShaderFuture future = loader.request(vertexPath, fragmentPath, defines);
+    loader.wait(future);
+    std::unique_ptr<Shader> shader = future.take();
+    prototype.compileMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - requested).count();
+    if (!shader->isLinked())
+    {
+        std::cout << "ERROR::BENCH:: " << fragmentPath << " did not build, skipped" << std::endl;
+        shader->release();
+        return false;
+    }
+
+    GLuint query;
+    glGenQueries(1, &query);
+    for (const glm::ivec2& size : resolutions)
+    {
+        BenchResult result = prototype;
+        result.width = size.x;
+        result.height = size.y;
+        RenderTarget target(size.x, size.y);
+        unsigned int quadVBO;
+        const unsigned int quadVAO = createScreenQuad(size.x, size.y, quadVBO);
+        std::vector<float> gpuMs, wallMs;
+
+        // the same iTime sequence every run, warm-up frames replay its start
+        for (int frame = -report.warmup; frame < report.frames; ++frame)
+        {
+            const int step = frame < 0 ? frame + report.warmup : frame;
+            FrameInputs inputs;
+            inputs.time = report.timeStart + step * report.timeStep;
+            inputs.timeDelta = report.timeStep;
+            inputs.frame = step;
+            inputs.date = glm::vec4(0.0f, 0.0f, 0.0f, inputs.time);
+            for (int view = 0; view < FRAME_VIEW_COUNT; ++view)
+                inputs.resolution[view] = glm::vec2(float(size.x), float(size.y));
+            globals.update(inputs);
+
+            target.bind();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            shader->use();
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glEndQuery(GL_TIME_ELAPSED);
+            // a benchmark may stall: every frame is finished before the next
+            glFinish();
+            const float wall = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+            if (frame < 0)
+                continue;
+            gpuMs.push_back(float(ns) * 1e-6f);
+            wallMs.push_back(wall);
+        }
+        glDeleteVertexArrays(1, &quadVAO);
+        glDeleteBuffers(1, &quadVBO);
+
+        result.gpuMs = TimingSummary::of(gpuMs);
+        result.wallMs = TimingSummary::of(wallMs);
+        result.pixelsPerSecond = result.gpuMs.mean > 0.0f ? double(size.x) * size.y / (result.gpuMs.mean * 1e-3) : 0.0;
+        char line[200];
+        snprintf(line, sizeof(line), "%-44s %5dx%-5d compile %7.1f ms  gpu mean %7.3f p50 %7.3f p95 %7.3f p99 %7.3f ms  %8.1f Mpx/s",
+                 result.key().substr(0, result.key().find('@')).c_str(), size.x, size.y, result.compileMs,
+                 result.gpuMs.mean, result.gpuMs.p50, result.gpuMs.p95, result.gpuMs.p99, result.pixelsPerSecond * 1e-6);
+        std::cout << line << std::endl;
+        report.results.push_back(result);
+    }
+    glDeleteQueries(1, &query);
+    shader->release();
+    return true;
+}
+
+unsigned int createScreenQuad(int width, int height, unsigned int& VBO)
+{
+    // the quad is given in pixels, shadertoy_common_vs maps it to NDC
+    std::vector<float> sqadVertices
+    {
+        // top    triangle
+        float(width), float(height), 0.0f,
+        float(width), 0.0f, 0.0f,
+        0.0f, 0.0f, 0.0f,
+        // bottom triangle
+        0.0f, 0.0f, 0.0f,
+        0.0f, float(height), 0.0f,
+        float(width), float(height), 0.0f
+    };
+    unsigned int VAO;
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sqadVertices.size() * sizeof(float), &sqadVertices[0], GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    return VAO;
+}
@@ -0,0 +1,346 @@
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include "myImplement/shader.h"
+#include "myImplement/shader_loader.h"
+#include "myImplement/shader_preprocessor.h"
+#include "myImplement/shader_permutations.h"
+#include "myImplement/program_cache.h"
+#include "myImplement/config.h"
+#include "myImplement/errorno.h"
+#include "myImplement/headless.h"
+#include "myImplement/render_target.h"
+#include "myImplement/frame_globals.h"
+#include "myImplement/image_io.h"
+#include "myImplement/video_sink.h"
+#include "myImplement/render_farm.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// what a worker process keeps between the jobs of one coordinator
+struct FarmWorker
+{
+    HeadlessContext context;
+    bool hasContext;
+    std::unique_ptr<ShaderPreprocessor> preprocessor;
+    std::unique_ptr<Shader> shader;
+    FrameGlobals globals;
+    RenderTarget target;
+    unsigned int quadVAO;
+    unsigned int quadVBO;
+    FarmSetup setup;
+
+    FarmWorker() : hasContext(false), quadVAO(0), quadVBO(0) {}
+};
+
+// other utilities this farm will use
+unsigned int createScreenQuad(int width, int height, unsigned int& VBO);
+bool hashSources(const FarmSetup& setup, unsigned long long& sourceHash, ShaderDefines& defines, std::string& error);
+bool setupWorker(FarmWorker& worker, const FarmSetup& setup, unsigned long long& sourceHash, std::string& error);
+bool renderJob(FarmWorker& worker, const FarmJob& job, std::vector<unsigned char>& rgba);
+
+// ! ================================== main ==================================
+// shader_farm [config]         render the frame range of the config on workers
+// shader_farm --listen port    serve coordinators on other hosts
+// shader_farm --worker fd      a local worker, started by the coordinator
+int main(int argc, char** argv)
+{
+    std::string configPath = "../config/farm.yaml";
+    int workerFd = -1;
+    int listenPort = 0;
+    const char* usage = "usage: shader_farm [config] | --listen port | --worker fd";
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+        {
+            std::cout << usage << std::endl;
+            return 0;
+        }
+        else if (strcmp(argv[i], "--worker") == 0 && hasValue)
+            workerFd = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--listen") == 0 && hasValue)
+        {
+            listenPort = atoi(argv[++i]);
+            if (listenPort <= 0 || listenPort > 65535)
+            {
+                std::cout << "ERROR::FARM:: no port " << argv[i] << std::endl << usage << std::endl;
+                return EMPTY_CONF;
+            }
+        }
+        else if (argv[i][0] == '-')
+        {
+            const bool takesValue = strcmp(argv[i], "--worker") == 0 || strcmp(argv[i], "--listen") == 0;
+            std::cout << "ERROR::FARM:: " << (takesValue ? "no value for " : "unknown option ") << argv[i] << std::endl
+                      << usage << std::endl;
+            return EMPTY_CONF;
+        }
+        else
+            configPath = argv[i];
+    }
+
+    if (workerFd >= 0 || listenPort > 0)
+    {
+        FarmWorker worker;
+        FarmHandler handler;
+        handler.setup = [&worker](const FarmSetup& setup, unsigned long long& sourceHash, std::string& error)
+        {
+            return setupWorker(worker, setup, sourceHash, error);
+        };
+        handler.render = [&worker](const FarmJob& job, std::vector<unsigned char>& rgba)
+        {
+            return renderJob(worker, job, rgba);
+        };
+        if (workerFd >= 0)
+            return serveFarm(workerFd, handler) ? 0 : FAIL_CTXT;
+        return listenFarm(listenPort, handler) ? 0 : FAIL_CTXT;
+    }
+
+    YAMLconfig config;
+    try
+    {
+        config.loadFile(configPath.c_str());
+    }
+    catch (const YAML::Exception& e)
+    {
+        std::cout << "ERROR::FARM:: cannot load " << configPath << ": " << e.what() << std::endl;
+        return EMPTY_CONF;
+    }
+    if (!config.isLoaded())
+    {
+        std::cout << "ERROR::FARM:: " << configPath << " holds no settings" << std::endl;
+        return EMPTY_CONF;
+    }
+    FarmSetup setup;
+    const std::vector<int> resolution = config.getValue<std::vector<int>>("resolution", std::vector<int>{ 1280, 720 });
+    const std::vector<float> mouse = config.getValue<std::vector<float>>("mouse", std::vector<float>{ 0.0f, 0.0f });
+    const std::vector<int> tile = config.getValue<std::vector<int>>("tile", std::vector<int>{ 0, 0 });
+    if (resolution.size() != 2 || resolution[0] <= 0 || resolution[1] <= 0 || mouse.size() != 2 || tile.size() != 2)
+    {
+        std::cout << "ERROR::FARM:: " << configPath << " has no valid resolution, mouse or tile" << std::endl;
+        return EMPTY_CONF;
+    }
+    setup.width = resolution[0];
+    setup.height = resolution[1];
+    setup.mouseX = mouse[0];
+    setup.mouseY = mouse[1];
+    setup.timeStart = config.getValue<float>("time_start", 0.0f);
+    setup.timeStep = config.getValue<float>("time_step", 1.0f / 60.0f);
+    setup.vertexPath = config.getValue<std::string>("vertex", "../shader/shader_vert/shadertoy_common_vs.glsl");
+    setup.fragmentPath = config.getValue<std::string>("fragment");
+    setup.library = config.getValue<std::string>("library", "../shader/shader_lib");
+    setup.quality = config.getValue<std::string>("quality", "");
+    setup.tier = config.getValue<std::string>("quality_tier", "");
+    ShaderDefines defines;
+    std::string error;
+    if (!hashSources(setup, setup.sourceHash, defines, error))
+    {
+        std::cout << "ERROR::FARM:: " << error << std::endl;
+        return EMPTY_FILE;
+    }
+    const int frameBeg = config.getValue<int>("frame_beg", 0);
+    const int frameEnd = config.getValue<int>("frame_end", 60);
+
+    // frames go to the video stream in order, or to one PPM each
+    const std::string outputDir = config.getValue<std::string>("output", "../output/farm");
+    const std::string videoPath = config.getValue<std::string>("video", "");
+    std::unique_ptr<VideoSink> video;
+    if (!videoPath.empty())
+    {
+        // the stream owns stdout, our messages move to stderr
+        if (videoPath == "-")
+            std::cout.rdbuf(std::cerr.rdbuf());
+        video.reset(new VideoSink());
+        if (!video->open(videoPath, setup.width, setup.height, int(std::lround(1.0f / setup.timeStep)), config.getValue<int>("video_queue", 4)))
+            return FAIL_WRIT;
+    }
+    else if (!ensureDirectory(outputDir))
+    {
+        std::cout << "ERROR::FARM:: cannot create " << outputDir << std::endl;
+        return FAIL_WRIT;
+    }
+
+    FarmCoordinator farm(setup);
+    farm.setDepth(config.getValue<int>("depth", 2));
+    farm.setReorder(config.getValue<int>("reorder", 16));
+    farm.setRetries(config.getValue<int>("retries", 3));
+    farm.setTimeout(config.getValue<double>("timeout", 30.0));
+    int localWorkers = config.getValue<int>("workers", 2);
+    if (localWorkers == 0)
+        localWorkers = std::max(1, int(std::thread::hardware_concurrency()));
+    for (int i = 0; i < localWorkers; ++i)
+        farm.addLocal({ argv[0], "--worker" });
+    for (const std::string& host : config.getValue<std::vector<std::string>>("hosts", std::vector<std::string>()))
+        farm.addRemote(host);
+    std::cout << "farm: " << setup.fragmentPath << (setup.tier.empty() ? "" : "[" + setup.tier + "]") << ", frames " << frameBeg
+              << " to " << frameEnd << " at " << setup.width << "x" << setup.height << " on " << farm.getWorkerCount() << " workers" << std::endl;
+
+    bool stored = true;
+    const int width = setup.width;
+    const int height = setup.height;
+    const FarmCoordinator::Consumer writeFrame = [&](int frame, const unsigned char* rgba)
+    {
+        stored = video ? video->push(rgba) : writePPM(framePath(outputDir, "frame_", frame), width, height, 4, rgba);
+        return stored;
+    };
+    const bool rendered = farm.run(splitFrames(frameBeg, frameEnd, width, height, tile[0], tile[1]), writeFrame);
+    if (video)
+    {
+        stored = video->close() && stored;
+        std::cout << "video: " << video->getStats().summary() << std::endl;
+    }
+    std::cout << "farm: " << farm.getStats().summary() << std::endl;
+    if (!rendered)
+        std::cout << "ERROR::FARM:: " << farm.getError() << std::endl;
+    if (!stored)
+        return FAIL_WRIT;
+    return rendered ? 0 : FAIL_CTXT;
+}
+
+// the hash every worker has to match: both sources expanded, and the
+// #defines of the tier, which the loader puts into the fragment shader
+bool hashSources(const FarmSetup& setup, unsigned long long& sourceHash, ShaderDefines& defines, std::string& error)
+{
+    defines.clear();
+    if (!setup.tier.empty())
+    {
+        QualityTiers tiers;
+        if (!tiers.load(setup.quality))
+        {
+            error = tiers.getError();
+            return false;
+        }
+        const int tier = tiers.find(setup.tier);
+        if (tier < 0)
+        {
+            error = "no quality tier '" + setup.tier + "' in " + setup.quality;
+            return false;
+        }
+        defines = tiers.definesFor(setup.fragmentPath, tier);
+    }
+    ShaderPreprocessor preprocessor(setup.library);
+    std::string vertexCode, fragmentCode;
+    if (!preprocessor.expand(setup.vertexPath, vertexCode) || !preprocessor.expand(setup.fragmentPath, fragmentCode))
+    {
+        error = "cannot read " + setup.vertexPath + " or " + setup.fragmentPath;
+        return false;
+    }
+    for (const std::pair<std::string, std::string>& define : defines)
+        fragmentCode += "\n#define " + define.first + " " + define.second;
+    sourceHash = ProgramCache::hashSources(vertexCode, fragmentCode);
+    return true;
+}
+
+bool setupWorker(FarmWorker& worker, const FarmSetup& setup, unsigned long long& sourceHash, std::string& error)
+{
+    ShaderDefines defines;
+    if (!hashSources(setup, sourceHash, defines, error))
+        return false;
+    if (!worker.hasContext)
+    {
+        if (!worker.context.create(3, 3) || !gladLoadGLLoader(HeadlessContext::getProcLoader()) || !worker.globals.create())
+        {
+            error = "no OpenGL 3.3 context";
+            return false;
+        }
+        worker.hasContext = true;
+    }
+    // a tile is drawn with the whole frame's viewport moved down and left by
+    // its corner, so it needs a viewport as large as the frame
+    GLint maxViewport[2] = { 0, 0 };
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+    if (setup.width > maxViewport[0] || setup.height > maxViewport[1])
+    {
+        error = "frames are limited to " + std::to_string(maxViewport[0]) + "x" + std::to_string(maxViewport[1]) + " here";
+        return false;
+    }
+
+    worker.preprocessor.reset(new ShaderPreprocessor(setup.library));
+    Shader::setPreprocessor(worker.preprocessor.get());
+    if (worker.shader)
+        worker.shader->release();
+    ShaderLoader loader;
+    ShaderFuture future = loader.request(setup.vertexPath, setup.fragmentPath, defines);
+    loader.wait(future);
+    worker.shader = future.take();
+    if (!worker.shader->isLinked())
+    {
+        error = setup.fragmentPath + " did not build";
+        return false;
+    }
+    if (worker.quadVAO)
+    {
+        glDeleteVertexArrays(1, &worker.quadVAO);
+        glDeleteBuffers(1, &worker.quadVBO);
+    }
+    worker.quadVAO = createScreenQuad(setup.width, setup.height, worker.quadVBO);
+    worker.setup = setup;
+    error = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    return true;
+}
+
+bool renderJob(FarmWorker& worker, const FarmJob& job, std::vector<unsigned char>& rgba)
+{
+    const FarmSetup& setup = worker.setup;
+    if (job.width > worker.target.getWidth() || job.height > worker.target.getHeight())
+    {
+        if (!worker.target.create(std::max(job.width, worker.target.getWidth()), std::max(job.height, worker.target.getHeight())))
+            return false;
+    }
+
+    // the same inputs for every tile of a frame, and on every worker
+    FrameInputs inputs;
+    inputs.time = setup.timeStart + job.frame * setup.timeStep;
+    inputs.timeDelta = setup.timeStep;
+    inputs.frame = job.frame;
+    inputs.mouse = glm::vec2(setup.mouseX, setup.mouseY);
+    inputs.date = glm::vec4(0.0f, 0.0f, 0.0f, inputs.time);
+    for (int view = 0; view < FRAME_VIEW_COUNT; ++view)
+        inputs.resolution[view] = glm::vec2(float(setup.width), float(setup.height));
+    worker.globals.update(inputs);
+
+    worker.target.bind();
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glViewport(-job.x, -job.y, setup.width, setup.height);
+    worker.shader->use();
+    glBindVertexArray(worker.quadVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, job.width, job.height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+    return glGetError() == GL_NO_ERROR;
+}
+
+unsigned int createScreenQuad(int width, int height, unsigned int& VBO)
+{
+    // the quad is given in pixels, shadertoy_common_vs maps it to NDC
+    std::vector<float> sqadVertices
+    {
+        // top    triangle
+        float(width), float(height), 0.0f,
+        float(width), 0.0f, 0.0f,
+        0.0f, 0.0f, 0.0f,
+        // bottom triangle
+        0.0f, 0.0f, 0.0f,
+        0.0f, float(height), 0.0f,
+        float(width), float(height), 0.0f
+    };
+    unsigned int VAO;
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sqadVertices.size() * sizeof(float), &sqadVertices[0], GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    return VAO;
+}
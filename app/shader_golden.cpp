@@ -0,0 +1,342 @@
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include "myImplement/shader.h"
+#include "myImplement/shader_loader.h"
+#include "myImplement/shader_preprocessor.h"
+#include "myImplement/shader_permutations.h"
+#include "myImplement/config.h"
+#include "myImplement/errorno.h"
+#include "myImplement/headless.h"
+#include "myImplement/render_target.h"
+#include "myImplement/frame_globals.h"
+#include "myImplement/frame_capture.h"
+#include "myImplement/image_io.h"
+#include "myImplement/image_diff.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// what a frame has to reach to pass against its golden image
+struct GoldenLimits
+{
+    float minPsnr;
+    float minSsim;
+    float minTileSsim;
+    int tileSize;
+    int errorMaps;  // error maps written per shader, for its first failing frames
+};
+
+// how one shader did over all its frames
+struct GoldenResult
+{
+    int compared;
+    int failed;
+    int missing;    // frames without a golden image
+    float worstPsnr;
+    float worstSsim;
+    float worstTileSsim;
+    std::vector<std::string> lines; // one per failing frame
+
+    GoldenResult() : compared(0), failed(0), missing(0), worstPsnr(99.0f), worstSsim(1.0f), worstTileSsim(1.0f) {}
+};
+
+// other utilities this harness will use
+unsigned int createScreenQuad(int width, int height, unsigned int& VBO);
+bool render(FrameGlobals& globals, Shader& shader, const glm::ivec2& size, const FrameInputs& prototype,
+            int frames, float timeStep, const FrameCapture::Consumer& consumer);
+bool compareFrame(int frame, const unsigned char* rgba, const glm::ivec2& size, const std::string& goldenDir,
+                  const std::string& outputDir, const GoldenLimits& limits, GoldenResult& result);
+
+// ! ================================== main ==================================
+// shader_golden [config] [--update] [--tier name]
+int main(int argc, char** argv)
+{
+    std::string configPath = "../config/golden.yaml";
+    bool update = false;
+    std::string tierName;
+    bool tierGiven = false;
+    const char* usage = "usage: shader_golden [config] [--update] [--tier name]";
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+        {
+            std::cout << usage << std::endl;
+            return 0;
+        }
+        else if (strcmp(argv[i], "--update") == 0)
+            update = true;
+        else if (strcmp(argv[i], "--tier") == 0 && hasValue)
+        {
+            tierName = argv[++i];
+            tierGiven = true;
+        }
+        else if (argv[i][0] == '-')
+        {
+            std::cout << "ERROR::GOLDEN:: " << (strcmp(argv[i], "--tier") == 0 ? "no value for " : "unknown option ") << argv[i]
+                      << std::endl << usage << std::endl;
+            return EMPTY_CONF;
+        }
+        else
+            configPath = argv[i];
+    }
+    YAMLconfig config;
+    try
+    {
+        config.loadFile(configPath.c_str());
+    }
+    catch (const YAML::Exception& e)
+    {
+        std::cout << "ERROR::GOLDEN:: cannot load " << configPath << ": " << e.what() << std::endl;
+        return EMPTY_CONF;
+    }
+    if (!config.isLoaded())
+    {
+        std::cout << "ERROR::GOLDEN:: " << configPath << " holds no settings" << std::endl;
+        return EMPTY_CONF;
+    }
+    if (!tierGiven)
+        tierName = config.getValue<std::string>("quality_tier", "");
+
+    const std::string vertexPath = config.getValue<std::string>("vertex", "../shader/shader_vert/shadertoy_common_vs.glsl");
+    const std::vector<std::string> shaders = config.getValue<std::vector<std::string>>("shaders", std::vector<std::string>());
+    const std::vector<int> resolution = config.getValue<std::vector<int>>("resolution", std::vector<int>{ 320, 180 });
+    const std::vector<float> mouse = config.getValue<std::vector<float>>("mouse", std::vector<float>{ 0.0f, 0.0f });
+    const int frames = std::max(config.getValue<int>("frames", 60), 1);
+    const float timeStep = config.getValue<float>("time_step", 1.0f / 60.0f);
+    const std::string goldenDir = config.getValue<std::string>("golden", "../golden");
+    const std::string outputDir = config.getValue<std::string>("output", "../output/golden");
+    GoldenLimits limits;
+    limits.minPsnr = config.getValue<float>("min_psnr", 40.0f);
+    limits.minSsim = config.getValue<float>("min_ssim", 0.99f);
+    limits.minTileSsim = config.getValue<float>("min_tile_ssim", 0.95f);
+    limits.tileSize = config.getValue<int>("tile", 32);
+    limits.errorMaps = config.getValue<int>("error_maps", 4);
+    if (shaders.empty() || resolution.size() != 2 || resolution[0] <= 0 || resolution[1] <= 0 || mouse.size() != 2)
+    {
+        std::cout << "ERROR::GOLDEN:: " << configPath << " lists no shaders, or no valid resolution or mouse" << std::endl;
+        return EMPTY_CONF;
+    }
+    const glm::ivec2 size(resolution[0], resolution[1]);
+
+    HeadlessContext context;
+    if (!context.create(3, 3))
+        return FAIL_CTXT;
+    if (!gladLoadGLLoader(HeadlessContext::getProcLoader()))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return FAIL_CTXT;
+    }
+    std::cout << "golden renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+    ShaderPreprocessor preprocessor(config.getValue<std::string>("library", "../shader/shader_lib"));
+    Shader::setPreprocessor(&preprocessor);
+    // a tier renders against the goldens of the shader as written, to see what it costs
+    QualityTiers tiers;
+    const std::string qualityPath = config.getValue<std::string>("quality", "");
+    if (!qualityPath.empty() && !tiers.load(qualityPath))
+        std::cout << "ERROR::QUALITY:: " << tiers.getError() << std::endl;
+    const int tier = tierName.empty() ? -1 : tiers.find(tierName);
+    if (!tierName.empty() && tier < 0)
+    {
+        std::cout << "ERROR::GOLDEN:: no quality tier '" << tierName << "'" << std::endl;
+        return EMPTY_CONF;
+    }
+    if (update && tier >= 0)
+    {
+        std::cout << "ERROR::GOLDEN:: goldens are rendered from the shaders as written, not at a tier" << std::endl;
+        return EMPTY_CONF;
+    }
+    ShaderLoader loader;
+    FrameGlobals globals;
+    if (!globals.create())
+        return FAIL_CTXT;
+    if (!ensureDirectory(goldenDir) || (!update && !ensureDirectory(outputDir)))
+    {
+        std::cout << "ERROR::GOLDEN:: cannot create " << goldenDir << " or " << outputDir << std::endl;
+        return FAIL_WRIT;
+    }
+
+    // everything the frames depend on is fixed: time, mouse, date and size
+    FrameInputs prototype;
+    prototype.time = config.getValue<float>("time_start", 0.0f);
+    prototype.timeDelta = timeStep;
+    prototype.mouse = glm::vec2(mouse[0], mouse[1]);
+    prototype.date = glm::vec4(0.0f, 0.0f, 0.0f, prototype.time);
+    for (int view = 0; view < FRAME_VIEW_COUNT; ++view)
+        prototype.resolution[view] = glm::vec2(float(size.x), float(size.y));
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool built = true;
+    bool stored = true;
+    int failedShaders = 0;
+    for (const std::string& fragmentPath : shaders)
+    {
+        const size_t slash = fragmentPath.find_last_of('/');
+        std::string name = slash == std::string::npos ? fragmentPath : fragmentPath.substr(slash + 1);
+        name = name.substr(0, name.find_last_of('.'));
+        ShaderFuture future = loader.request(vertexPath, fragmentPath, tier >= 0 ? tiers.definesFor(fragmentPath, tier) : ShaderDefines());
+        loader.wait(future);
+        std::unique_ptr<Shader> shader = future.take();
+        if (!shader->isLinked())
+        {
+            std::cout << "ERROR::GOLDEN:: " << fragmentPath << " did not build, skipped" << std::endl;
+            shader->release();
+            built = false;
+            continue;
+        }
+
+        const std::string shaderGolden = goldenDir + "/" + name;
+        const std::string shaderOutput = outputDir + "/" + name;
+        if (!ensureDirectory(shaderGolden) || (!update && !ensureDirectory(shaderOutput)))
+        {
+            std::cout << "ERROR::GOLDEN:: cannot create " << shaderGolden << " or " << shaderOutput << std::endl;
+            shader->release();
+            stored = false;
+            continue;
+        }
+
+        if (update)
+        {
+            const FrameCapture::Consumer writeGolden = [&](int frame, const unsigned char* rgba)
+            {
+                return writePPM(framePath(shaderGolden, "frame_", frame), size.x, size.y, 4, rgba);
+            };
+            stored = render(globals, *shader, size, prototype, frames, timeStep, writeGolden) && stored;
+            std::cout << name << ": " << frames << " golden frames written to " << shaderGolden << std::endl;
+            shader->release();
+            continue;
+        }
+
+        // only the capture thread touches 'result' until render() has finished it
+        GoldenResult result;
+        const FrameCapture::Consumer compare = [&](int frame, const unsigned char* rgba)
+        {
+            return compareFrame(frame, rgba, size, shaderGolden, shaderOutput, limits, result);
+        };
+        stored = render(globals, *shader, size, prototype, frames, timeStep, compare) && stored;
+        shader->release();
+
+        for (const std::string& line : result.lines)
+            std::cout << "  " << line << std::endl;
+        char line[200];
+        snprintf(line, sizeof(line), "%-44s %3d frames, %3d failed, %3d missing, worst PSNR %6.2f dB, SSIM %.5f, tile SSIM %.4f",
+                 (name + (tierName.empty() ? "" : "[" + tierName + "]")).c_str(), result.compared, result.failed, result.missing,
+                 result.worstPsnr, result.worstSsim, result.worstTileSsim);
+        std::cout << line << std::endl;
+        if (result.failed > 0 || result.missing > 0)
+            ++failedShaders;
+    }
+    const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "golden: " << shaders.size() << " shaders x " << frames << " frames in " << seconds << " s";
+    if (!update)
+        std::cout << ", " << failedShaders << " with visual regressions";
+    std::cout << std::endl;
+
+    if (!stored)
+        return FAIL_WRIT;
+    if (!built)
+        return FAIL_SHDR;
+    return failedShaders > 0 ? FAIL_DIFF : 0;
+}
+
+// draw 'frames' frames of 'shader' at a fixed iTime step and hand each to
+// 'consumer' on the capture thread while the next ones render; false if
+// the consumer failed on any
+bool render(FrameGlobals& globals, Shader& shader, const glm::ivec2& size, const FrameInputs& prototype,
+            int frames, float timeStep, const FrameCapture::Consumer& consumer)
+{
+    RenderTarget target(size.x, size.y);
+    unsigned int quadVBO;
+    const unsigned int quadVAO = createScreenQuad(size.x, size.y, quadVBO);
+    FrameCapture capture(size.x, size.y, 3, false, consumer);
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        FrameInputs inputs = prototype;
+        inputs.time = prototype.time + frame * timeStep;
+        inputs.frame = frame;
+        inputs.date.w = inputs.time;
+        globals.update(inputs);
+
+        target.bind();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        shader.use();
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        capture.capture(target.getFBO(), GL_COLOR_ATTACHMENT0, frame);
+    }
+    capture.finish();
+    glDeleteVertexArrays(1, &quadVAO);
+    glDeleteBuffers(1, &quadVBO);
+    return capture.getStats().failed == 0;
+}
+
+// compare one frame with its golden image, false only if an error map
+// could not be written; a frame that differs is counted in 'result'
+bool compareFrame(int frame, const unsigned char* rgba, const glm::ivec2& size, const std::string& goldenDir,
+                  const std::string& outputDir, const GoldenLimits& limits, GoldenResult& result)
+{
+    int width = 0, height = 0;
+    std::vector<unsigned char> golden;
+    if (!readPPM(framePath(goldenDir, "frame_", frame), width, height, golden) || width != size.x || height != size.y)
+    {
+        if (result.missing++ == 0)
+            result.lines.push_back("no " + std::to_string(size.x) + "x" + std::to_string(size.y) + " golden " +
+                                   framePath(goldenDir, "frame_", frame) + ", run with --update");
+        return true;
+    }
+    const ImageDiff diff = diffImages(rgba, golden.data(), width, height, limits.tileSize);
+    const TileError* worst = diff.worstTile();
+    ++result.compared;
+    result.worstPsnr = std::min(result.worstPsnr, diff.psnr);
+    result.worstSsim = std::min(result.worstSsim, diff.ssim);
+    result.worstTileSsim = std::min(result.worstTileSsim, worst->ssim);
+    if (diff.psnr >= limits.minPsnr && diff.ssim >= limits.minSsim && worst->ssim >= limits.minTileSsim)
+        return true;
+
+    ++result.failed;
+    std::string line = "frame " + std::to_string(frame) + ": " + diff.summary();
+    if (result.failed > limits.errorMaps)
+    {
+        result.lines.push_back(line);
+        return true;
+    }
+    const std::string mapPath = framePath(outputDir, "error_", frame);
+    const bool written = writeErrorMap(mapPath, diff, rgba, golden.data()) &&
+                         writePPM(framePath(outputDir, "frame_", frame), width, height, 4, rgba);
+    result.lines.push_back(line + (written ? ", see " + mapPath : ", cannot write " + mapPath));
+    return written;
+}
+
+unsigned int createScreenQuad(int width, int height, unsigned int& VBO)
+{
+    // the quad is given in pixels, shadertoy_common_vs maps it to NDC
+    std::vector<float> sqadVertices
+    {
+        // top    triangle
+        float(width), float(height), 0.0f,
+        float(width), 0.0f, 0.0f,
+        0.0f, 0.0f, 0.0f,
+        // bottom triangle
+        0.0f, 0.0f, 0.0f,
+        0.0f, float(height), 0.0f,
+        float(width), float(height), 0.0f
+    };
+    unsigned int VAO;
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sqadVertices.size() * sizeof(float), &sqadVertices[0], GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    return VAO;
+}
@@ -6,9 +6,29 @@
 #include "stb_image/stb_image.h"
 
 #include "myImplement/shader.h"
+#include "myImplement/shader_loader.h"
 #include "myImplement/camera.h"
 #include "myImplement/config.h"
 #include "myImplement/errorno.h"
+#include "myImplement/headless.h"
+#include "myImplement/render_target.h"
+#include "myImplement/image_io.h"
+#include "myImplement/cpu_shader.h"
+#include "myImplement/vm_shader.h"
+#include "myImplement/dynamic_resolution.h"
+#include "myImplement/quality_controller.h"
+#include "myImplement/frame_profiler.h"
+#include "myImplement/render_graph.h"
+#include "myImplement/frame_globals.h"
+#include "myImplement/file_watcher.h"
+#include "myImplement/shader_preprocessor.h"
+#include "myImplement/shader_permutations.h"
+#include "myImplement/frame_capture.h"
+#include "myImplement/video_sink.h"
+#include "myImplement/shm_ring.h"
+#include "myImplement/step_heatmap.h"
+#include "myImplement/input_record.h"
+#include "myImplement/bench_report.h"
 
 #include <iostream>
 #include <fstream>
@@ -16,17 +36,37 @@
 #include <string>
 #include <random>
 #include <ctime>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <memory>
 
 
 // callback functions
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+void refresh_callback(GLFWwindow* window);
 void processInput(GLFWwindow* window);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scrol_callback(GLFWwindow* window, double xoff, double yoff);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+// what the callbacks do with an event, live or replayed
+void moveMouse(double xpos, double ypos);
+void pressKey(int key);
+unsigned int keysHeld(GLFWwindow* window);
 
 // other utilities this demo will use
 std::vector<float> readFloats(const char* filePath);
 unsigned int loadTexture(const char* imagePath);
+unsigned int createScreenQuad(int width, int height, unsigned int& VBO);
+int runHeadless(YAMLconfig& config);
+std::unique_ptr<RenderGraph> loadGraph(YAMLconfig& config, int width, int height, unsigned int quadVAO, ShaderLoader& loader,
+                                       const QualityTiers& tiers, int tier);
+void openProgramCache(YAMLconfig& config, ProgramCache& cache, GLADloadproc loader);
+int loadQualityTiers(YAMLconfig& config, QualityTiers& tiers);
+std::unique_ptr<FrameProfiler> openProfiler(YAMLconfig& config);
+void reportProfile(YAMLconfig& config, const FrameProfiler& profiler);
+bool readsClock(const Shader& shader);
 
 // global variable
 camera testCam;
@@ -35,11 +75,40 @@ float mousePosY = 0.0f;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 float currFrame = 0.0f;
+// the window needs a redraw whatever the shader inputs say
+bool frameDirty = true;
+// quality tier picked with the number keys, -1 once handled
+int qualityKey = -1;
+// H was pressed, the step heatmap goes on or off
+bool heatmapKey = false;
+// the movement keys held for this frame, as bits
+enum { MOVE_W = 1, MOVE_S = 2, MOVE_A = 4, MOVE_D = 8 };
+unsigned int heldKeys = 0;
+// input log: a live window writes its input to the recorder, a replay
+// takes it from the log and ignores the live one
+InputRecorder inputRecorder;
+InputReplay inputReplay;
 
 // ! ================================== main ==================================
 int main(int argc, char** argv)
 {
     YAMLconfig config("../config/shadertoy.yaml");
+    // no window, no display: render the frame range off-screen and dump it
+    bool headless = config.getValue<bool>("HEADLESS", false);
+    std::string recordPath = config.getValue<std::string>("INPUT_RECORD", "");
+    std::string replayPath = config.getValue<std::string>("INPUT_REPLAY", "");
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replayPath = argv[++i];
+    }
+    if (headless)
+        return runHeadless(config);
+
     const int WINDOW_WID = config.getValue<int>("WINDOW_WID");
     const int WINDOW_HEI = config.getValue<int>("WINDOW_HEI");
 
@@ -72,8 +141,10 @@ int main(int argc, char** argv)
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     // callback preparation
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetWindowRefreshCallback(window, refresh_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scrol_callback);
+    glfwSetKeyCallback(window, key_callback);
 
     // glad preparation
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -86,13 +157,19 @@ int main(int argc, char** argv)
     stbi_set_flip_vertically_on_load(true);
     glEnable(GL_DEPTH_TEST);
 
-    // shader preparation
-    Shader mainShader(
-        // vertex shader
-        config.getValue<std::string>("main_vs").c_str(),
-        // fragment shader
-        config.getValue<std::string>("main_fs").c_str()
-    );
+    ProgramCache programCache;
+    openProgramCache(config, programCache, (GLADloadproc)glfwGetProcAddress);
+    ShaderPreprocessor preprocessor(config.getValue<std::string>("SHADER_LIBRARY", "../shader/shader_lib"));
+    Shader::setPreprocessor(&preprocessor);
+
+    // shader preparation: the programs the loop needs build in the background
+    const std::string mainVs = config.getValue<std::string>("main_vs");
+    const std::string mainFs = config.getValue<std::string>("main_fs");
+    QualityTiers qualityTiers;
+    const int startTier = loadQualityTiers(config, qualityTiers);
+    ShaderLoader shaderLoader;
+    ShaderPermutations mainProgram(shaderLoader, mainVs, mainFs, &qualityTiers, startTier);
+    ShaderFuture upscaleFuture;
 
     Shader sqadShader(
         // vertex shader
@@ -103,17 +180,6 @@ int main(int argc, char** argv)
 
     // vertex data preparation
     std::vector<float> cubeVertices = std::move(readFloats(config.getValue<std::string>("simple_cube").c_str()));
-    std::vector<float> sqadVertices
-    {
-        // top    triangle
-        float(WINDOW_WID), float(WINDOW_HEI), 0.0f,
-        float(WINDOW_WID), 0.0f, 0.0f,
-        0.0f, 0.0f, 0.0f,
-        // bottom triangle
-        0.0f, 0.0f, 0.0f,
-        0.0f, float(WINDOW_HEI), 0.0f,
-        float(WINDOW_WID), float(WINDOW_HEI), 0.0f
-    };
     // world space positions of our cubes
     std::vector<glm::vec3> cube_positions {
         glm::vec3( 0.0f,  0.0f,  0.0f),
@@ -143,16 +209,18 @@ int main(int argc, char** argv)
     glEnableVertexAttribArray(1);
     glBindVertexArray(0);
     // screen square
-    unsigned int sqadVAO;
-    glGenVertexArrays(1, &sqadVAO);
-    glBindVertexArray(sqadVAO);
     unsigned int sqadVBO;
-    glGenBuffers(1, &sqadVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, sqadVBO);
-    glBufferData(GL_ARRAY_BUFFER, sqadVertices.size() * sizeof(float), &sqadVertices[0], GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glBindVertexArray(0);
+    unsigned int sqadVAO = createScreenQuad(WINDOW_WID, WINDOW_HEI, sqadVBO);
+
+    // a pass graph replaces main_fs with Buffer passes feeding an Image pass
+    std::unique_ptr<RenderGraph> graph = loadGraph(config, WINDOW_WID, WINDOW_HEI, sqadVAO, shaderLoader, qualityTiers, startTier);
+    if (!config.getValue<std::string>("MULTIPASS", "").empty() && !graph)
+        return FAIL_SHDR;
+    // iTime, iResolution and friends, one upload per frame for every program
+    FrameGlobals globals;
+    if (!globals.create())
+        return FAIL_CTXT;
+    int frameIndex = 0;
 
     // render buffer object
     unsigned int FBO;
@@ -180,36 +248,467 @@ int main(int argc, char** argv)
     unsigned int texture1 = loadTexture(config.getValue<std::string>("image_container").c_str());
     unsigned int texture2 = loadTexture(config.getValue<std::string>("image_awesomeface").c_str());
 
+    // dynamic resolution: the shader pass renders into sceneTarget at a scale
+    // picked from its GPU time, then gets upscaled to the window
+    std::unique_ptr<DynamicResolution> resolution;
+    std::unique_ptr<Shader> upscaleShader;
+    Uniform<glm::vec2> upscaleSize;
+    RenderTarget sceneTarget;
+    const bool qualityControl = config.getValue<bool>("QUALITY_CONTROL", false);
+    if (config.getValue<bool>("DYNRES", false) || qualityControl)
+    {
+        resolution.reset(new DynamicResolution(
+            config.getValue<float>("DYNRES_TARGET_MS", 16.0f),
+            config.getValue<float>("DYNRES_MIN_SCALE", 0.5f),
+            config.getValue<float>("DYNRES_MAX_SCALE", 1.0f),
+            config.getValue<float>("DYNRES_HYSTERESIS", 0.1f)
+        ));
+        upscaleFuture = shaderLoader.request(
+            config.getValue<std::string>("main_vs"),
+            config.getValue<std::string>("upscale_fs")
+        );
+        // sized for the largest scale, smaller frames use its lower left corner
+        sceneTarget.create(
+            int(std::ceil(WINDOW_WID * resolution->getScale())),
+            int(std::ceil(WINDOW_HEI * resolution->getScale())),
+            GL_RGBA8, false
+        );
+    }
+    // quality control: the quality tier follows the frame time too, once
+    // the scale alone cannot keep it on target
+    std::unique_ptr<QualityController> controller;
+    if (qualityControl)
+    {
+        controller.reset(new QualityController(
+            config.getValue<float>("DYNRES_TARGET_MS", 16.0f),
+            qualityTiers.getCount(), mainProgram.getSelectedTier(),
+            config.getValue<float>("DYNRES_HYSTERESIS", 0.1f),
+            config.getValue<int>("QUALITY_CONTROL_DWELL", 30)
+        ));
+        const std::string controlLog = config.getValue<std::string>("QUALITY_CONTROL_LOG", "");
+        if (!controlLog.empty() && !controller->setLog(controlLog))
+            std::cout << "ERROR::QUALITY:: cannot open " << controlLog << std::endl;
+    }
+    float lastTitle = 0.0f;
+    std::unique_ptr<FrameProfiler> profiler = openProfiler(config);
+
+    // step heatmap: main_fs built again with its marked loops counted, the
+    // counts drawn over the frame and their histogram printed every second
+    std::unique_ptr<StepHeatmap> heatmap;
+    ShaderFuture countedFuture;
+    ShaderFuture overlayFuture;
+    std::unique_ptr<Shader> countedShader;
+    std::unique_ptr<Shader> overlayShader;
+    const float heatmapOpacity = config.getValue<float>("STEP_HEATMAP_OPACITY", 0.7f);
+    float lastHistogram = 0.0f;
+    heatmapKey = config.getValue<bool>("STEP_HEATMAP", false);
+    int profiledFrame = 0;
+
+    // recording: every presented frame goes through the readback ring, to
+    // files and/or the shared memory ring
+    std::unique_ptr<FrameCapture> recorder;
+    const std::string recordDir = config.getValue<std::string>("CAPTURE_WINDOW", "");
+    const std::string shmName = config.getValue<std::string>("SHM_RING", "");
+    ShmFrameWriter shmRing;
+    int recordFrame = 0;
+    if (!recordDir.empty() || !shmName.empty())
+    {
+        if (!recordDir.empty() && !ensureDirectory(recordDir))
+        {
+            std::cout << "ERROR::FRAME_CAPTURE:: cannot create " << recordDir << std::endl;
+            return FAIL_WRIT;
+        }
+        int recordWid, recordHei;
+        glfwGetFramebufferSize(window, &recordWid, &recordHei);
+        if (!shmName.empty() && !shmRing.open(shmName, recordWid, recordHei, config.getValue<int>("SHM_RING_SLOTS", 4)))
+            return FAIL_WRIT;
+        ShmFrameWriter* ring = shmRing.isOpen() ? &shmRing : nullptr;
+        recorder.reset(new FrameCapture(
+            recordWid, recordHei,
+            std::max(config.getValue<int>("CAPTURE_RING", 3), 1),
+            config.getValue<bool>("CAPTURE_DROP", true),
+            [recordDir, recordWid, recordHei, ring](int frame, const unsigned char* rgba)
+            {
+                if (ring)
+                    ring->publish(rgba, frame, glfwGetTime());
+                return recordDir.empty() || writePPM(framePath(recordDir, "frame_", frame), recordWid, recordHei, 4, rgba);
+            }
+        ));
+    }
+
+    // render on demand: only the clock, the frame counter and the mouse
+    // change on their own, a program that reads none of them gives the
+    // same frame until the window does
+    const bool renderOnDemand = config.getValue<bool>("RENDER_ON_DEMAND", true);
+    Shader* mainShader = nullptr;
+    bool usesTime = false;
+    bool usesMouse = false;
+    glm::vec2 drawnSize(0.0f, 0.0f);
+    glm::vec2 drawnMouse(-1.0f, -1.0f);
+
+    // hot reload: an edited shader builds in the background while the old
+    // program keeps drawing, and replaces it between frames if it links
+    FileWatcher watcher;
+    std::vector<std::string> changedFiles;
+    std::vector<std::string> sources;
+    if (config.getValue<bool>("HOT_RELOAD", true))
+    {
+        sources = graph ? graph->getSources() : std::vector<std::string>();
+        sources.push_back(mainVs);
+        sources.push_back(mainFs);
+        for (const std::string& path : sources)
+            watcher.watch(path);
+    }
+    // the files the sources include are known once they were read, and
+    // change with them
+    auto watchIncludes = [&]()
+    {
+        for (const std::string& path : sources)
+        {
+            for (const std::string& include : preprocessor.includesOf(path))
+                watcher.watch(include);
+        }
+    };
+
+    // input log: frames are logged, and replayed, from the first one that
+    // draws, however long the programs took to build. a replay runs at
+    // INPUT_REPLAY_STEP seconds a frame (0 keeps the logged clock), without
+    // vsync and drawing every frame, so its frame times compare across builds
+    const float replayStep = config.getValue<float>("INPUT_REPLAY_STEP", 1.0f / 60.0f);
+    std::vector<float> replayFrameMs;
+    float replayStart = 0.0f;
+    double lastFrameStart = 0.0;
+    if (!replayPath.empty())
+    {
+        if (!inputReplay.open(replayPath))
+            return EMPTY_FILE;
+        if (inputReplay.getWidth() != WINDOW_WID || inputReplay.getHeight() != WINDOW_HEI)
+            std::cout << "ERROR::INPUT_REPLAY:: " << replayPath << " was recorded at " << inputReplay.getWidth() << "x"
+                      << inputReplay.getHeight() << ", the window is " << WINDOW_WID << "x" << WINDOW_HEI << std::endl;
+        if (!recordPath.empty())
+            std::cout << "ERROR::INPUT_RECORD:: a replay is not recorded again, ignoring " << recordPath << std::endl;
+        glfwSwapInterval(0);
+    }
+    if (!replayPath.empty() || !recordPath.empty())
+    {
+        mainProgram.wait();
+        shaderLoader.waitAll();
+    }
+    if (replayPath.empty() && !recordPath.empty() && !inputRecorder.open(recordPath, WINDOW_WID, WINDOW_HEI, FrameInputs::dateNow()))
+        return FAIL_WRIT;
+
     while (!glfwWindowShouldClose(window))
     {
-        currFrame = glfwGetTime();
+        const double frameStart = glfwGetTime();
+        if (inputReplay.isOpen())
+        {
+            // the logged events go where the callbacks would send them
+            InputFrame logged;
+            if (!inputReplay.next(logged))
+                break;
+            currFrame = replayStep > 0.0f ? replayStep * inputReplay.getPosition() : float(logged.time);
+            if (inputReplay.getPosition() == 1)
+                replayStart = currFrame;
+            else
+                replayFrameMs.push_back(float(frameStart - lastFrameStart) * 1000.0f);
+            heldKeys = logged.keys;
+            for (const InputEvent& event : logged.events)
+            {
+                if (event.type == INPUT_MOUSE)
+                    moveMouse(event.x, event.y);
+                else if (event.type == INPUT_SCROLL)
+                    testCam.updateZoom(event.x, event.y);
+                else if (event.type == INPUT_KEY)
+                    pressKey(event.key);
+            }
+        }
+        else
+        {
+            currFrame = float(frameStart);
+            heldKeys = keysHeld(window);
+            inputRecorder.frame(currFrame, heldKeys);
+        }
+        lastFrameStart = frameStart;
         deltaTime = currFrame - lastFrame;
         lastFrame = currFrame;
-        processInput(window);
-
-        // glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        // clear screen and set background colour
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glClear(GL_COLOR_BUFFER_BIT);
-        glClear(GL_DEPTH_BUFFER_BIT);
-
-        mainShader.use();
-        glBindVertexArray(sqadVAO);
-        mainShader.setFloat(
-            "iTime", 
-            glfwGetTime()
-        );
-        mainShader.setVec2(
-            "iResolution", 
-            glm::vec2(float(WINDOW_WID), float(WINDOW_HEI))
-        );
-        mainShader.setVec2(
-            "iMousePos",
-            glm::vec2(mousePosX, mousePosY)
-        );
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        if (profiler)
+            profiler->beginFrame(profiledFrame++);
+        {
+            FrameProfiler::Scope phase(profiler.get(), "input");
+            processInput(window);
+        }
+
+        // until its programs are built the window shows the clear colour, but keeps responding
+        if (!mainShader)
+        {
+            shaderLoader.poll();
+            mainProgram.update();
+            if (!mainProgram.get() || (upscaleFuture.isValid() && !upscaleFuture.isReady()))
+            {
+                glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+                if (profiler)
+                    profiler->endFrame();
+                continue;
+            }
+            mainShader = mainProgram.get();
+            if (upscaleFuture.isValid())
+            {
+                upscaleShader = upscaleFuture.take();
+                // the sampler never changes unit, the source size is set per frame
+                upscaleShader->use();
+                upscaleShader->set(upscaleShader->uniform<int>("sourceTex"), 0);
+                upscaleSize = upscaleShader->uniform<glm::vec2>("sourceSize");
+            }
+            usesTime = readsClock(*mainShader);
+            usesMouse = mainShader->isUniformActive("iMousePos");
+            std::cout << "shaders: " << shaderLoader.getStats().summary() << std::endl;
+            std::cout << "preprocessor: " << preprocessor.getStats().summary() << std::endl;
+            if (programCache.isEnabled())
+                std::cout << "program cache: " << programCache.getStats().summary() << std::endl;
+            if (watcher.isWatching())
+                watchIncludes();
+        }
+        // edits, tier switches and finished builds
+        if (profiler)
+            profiler->begin("reload");
+        if (watcher.isWatching())
+        {
+            watcher.poll(changedFiles);
+            // an edited include rebuilds every source that pulled it in
+            std::vector<std::string> edited;
+            for (const std::string& path : changedFiles)
+            {
+                std::vector<std::string> includers = preprocessor.includersOf(path);
+                includers.push_back(path);
+                for (const std::string& source : includers)
+                {
+                    if (std::find(edited.begin(), edited.end(), source) == edited.end())
+                        edited.push_back(source);
+                }
+            }
+            if (std::find(edited.begin(), edited.end(), mainVs) != edited.end() ||
+                std::find(edited.begin(), edited.end(), mainFs) != edited.end())
+                mainProgram.reload();
+            for (const std::string& path : edited)
+            {
+                if (graph)
+                    graph->rebuild(path);
+            }
+        }
+        // the number keys pick a quality tier, one that was not needed yet
+        // builds in the background while the current one keeps drawing
+        if (qualityKey >= 0)
+        {
+            if (qualityKey < qualityTiers.getCount())
+            {
+                mainProgram.select(qualityKey);
+                if (graph)
+                    graph->selectTier(qualityKey);
+                if (controller)
+                    controller->setTier(currFrame, qualityKey);
+                std::cout << "quality: " << qualityTiers.getName(qualityKey) << " selected" << std::endl;
+            }
+            qualityKey = -1;
+        }
+        if (heatmapKey)
+        {
+            heatmapKey = false;
+            frameDirty = true;
+            if (graph)
+                std::cout << "heatmap: only main_fs is counted, not a MULTIPASS graph" << std::endl;
+            else if (heatmap)
+            {
+                heatmap.reset();
+                if (countedShader)
+                    countedShader->release();
+                countedShader.reset();
+                countedFuture = ShaderFuture();
+                std::cout << "heatmap: off" << std::endl;
+            }
+            else
+            {
+                heatmap.reset(new StepHeatmap(std::max(WINDOW_WID, sceneTarget.getWidth()), std::max(WINDOW_HEI, sceneTarget.getHeight()),
+                                              config.getValue<int>("STEP_HEATMAP_BUDGET", 200)));
+                countedFuture = shaderLoader.request(mainVs, mainFs, qualityTiers.definesFor(mainFs, mainProgram.getTier()), true);
+                if (!overlayShader && !overlayFuture.isValid())
+                    overlayFuture = shaderLoader.request(mainVs, config.getValue<std::string>("heatmap_fs"));
+            }
+        }
+        shaderLoader.poll();
+        // the counted program follows main_fs through reloads and tier switches
+        if (countedFuture.isReady())
+        {
+            if (countedShader)
+                countedShader->release();
+            countedShader = countedFuture.take();
+            countedFuture = ShaderFuture();
+            frameDirty = true;
+        }
+        if (overlayFuture.isReady())
+        {
+            overlayShader = overlayFuture.take();
+            overlayFuture = ShaderFuture();
+        }
+        const int drawnTier = mainProgram.getTier();
+        if (mainProgram.update())
+        {
+            mainShader = mainProgram.get();
+            usesTime = readsClock(*mainShader);
+            usesMouse = mainShader->isUniformActive("iMousePos");
+            frameDirty = true;
+            if (resolution)
+                resolution->restart();
+            if (watcher.isWatching())
+                watchIncludes();
+            if (mainProgram.getTier() != drawnTier)
+                std::cout << "quality: " << qualityTiers.getName(mainProgram.getTier()) << " for " << mainFs << std::endl;
+            else
+                std::cout << "reloaded " << mainFs << std::endl;
+            if (heatmap)
+                countedFuture = shaderLoader.request(mainVs, mainFs, qualityTiers.definesFor(mainFs, mainProgram.getTier()), true);
+        }
+        if (graph && graph->update())
+        {
+            if (resolution)
+                resolution->restart();
+            if (watcher.isWatching())
+                watchIncludes();
+        }
+        if (profiler)
+            profiler->end();
+
+        // the scaled pass draws the same pixel sized quad, a smaller
+        // iResolution maps its lower left corner onto the smaller viewport
+        float scale = 1.0f;
+        int sceneWid = WINDOW_WID;
+        int sceneHei = WINDOW_HEI;
+        if (resolution)
+        {
+            scale = resolution->getScale();
+            sceneWid = std::max(1, int(WINDOW_WID * scale + 0.5f));
+            sceneHei = std::max(1, int(WINDOW_HEI * scale + 0.5f));
+        }
+        const glm::vec2 sceneSize = glm::vec2(float(sceneWid), float(sceneHei));
+        const glm::vec2 mouse = glm::vec2(mousePosX, mousePosY) * scale;
+        if (renderOnDemand && !inputReplay.isOpen() && !graph && !frameDirty && !usesTime && sceneSize == drawnSize && (!usesMouse || mouse == drawnMouse))
+        {
+            // the last frame is still on screen, sleep until something happens
+            if (recorder)
+                recorder->poll();
+            // a watched file may change, or a program finish building,
+            // without any event, wake up to look
+            if (profiler)
+                profiler->endFrame();
+            if (watcher.isWatching() || !shaderLoader.isIdle())
+                glfwWaitEventsTimeout(0.05);
+            else
+                glfwWaitEvents();
+            continue;
+        }
+        frameDirty = false;
+
+        FrameInputs inputs;
+        inputs.time = currFrame;
+        inputs.timeDelta = deltaTime;
+        inputs.frame = frameIndex++;
+        inputs.mouse = mouse;
+        // a replay's date moves with its clock, from the one it was recorded on
+        inputs.date = FrameInputs::dateNow();
+        if (inputReplay.isOpen())
+            inputs.date = inputReplay.getDate() + glm::vec4(0.0f, 0.0f, 0.0f, currFrame - replayStart);
+        inputs.resolution[FRAME_VIEW_SCENE] = sceneSize;
+        inputs.resolution[FRAME_VIEW_BUFFER] = graph ? glm::vec2(float(graph->getWidth()), float(graph->getHeight())) : sceneSize;
+        inputs.resolution[FRAME_VIEW_WINDOW] = glm::vec2(float(WINDOW_WID), float(WINDOW_HEI));
+        {
+            FrameProfiler::Scope phase(profiler.get(), "uniforms");
+            globals.update(inputs);
+        }
+
+        if (profiler)
+            profiler->begin("draw");
+        // the counted program draws into the heatmap's target, instead of the scaled scene
+        const bool drawHeatmap = heatmap && countedShader && overlayShader;
+        if (drawHeatmap)
+        {
+            heatmap->bind(sceneWid, sceneHei);
+        }
+        else if (resolution)
+        {
+            sceneTarget.bind();
+            glViewport(0, 0, sceneWid, sceneHei);
+            resolution->beginFrame();
+        }
+        else
+        {
+            // glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+        // clear screen and set background colour, the heatmap cleared its counts already
+        if (!drawHeatmap)
+        {
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glClear(GL_COLOR_BUFFER_BIT);
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+
+        if (graph)
+        {
+            graph->render(inputs.frame, globals, sceneWid, sceneHei);
+        }
+        else
+        {
+            (drawHeatmap ? countedShader.get() : mainShader)->use();
+            glBindVertexArray(sqadVAO);
+            drawnSize = sceneSize;
+            drawnMouse = mouse;
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        }
+        if (profiler)
+            profiler->end();
+
+        if (drawHeatmap)
+        {
+            FrameProfiler::Scope phase(profiler.get(), "heatmap");
+            int frameWid, frameHei;
+            glfwGetFramebufferSize(window, &frameWid, &frameHei);
+            RenderTarget::bindDefault(frameWid, frameHei);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            globals.bindView(FRAME_VIEW_WINDOW);
+            heatmap->present(*overlayShader, sceneWid, sceneHei, heatmapOpacity);
+            // the read back waits for the GPU, once a second is enough to follow the scene
+            if (currFrame - lastHistogram > 1.0f)
+            {
+                lastHistogram = currFrame;
+                std::cout << "heatmap: " << heatmap->collect(sceneWid, sceneHei).summary() << std::endl;
+            }
+        }
+        else if (resolution)
+        {
+            resolution->endFrame();
+            FrameProfiler::Scope phase(profiler.get(), "upscale");
+            int frameWid, frameHei;
+            glfwGetFramebufferSize(window, &frameWid, &frameHei);
+            RenderTarget::bindDefault(frameWid, frameHei);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            upscaleShader->use();
+            upscaleShader->set(upscaleSize, glm::vec2(float(sceneWid), float(sceneHei)));
+            globals.bindView(FRAME_VIEW_WINDOW);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, sceneTarget.getTexture());
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+
+            if (currFrame - lastTitle > 0.5f)
+            {
+                lastTitle = currFrame;
+                char title[64];
+                snprintf(title, sizeof(title), "LearnOpenGL %dx%d (%.2f ms)", sceneWid, sceneHei, resolution->getFrameMs());
+                glfwSetWindowTitle(window, title);
+            }
+        }
 
 
 
@@ -245,10 +744,69 @@ int main(int argc, char** argv)
         //     glDrawArrays(GL_TRIANGLES, 0, 36);
         // }
 
+        // the heatmap frames are not timed, the controller waits until it is off
+        if (controller && !drawHeatmap)
+        {
+            // the CPU side of the frame, up to the swap that may wait for vsync
+            const float cpuMs = float(glfwGetTime() - frameStart) * 1000.0f;
+            if (controller->submit(currFrame, resolution->getFrameMs(), cpuMs,
+                                   resolution->getScale(), resolution->getMinScale(), resolution->getMaxScale()))
+            {
+                mainProgram.select(controller->getTier());
+                if (graph)
+                    graph->selectTier(controller->getTier());
+            }
+            else if (controller->getPrewarm() >= 0)
+            {
+                mainProgram.prewarm(controller->getPrewarm());
+                if (graph)
+                    graph->prewarmTier(controller->getPrewarm());
+            }
+        }
+
+        if (recorder)
+        {
+            FrameProfiler::Scope phase(profiler.get(), "capture");
+            recorder->capture(0, GL_BACK, recordFrame++);
+        }
+
         // event bus
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        {
+            FrameProfiler::Scope phase(profiler.get(), "swap");
+            glfwSwapBuffers(window);
+        }
+        {
+            FrameProfiler::Scope phase(profiler.get(), "events");
+            glfwPollEvents();
+        }
+        if (profiler)
+            profiler->endFrame();
     }
+    if (recorder)
+    {
+        recorder->finish();
+        std::cout << "recorded to " << (recordDir.empty() ? shmName : recordDir) << ": " << recorder->getStats().summary() << std::endl;
+        recorder.reset();
+    }
+    if (controller)
+        std::cout << "quality control: " << controller->getStats().summary() << std::endl;
+    if (inputRecorder.isOpen())
+    {
+        const int logged = inputRecorder.getFrames();
+        if (inputRecorder.close())
+            std::cout << "input: recorded " << logged << " frames to " << recordPath << std::endl;
+    }
+    if (inputReplay.isOpen())
+    {
+        // a frame is timed from its start to the next one's, the last one has no next
+        const TimingSummary frameMs = TimingSummary::of(replayFrameMs);
+        char line[200];
+        snprintf(line, sizeof(line), "input: replayed %d of %d frames, frame ms mean %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f",
+                 inputReplay.getPosition(), inputReplay.getFrames(), frameMs.mean, frameMs.p50, frameMs.p95, frameMs.p99, frameMs.max);
+        std::cout << line << std::endl;
+    }
+    if (profiler)
+        reportProfile(config, *profiler);
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &cubeVAO);
@@ -263,24 +821,54 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     // callback function for when the shape of window is changed
     glViewport(0, 0, width, height);
+    frameDirty = true;
+}
+
+void refresh_callback(GLFWwindow* window)
+{
+    // the window system lost the contents, e.g. after being uncovered
+    frameDirty = true;
 }
 
 void processInput(GLFWwindow* window)
 {
+    // escape stays live, a replay can be cut short
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
     
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (heldKeys & MOVE_W)
         testCam.updatePosi(camera::CAMOVEMENT::FORD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (heldKeys & MOVE_S)
         testCam.updatePosi(camera::CAMOVEMENT::BACK, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (heldKeys & MOVE_A)
         testCam.updatePosi(camera::CAMOVEMENT::LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (heldKeys & MOVE_D)
         testCam.updatePosi(camera::CAMOVEMENT::RIGH, deltaTime);
 }
 
+unsigned int keysHeld(GLFWwindow* window)
+{
+    unsigned int keys = 0;
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        keys |= MOVE_W;
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        keys |= MOVE_S;
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        keys |= MOVE_A;
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        keys |= MOVE_D;
+    return keys;
+}
+
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
+{
+    if (inputReplay.isOpen())
+        return;
+    inputRecorder.mouse(xpos, ypos);
+    moveMouse(xpos, ypos);
+}
+
+void moveMouse(double xpos, double ypos)
 {
     // update the global mouse pos
     mousePosX = xpos;
@@ -290,9 +878,29 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 
 void scrol_callback(GLFWwindow* window, double xoff, double yoff)
 {
+    if (inputReplay.isOpen())
+        return;
+    inputRecorder.scroll(xoff, yoff);
     testCam.updateZoom(xoff, yoff);
 }
 
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (action != GLFW_PRESS || inputReplay.isOpen())
+        return;
+    inputRecorder.key(key);
+    pressKey(key);
+}
+
+void pressKey(int key)
+{
+    // 1..9 pick the quality tier, cheapest first
+    if (key >= GLFW_KEY_1 && key <= GLFW_KEY_9)
+        qualityKey = key - GLFW_KEY_1;
+    if (key == GLFW_KEY_H)
+        heatmapKey = true;
+}
+
 std::vector<float> readFloats(const char* file_path)
 {
     std::ifstream float_file;
@@ -350,3 +958,373 @@ unsigned int loadTexture(const char* imagePath)
     stbi_image_free(data);
     return texture;
 }
+
+unsigned int createScreenQuad(int width, int height, unsigned int& VBO)
+{
+    // the quad is given in pixels, shadertoy_common_vs maps it to NDC
+    std::vector<float> sqadVertices
+    {
+        // top    triangle
+        float(width), float(height), 0.0f,
+        float(width), 0.0f, 0.0f,
+        0.0f, 0.0f, 0.0f,
+        // bottom triangle
+        0.0f, 0.0f, 0.0f,
+        0.0f, float(height), 0.0f,
+        float(width), float(height), 0.0f
+    };
+    unsigned int VAO;
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    glGenBuffers(1, &VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sqadVertices.size() * sizeof(float), &sqadVertices[0], GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    return VAO;
+}
+
+int runHeadless(YAMLconfig& config)
+{
+    const int WINDOW_WID = config.getValue<int>("WINDOW_WID");
+    const int WINDOW_HEI = config.getValue<int>("WINDOW_HEI");
+    const int frameBeg = config.getValue<int>("HEADLESS_FRAME_BEG", 0);
+    const int frameEnd = config.getValue<int>("HEADLESS_FRAME_END", 60);
+    const float timeStep = config.getValue<float>("HEADLESS_TIME_STEP", 1.0f / 60.0f);
+    const std::string outputDir = config.getValue<std::string>("HEADLESS_OUTPUT", "../output");
+    const std::string videoPath = config.getValue<std::string>("HEADLESS_VIDEO", "");
+    if (videoPath.empty() && !ensureDirectory(outputDir))
+    {
+        std::cerr << "cannot create output directory: " << outputDir << std::endl;
+        return FAIL_WRIT;
+    }
+
+    // frames go to the video stream in order, or to one PPM each
+    std::unique_ptr<VideoSink> video;
+    if (!videoPath.empty())
+    {
+        // the stream owns stdout, our messages move to stderr
+        if (videoPath == "-")
+            std::cout.rdbuf(std::cerr.rdbuf());
+        video.reset(new VideoSink());
+        if (!video->open(videoPath, WINDOW_WID, WINDOW_HEI, int(std::lround(1.0f / timeStep)),
+                         config.getValue<int>("HEADLESS_VIDEO_QUEUE", 4)))
+            return FAIL_WRIT;
+    }
+    // or straight into the shared memory ring
+    const std::string shmName = config.getValue<std::string>("SHM_RING", "");
+    ShmFrameWriter shmRing;
+    if (!shmName.empty() && !shmRing.open(shmName, WINDOW_WID, WINDOW_HEI, config.getValue<int>("SHM_RING_SLOTS", 4)))
+        return FAIL_WRIT;
+    ShmFrameWriter* ring = shmRing.isOpen() ? &shmRing : nullptr;
+    VideoSink* videoSink = video.get();
+    const FrameCapture::Consumer writeFrame = [ring, videoSink, outputDir, WINDOW_WID, WINDOW_HEI, timeStep](int frame, const unsigned char* rgba)
+    {
+        if (ring)
+        {
+            ring->publish(rgba, frame, frame * timeStep);
+            return true;
+        }
+        if (videoSink)
+            return videoSink->push(rgba);
+        return writePPM(framePath(outputDir, "frame_", frame), WINDOW_WID, WINDOW_HEI, 4, rgba);
+    };
+    const std::string destination = ring ? shmName : video ? videoPath : outputDir;
+    // flush the video, false if it could not be written
+    auto finishVideo = [&]()
+    {
+        if (!video)
+            return true;
+        const bool closed = video->close();
+        std::cout << "video: " << video->getStats().summary() << std::endl;
+        return closed;
+    };
+
+    // #include is resolved against the shader library, and the quality
+    // tier picked, the same way by every backend
+    ShaderPreprocessor preprocessor(config.getValue<std::string>("SHADER_LIBRARY", "../shader/shader_lib"));
+    Shader::setPreprocessor(&preprocessor);
+    QualityTiers qualityTiers;
+    const int startTier = loadQualityTiers(config, qualityTiers);
+
+    // the cpu backends run the shader without any GL context: cpu transpiles it
+    // to C++ and builds it with the host compiler, vm interprets bytecode
+    const std::string backend = config.getValue<std::string>("HEADLESS_BACKEND", "gl");
+    if (backend == "cpu" || backend == "vm")
+    {
+        const std::string fragmentPath = config.getValue<std::string>("main_fs");
+        std::unique_ptr<CpuRenderer> cpuShader;
+        if (backend == "cpu")
+            cpuShader.reset(new CpuShader(
+                fragmentPath.c_str(),
+                config.getValue<std::string>("CPU_CXX", "c++"),
+                config.getValue<std::string>("CPU_CACHE", "../cache"),
+                config.getValue<std::string>("CPU_INCLUDE", "../include"),
+                &preprocessor, qualityTiers.definesFor(fragmentPath, startTier)
+            ));
+        else
+            cpuShader.reset(new VmShader(fragmentPath.c_str(), &preprocessor, qualityTiers.definesFor(fragmentPath, startTier)));
+        if (!cpuShader->isValid())
+            return FAIL_SHDR;
+        cpuShader->setThreadCount(config.getValue<int>("CPU_THREADS", 0));
+        cpuShader->setTileSize(config.getValue<int>("CPU_TILE_WID", 64), config.getValue<int>("CPU_TILE_HEI", 16));
+        const bool tileStats = config.getValue<bool>("CPU_TILE_STATS", false);
+        int reused = 0;
+        for (int frame = frameBeg; frame < frameEnd; ++frame)
+        {
+            cpuShader->setFloat("iTime", frame * timeStep);
+            cpuShader->setVec2("iResolution", glm::vec2(float(WINDOW_WID), float(WINDOW_HEI)));
+            cpuShader->setVec2("iMousePos", glm::vec2(0.0f, 0.0f));
+            const unsigned char* pixels = cpuShader->render(WINDOW_WID, WINDOW_HEI);
+            reused += cpuShader->wasFrameReused() ? 1 : 0;
+            if (tileStats && !cpuShader->wasFrameReused())
+                std::cout << "frame " << frame << ": " << cpuShader->getStats().summary() << std::endl;
+            if (!writeFrame(frame, pixels))
+                return FAIL_WRIT;
+        }
+        if (!finishVideo())
+            return FAIL_WRIT;
+        std::cout << "wrote " << (frameEnd - frameBeg) << " frames to " << destination << " on the " << backend << " backend, "
+                  << reused << " unchanged frames reused" << std::endl;
+        return 0;
+    }
+
+    HeadlessContext context;
+    if (!context.create(3, 3))
+        return FAIL_CTXT;
+    if (!gladLoadGLLoader(HeadlessContext::getProcLoader()))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return FAIL_CTXT;
+    }
+    std::cout << "headless renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+    ProgramCache programCache;
+    openProgramCache(config, programCache, HeadlessContext::getProcLoader());
+    // main_fs builds while the graph's passes do
+    ShaderLoader shaderLoader;
+    ShaderPermutations mainProgram(shaderLoader, config.getValue<std::string>("main_vs"), config.getValue<std::string>("main_fs"),
+                                   &qualityTiers, startTier);
+    unsigned int sqadVBO;
+    unsigned int sqadVAO = createScreenQuad(WINDOW_WID, WINDOW_HEI, sqadVBO);
+    RenderTarget target(WINDOW_WID, WINDOW_HEI);
+    std::vector<unsigned char> pixels;
+
+    // frames are written by the capture thread while the next ones render
+    std::unique_ptr<FrameCapture> capture;
+    if (config.getValue<int>("CAPTURE_RING", 3) > 0)
+        capture.reset(new FrameCapture(
+            WINDOW_WID, WINDOW_HEI, config.getValue<int>("CAPTURE_RING", 3), false, writeFrame
+        ));
+    // store the frame in target, false if it could not be written. an
+    // unchanged target is not read back again unless the capture ring does it
+    auto storeFrame = [&](int frame, bool redrawn)
+    {
+        if (capture)
+            return capture->capture(target.getFBO(), GL_COLOR_ATTACHMENT0, frame);
+        if (redrawn)
+            target.readPixels(pixels);
+        return writeFrame(frame, pixels.data());
+    };
+    // wait for the capture thread and the video, false if either failed on some frame
+    auto finishFrames = [&]()
+    {
+        bool stored = true;
+        if (capture)
+        {
+            capture->finish();
+            const CaptureStats stats = capture->getStats();
+            std::cout << "capture: " << stats.summary() << std::endl;
+            stored = stats.failed == 0;
+        }
+        return finishVideo() && stored;
+    };
+
+    std::unique_ptr<RenderGraph> graph = loadGraph(config, WINDOW_WID, WINDOW_HEI, sqadVAO, shaderLoader, qualityTiers, startTier);
+    if (!config.getValue<std::string>("MULTIPASS", "").empty() && !graph)
+        return FAIL_SHDR;
+    mainProgram.wait();
+    Shader* mainShader = mainProgram.get();
+    std::cout << "shaders: " << shaderLoader.getStats().summary() << std::endl;
+    std::cout << "preprocessor: " << preprocessor.getStats().summary() << std::endl;
+    if (programCache.isEnabled())
+        std::cout << "program cache: " << programCache.getStats().summary() << std::endl;
+
+    // iResolution and iMousePos are fixed off-screen, and iDate carries no
+    // wall clock, only iTime as its seconds, so every run gives the same frames
+    FrameGlobals globals;
+    if (!globals.create())
+        return FAIL_CTXT;
+    auto updateGlobals = [&](int frame)
+    {
+        FrameInputs inputs;
+        inputs.time = frame * timeStep;
+        inputs.timeDelta = timeStep;
+        inputs.frame = frame;
+        inputs.date = glm::vec4(0.0f, 0.0f, 0.0f, inputs.time);
+        for (int view = 0; view < FRAME_VIEW_COUNT; ++view)
+            inputs.resolution[view] = glm::vec2(float(WINDOW_WID), float(WINDOW_HEI));
+        globals.update(inputs);
+    };
+
+    std::unique_ptr<FrameProfiler> profiler = openProfiler(config);
+    if (graph)
+    {
+        // feedback buffers hold the whole history, so frame N needs frames 0..N-1 first
+        for (int frame = graph->hasFeedback() ? 0 : frameBeg; frame < frameEnd; ++frame)
+        {
+            if (profiler)
+                profiler->beginFrame(frame);
+            {
+                FrameProfiler::Scope phase(profiler.get(), "uniforms");
+                updateGlobals(frame);
+            }
+            {
+                FrameProfiler::Scope phase(profiler.get(), "draw");
+                target.bind();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                graph->render(frame, globals, WINDOW_WID, WINDOW_HEI);
+            }
+            if (frame >= frameBeg)
+            {
+                FrameProfiler::Scope phase(profiler.get(), "capture");
+                if (!storeFrame(frame, true))
+                    return FAIL_WRIT;
+            }
+            if (profiler)
+                profiler->endFrame();
+        }
+        if (!finishFrames())
+            return FAIL_WRIT;
+        if (profiler)
+            reportProfile(config, *profiler);
+        std::cout << "wrote " << (frameEnd - frameBeg) << " frames to " << destination << " from passes " << graph->describe() << std::endl;
+        glDeleteVertexArrays(1, &sqadVAO);
+        glDeleteBuffers(1, &sqadVBO);
+        return 0;
+    }
+
+    // so a program that reads none of the per-frame values draws the same frame every time
+    const bool usesTime = readsClock(*mainShader);
+    const bool renderOnDemand = config.getValue<bool>("RENDER_ON_DEMAND", true);
+    int reused = 0;
+
+    for (int frame = frameBeg; frame < frameEnd; ++frame)
+    {
+        if (profiler)
+            profiler->beginFrame(frame);
+        const bool reuse = renderOnDemand && !usesTime && frame > frameBeg;
+        if (reuse)
+        {
+            ++reused;
+        }
+        else
+        {
+            {
+                FrameProfiler::Scope phase(profiler.get(), "uniforms");
+                updateGlobals(frame);
+            }
+            FrameProfiler::Scope phase(profiler.get(), "draw");
+            target.bind();
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            mainShader->use();
+            glBindVertexArray(sqadVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        }
+        {
+            FrameProfiler::Scope phase(profiler.get(), "capture");
+            if (!storeFrame(frame, !reuse))
+                return FAIL_WRIT;
+        }
+        if (profiler)
+            profiler->endFrame();
+    }
+    if (!finishFrames())
+        return FAIL_WRIT;
+    if (profiler)
+        reportProfile(config, *profiler);
+    std::cout << "wrote " << (frameEnd - frameBeg) << " frames to " << destination << ", " << reused << " unchanged frames reused" << std::endl;
+
+    glDeleteVertexArrays(1, &sqadVAO);
+    glDeleteBuffers(1, &sqadVBO);
+    return 0;
+}
+
+std::unique_ptr<RenderGraph> loadGraph(YAMLconfig& config, int width, int height, unsigned int quadVAO, ShaderLoader& loader,
+                                       const QualityTiers& tiers, int tier)
+{
+    const std::string graphPath = config.getValue<std::string>("MULTIPASS", "");
+    if (graphPath.empty())
+        return nullptr;
+    std::unique_ptr<RenderGraph> graph(new RenderGraph());
+    if (!graph->load(graphPath.c_str(), config.getValue<std::string>("main_vs").c_str(), width, height, quadVAO, loader, &tiers, tier))
+    {
+        std::cout << "ERROR::RENDER_GRAPH:: " << graph->getError() << std::endl;
+        return nullptr;
+    }
+    std::cout << "render graph: " << graph->describe() << ", " << graph->memorySummary() << std::endl;
+    return graph;
+}
+
+void openProgramCache(YAMLconfig& config, ProgramCache& cache, GLADloadproc loader)
+{
+    // without a cache every program is compiled, as before
+    const std::string directory = config.getValue<std::string>("SHADER_CACHE", "");
+    if (!directory.empty() && cache.open(directory, loader))
+        Shader::setProgramCache(&cache);
+}
+
+int loadQualityTiers(YAMLconfig& config, QualityTiers& tiers)
+{
+    // without tiers every shader builds with the values in its source
+    const std::string path = config.getValue<std::string>("QUALITY", "");
+    if (path.empty())
+        return 0;
+    if (!tiers.load(path))
+    {
+        std::cout << "ERROR::QUALITY:: " << tiers.getError() << std::endl;
+        return 0;
+    }
+    const std::string name = config.getValue<std::string>("QUALITY_TIER", "");
+    const int tier = name.empty() ? tiers.getCount() - 1 : tiers.find(name);
+    if (tier < 0)
+    {
+        std::cout << "ERROR::QUALITY:: no tier called " << name << ", using " << tiers.getName(tiers.getCount() - 1) << std::endl;
+        return tiers.getCount() - 1;
+    }
+    return tier;
+}
+
+std::unique_ptr<FrameProfiler> openProfiler(YAMLconfig& config)
+{
+    if (!config.getValue<bool>("PROFILE", false))
+        return nullptr;
+    return std::unique_ptr<FrameProfiler>(new FrameProfiler(
+        true,
+        config.getValue<int>("PROFILE_HISTORY", 240),
+        config.getValue<int>("PROFILE_TRACE_FRAMES", 600)
+    ));
+}
+
+void reportProfile(YAMLconfig& config, const FrameProfiler& profiler)
+{
+    std::cout << "profile:" << std::endl;
+    for (const PhaseStats& phase : profiler.getStats())
+        std::cout << "  " << phase.summary() << std::endl;
+    const std::string tracePath = config.getValue<std::string>("PROFILE_TRACE", "");
+    if (tracePath.empty())
+        return;
+    if (profiler.writeTrace(tracePath))
+        std::cout << "profile: trace written to " << tracePath << std::endl;
+    else
+        std::cout << "ERROR::PROFILE:: cannot write " << tracePath << std::endl;
+}
+
+bool readsClock(const Shader& shader)
+{
+    // the inputs that change every frame whatever the user does
+    return shader.isUniformActive("iTime") || shader.isUniformActive("iTimeDelta") ||
+           shader.isUniformActive("iFrame") || shader.isUniformActive("iDate");
+}
@@ -13,6 +13,11 @@
 #include "myImplement/camera.h"
 #include "myImplement/config.h"
 #include "myImplement/errorno.h"
+#include "myImplement/frame_globals.h"
+#include "myImplement/frame_profiler.h"
+#include "myImplement/shader_loader.h"
+#include "myImplement/shader_preprocessor.h"
+#include "myImplement/step_heatmap.h"
 
 #include <iostream>
 #include <fstream>
@@ -20,6 +25,7 @@
 #include <string>
 #include <random>
 #include <ctime>
+#include <memory>
 
 
 // callback functions
@@ -91,7 +97,10 @@ int main(int argc, char** argv)
     stbi_set_flip_vertically_on_load(true);
     glEnable(GL_DEPTH_TEST);
 
-    // shader preparation
+    // shader preparation: #include is resolved against the shader library,
+    // for these and for the heatmap programs ShaderLoader builds later
+    ShaderPreprocessor preprocessor(config.getValue<std::string>("SHADER_LIBRARY", "../shader/shader_lib"));
+    Shader::setPreprocessor(&preprocessor);
     Shader mainShader(
         // vertex shader
         config.getValue<std::string>("main_vs").c_str(),
@@ -194,14 +203,41 @@ int main(int argc, char** argv)
     bool show_another_window = false;
     ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
+    // iTime, iResolution and iMousePos reach the shader through the frame block
+    FrameGlobals globals;
+    if (!globals.create())
+        return FAIL_CTXT;
+    int frameIndex = 0;
+
+    // where the frame time goes, phase by phase, instead of one averaged framerate
+    FrameProfiler profiler(true, config.getValue<int>("PROFILE_HISTORY", 240), config.getValue<int>("PROFILE_TRACE_FRAMES", 600));
+    std::vector<PhaseStats> phaseStats;
+    float lastStats = 0.0f;
+
+    // step heatmap: main_fs built again with its '#pragma count_steps'
+    // loops counted, drawn over the frame with the histogram in its window
+    ShaderLoader shaderLoader;
+    std::unique_ptr<StepHeatmap> heatmap;
+    ShaderFuture countedFuture;
+    ShaderFuture overlayFuture;
+    std::unique_ptr<Shader> countedShader;
+    std::unique_ptr<Shader> overlayShader;
+    bool showHeatmap = config.getValue<bool>("STEP_HEATMAP", false);
+    int heatmapBudget = config.getValue<int>("STEP_HEATMAP_BUDGET", 200);
+    float heatmapOpacity = config.getValue<float>("STEP_HEATMAP_OPACITY", 0.7f);
+    float lastHistogram = 0.0f;
+
     while (!glfwWindowShouldClose(window))
     {
         currFrame = glfwGetTime();
         deltaTime = currFrame - lastFrame;
         lastFrame = currFrame;
+        profiler.beginFrame(frameIndex);
 
+        profiler.begin("input");
         glfwPollEvents();
         processInput(window);
+        profiler.end();
 
         // glBindFramebuffer(GL_FRAMEBUFFER, FBO);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -211,23 +247,59 @@ int main(int argc, char** argv)
         glClear(GL_COLOR_BUFFER_BIT);
         glClear(GL_DEPTH_BUFFER_BIT);
 
-        mainShader.use();
+        FrameInputs inputs;
+        inputs.time = float(glfwGetTime());
+        inputs.timeDelta = deltaTime;
+        inputs.frame = frameIndex++;
+        inputs.mouse = glm::vec2(mousePosX, mousePosY);
+        inputs.date = FrameInputs::dateNow();
+        for (int view = 0; view < FRAME_VIEW_COUNT; ++view)
+            inputs.resolution[view] = glm::vec2(float(WINDOW_WID), float(WINDOW_HEI));
+        profiler.begin("uniforms");
+        globals.update(inputs);
+        profiler.end();
+
+        // the heatmap's programs build in the background the first time it is switched on
+        if (showHeatmap && !heatmap)
+        {
+            heatmap.reset(new StepHeatmap(WINDOW_WID, WINDOW_HEI, heatmapBudget));
+            countedFuture = shaderLoader.request(config.getValue<std::string>("main_vs"), config.getValue<std::string>("main_fs"), ShaderDefines(), true);
+            overlayFuture = shaderLoader.request(config.getValue<std::string>("main_vs"), config.getValue<std::string>("heatmap_fs"));
+        }
+        if (!shaderLoader.isIdle())
+        {
+            shaderLoader.poll();
+            if (countedFuture.isReady())
+                countedShader = countedFuture.take();
+            if (overlayFuture.isReady())
+                overlayShader = overlayFuture.take();
+        }
+
+        profiler.begin("draw");
+        const bool drawHeatmap = showHeatmap && countedShader && overlayShader;
+        if (drawHeatmap)
+        {
+            heatmap->setBudget(heatmapBudget);
+            heatmap->bind(WINDOW_WID, WINDOW_HEI);
+        }
+        (drawHeatmap ? countedShader.get() : &mainShader)->use();
         glBindVertexArray(sqadVAO);
-        mainShader.setFloat(
-            "iTime", 
-            glfwGetTime()
-        );
-        mainShader.setVec2(
-            "iResolution", 
-            glm::vec2(float(WINDOW_WID), float(WINDOW_HEI))
-        );
-        mainShader.setVec2(
-            "iMousePos",
-            glm::vec2(mousePosX, mousePosY)
-        );
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        if (drawHeatmap)
+        {
+            RenderTarget::bindDefault(WINDOW_WID, WINDOW_HEI);
+            heatmap->present(*overlayShader, WINDOW_WID, WINDOW_HEI, heatmapOpacity);
+            // the read back waits for the GPU, twice a second is plenty
+            if (currFrame - lastHistogram > 0.5f)
+            {
+                lastHistogram = currFrame;
+                heatmap->collect(WINDOW_WID, WINDOW_HEI);
+            }
+        }
+        profiler.end();
 
         // UI part
+        profiler.begin("imgui");
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -253,6 +325,31 @@ int main(int argc, char** argv)
             ImGui::Text("counter = %d", counter);
 
             ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+            // percentiles change slowly, sorting them twice a second is plenty
+            if (currFrame - lastStats > 0.5f)
+            {
+                lastStats = currFrame;
+                phaseStats = profiler.getStats();
+            }
+            ImGui::Text("phase        cpu p50   p95   p99   gpu p50   p95   p99 (ms)");
+            for (const PhaseStats& phase : phaseStats)
+                ImGui::Text("%-10s %8.2f %5.2f %5.2f %9.2f %5.2f %5.2f", phase.name.c_str(),
+                            phase.cpuP50, phase.cpuP95, phase.cpuP99, phase.gpuP50, phase.gpuP95, phase.gpuP99);
+            ImGui::Begin("Step heatmap");
+            ImGui::Checkbox("count the marked loops of main_fs", &showHeatmap);
+            ImGui::SliderInt("budget", &heatmapBudget, 8, 1000);
+            ImGui::SliderFloat("opacity", &heatmapOpacity, 0.0f, 1.0f);
+            if (showHeatmap && heatmap)
+            {
+                const StepHistogram& histogram = heatmap->getHistogram();
+                ImGui::Text("%d of %d pixels counted", histogram.counted, histogram.pixels);
+                ImGui::Text("steps mean %.1f  p50 %.0f  p95 %.0f  max %.0f", histogram.mean, histogram.p50, histogram.p95, histogram.max);
+                ImGui::Text("%.1f%% of the counted pixels at the budget", histogram.overBudget * 100.0f);
+                if (!histogram.buckets.empty())
+                    ImGui::PlotHistogram("##steps", histogram.buckets.data(), int(histogram.buckets.size()), 0,
+                                         "0 .. budget steps", 0.0f, FLT_MAX, ImVec2(0.0f, 80.0f));
+            }
+            ImGui::End();
             // 3. Show another simple window.
             if (show_another_window)
             {
@@ -266,6 +363,7 @@ int main(int argc, char** argv)
         }
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        profiler.end();
 
         // swap back to normal screen
         // glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -300,8 +398,16 @@ int main(int argc, char** argv)
         // }
 
         // event bus
+        profiler.begin("swap");
         glfwSwapBuffers(window);
+        profiler.end();
+        profiler.endFrame();
     }
+    for (const PhaseStats& phase : profiler.getStats())
+        std::cout << "profile: " << phase.summary() << std::endl;
+    const std::string tracePath = config.getValue<std::string>("PROFILE_TRACE", "");
+    if (!tracePath.empty() && !profiler.writeTrace(tracePath))
+        std::cout << "ERROR::PROFILE:: cannot write " << tracePath << std::endl;
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &cubeVAO);
@@ -0,0 +1,79 @@
+#include "myImplement/shm_ring.h"
+#include "myImplement/image_io.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief follows the frame ring shader_toy publishes with SHM_RING:
+ * reads every frame in place, prints the rate and the frames lost
+ * once a second, and writes the newest frame as a PPM when given a path.
+ *
+ * usage: shm_reader [name = /shadertoy] [seconds = 10] [frame.ppm]
+ */
+int main(int argc, char** argv)
+{
+    const std::string name = argc > 1 ? argv[1] : "/shadertoy";
+    const double seconds = argc > 2 ? atof(argv[2]) : 10.0;
+    const std::string snapshot = argc > 3 ? argv[3] : "";
+
+    ShmFrameReader reader;
+    if (!reader.open(name))
+        return 1;
+    std::cout << "reading " << name << ": " << reader.getWidth() << "x" << reader.getHeight() << std::endl;
+
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    Clock::time_point lastReport = start;
+    uint64_t frames = 0;
+    uint64_t framesReported = 0;
+    uint64_t checksum = 0;
+    ShmFrameView view;
+    while (std::chrono::duration<double>(Clock::now() - start).count() < seconds)
+    {
+        const ShmReadStatus status = reader.acquireNext(view);
+        if (status == SHM_READ_CLOSED)
+            break;
+        if (status == SHM_READ_NONE)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        // touch the frame where it lies, a real consumer would upload or encode it here
+        for (size_t i = 0; i < size_t(view.width) * view.height * 4; i += 4096)
+            checksum += view.pixels[i];
+        if (reader.release(view))
+            ++frames;
+
+        const Clock::time_point now = Clock::now();
+        const double elapsed = std::chrono::duration<double>(now - lastReport).count();
+        if (elapsed >= 1.0)
+        {
+            std::cout << "frame " << view.frameIndex << ": " << (frames - framesReported) / elapsed << " fps, "
+                      << reader.getOverruns() << " overrun, " << reader.getTorn() << " torn" << std::endl;
+            lastReport = now;
+            framesReported = frames;
+        }
+    }
+    std::cout << frames << " frames read, " << reader.getOverruns() << " overrun, " << reader.getTorn() << " torn" << std::endl;
+
+    if (!snapshot.empty())
+    {
+        // the last frame read is still mapped, even after the writer has gone
+        std::vector<unsigned char> pixels;
+        if (frames > 0)
+            pixels.assign(view.pixels, view.pixels + size_t(view.width) * view.height * 4);
+        if (frames == 0 || !reader.release(view))
+        {
+            std::cout << "no intact frame to write to " << snapshot << std::endl;
+            return 1;
+        }
+        if (!writePPM(snapshot, view.width, view.height, 4, pixels.data()))
+            return 1;
+        std::cout << "frame " << view.frameIndex << " written to " << snapshot << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include <string>
+#include <vector>
+
+// mean and percentiles of one set of frame times, in milliseconds
+struct TimingSummary
+{
+    float mean, p50, p95, p99, max;
+
+    TimingSummary() : mean(0.0f), p50(0.0f), p95(0.0f), p99(0.0f), max(0.0f) {}
+    static TimingSummary of(std::vector<float> samples);
+};
+
+// one shader at one quality tier and one resolution
+struct BenchResult
+{
+    std::string shader;   // file name
+    std::string tier;     // empty for a shader built as written
+    int width, height;
+    float compileMs;      // compile and link, from request to a usable program
+    TimingSummary gpuMs;  // GL_TIME_ELAPSED of the draw
+    TimingSummary wallMs; // CPU time from the draw to glFinish
+    double pixelsPerSecond; // at the mean GPU time
+
+    BenchResult() : width(0), height(0), compileMs(0.0f), pixelsPerSecond(0.0) {}
+    // "shader[tier]@WxH", what a baseline is matched by
+    std::string key() const;
+};
+
+/**
+ * @brief what shader_bench measured, written as JSON and read back as a
+ * baseline. yaml-cpp does the reading, JSON being a subset of YAML.
+ */
+struct BenchReport
+{
+    std::string renderer;
+    int warmup;
+    int frames;
+    float timeStart;
+    float timeStep;
+    std::vector<BenchResult> results;
+
+    BenchReport() : warmup(0), frames(0), timeStart(0.0f), timeStep(0.0f) {}
+    bool write(const std::string& path) const;
+    // false with 'error' set if 'path' is not a report
+    bool load(const std::string& path, std::string& error);
+};
+
+struct BenchComparison
+{
+    int compared;
+    int regressions;     // median slower than the baseline by more than the threshold
+    int slowerTails;     // only the p95 slower by more than it, a warning
+    int improvements;    // median faster by more than it
+    int missing;         // in the baseline but not measured, or the other way round
+    std::vector<std::string> lines; // one per result that moved or is missing
+
+    BenchComparison() : compared(0), regressions(0), slowerTails(0), improvements(0), missing(0) {}
+    std::string summary() const;
+};
+
+// results are matched by key() and their GPU times compared: a regression
+// if the p50 grew by more than 'threshold', e.g. 0.1 for 10%, an
+// improvement if it shrank by more. the p95 is only a warning, a few
+// slow frames out of a short run are too noisy to fail on
+BenchComparison compareBench(const BenchReport& current, const BenchReport& baseline, float threshold);
+
+#endif
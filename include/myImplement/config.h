@@ -21,6 +21,11 @@ public:
         return yaml.size() > 0;
     }
 
+    bool hasKey(std::string key) const
+    {
+        return isLoaded() && yaml[key].IsDefined();
+    }
+
     bool loadFile(const char* filePath)
     {
         yaml = YAML::LoadFile(filePath);
@@ -37,6 +42,15 @@ public:
         }
         return yaml[key].as<Type>();
     }
+
+    // same as above, but optional keys fall back to a default value
+    template <typename Type>
+    Type getValue(std::string key, const Type& fallback)
+    {
+        if (!hasKey(key))
+            return fallback;
+        return yaml[key].as<Type>();
+    }
 };
 
 
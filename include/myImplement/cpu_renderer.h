@@ -0,0 +1,75 @@
+#ifndef CPU_RENDERER_H
+#define CPU_RENDERER_H
+
+#include "myImplement/glsl_front.h"
+#include "myImplement/tile_scheduler.h"
+
+#include <glm/glm.hpp>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * @brief what the CPU back ends have in common: the uniform block,
+ * packed as floats in declaration order and set with the same calls
+ * as Shader, and a render() that shades the frame tile by tile on
+ * every core through a work-stealing TileScheduler. a frame is only
+ * shaded again when its size or a uniform main() reads has changed,
+ * shaders that ignore iTime cost nothing after the first frame.
+ * uniform names that the shader does not declare are ignored, like a
+ * -1 GL location.
+ */
+class CpuRenderer
+{
+protected:
+    std::map<std::string, glsl::UniformSlot> slots;
+    std::vector<float> uniforms;
+    std::set<std::string> activeUniforms;
+    TileScheduler scheduler;
+    // the frame buffer holds a frame of this size for the current active uniform values
+    int frameWidth;
+    int frameHeight;
+    bool frameReused;
+
+    void setLayout(const glsl::Program& program);
+    void setFloats(const std::string& name, const float* values, int count);
+    // shades one tile of an RGBA8 image 'width' pixels wide
+    virtual void renderTile(const Tile& tile, int width, unsigned char* rgba) const = 0;
+
+public:
+    CpuRenderer() : frameWidth(0), frameHeight(0), frameReused(false) {}
+    virtual ~CpuRenderer() {}
+    CpuRenderer(const CpuRenderer&) = delete;
+    CpuRenderer& operator=(const CpuRenderer&) = delete;
+
+    virtual bool isValid() const = 0;
+    // 0 means one thread per hardware thread
+    void setThreadCount(int count) { scheduler.setThreadCount(count); }
+    void setTileSize(int width, int height) { scheduler.setTileSize(width, height); }
+    // RGBA8, bottom row first like glReadPixels. the frame is owned by the
+    // renderer and stays valid until the next render() at another size
+    const unsigned char* render(int width, int height);
+    // true when the last render() found nothing changed and kept the frame
+    bool wasFrameReused() const { return frameReused; }
+    bool isUniformActive(const std::string &name) const { return activeUniforms.count(name) != 0; }
+    // per tile timings of the last frame
+    const TileStats& getStats() const { return scheduler.getStats(); }
+
+    // utility uniform functions
+    void setBool(const std::string &name, bool value);
+    void setInt(const std::string &name, int value);
+    void setFloat(const std::string &name, float value);
+    void setVec2(const std::string &name, const glm::vec2 &value);
+    void setVec2(const std::string &name, float x, float y);
+    void setVec3(const std::string &name, const glm::vec3 &value);
+    void setVec3(const std::string &name, float x, float y, float z);
+    void setVec4(const std::string &name, const glm::vec4 &value);
+    void setVec4(const std::string &name, float x, float y, float z, float w);
+    void setMat2(const std::string &name, const glm::mat2 &mat);
+    void setMat3(const std::string &name, const glm::mat3 &mat);
+    void setMat4(const std::string &name, const glm::mat4 &mat);
+};
+
+#endif
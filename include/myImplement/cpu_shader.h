@@ -0,0 +1,38 @@
+#ifndef CPU_SHADER_H
+#define CPU_SHADER_H
+
+#include "myImplement/cpu_renderer.h"
+#include "myImplement/glsl_runtime.h"
+#include "myImplement/shader_preprocessor.h"
+
+#include <string>
+
+/**
+ * @brief runs a shadertoy fragment shader on the CPU. the shader
+ * is transpiled to C++, built once into a shared library with the
+ * host compiler (cached by source hash) and loaded at run time.
+ */
+class CpuShader : public CpuRenderer
+{
+private:
+    void* library;
+    ShadertoyTileFunc tileFunc;
+
+    bool build(const std::string& source, const std::string& compiler, const std::string& cacheDir, const std::string& includeDir);
+
+protected:
+    void renderTile(const Tile& tile, int width, unsigned char* rgba) const override;
+
+public:
+    // compiles on the fly like Shader, check isValid() afterwards;
+    // #include is expanded through 'preprocessor' if there is one, then
+    // the #define lines 'defines' names get its values
+    CpuShader(const char* fragmentPath, const std::string& compiler = "c++",
+              const std::string& cacheDir = "../cache", const std::string& includeDir = "../include",
+              ShaderPreprocessor* preprocessor = nullptr, const ShaderDefines& defines = ShaderDefines());
+    ~CpuShader();
+
+    bool isValid() const override { return tileFunc != nullptr; }
+};
+
+#endif
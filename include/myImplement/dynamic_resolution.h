@@ -0,0 +1,56 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+
+/**
+ * @brief picks the render scale of the shader pass from its measured
+ * GPU time. the pass is timed with GL_TIME_ELAPSED queries kept in a
+ * small ring, so reading a result never waits on the GPU. the scale
+ * moves towards the frame time budget only when the smoothed time
+ * leaves the hysteresis band around it, so it does not flicker
+ * between two sizes.
+ */
+class DynamicResolution
+{
+private:
+    static const int QUERY_COUNT = 4;
+
+    unsigned int queries[QUERY_COUNT];
+    bool pending[QUERY_COUNT];
+    int current;
+
+    float targetMs;
+    float minScale;
+    float maxScale;
+    float hysteresis;
+
+    float scale;
+    float smoothedMs;
+    int settleFrames; // results still in flight from before the last change
+
+    void submit(float ms);
+
+public:
+    DynamicResolution(float targetMs, float minScale = 0.5f, float maxScale = 1.0f, float hysteresis = 0.1f);
+    ~DynamicResolution();
+
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    // bracket the GPU work of the scaled pass
+    void beginFrame();
+    void endFrame();
+
+    // the program drawn changed, measure it again before moving the scale
+    void restart();
+
+    // the scale to render the next frame at, in [minScale, maxScale]
+    float getScale() const { return scale; }
+    float getMinScale() const { return minScale; }
+    float getMaxScale() const { return maxScale; }
+    // smoothed GPU time of the scaled pass
+    float getFrameMs() const { return smoothedMs; }
+};
+
+#endif
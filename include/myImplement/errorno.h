@@ -4,5 +4,10 @@
 #define EMPTY_CONF -2
 #define EMPTY_TXUR -3
 #define EMPTY_FILE -4
+#define FAIL_CTXT  -5
+#define FAIL_WRIT  -6
+#define FAIL_SHDR  -7
+#define FAIL_PERF  -8
+#define FAIL_DIFF  -9
 
 #endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @brief tells which of a set of files were written since it was last
+ * asked, without blocking. it watches their directories with inotify,
+ * so editors that save by writing a new file and renaming it over the
+ * old one are seen too. Linux only, elsewhere watch() fails.
+ */
+class FileWatcher
+{
+private:
+    struct WatchedFile
+    {
+        std::string path;      // as given to watch()
+        int directory;         // inotify watch descriptor
+        std::string name;      // file name within the directory
+    };
+
+    int fd;
+    std::map<std::string, int> directories; // directory -> watch descriptor
+    std::vector<WatchedFile> files;
+
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // start watching 'path'; watching it again does nothing
+    bool watch(const std::string& path);
+    // the watched paths written or replaced since the last call, each once
+    void poll(std::vector<std::string>& changed);
+
+    bool isWatching() const { return !files.empty(); }
+};
+
+#endif
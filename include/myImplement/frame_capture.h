@@ -0,0 +1,113 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct CaptureStats
+{
+    int captured;          // frames handed to the consumer
+    int dropped;           // frames skipped because every buffer was busy
+    int failed;            // frames the consumer reported failing on
+    double meanLatencyMs;  // from capture() until the consumer is done with it
+    double maxLatencyMs;
+    double seconds;        // from the first capture to the last frame consumed
+    double megabytes;      // pixels consumed
+
+    CaptureStats()
+        : captured(0), dropped(0), failed(0), meanLatencyMs(0.0), maxLatencyMs(0.0), seconds(0.0), megabytes(0.0) {}
+    // one line: frames, drops, latency and throughput
+    std::string summary() const;
+};
+
+/**
+ * @brief reads frames back without stalling the pipeline. capture()
+ * starts a glReadPixels into one of a ring of pixel pack buffers and
+ * fences it; once the fence has passed, the buffer is mapped and a
+ * background thread hands the mapped pixels to the consumer, while the
+ * GL thread is already drawing the next frames. the buffer is unmapped
+ * and reused after the consumer returns.
+ *
+ * every GL call happens on the thread that owns the context, only the
+ * consumer runs on the background thread. pixels are RGBA8, bottom row
+ * first, like RenderTarget::readPixels.
+ */
+class FrameCapture
+{
+public:
+    // frame index and its pixels, false if the frame could not be stored
+    typedef std::function<bool(int frame, const unsigned char* rgba)> Consumer;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    enum SlotState
+    {
+        SLOT_FREE,
+        SLOT_READING,  // glReadPixels issued, fence not yet passed
+        SLOT_MAPPED,   // queued for or being read by the consumer
+        SLOT_CONSUMED  // consumer done, waiting to be unmapped
+    };
+
+    struct Slot
+    {
+        GLuint buffer;
+        GLsync fence;
+        SlotState state;
+        int frame;
+        const unsigned char* pixels;
+        Clock::time_point start;
+    };
+
+    int width;
+    int height;
+    bool dropWhenFull;
+    Consumer consumer;
+    std::vector<Slot> slots;
+    std::deque<int> reading; // slots in the order their reads were issued
+
+    std::thread worker;
+    mutable std::mutex lock;
+    std::condition_variable queued;
+    std::condition_variable consumed;
+    std::deque<int> mapped;  // slots for the consumer, oldest first
+    bool stopping;
+    CaptureStats stats;
+    double totalLatencyMs;
+    Clock::time_point firstCapture;
+    bool started;
+
+    void workerLoop();
+    // map the oldest read if it finished, or wait for it when 'block'
+    bool mapOldest(bool block);
+    void unmapConsumed();
+
+public:
+    // 'depth' buffers of width x height; a full ring drops the new frame
+    // if dropWhenFull, otherwise capture() waits for the oldest one
+    FrameCapture(int width, int height, int depth, bool dropWhenFull, Consumer consumer);
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // start reading 'readBuffer' (GL_BACK, GL_COLOR_ATTACHMENT0, ...) of
+    // 'framebuffer', false if the frame was dropped
+    bool capture(GLuint framebuffer, GLenum readBuffer, int frame);
+    // hand finished reads to the consumer and recycle consumed buffers, never blocks
+    void poll();
+    // wait until every captured frame has been consumed
+    void finish();
+
+    CaptureStats getStats() const;
+};
+
+#endif
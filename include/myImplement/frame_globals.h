@@ -0,0 +1,75 @@
+#ifndef FRAME_GLOBALS_H
+#define FRAME_GLOBALS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// the uniform buffer binding point every program reads the block from
+const GLuint FRAME_GLOBALS_BINDING = 0;
+
+// the resolutions one frame is drawn at, each gets its own copy of the block
+enum FrameView
+{
+    FRAME_VIEW_SCENE,  // the shader pass, or the image pass of a graph
+    FRAME_VIEW_BUFFER, // the buffer passes of a render graph
+    FRAME_VIEW_WINDOW, // the whole window, e.g. the upscale pass
+    FRAME_VIEW_COUNT
+};
+
+// what the application knows about a frame before drawing it
+struct FrameInputs
+{
+    float time;      // iTime, seconds
+    float timeDelta; // iTimeDelta, seconds since the previous frame
+    int frame;       // iFrame
+    glm::vec2 mouse; // iMousePos, in scene pixels
+    glm::vec4 date;  // iDate: year, month (0 based), day, seconds of the day
+    glm::vec2 resolution[FRAME_VIEW_COUNT];
+
+    FrameInputs();
+    // the local date now, for a live window
+    static glm::vec4 dateNow();
+};
+
+/**
+ * @brief the per-frame uniforms every shadertoy program reads (iTime,
+ * iFrame, iResolution, iMousePos, ...), kept in one std140 uniform block
+ * instead of separate uniforms in each program. a program that declares
+ * any of them as plain uniforms gets the block instead when Shader loads
+ * it, see injectFrameGlobals. update() writes every view with a single
+ * buffer upload, bindView() picks the record the next draws read.
+ */
+class FrameGlobals
+{
+private:
+    GLuint UBO;
+    GLsizeiptr stride; // one record, rounded up to the offset alignment
+    std::vector<unsigned char> staging;
+
+public:
+    FrameGlobals();
+    ~FrameGlobals();
+
+    FrameGlobals(const FrameGlobals&) = delete;
+    FrameGlobals& operator=(const FrameGlobals&) = delete;
+
+    bool create();
+    void release();
+
+    // upload this frame's values and bind the scene view
+    void update(const FrameInputs& inputs);
+    void bindView(FrameView view) const;
+
+    bool isValid() const { return UBO != 0; }
+};
+
+// if 'source' declares any of the block's members as plain uniforms of the
+// same type, swap those declarations for the block (keeping line numbers)
+// and add the names the code reads to 'read'; one declared with another
+// type is reported and left alone. false if nothing was swapped
+bool injectFrameGlobals(std::string& source, std::vector<std::string>& read);
+
+#endif
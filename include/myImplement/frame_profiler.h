@@ -0,0 +1,129 @@
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+// rolling percentiles of one phase, in milliseconds; gpu ones are 0 until measured
+struct PhaseStats
+{
+    std::string name;
+    int samples;
+    float cpuP50, cpuP95, cpuP99, cpuMax;
+    float gpuP50, gpuP95, gpuP99, gpuMax;
+
+    PhaseStats()
+        : samples(0), cpuP50(0.0f), cpuP95(0.0f), cpuP99(0.0f), cpuMax(0.0f),
+          gpuP50(0.0f), gpuP95(0.0f), gpuP99(0.0f), gpuMax(0.0f) {}
+    // one line: cpu and gpu p50/p95/p99/max
+    std::string summary() const;
+};
+
+/**
+ * @brief times the phases of a frame on both sides. every begin()/end()
+ * pair takes a CPU timestamp and, on the GPU, a GL_TIMESTAMP query, so
+ * phases may nest. the queries of a frame are kept in a ring of
+ * FRAME_SLOTS frames and read back once the GPU is done with them, a
+ * few frames later, without waiting; a frame whose slot is still busy
+ * is timed on the CPU only.
+ *
+ * each phase keeps its last 'history' frames for percentiles, and the
+ * last 'traceFrames' frames are kept as Chrome trace_event records
+ * (chrome://tracing, Perfetto) with the CPU and the GPU on two tracks.
+ * all calls belong to the thread that owns the context.
+ */
+class FrameProfiler
+{
+private:
+    static const int FRAME_SLOTS = 4;
+
+    struct Record
+    {
+        int phase;
+        int depth;
+        double cpuBegin;   // microseconds since the profiler started
+        double cpuEnd;
+        int query;         // first of two timestamp queries in the slot, -1 without
+    };
+    struct FrameSlot
+    {
+        int frame;
+        bool pending;      // queries not read back yet
+        std::vector<Record> records;
+        std::vector<unsigned int> queries;
+        int queriesUsed;
+    };
+    struct Phase
+    {
+        std::string name;
+        std::vector<float> cpuMs;   // ring of 'history' samples
+        std::vector<float> gpuMs;
+        int cpuNext;
+        int gpuNext;
+    };
+    struct TraceEvent
+    {
+        int phase;
+        int frame;
+        bool gpu;
+        double begin;      // microseconds on the CPU clock
+        double duration;
+    };
+
+    bool gpu;
+    int history;
+    int traceFrames;
+    std::chrono::steady_clock::time_point start;
+    double gpuOffsetUs;     // CPU clock minus GPU clock
+    FrameSlot slots[FRAME_SLOTS];
+    int current;
+    bool timingGpu;         // this frame's slot was free
+    std::vector<int> open;  // records begun and not ended yet
+    std::vector<Phase> phases;
+    std::deque<TraceEvent> trace;
+
+    double nowUs() const;
+    void syncClocks();
+    int phaseIndex(const char* name);
+    void addSample(std::vector<float>& ring, int& next, float ms);
+    void addTrace(const TraceEvent& event);
+    void collect(FrameSlot& slot);
+
+public:
+    // 'gpu' false times the CPU side only, e.g. without a GL context
+    explicit FrameProfiler(bool gpu = true, int history = 240, int traceFrames = 600);
+    ~FrameProfiler();
+
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    void beginFrame(int frame);
+    // reads back whatever earlier frames finished on the GPU
+    void endFrame();
+    // phase names are compared by content, literals are fine
+    void begin(const char* phase);
+    void end();
+
+    // begin() in the constructor and end() in the destructor, a null profiler does nothing
+    class Scope
+    {
+    private:
+        FrameProfiler* profiler;
+    public:
+        Scope(FrameProfiler* profiler, const char* phase) : profiler(profiler) { if (profiler) profiler->begin(phase); }
+        ~Scope() { if (profiler) profiler->end(); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // percentiles over the rolling history, in the order phases were first seen
+    std::vector<PhaseStats> getStats() const;
+    // the kept frames as a Chrome trace_event JSON file
+    bool writeTrace(const std::string& path) const;
+};
+
+#endif
@@ -0,0 +1,226 @@
+#ifndef GLSL_FRONT_H
+#define GLSL_FRONT_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+
+/**
+ * @brief a small front end for the GLSL subset our shadertoy
+ * fragment shaders use: float/int/bool scalars, vectors, square
+ * matrices, structs, swizzles, user functions, if/for/while and
+ * the common built-in functions. it preprocesses, parses and
+ * type checks a fragment shader into a typed syntax tree, with
+ * every implicit int -> float conversion made explicit, so the
+ * CPU back ends can walk it without knowing GLSL's rules.
+ */
+namespace glsl
+{
+    enum BaseType
+    {
+        TY_VOID,
+        TY_BOOL,
+        TY_INT,
+        TY_FLOAT,
+        TY_STRUCT
+    };
+
+    struct Type
+    {
+        BaseType base;
+        int rows;     // vector size, or number of rows of a matrix
+        int cols;     // number of columns, 1 unless it is a matrix
+        int structId; // index into Program::structs
+
+        Type(BaseType base = TY_VOID, int rows = 1, int cols = 1, int structId = -1)
+            : base(base), rows(rows), cols(cols), structId(structId) {}
+
+        bool isScalar() const { return base != TY_VOID && base != TY_STRUCT && rows == 1 && cols == 1; }
+        bool isVector() const { return rows > 1 && cols == 1; }
+        bool isMatrix() const { return cols > 1; }
+        bool isNumeric() const { return base == TY_INT || base == TY_FLOAT; }
+        bool operator==(const Type& other) const
+        {
+            return base == other.base && rows == other.rows && cols == other.cols && structId == other.structId;
+        }
+        bool operator!=(const Type& other) const { return !(*this == other); }
+    };
+
+    struct StructDecl
+    {
+        std::string name;
+        std::vector<std::string> fieldNames;
+        std::vector<Type> fieldTypes;
+    };
+
+    enum Storage
+    {
+        VS_LOCAL,
+        VS_PARAM,
+        VS_GLOBAL,
+        VS_UNIFORM,
+        VS_INPUT,
+        VS_OUTPUT
+    };
+
+    enum ParamQualifier
+    {
+        PQ_IN,
+        PQ_OUT,
+        PQ_INOUT
+    };
+
+    struct Variable
+    {
+        std::string name;
+        Type type;
+        Storage storage;
+        ParamQualifier qualifier;
+        bool isConst;
+        int id; // unique in the program, back ends use it to avoid name clashes
+    };
+
+    enum ExprKind
+    {
+        EX_LITERAL,
+        EX_VARIABLE,
+        EX_UNARY,     // args[0]
+        EX_BINARY,    // args[0] op args[1]
+        EX_ASSIGN,    // args[0] op= args[1], op is OP_ASSIGN for plain '='
+        EX_INCDEC,    // ++/-- on args[0], see 'prefix'
+        EX_CALL,      // user function
+        EX_BUILTIN,   // built-in function
+        EX_CONSTRUCT, // type constructor, also every implicit conversion
+        EX_SWIZZLE,   // args[0].xyzw
+        EX_FIELD,     // args[0].field
+        EX_INDEX,     // args[0][args[1]]
+        EX_TERNARY    // args[0] ? args[1] : args[2]
+    };
+
+    enum Operator
+    {
+        OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD,
+        OP_LT, OP_LE, OP_GT, OP_GE, OP_EQ, OP_NE,
+        OP_AND, OP_OR, OP_XOR,
+        OP_NOT, OP_NEG, OP_PLUS,
+        OP_ASSIGN, OP_INC, OP_DEC
+    };
+
+    enum Builtin
+    {
+        BI_RADIANS, BI_DEGREES, BI_SIN, BI_COS, BI_TAN, BI_ASIN, BI_ACOS, BI_ATAN,
+        BI_EXP, BI_LOG, BI_EXP2, BI_LOG2, BI_SQRT, BI_INVERSESQRT,
+        BI_ABS, BI_SIGN, BI_FLOOR, BI_CEIL, BI_FRACT, BI_TRUNC, BI_ROUND,
+        BI_POW, BI_MOD, BI_MIN, BI_MAX, BI_STEP,
+        BI_CLAMP, BI_MIX, BI_SMOOTHSTEP,
+        BI_LENGTH, BI_DISTANCE, BI_DOT, BI_CROSS, BI_NORMALIZE, BI_REFLECT,
+        BI_COUNT
+    };
+
+    struct Function;
+
+    struct Expr
+    {
+        ExprKind kind;
+        Type type;
+        int line;
+        Operator op;
+        bool prefix;        // EX_INCDEC
+        double number;      // EX_LITERAL, bools are 0/1
+        Variable* variable; // EX_VARIABLE
+        Function* function; // EX_CALL
+        Builtin builtin;    // EX_BUILTIN
+        int swizzle[4];     // EX_SWIZZLE components, EX_FIELD uses swizzle[0] as field index
+        int swizzleCount;
+        std::vector<std::unique_ptr<Expr>> args;
+
+        Expr(ExprKind kind, const Type& type, int line)
+            : kind(kind), type(type), line(line), op(OP_ADD), prefix(false), number(0.0),
+              variable(nullptr), function(nullptr), builtin(BI_COUNT), swizzleCount(0) {}
+    };
+    typedef std::unique_ptr<Expr> ExprPtr;
+
+    enum StmtKind
+    {
+        SK_BLOCK,
+        SK_DECL,
+        SK_EXPR,
+        SK_IF,
+        SK_FOR,
+        SK_WHILE,
+        SK_DO,
+        SK_BREAK,
+        SK_CONTINUE,
+        SK_RETURN,
+        SK_EMPTY
+    };
+
+    struct Stmt
+    {
+        StmtKind kind;
+        int line;
+        std::vector<std::unique_ptr<Stmt>> body; // SK_BLOCK children
+        std::vector<Variable*> vars;             // SK_DECL, one initializer each (may be null)
+        std::vector<ExprPtr> inits;
+        ExprPtr expr;                            // SK_EXPR, SK_RETURN value, loop/if condition
+        ExprPtr step;                            // SK_FOR increment
+        std::unique_ptr<Stmt> init;              // SK_FOR initializer
+        std::unique_ptr<Stmt> then;              // SK_IF then branch, loop body
+        std::unique_ptr<Stmt> otherwise;         // SK_IF else branch
+
+        Stmt(StmtKind kind, int line) : kind(kind), line(line) {}
+    };
+    typedef std::unique_ptr<Stmt> StmtPtr;
+
+    struct Function
+    {
+        std::string name;
+        Type returnType;
+        std::vector<Variable*> params;
+        StmtPtr body; // null for a prototype that was never defined
+    };
+
+    struct Program
+    {
+        std::vector<StructDecl> structs;
+        std::vector<std::unique_ptr<Variable>> variables; // owns every variable
+        std::vector<Variable*> uniforms;
+        std::vector<Variable*> inputs;
+        std::vector<Variable*> outputs;
+        std::vector<Variable*> globals;
+        std::vector<ExprPtr> globalInits; // parallel to globals, may be null
+        std::vector<std::unique_ptr<Function>> functions;
+        Function* entry; // main()
+        std::string error;
+
+        Program() : entry(nullptr) {}
+    };
+
+    struct UniformSlot
+    {
+        std::string name;
+        Type type;
+        int offset; // in floats from the start of the block
+    };
+
+    // preprocess, parse and type check a fragment shader. extra defines
+    // are applied as if they were at the top of the file.
+    bool parse(const std::string& source, Program& program,
+               const std::map<std::string, std::string>& defines = std::map<std::string, std::string>());
+
+    // the GLSL spelling of a type, e.g. "vec3" or a struct name
+    std::string typeName(const Type& type, const Program& program);
+    const char* builtinName(Builtin builtin);
+    // number of scalar components, structs included
+    int componentCount(const Type& type, const Program& program);
+    // the CPU back ends take their uniforms as one float block, packed
+    // in declaration order. ints and bools are stored as floats too.
+    std::vector<UniformSlot> uniformLayout(const Program& program, int& floatCount);
+    // uniforms that main() can read, directly or through the functions it
+    // calls, the CPU side counterpart of GL's active uniforms
+    std::set<std::string> activeUniforms(const Program& program);
+}
+
+#endif
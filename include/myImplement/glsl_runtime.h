@@ -0,0 +1,724 @@
+#ifndef GLSL_RUNTIME_H
+#define GLSL_RUNTIME_H
+
+/**
+ * @brief support code for the C++ the GLSL transpiler generates.
+ * the engine only needs the entry point declarations below; the
+ * lane types, which run LANES neighbouring pixels through every
+ * instruction at once, are only compiled where GLSL_LANE_TYPES is
+ * defined: in generated shaders and in the bytecode VM.
+ */
+
+#if defined(_WIN32)
+#define SHADERTOY_EXPORT extern "C" __declspec(dllexport)
+#else
+#define SHADERTOY_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+// the symbol CpuShader looks up in a compiled shader
+#define SHADERTOY_TILE_ENTRY "shadertoy_run_tile"
+
+// fills rows [y0, y1) and columns [x0, x1) of an RGBA8 image whose rows
+// are 'width' pixels apart, bottom row first like glReadPixels
+typedef void (*ShadertoyTileFunc)(const float* uniforms, int x0, int y0, int x1, int y1, int width, unsigned char* rgba);
+
+#if defined(GLSL_LANE_TYPES)
+
+#include <cmath>
+#include <cstddef>
+
+// one AVX-512 register holds 16 floats, AVX 8, SSE/NEON 4
+#if defined(__AVX512F__)
+#define GLSL_LANES 16
+#elif defined(__AVX__)
+#define GLSL_LANES 8
+#else
+#define GLSL_LANES 4
+#endif
+
+namespace glsl_rt
+{
+    const int LANES = GLSL_LANES;
+    typedef float lanef __attribute__((vector_size(GLSL_LANES * 4)));
+    typedef int lanei __attribute__((vector_size(GLSL_LANES * 4)));
+
+    // ============================== lane scalars ===============================
+    // bool lanes are 0 / -1 so they double as blend masks
+    struct vbool
+    {
+        lanei v;
+        vbool() : v() {}
+        explicit vbool(bool b) : v(lanei{} + (b ? -1 : 0)) {}
+        explicit vbool(lanei m) : v(m) {}
+    };
+
+    struct vint
+    {
+        lanei v;
+        vint() : v() {}
+        explicit vint(int s) : v(lanei{} + s) {}
+        explicit vint(lanei v) : v(v) {}
+    };
+
+    struct vfloat
+    {
+        lanef v;
+        vfloat() : v() {}
+        explicit vfloat(float s) : v(lanef{} + s) {}
+        explicit vfloat(lanef v) : v(v) {}
+    };
+
+    inline vbool operator&(vbool a, vbool b) { return vbool(a.v & b.v); }
+    inline vbool operator|(vbool a, vbool b) { return vbool(a.v | b.v); }
+    inline vbool operator^(vbool a, vbool b) { return vbool(a.v ^ b.v); }
+    inline vbool operator~(vbool a) { return vbool(~a.v); }
+    inline vbool operator!(vbool a) { return vbool(~a.v); }
+
+    inline bool any(vbool m)
+    {
+        int bits = 0;
+        for (int i = 0; i < LANES; ++i)
+            bits |= m.v[i];
+        return bits != 0;
+    }
+    inline bool none(vbool m) { return !any(m); }
+
+    inline vfloat select(vbool m, vfloat a, vfloat b) { return vfloat((lanef)(((lanei)a.v & m.v) | ((lanei)b.v & ~m.v))); }
+    inline vint select(vbool m, vint a, vint b) { return vint((a.v & m.v) | (b.v & ~m.v)); }
+    inline vbool select(vbool m, vbool a, vbool b) { return vbool((a.v & m.v) | (b.v & ~m.v)); }
+
+    inline vfloat operator+(vfloat a, vfloat b) { return vfloat(a.v + b.v); }
+    inline vfloat operator-(vfloat a, vfloat b) { return vfloat(a.v - b.v); }
+    inline vfloat operator*(vfloat a, vfloat b) { return vfloat(a.v * b.v); }
+    inline vfloat operator/(vfloat a, vfloat b) { return vfloat(a.v / b.v); }
+    inline vfloat operator-(vfloat a) { return vfloat(-a.v); }
+    inline vbool operator<(vfloat a, vfloat b) { return vbool((lanei)(a.v < b.v)); }
+    inline vbool operator<=(vfloat a, vfloat b) { return vbool((lanei)(a.v <= b.v)); }
+    inline vbool operator>(vfloat a, vfloat b) { return vbool((lanei)(a.v > b.v)); }
+    inline vbool operator>=(vfloat a, vfloat b) { return vbool((lanei)(a.v >= b.v)); }
+
+    inline vint operator+(vint a, vint b) { return vint(a.v + b.v); }
+    inline vint operator-(vint a, vint b) { return vint(a.v - b.v); }
+    inline vint operator*(vint a, vint b) { return vint(a.v * b.v); }
+    // inactive lanes hold anything, never let them trap on a zero divisor
+    inline vint operator/(vint a, vint b) { return vint(a.v / select(vbool(b.v == 0), vint(1), b).v); }
+    inline vint operator%(vint a, vint b) { return vint(a.v % select(vbool(b.v == 0), vint(1), b).v); }
+    inline vint operator-(vint a) { return vint(-a.v); }
+    inline vbool operator<(vint a, vint b) { return vbool(a.v < b.v); }
+    inline vbool operator<=(vint a, vint b) { return vbool(a.v <= b.v); }
+    inline vbool operator>(vint a, vint b) { return vbool(a.v > b.v); }
+    inline vbool operator>=(vint a, vint b) { return vbool(a.v >= b.v); }
+
+    inline vbool eq(vfloat a, vfloat b) { return vbool((lanei)(a.v == b.v)); }
+    inline vbool eq(vint a, vint b) { return vbool(a.v == b.v); }
+    inline vbool eq(vbool a, vbool b) { return vbool(~(a.v ^ b.v)); }
+
+    // ========================== vectors and matrices ===========================
+    template<int N, typename T>
+    struct tvec
+    {
+        T c[N];
+    };
+
+    template<int C, int R>
+    struct tmat
+    {
+        tvec<R, vfloat> c[C]; // columns, like GLSL
+    };
+
+    typedef tvec<2, vfloat> vec2;
+    typedef tvec<3, vfloat> vec3;
+    typedef tvec<4, vfloat> vec4;
+    typedef tvec<2, vint> ivec2;
+    typedef tvec<3, vint> ivec3;
+    typedef tvec<4, vint> ivec4;
+    typedef tvec<2, vbool> bvec2;
+    typedef tvec<3, vbool> bvec3;
+    typedef tvec<4, vbool> bvec4;
+    typedef tmat<2, 2> mat2;
+    typedef tmat<3, 3> mat3;
+    typedef tmat<4, 4> mat4;
+
+#define GLSL_VEC_OPERATOR(op)                                                           \
+    template<int N, typename T>                                                         \
+    inline tvec<N, T> operator op(const tvec<N, T>& a, const tvec<N, T>& b)             \
+    {                                                                                   \
+        tvec<N, T> r;                                                                   \
+        for (int i = 0; i < N; ++i)                                                     \
+            r.c[i] = a.c[i] op b.c[i];                                                  \
+        return r;                                                                       \
+    }                                                                                   \
+    template<int N, typename T>                                                         \
+    inline tvec<N, T> operator op(const tvec<N, T>& a, const T& b)                      \
+    {                                                                                   \
+        tvec<N, T> r;                                                                   \
+        for (int i = 0; i < N; ++i)                                                     \
+            r.c[i] = a.c[i] op b;                                                       \
+        return r;                                                                       \
+    }                                                                                   \
+    template<int N, typename T>                                                         \
+    inline tvec<N, T> operator op(const T& a, const tvec<N, T>& b)                      \
+    {                                                                                   \
+        tvec<N, T> r;                                                                   \
+        for (int i = 0; i < N; ++i)                                                     \
+            r.c[i] = a op b.c[i];                                                       \
+        return r;                                                                       \
+    }
+    GLSL_VEC_OPERATOR(+)
+    GLSL_VEC_OPERATOR(-)
+    GLSL_VEC_OPERATOR(*)
+    GLSL_VEC_OPERATOR(/)
+    GLSL_VEC_OPERATOR(%)
+#undef GLSL_VEC_OPERATOR
+
+    template<int N, typename T>
+    inline tvec<N, T> operator-(const tvec<N, T>& a)
+    {
+        tvec<N, T> r;
+        for (int i = 0; i < N; ++i)
+            r.c[i] = -a.c[i];
+        return r;
+    }
+
+    // component wise +, -, / and unary -, linear algebra for *
+#define GLSL_MAT_OPERATOR(op)                                                           \
+    template<int C, int R>                                                              \
+    inline tmat<C, R> operator op(const tmat<C, R>& a, const tmat<C, R>& b)             \
+    {                                                                                   \
+        tmat<C, R> r;                                                                   \
+        for (int i = 0; i < C; ++i)                                                     \
+            r.c[i] = a.c[i] op b.c[i];                                                  \
+        return r;                                                                       \
+    }                                                                                   \
+    template<int C, int R>                                                              \
+    inline tmat<C, R> operator op(const tmat<C, R>& a, const vfloat& b)                 \
+    {                                                                                   \
+        tmat<C, R> r;                                                                   \
+        for (int i = 0; i < C; ++i)                                                     \
+            r.c[i] = a.c[i] op b;                                                       \
+        return r;                                                                       \
+    }                                                                                   \
+    template<int C, int R>                                                              \
+    inline tmat<C, R> operator op(const vfloat& a, const tmat<C, R>& b)                 \
+    {                                                                                   \
+        tmat<C, R> r;                                                                   \
+        for (int i = 0; i < C; ++i)                                                     \
+            r.c[i] = a op b.c[i];                                                       \
+        return r;                                                                       \
+    }
+    GLSL_MAT_OPERATOR(+)
+    GLSL_MAT_OPERATOR(-)
+    GLSL_MAT_OPERATOR(/)
+#undef GLSL_MAT_OPERATOR
+
+    template<int C, int R>
+    inline tmat<C, R> operator-(const tmat<C, R>& a)
+    {
+        tmat<C, R> r;
+        for (int i = 0; i < C; ++i)
+            r.c[i] = -a.c[i];
+        return r;
+    }
+    template<int C, int R>
+    inline tmat<C, R> operator*(const tmat<C, R>& a, const vfloat& b)
+    {
+        tmat<C, R> r;
+        for (int i = 0; i < C; ++i)
+            r.c[i] = a.c[i] * b;
+        return r;
+    }
+    template<int C, int R>
+    inline tmat<C, R> operator*(const vfloat& a, const tmat<C, R>& b) { return b * a; }
+    template<int C, int R>
+    inline tvec<R, vfloat> operator*(const tmat<C, R>& m, const tvec<C, vfloat>& v)
+    {
+        tvec<R, vfloat> r = m.c[0] * v.c[0];
+        for (int i = 1; i < C; ++i)
+            r = r + m.c[i] * v.c[i];
+        return r;
+    }
+    template<int C, int R>
+    inline tvec<C, vfloat> operator*(const tvec<R, vfloat>& v, const tmat<C, R>& m)
+    {
+        tvec<C, vfloat> r;
+        for (int i = 0; i < C; ++i)
+        {
+            r.c[i] = v.c[0] * m.c[i].c[0];
+            for (int j = 1; j < R; ++j)
+                r.c[i] = r.c[i] + v.c[j] * m.c[i].c[j];
+        }
+        return r;
+    }
+    template<int K, int C, int R>
+    inline tmat<C, R> operator*(const tmat<K, R>& a, const tmat<C, K>& b)
+    {
+        tmat<C, R> r;
+        for (int i = 0; i < C; ++i)
+            r.c[i] = a * b.c[i];
+        return r;
+    }
+
+    template<int N, typename T>
+    inline vbool eq(const tvec<N, T>& a, const tvec<N, T>& b)
+    {
+        vbool r = eq(a.c[0], b.c[0]);
+        for (int i = 1; i < N; ++i)
+            r = r & eq(a.c[i], b.c[i]);
+        return r;
+    }
+    template<int C, int R>
+    inline vbool eq(const tmat<C, R>& a, const tmat<C, R>& b)
+    {
+        vbool r = eq(a.c[0], b.c[0]);
+        for (int i = 1; i < C; ++i)
+            r = r & eq(a.c[i], b.c[i]);
+        return r;
+    }
+    template<typename T>
+    inline vbool ne(const T& a, const T& b) { return ~eq(a, b); }
+
+    template<int N, typename T>
+    inline tvec<N, T> select(vbool m, const tvec<N, T>& a, const tvec<N, T>& b)
+    {
+        tvec<N, T> r;
+        for (int i = 0; i < N; ++i)
+            r.c[i] = select(m, a.c[i], b.c[i]);
+        return r;
+    }
+    template<int C, int R>
+    inline tmat<C, R> select(vbool m, const tmat<C, R>& a, const tmat<C, R>& b)
+    {
+        tmat<C, R> r;
+        for (int i = 0; i < C; ++i)
+            r.c[i] = select(m, a.c[i], b.c[i]);
+        return r;
+    }
+
+    // =============================== stores ====================================
+    // every write only lands in the lanes that are executing
+    template<typename T>
+    inline const T& assign(T& target, const T& value, vbool exec)
+    {
+        target = select(exec, value, target);
+        return target;
+    }
+    template<typename T, typename One>
+    inline T preAdd(T& target, const One& one, vbool exec)
+    {
+        return assign(target, T(target + one), exec);
+    }
+    template<typename T, typename One>
+    inline T postAdd(T& target, const One& one, vbool exec)
+    {
+        T old = target;
+        assign(target, T(target + one), exec);
+        return old;
+    }
+
+    // swizzle reads, v.zx becomes swz<2, 0>(v)
+    template<int A, int L, typename T>
+    inline T swz(const tvec<L, T>& v) { return v.c[A]; }
+    template<int A, int B, int L, typename T>
+    inline tvec<2, T> swz(const tvec<L, T>& v) { return tvec<2, T>{ { v.c[A], v.c[B] } }; }
+    template<int A, int B, int C, int L, typename T>
+    inline tvec<3, T> swz(const tvec<L, T>& v) { return tvec<3, T>{ { v.c[A], v.c[B], v.c[C] } }; }
+    template<int A, int B, int C, int D, int L, typename T>
+    inline tvec<4, T> swz(const tvec<L, T>& v) { return tvec<4, T>{ { v.c[A], v.c[B], v.c[C], v.c[D] } }; }
+
+    // swizzle writes, v.zx = a becomes swzSet<2, 0>(v, a, exec)
+    template<int A, int L, typename T>
+    inline T swzSet(tvec<L, T>& v, const T& a, vbool exec)
+    {
+        v.c[A] = select(exec, a, v.c[A]);
+        return a;
+    }
+    template<int A, int B, int L, typename T>
+    inline tvec<2, T> swzSet(tvec<L, T>& v, const tvec<2, T>& a, vbool exec)
+    {
+        v.c[A] = select(exec, a.c[0], v.c[A]);
+        v.c[B] = select(exec, a.c[1], v.c[B]);
+        return a;
+    }
+    template<int A, int B, int C, int L, typename T>
+    inline tvec<3, T> swzSet(tvec<L, T>& v, const tvec<3, T>& a, vbool exec)
+    {
+        v.c[A] = select(exec, a.c[0], v.c[A]);
+        v.c[B] = select(exec, a.c[1], v.c[B]);
+        v.c[C] = select(exec, a.c[2], v.c[C]);
+        return a;
+    }
+    template<int A, int B, int C, int D, int L, typename T>
+    inline tvec<4, T> swzSet(tvec<L, T>& v, const tvec<4, T>& a, vbool exec)
+    {
+        v.c[A] = select(exec, a.c[0], v.c[A]);
+        v.c[B] = select(exec, a.c[1], v.c[B]);
+        v.c[C] = select(exec, a.c[2], v.c[C]);
+        v.c[D] = select(exec, a.c[3], v.c[D]);
+        return a;
+    }
+
+    // v[i] with an index that may differ per lane
+    template<int N, typename T>
+    inline T at(const tvec<N, T>& v, vint i)
+    {
+        T r = v.c[0];
+        for (int k = 1; k < N; ++k)
+            r = select(eq(i, vint(k)), v.c[k], r);
+        return r;
+    }
+    template<int C, int R>
+    inline tvec<R, vfloat> at(const tmat<C, R>& m, vint i)
+    {
+        tvec<R, vfloat> r = m.c[0];
+        for (int k = 1; k < C; ++k)
+            r = select(eq(i, vint(k)), m.c[k], r);
+        return r;
+    }
+    template<int N, typename T>
+    inline T atSet(tvec<N, T>& v, vint i, const T& a, vbool exec)
+    {
+        for (int k = 0; k < N; ++k)
+            v.c[k] = select(exec & eq(i, vint(k)), a, v.c[k]);
+        return a;
+    }
+    template<int C, int R>
+    inline tvec<R, vfloat> atSet(tmat<C, R>& m, vint i, const tvec<R, vfloat>& a, vbool exec)
+    {
+        for (int k = 0; k < C; ++k)
+            m.c[k] = select(exec & eq(i, vint(k)), a, m.c[k]);
+        return a;
+    }
+
+    // ============================ constructors =================================
+    inline void cvt(vfloat& d, const vfloat& s) { d = s; }
+    inline void cvt(vfloat& d, const vint& s) { d = vfloat(__builtin_convertvector(s.v, lanef)); }
+    inline void cvt(vfloat& d, const vbool& s) { d = select(s, vfloat(1.0f), vfloat(0.0f)); }
+    inline void cvt(vint& d, const vfloat& s) { d = vint(__builtin_convertvector(s.v, lanei)); }
+    inline void cvt(vint& d, const vint& s) { d = s; }
+    inline void cvt(vint& d, const vbool& s) { d = vint(-s.v); }
+    inline void cvt(vbool& d, const vfloat& s) { d = vbool((lanei)(s.v != 0.0f)); }
+    inline void cvt(vbool& d, const vint& s) { d = vbool(s.v != 0); }
+    inline void cvt(vbool& d, const vbool& s) { d = s; }
+    template<int N, typename D, typename S>
+    inline void cvt(tvec<N, D>& d, const tvec<N, S>& s)
+    {
+        for (int i = 0; i < N; ++i)
+            cvt(d.c[i], s.c[i]);
+    }
+    // float(i), vec3(ivec3) and friends
+    template<typename D, typename S>
+    inline D convert(const S& s)
+    {
+        D d;
+        cvt(d, s);
+        return d;
+    }
+
+    template<typename V>
+    struct Components;
+    template<int N, typename T>
+    struct Components<tvec<N, T>>
+    {
+        typedef T Scalar;
+        static T& get(tvec<N, T>& v, int i) { return v.c[i]; }
+    };
+    template<int C, int R>
+    struct Components<tmat<C, R>>
+    {
+        typedef vfloat Scalar;
+        static vfloat& get(tmat<C, R>& m, int i) { return m.c[i / R].c[i % R]; }
+    };
+
+    template<typename V>
+    struct Builder
+    {
+        typedef typename Components<V>::Scalar Scalar;
+        V value;
+        int count;
+        Builder() : value(), count(0) {}
+        void add(const Scalar& s) { Components<V>::get(value, count++) = s; }
+        template<int M>
+        void add(const tvec<M, Scalar>& v)
+        {
+            for (int i = 0; i < M; ++i)
+                add(v.c[i]);
+        }
+    };
+
+    // vec4(a.xy, 0.0, 1.0): the components of all arguments in order
+    template<typename V, typename... Args>
+    inline V make(const Args&... args)
+    {
+        Builder<V> builder;
+        int expand[] = { (builder.add(args), 0)... };
+        (void)expand;
+        return builder.value;
+    }
+    template<typename V>
+    inline V splat(const typename Components<V>::Scalar& s)
+    {
+        V v;
+        for (int i = 0; i < int(sizeof(v.c) / sizeof(v.c[0])); ++i)
+            v.c[i] = s;
+        return v;
+    }
+    template<typename M>
+    inline M diagonal(const vfloat& s)
+    {
+        M m = M();
+        for (int i = 0; i < int(sizeof(m.c) / sizeof(m.c[0])); ++i)
+            m.c[i].c[i] = s;
+        return m;
+    }
+
+    // ============================= built-ins ===================================
+    // sqrt compiles to one instruction per lane group; the transcendental
+    // functions further down are polynomial, like a GPU's, not libm calls
+    inline vfloat sqrt(vfloat x)
+    {
+        vfloat r;
+        for (int i = 0; i < LANES; ++i)
+            r.v[i] = std::sqrt(x.v[i]);
+        return r;
+    }
+
+    inline vfloat radians(vfloat x) { return x * vfloat(0.0174532925f); }
+    inline vfloat degrees(vfloat x) { return x * vfloat(57.2957795f); }
+    inline vfloat inversesqrt(vfloat x) { return vfloat(1.0f) / sqrt(x); }
+    inline vfloat abs(vfloat x) { return vfloat((lanef)((lanei)x.v & 0x7fffffff)); }
+    inline vint abs(vint x) { return select(x < vint(0), -x, x); }
+    inline vfloat sign(vfloat x) { return select(x > vfloat(0.0f), vfloat(1.0f), select(x < vfloat(0.0f), vfloat(-1.0f), vfloat(0.0f))); }
+    inline vint sign(vint x) { return select(x > vint(0), vint(1), select(x < vint(0), vint(-1), vint(0))); }
+
+    // beyond 2^23 every float is already an integer
+    inline vbool hasFraction(vfloat x) { return abs(x) < vfloat(8388608.0f); }
+    inline vfloat trunc(vfloat x) { return select(hasFraction(x), convert<vfloat>(convert<vint>(x)), x); }
+    inline vfloat floor(vfloat x)
+    {
+        vfloat t = trunc(x);
+        return select(t > x, t - vfloat(1.0f), t);
+    }
+    inline vfloat ceil(vfloat x)
+    {
+        vfloat t = trunc(x);
+        return select(t < x, t + vfloat(1.0f), t);
+    }
+    inline vfloat round(vfloat x)
+    {
+        // adding and removing 1.5 * 2^23 rounds half to even, like the GPU
+        const vfloat magic(12582912.0f);
+        return select(hasFraction(x), (x + magic) - magic, x);
+    }
+    inline vfloat fract(vfloat x) { return x - floor(x); }
+    inline vfloat mod(vfloat x, vfloat y) { return x - y * floor(x / y); }
+    inline vfloat min(vfloat x, vfloat y) { return select(y < x, y, x); }
+    inline vfloat max(vfloat x, vfloat y) { return select(x < y, y, x); }
+    inline vint min(vint x, vint y) { return select(y < x, y, x); }
+    inline vint max(vint x, vint y) { return select(x < y, y, x); }
+    inline vfloat clamp(vfloat x, vfloat lo, vfloat hi) { return min(max(x, lo), hi); }
+    inline vint clamp(vint x, vint lo, vint hi) { return min(max(x, lo), hi); }
+    inline vfloat step(vfloat edge, vfloat x) { return select(x < edge, vfloat(0.0f), vfloat(1.0f)); }
+    inline vfloat mix(vfloat x, vfloat y, vfloat a) { return x * (vfloat(1.0f) - a) + y * a; }
+    inline vfloat smoothstep(vfloat e0, vfloat e1, vfloat x)
+    {
+        vfloat t = clamp((x - e0) / (e1 - e0), vfloat(0.0f), vfloat(1.0f));
+        return t * t * (vfloat(3.0f) - vfloat(2.0f) * t);
+    }
+
+    // sin and cos share the reduction to [-pi/4, pi/4] (Cephes sinf/cosf)
+    inline void sinCos(vfloat x, vfloat& s, vfloat& c)
+    {
+        const lanef ax = abs(x).v;
+        lanei j = __builtin_convertvector(ax * 1.27323954f, lanei);
+        j = (j + 1) & ~1;
+        const lanef y = __builtin_convertvector(j, lanef);
+        // pi/4 split in three so the reduction stays exact for large arguments
+        const lanef r = ((ax - y * 0.78515625f) - y * 2.41875648e-4f) - y * 3.77489497e-8f;
+        const lanef z = r * r;
+        const vfloat ps(((-1.95152959e-4f * z + 8.33216087e-3f) * z - 1.66666546e-1f) * z * r + r);
+        const vfloat pc(((2.44331571e-5f * z - 1.38873163e-3f) * z + 4.16666457e-2f) * z * z - 0.5f * z + 1.0f);
+        const vbool swap((j & 2) != 0);
+        const lanei sinSign = (((j & 4) != 0) ^ (x.v < 0.0f)) & (int)0x80000000;
+        const lanei cosSign = (((j + 2) & 4) != 0) & (int)0x80000000;
+        s = vfloat((lanef)((lanei)select(swap, pc, ps).v ^ sinSign));
+        c = vfloat((lanef)((lanei)select(swap, ps, pc).v ^ cosSign));
+    }
+    inline vfloat sin(vfloat x)
+    {
+        vfloat s, c;
+        sinCos(x, s, c);
+        return s;
+    }
+    inline vfloat cos(vfloat x)
+    {
+        vfloat s, c;
+        sinCos(x, s, c);
+        return c;
+    }
+    inline vfloat tan(vfloat x)
+    {
+        vfloat s, c;
+        sinCos(x, s, c);
+        return s / c;
+    }
+
+    // Cephes atanf, reduced to |x| < tan(pi/8)
+    inline vfloat atan(vfloat x)
+    {
+        const vfloat ax = abs(x);
+        const vbool big = ax > vfloat(2.41421356f);
+        const vbool mid = ax > vfloat(0.414213562f);
+        const vfloat base = select(big, vfloat(1.57079633f), select(mid, vfloat(0.785398163f), vfloat(0.0f)));
+        const vfloat r = select(big, vfloat(-1.0f) / ax, select(mid, (ax - vfloat(1.0f)) / (ax + vfloat(1.0f)), ax));
+        const lanef z = r.v * r.v;
+        const lanef y = (((8.05374449e-2f * z - 1.38776856e-1f) * z + 1.99777106e-1f) * z - 3.33329491e-1f) * z * r.v + r.v + base.v;
+        return vfloat((lanef)((lanei)y ^ ((lanei)x.v & (int)0x80000000)));
+    }
+    // GLSL's atan(y, x)
+    inline vfloat atan(vfloat y, vfloat x)
+    {
+        const vfloat r = atan(y / x);
+        const vfloat half = select(y < vfloat(0.0f), vfloat(-3.14159265f), vfloat(3.14159265f));
+        const vfloat full = select(x < vfloat(0.0f), r + half, r);
+        return select(eq(x, vfloat(0.0f)) & eq(y, vfloat(0.0f)), vfloat(0.0f), full);
+    }
+    inline vfloat asin(vfloat x) { return atan(x, sqrt(vfloat(1.0f) - x * x)); }
+    inline vfloat acos(vfloat x) { return atan(sqrt(vfloat(1.0f) - x * x), x); }
+
+    // 2^round(x) from the exponent bits times e^(f ln 2) for the rest (Cephes expf);
+    // results below 2^-126 flush to zero like on the GPU
+    inline vfloat exp2(vfloat x)
+    {
+        const vfloat n = round(clamp(x, vfloat(-126.0f), vfloat(127.0f)));
+        const lanef f = (x.v - n.v) * 0.693147181f;
+        const lanef p = (((((1.98756915e-4f * f + 1.39819995e-3f) * f + 8.33345191e-3f) * f + 4.16657959e-2f) * f
+                          + 1.66666655e-1f) * f + 5.00000012e-1f) * f * f + f + 1.0f;
+        const lanef scale = (lanef)((__builtin_convertvector(n.v, lanei) + 127) << 23);
+        const vfloat r(p * scale);
+        return select(x < vfloat(-126.0f), vfloat(0.0f), select(x >= vfloat(128.0f), vfloat(HUGE_VALF), r));
+    }
+    // exponent bits plus Cephes logf on a mantissa in [sqrt(1/2), sqrt(2))
+    inline vfloat log2(vfloat x)
+    {
+        const lanei bits = (lanei)x.v;
+        const vbool high = vbool((bits & 0x007fffff) > 0x003504f3);
+        const lanef m = (lanef)((bits & 0x007fffff) | 0x3f800000);
+        const lanef f = select(high, vfloat(m * 0.5f), vfloat(m)).v - 1.0f;
+        const lanef e = __builtin_convertvector(((bits >> 23) & 0xff) - 127 - high.v, lanef);
+        const lanef z = f * f;
+        const lanef y = ((((((((7.0376836e-2f * f - 1.1514610e-1f) * f + 1.1676998e-1f) * f - 1.2420141e-1f) * f
+                             + 1.4249323e-1f) * f - 1.6668057e-1f) * f + 2.0000714e-1f) * f - 2.4999994e-1f) * f
+                          + 3.3333331e-1f) * f * z;
+        const vfloat r((f - 0.5f * z + y) * 1.44269504f + e);
+        // zero and denormals go to -inf, negative numbers to NaN, inf and NaN stay
+        return select(x < vfloat(1.17549435e-38f), select(x < vfloat(0.0f), vfloat(NAN), vfloat(-HUGE_VALF)),
+                      select(x < vfloat(HUGE_VALF), r, x));
+    }
+    inline vfloat exp(vfloat x) { return exp2(x * vfloat(1.44269504f)); }
+    inline vfloat log(vfloat x) { return log2(x) * vfloat(0.693147181f); }
+    inline vfloat pow(vfloat x, vfloat y) { return exp2(y * log2(x)); }
+
+#define GLSL_COMPONENTWISE1(name)                                                       \
+    template<int N, typename T>                                                         \
+    inline tvec<N, T> name(const tvec<N, T>& x)                                         \
+    {                                                                                   \
+        tvec<N, T> r;                                                                   \
+        for (int i = 0; i < N; ++i)                                                     \
+            r.c[i] = name(x.c[i]);                                                      \
+        return r;                                                                       \
+    }
+#define GLSL_COMPONENTWISE2(name)                                                       \
+    template<int N, typename T>                                                         \
+    inline tvec<N, T> name(const tvec<N, T>& x, const tvec<N, T>& y)                    \
+    {                                                                                   \
+        tvec<N, T> r;                                                                   \
+        for (int i = 0; i < N; ++i)                                                     \
+            r.c[i] = name(x.c[i], y.c[i]);                                              \
+        return r;                                                                       \
+    }
+#define GLSL_COMPONENTWISE3(name)                                                       \
+    template<int N, typename T>                                                         \
+    inline tvec<N, T> name(const tvec<N, T>& x, const tvec<N, T>& y, const tvec<N, T>& z) \
+    {                                                                                   \
+        tvec<N, T> r;                                                                   \
+        for (int i = 0; i < N; ++i)                                                     \
+            r.c[i] = name(x.c[i], y.c[i], z.c[i]);                                      \
+        return r;                                                                       \
+    }
+    GLSL_COMPONENTWISE1(radians) GLSL_COMPONENTWISE1(degrees)
+    GLSL_COMPONENTWISE1(sin) GLSL_COMPONENTWISE1(cos) GLSL_COMPONENTWISE1(tan)
+    GLSL_COMPONENTWISE1(asin) GLSL_COMPONENTWISE1(acos) GLSL_COMPONENTWISE1(atan) GLSL_COMPONENTWISE2(atan)
+    GLSL_COMPONENTWISE1(exp) GLSL_COMPONENTWISE1(log) GLSL_COMPONENTWISE1(exp2) GLSL_COMPONENTWISE1(log2)
+    GLSL_COMPONENTWISE1(sqrt) GLSL_COMPONENTWISE1(inversesqrt)
+    GLSL_COMPONENTWISE1(abs) GLSL_COMPONENTWISE1(sign) GLSL_COMPONENTWISE1(floor) GLSL_COMPONENTWISE1(ceil)
+    GLSL_COMPONENTWISE1(fract) GLSL_COMPONENTWISE1(trunc) GLSL_COMPONENTWISE1(round)
+    GLSL_COMPONENTWISE2(pow) GLSL_COMPONENTWISE2(mod) GLSL_COMPONENTWISE2(min) GLSL_COMPONENTWISE2(max)
+    GLSL_COMPONENTWISE2(step)
+    GLSL_COMPONENTWISE3(clamp) GLSL_COMPONENTWISE3(mix) GLSL_COMPONENTWISE3(smoothstep)
+#undef GLSL_COMPONENTWISE1
+#undef GLSL_COMPONENTWISE2
+#undef GLSL_COMPONENTWISE3
+
+    inline vfloat dot(vfloat a, vfloat b) { return a * b; }
+    inline vfloat length(vfloat x) { return abs(x); }
+    inline vfloat distance(vfloat a, vfloat b) { return abs(a - b); }
+    inline vfloat normalize(vfloat x) { return x / abs(x); }
+    inline vfloat reflect(vfloat i, vfloat n) { return i - vfloat(2.0f) * dot(n, i) * n; }
+    template<int N>
+    inline vfloat dot(const tvec<N, vfloat>& a, const tvec<N, vfloat>& b)
+    {
+        vfloat r = a.c[0] * b.c[0];
+        for (int i = 1; i < N; ++i)
+            r = r + a.c[i] * b.c[i];
+        return r;
+    }
+    template<int N>
+    inline vfloat length(const tvec<N, vfloat>& x) { return sqrt(dot(x, x)); }
+    template<int N>
+    inline vfloat distance(const tvec<N, vfloat>& a, const tvec<N, vfloat>& b) { return length(a - b); }
+    template<int N>
+    inline tvec<N, vfloat> normalize(const tvec<N, vfloat>& x) { return x * inversesqrt(dot(x, x)); }
+    template<int N>
+    inline tvec<N, vfloat> reflect(const tvec<N, vfloat>& i, const tvec<N, vfloat>& n) { return i - vfloat(2.0f) * dot(n, i) * n; }
+    inline vec3 cross(const vec3& a, const vec3& b)
+    {
+        return vec3{ { a.c[1] * b.c[2] - b.c[1] * a.c[2], a.c[2] * b.c[0] - b.c[2] * a.c[0], a.c[0] * b.c[1] - b.c[0] * a.c[1] } };
+    }
+
+    // ============================ tile glue ====================================
+    // x offsets of the lanes, 0, 1, 2, ...
+    inline vfloat laneOffsets()
+    {
+        vfloat r;
+        for (int i = 0; i < LANES; ++i)
+            r.v[i] = float(i);
+        return r;
+    }
+    // lanes [0, count) are on, for the ragged right edge of a tile
+    inline vbool lanesBelow(int count)
+    {
+        vbool r;
+        for (int i = 0; i < LANES; ++i)
+            r.v[i] = i < count ? -1 : 0;
+        return r;
+    }
+    // float -> unorm8 the way the GL writes an RGBA8 attachment
+    inline unsigned char unorm8(float x)
+    {
+        if (!(x > 0.0f))
+            return 0;
+        if (x >= 1.0f)
+            return 255;
+        return (unsigned char)(x * 255.0f + 0.5f);
+    }
+    inline void storePixels(unsigned char* rgba, int count, const vec4& colour)
+    {
+        for (int i = 0; i < count; ++i)
+            for (int c = 0; c < 4; ++c)
+                rgba[i * 4 + c] = unorm8(colour.c[c].v[i]);
+    }
+}
+
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef GLSL_TRANSPILER_H
+#define GLSL_TRANSPILER_H
+
+#include "myImplement/glsl_front.h"
+
+#include <string>
+
+/**
+ * @brief turns a parsed fragment shader into a self contained C++
+ * translation unit over the lane types of glsl_runtime.h, so one
+ * call to main() shades a whole row of LANES pixels with masked
+ * control flow. the generated code exports one tile function that
+ * runs main() for every pixel of a rectangle, with the first 'in'
+ * variable set to the pixel centre and the first 'out' variable
+ * stored as RGBA8.
+ */
+namespace glsl
+{
+    // false with 'error' set for the few constructs that have no C++ translation
+    bool transpile(const Program& program, std::string& source, std::string& error);
+}
+
+#endif
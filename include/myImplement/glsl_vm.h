@@ -0,0 +1,67 @@
+#ifndef GLSL_VM_H
+#define GLSL_VM_H
+
+#include "myImplement/glsl_front.h"
+
+#include <string>
+#include <vector>
+
+// pixels one VM instruction works on, a multiple of the lane width
+#define GLSL_VM_LANES 16
+
+/**
+ * @brief a bytecode back end for the same GLSL subset as the
+ * transpiler, for machines without a host compiler. every value is
+ * split into scalar registers (a vec3 is three of them, swizzles and
+ * fields just pick registers) and each register holds one component
+ * for GLSL_VM_LANES pixels, so one dispatch shades a whole row of
+ * pixels. user functions are inlined and control flow is masked per
+ * lane exactly like the transpiled code, so both back ends give the
+ * same pixels.
+ */
+namespace glsl
+{
+    // dst = op(a, b, c) on register indices; jumps keep their target in 'a'
+    struct VmInstr
+    {
+        int op;
+        int dst;
+        int a;
+        int b;
+        int c;
+    };
+
+    // registers filled before a tile runs: constants as raw bits, uniforms from the float block
+    struct VmConstant
+    {
+        int reg;
+        unsigned bits;
+    };
+
+    struct VmUniform
+    {
+        int reg;
+        int offset;
+        BaseType base;
+    };
+
+    struct VmProgram
+    {
+        std::vector<VmInstr> code;
+        std::vector<VmConstant> constants;
+        std::vector<VmUniform> uniforms;
+        std::vector<int> input;  // components of the first 'in' variable
+        std::vector<int> output; // components of the first 'out' variable
+        int execRegister;
+        int registerCount;
+
+        VmProgram() : execRegister(0), registerCount(0) {}
+    };
+
+    // false with 'error' set for the constructs the VM cannot run
+    bool compileVm(const Program& program, VmProgram& vm, std::string& error);
+    // same contract as ShadertoyTileFunc in glsl_runtime.h
+    void runVm(const VmProgram& vm, const float* uniforms, int x0, int y0, int x1, int y1, int width, unsigned char* rgba);
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+
+/**
+ * @brief an OpenGL context without any window or display.
+ * on linux it is a surfaceless EGL context (works with mesa
+ * llvmpipe on machines that have no GPU at all), falling back
+ * to a tiny pbuffer when the driver cannot go surfaceless.
+ * on other platforms an invisible GLFW window is used instead.
+ * all rendering must go to an off-screen framebuffer.
+ */
+class HeadlessContext
+{
+private:
+    void* display;
+    void* surface;
+    void* context;
+    void* window; // only used by the GLFW fallback
+
+public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // create a core profile context and make it current
+    bool create(int major = 3, int minor = 3);
+    void destroy();
+    void makeCurrent();
+
+    // the loader to hand over to gladLoadGLLoader
+    static GLADloadproc getProcLoader();
+};
+
+#endif
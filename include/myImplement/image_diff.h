@@ -0,0 +1,49 @@
+#ifndef IMAGE_DIFF_H
+#define IMAGE_DIFF_H
+
+#include <string>
+#include <vector>
+
+// how far one tile of a frame is from the same tile of its golden image
+struct TileError
+{
+    int x, y;       // tile column and row, row 0 at the bottom like the pixels
+    double mse;     // over R, G and B
+    float psnr;     // dB, 99 when identical
+    float ssim;     // mean over the tile's 8x8 luma windows, 1 when identical
+};
+
+struct ImageDiff
+{
+    int width, height;
+    int tileSize;
+    int tilesX, tilesY;
+    double mse;
+    float psnr;
+    float ssim;
+    int maxError;                 // largest difference of any channel of any pixel
+    std::vector<TileError> tiles; // row by row, bottom row first
+
+    ImageDiff() : width(0), height(0), tileSize(0), tilesX(0), tilesY(0), mse(0.0), psnr(99.0f), ssim(1.0f), maxError(0) {}
+    // the tile with the lowest SSIM, the highest MSE among equals; null without tiles
+    const TileError* worstTile() const;
+    // one line: PSNR, SSIM, max error and the worst tile
+    std::string summary() const;
+};
+
+// compare two RGBA8 images of width x height, alpha is ignored. PSNR is
+// taken over R, G and B; SSIM on BT.601 luma over non-overlapping 8x8
+// windows, the block variant that needs no blur and ranks changes much
+// like the gaussian one. both are also kept per tile of 'tileSize'
+// pixels, rounded up to a multiple of 8. pixels past the last whole
+// window count for the PSNR only, a tile without a whole window keeps
+// an SSIM of 1
+ImageDiff diffImages(const unsigned char* rgba, const unsigned char* golden, int width, int height, int tileSize = 32);
+
+// the error map of 'diff' as a PPM: red is the tile's 1 - SSIM, green the
+// pixel's largest channel difference, both amplified, over the golden
+// image's luma dimmed in blue, so the tiles that moved stand out and
+// the pixels that did show inside them
+bool writeErrorMap(const std::string& filePath, const ImageDiff& diff, const unsigned char* rgba, const unsigned char* golden);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief tiny helpers to dump rendered frames to disk. frames
+ * come straight from glReadPixels, so rows are stored bottom
+ * row first and get flipped on the way out. binary PPM keeps
+ * us free of any encoder dependency.
+ */
+
+// write RGB or RGBA pixels (alpha is dropped) as a binary PPM
+bool writePPM(const std::string& filePath, int width, int height, int channels, const unsigned char* pixels, bool flipY = true);
+
+// read a binary PPM back as RGBA8, bottom row first like glReadPixels
+bool readPPM(const std::string& filePath, int& width, int& height, std::vector<unsigned char>& pixels);
+
+// create a directory, and its parents, if it does not exist yet
+bool ensureDirectory(const std::string& dirPath);
+
+// "<dir>/<prefix>00042.ppm"
+std::string framePath(const std::string& dirPath, const std::string& prefix, int frameIndex, const char* ext = "ppm");
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef INPUT_RECORD_H
+#define INPUT_RECORD_H
+
+#include <glm/glm.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+enum InputEventType
+{
+    INPUT_MOUSE = 1,  // cursor position x, y
+    INPUT_SCROLL = 2, // scroll offset x, y
+    INPUT_KEY = 3     // a key press, 'key' holds the GLFW key
+};
+
+struct InputEvent
+{
+    InputEventType type;
+    float x, y;
+    int key;
+};
+
+// one frame of a log: its clock, the keys held down for it and the
+// events that came in since the frame before
+struct InputFrame
+{
+    double time;
+    unsigned int keys; // a bit per held key, the caller picks which
+    std::vector<InputEvent> events;
+
+    InputFrame() : time(0.0), keys(0) {}
+};
+
+/**
+ * @brief writes the input of a live window to a compact binary log: a
+ * header with the window size and the date it started at, then one
+ * record per frame (13 bytes: its time and the held keys) and one per
+ * event (9 bytes), in the order they happened. events belong to the
+ * frame after them, the one that sees them first.
+ */
+class InputRecorder
+{
+private:
+    std::ofstream file;
+    std::string path;
+    int frames;
+
+    void writeEvent(InputEventType type, float x, float y);
+
+public:
+    InputRecorder();
+
+    // start a log for a width x height window opened on 'date' (iDate)
+    bool open(const std::string& filePath, int width, int height, const glm::vec4& date);
+    // the next frame starts at 'time' seconds with 'keys' held
+    void frame(double time, unsigned int keys);
+    void mouse(double x, double y);
+    void scroll(double x, double y);
+    void key(int key);
+    // flush and close, false if any of it could not be written
+    bool close();
+
+    bool isOpen() const { return file.is_open(); }
+    int getFrames() const { return frames; }
+};
+
+/**
+ * @brief reads an InputRecorder log back, all of it on open(), and hands
+ * out its frames in order. a log cut short, e.g. by a crash, replays up
+ * to its last whole frame.
+ */
+class InputReplay
+{
+private:
+    std::vector<InputFrame> frames;
+    size_t cursor;
+    int width, height;
+    glm::vec4 date;
+
+public:
+    InputReplay();
+
+    bool open(const std::string& filePath);
+    // the next frame, false past the last one
+    bool next(InputFrame& frame);
+    void rewind() { cursor = 0; }
+
+    bool isOpen() const { return !frames.empty(); }
+    int getFrames() const { return int(frames.size()); }
+    // frames handed out so far
+    int getPosition() const { return int(cursor); }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    const glm::vec4& getDate() const { return date; }
+};
+
+#endif
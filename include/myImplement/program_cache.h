@@ -0,0 +1,65 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <string>
+
+struct ProgramCacheStats
+{
+    int hits;          // programs loaded from a binary
+    int misses;        // programs compiled from source
+    int rejected;      // binaries the driver refused, or written by another driver
+    int stored;        // binaries written after a compile
+    double loadMs;     // time spent loading binaries
+    double compileMs;  // time spent compiling and linking on misses
+    double savedMs;    // compile time the hits would have cost, less their load time
+
+    ProgramCacheStats()
+        : hits(0), misses(0), rejected(0), stored(0), loadMs(0.0), compileMs(0.0), savedMs(0.0) {}
+    // one line: hit rate, load and compile time, time saved
+    std::string summary() const;
+};
+
+/**
+ * @brief an on-disk cache of linked programs (glGetProgramBinary blobs).
+ * an entry is named after the hash of the final vertex and fragment
+ * sources, after the frame globals are injected, and records which
+ * driver (vendor, renderer, version) wrote it. a binary from another
+ * driver, or one the driver refuses, counts as rejected: the program is
+ * compiled from source and the entry rewritten.
+ *
+ * glad only loads GL 3.3, so open() takes the context's proc loader to
+ * find the program binary entry points (GL 4.1 / ARB_get_program_binary).
+ */
+class ProgramCache
+{
+private:
+    std::string directory;
+    unsigned long long driverHash;
+    bool enabled;
+    ProgramCacheStats stats;
+
+    std::string entryPath(unsigned long long sourceHash) const;
+
+public:
+    ProgramCache();
+
+    // use 'directory' for this context; false (and the cache stays off)
+    // if the driver cannot hand out program binaries
+    bool open(const std::string& directory, GLADloadproc loader);
+
+    // hash of the sources a program is built from, the entry's key
+    static unsigned long long hashSources(const std::string& vertexCode, const std::string& fragmentCode);
+    // a linked program built from the sources, or 0 on a miss
+    GLuint load(unsigned long long sourceHash);
+    // call on a new program before linking it, so the driver keeps its binary
+    void prepare(GLuint program) const;
+    // save a freshly linked program that took 'compileMs' to build
+    void store(GLuint program, unsigned long long sourceHash, double compileMs);
+
+    bool isEnabled() const { return enabled; }
+    const ProgramCacheStats& getStats() const { return stats; }
+};
+
+#endif
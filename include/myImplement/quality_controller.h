@@ -0,0 +1,87 @@
+#ifndef QUALITY_CONTROLLER_H
+#define QUALITY_CONTROLLER_H
+
+#include <fstream>
+#include <string>
+
+struct QualityControlStats
+{
+    int frames;        // frames measured
+    int overBudget;    // of those, over target * (1 + hysteresis)
+    int tierDowns;
+    int tierUps;
+    int heldBack;      // raises skipped because the tier was left over budget recently
+    int scaleChanges;
+
+    QualityControlStats() : frames(0), overBudget(0), tierDowns(0), tierUps(0), heldBack(0), scaleChanges(0) {}
+    // one line: frames over budget, tier moves and resolution changes
+    std::string summary() const;
+};
+
+/**
+ * @brief holds the frame time near a target by moving the quality tier,
+ * on top of DynamicResolution moving the render scale. the scale is the
+ * quick, fine lever; the tier only drops once the scale is down to its
+ * minimum and the frame is still over budget, and only rises once the
+ * scale is back at its maximum with time to spare.
+ *
+ * the cost of a frame is the larger of its smoothed GPU and CPU times. the
+ * tier drops once it has been over budget for 'dwell' frames in a row and
+ * rises after twice that under budget; the tier above is built in the
+ * background half way there, so the switch does not wait for a compile.
+ * a tier that was left for being over budget is not tried again for a
+ * cooldown that doubles each time it is left again, so the controller
+ * settles instead of flapping between two tiers. every decision, tier or
+ * scale, is printed and, with setLog(), appended to a CSV file. no GL
+ * here, the caller measures and applies.
+ */
+class QualityController
+{
+private:
+    float targetMs;
+    float hysteresis;
+    int dwell;
+    int tierCount;
+
+    int tier;
+    int frame;
+    float cpuMs;          // smoothed
+    float lastScale;
+    int overFrames;       // consecutive frames with the condition to drop
+    int underFrames;      // consecutive frames with the condition to rise
+    int settleFrames;     // frames left to ignore after a tier change
+    int prewarm;          // tier to build ahead, -1 for none
+    int cooldownTier;     // tier left over budget, -1 for none
+    int cooldownUntil;    // frame it may be tried again from
+    int cooldownFrames;   // length of the next cooldown
+    QualityControlStats stats;
+    std::ofstream log;
+
+    void decide(float time, float gpuMs, float cost, float scale, const std::string& what, const std::string& reason);
+
+public:
+    // 'dwell' frames a condition has to hold before the tier moves
+    QualityController(float targetMs, int tierCount, int tier, float hysteresis = 0.1f, int dwell = 30);
+
+    QualityController(const QualityController&) = delete;
+    QualityController& operator=(const QualityController&) = delete;
+
+    // append every decision to 'path' as CSV, false if it cannot be opened
+    bool setLog(const std::string& path);
+    // one rendered frame at 'time' seconds: the smoothed GPU time, 0 while
+    // none is known, this frame's CPU time, and the render scale with its
+    // range; true if the tier to draw changed
+    bool submit(float time, float gpuMs, float frameCpuMs, float scale, float minScale, float maxScale);
+
+    // the tier was picked by hand at 'time', carry on from there
+    void setTier(float time, int tier);
+
+    // the tier to draw from now on
+    int getTier() const { return tier; }
+    // a tier worth building in the background, -1 if there is none
+    int getPrewarm() const { return prewarm; }
+    float getCpuMs() const { return cpuMs; }
+    const QualityControlStats& getStats() const { return stats; }
+};
+
+#endif
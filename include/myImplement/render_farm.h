@@ -0,0 +1,185 @@
+#ifndef RENDER_FARM_H
+#define RENDER_FARM_H
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// what every worker renders, sent to it when it joins. paths are
+// relative to the worker's bin directory, like in the configs
+struct FarmSetup
+{
+    int width, height;           // of the whole frame
+    float timeStart, timeStep;   // iTime of frame n is timeStart + n * timeStep
+    float mouseX, mouseY;
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string library;         // where #include looks after the shader's directory
+    std::string quality;         // the quality tier file, if 'tier' is given
+    std::string tier;            // empty for the shader as written
+    unsigned long long sourceHash; // of the expanded sources at the tier, the coordinator's
+
+    FarmSetup() : width(0), height(0), timeStart(0.0f), timeStep(1.0f / 60.0f), mouseX(0.0f), mouseY(0.0f), sourceHash(0) {}
+};
+
+// one piece of work: a tile of a frame, or all of it
+struct FarmJob
+{
+    int frame;
+    int x, y;          // lower left pixel, row 0 at the bottom
+    int width, height;
+};
+
+// frames [frameBeg, frameEnd) of width x height as jobs, frame after
+// frame; a tile size of 0 keeps whole frames
+std::vector<FarmJob> splitFrames(int frameBeg, int frameEnd, int width, int height, int tileWidth, int tileHeight);
+
+struct FarmStats
+{
+    int jobs;          // jobs rendered
+    int frames;        // frames handed to the consumer
+    int steals;        // an idle worker took half of another's queue
+    int retries;       // jobs handed out again after their worker failed them or went away
+    int workersLost;   // workers that died, hung or were turned away
+    int peakFrames;    // most frames held for reassembly at once
+    double seconds;
+    std::vector<int> jobsPerWorker;
+
+    FarmStats() : jobs(0), frames(0), steals(0), retries(0), workersLost(0), peakFrames(0), seconds(0.0) {}
+    // one line: frames, rate, steals, retries, lost workers and the jobs each worker did
+    std::string summary() const;
+};
+
+// the worker side: build what a coordinator asks for, then render its jobs
+struct FarmHandler
+{
+    // build 'setup', putting the hash of the sources this host would render
+    // in 'sourceHash'; false, with 'error', turns the coordinator down
+    std::function<bool(const FarmSetup& setup, unsigned long long& sourceHash, std::string& error)> setup;
+    // job.width x job.height RGBA8 into 'rgba', bottom row first
+    std::function<bool(const FarmJob& job, std::vector<unsigned char>& rgba)> render;
+};
+
+// serve one coordinator on the connected socket 'fd' until it is done,
+// then close it; false if it went away or the setup failed
+bool serveFarm(int fd, const FarmHandler& handler);
+// serve the coordinators that connect to 'port', one after the other;
+// only returns if the port cannot be opened
+bool listenFarm(int port, const FarmHandler& handler);
+
+/**
+ * @brief renders frames on worker processes, local ones it starts
+ * itself and remote ones listening on other hosts, and hands the
+ * frames, put back together from their tiles, to a consumer in order.
+ *
+ * the jobs are dealt out round robin into one queue per worker, so
+ * every worker starts on the oldest frames. a worker keeps up to
+ * 'depth' jobs in flight, taken from the front of its queue; once that
+ * runs dry it steals the older half of the longest queue, the frames
+ * the consumer waits for first. no job goes out more than 'reorder'
+ * frames past the oldest unfinished one, which bounds the frames held
+ * for reassembly.
+ *
+ * a worker that closes its connection, fails a job, or stays silent
+ * past the timeout is dropped: its jobs go back into the other queues
+ * and its process, if local, is killed. a job that failed 'retries'
+ * times, or a farm without workers, ends the run. every worker reports
+ * the hash of the sources it built, one that differs from the
+ * coordinator's (another checkout, another quality file) is turned
+ * away before it renders anything.
+ *
+ * POSIX only: local workers are forked and talk over a socket pair,
+ * remote ones over TCP.
+ */
+class FarmCoordinator
+{
+public:
+    // a finished frame, width x height RGBA8; false stops the run
+    typedef std::function<bool(int frame, const unsigned char* rgba)> Consumer;
+
+private:
+    enum WorkerState { JOINING, READY, LOST };
+
+    struct Worker
+    {
+        std::string name;
+        int fd;
+        int pid;                        // local workers only, 0 otherwise
+        WorkerState state;
+        std::deque<int> queue;          // job indices, ascending
+        std::vector<int> inFlight;
+        std::vector<unsigned char> received;
+        std::chrono::steady_clock::time_point lastHeard;
+        int done;
+    };
+
+    struct Frame
+    {
+        std::vector<unsigned char> pixels;
+        int missing;                    // jobs not back yet
+    };
+
+    FarmSetup setup;
+    std::vector<Worker> workers;
+    int depth;
+    int reorder;
+    int retries;
+    double timeout;
+
+    const std::vector<FarmJob>* jobs;
+    std::vector<int> attempts;          // failures per job
+    std::vector<int> ordinal;           // per job, the position of its frame in the range
+    std::vector<int> frameNumbers;      // per position
+    std::vector<int> jobsInFrame;       // per position
+    std::map<int, Frame> frames;        // by position, the frames with jobs out or back
+    int flushed;                        // frames handed to the consumer so far
+    std::string error;
+    FarmStats stats;
+
+    bool join(Worker& worker);
+    void lose(Worker& worker, const std::string& reason);
+    // put a job back into the live queue with the least work; a job that
+    // 'failed' counts towards its retries, false once past them
+    bool requeue(int job, bool failed);
+    bool next(Worker& worker, int& job);
+    void dispatch(Worker& worker);
+    // read what arrived and handle every whole message in it
+    void receive(Worker& worker);
+    // false if the message cost the worker its place
+    bool handle(Worker& worker, unsigned int type, const unsigned char* body, size_t length);
+
+public:
+    FarmCoordinator(const FarmSetup& setup);
+    ~FarmCoordinator();
+
+    FarmCoordinator(const FarmCoordinator&) = delete;
+    FarmCoordinator& operator=(const FarmCoordinator&) = delete;
+
+    // start 'command' (argv[0] first) as a local worker, with the socket's
+    // file descriptor appended as its last argument
+    bool addLocal(const std::vector<std::string>& command);
+    // connect to a worker listening at "host:port"
+    bool addRemote(const std::string& address);
+
+    // jobs in flight per worker
+    void setDepth(int count) { depth = count > 0 ? count : 1; }
+    // frames handed out past the oldest unfinished one
+    void setReorder(int count) { reorder = count > 0 ? count : 1; }
+    // failures a job may have before the run is given up
+    void setRetries(int count) { retries = count > 0 ? count : 1; }
+    // seconds a worker with work may go without answering
+    void setTimeout(double seconds) { timeout = seconds; }
+
+    // render 'frameJobs' (from splitFrames) and hand every frame to
+    // 'consumer', in order; false, see getError(), if it could not finish
+    bool run(const std::vector<FarmJob>& frameJobs, const Consumer& consumer);
+
+    int getWorkerCount() const { return int(workers.size()); }
+    const std::string& getError() const { return error; }
+    const FarmStats& getStats() const { return stats; }
+};
+
+#endif
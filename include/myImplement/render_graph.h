@@ -0,0 +1,121 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include "myImplement/frame_globals.h"
+#include "myImplement/shader.h"
+#include "myImplement/shader_loader.h"
+#include "myImplement/shader_permutations.h"
+#include "myImplement/target_allocator.h"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief a shadertoy style multipass frame: Buffer passes render into
+ * off-screen targets, the Image pass into whatever framebuffer is bound
+ * when render() is called. passes are declared in a YAML file:
+ *
+ *   passes:
+ *     - name: BufferA
+ *       fragment: ../shader/shader_frag/feedback_bufa_fs.glsl
+ *       format: rgba16f           # rgba8, rgba16f or rgba32f
+ *       channels: [BufferA.prev]  # iChannel0..3
+ *     - name: Image
+ *       fragment: ...
+ *       channels: [BufferA]
+ *
+ * a channel names a pass to read what it rendered this frame, or
+ * "name.prev" for what it rendered the frame before; a pass reading
+ * itself always gets the previous frame. the graph is scheduled in
+ * dependency order, and only passes whose previous frame is still
+ * needed after they render again get a second, ping-pong target.
+ * buffers only read within the frame are transient: buffers of the
+ * same format whose lifetimes do not overlap share one texture.
+ */
+class RenderGraph
+{
+private:
+    struct Channel
+    {
+        int pass;
+        bool previous;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        std::string fragmentPath;
+        GLenum format;
+        std::vector<std::string> channelNames;
+        std::vector<Channel> channels;
+        std::unique_ptr<ShaderPermutations> program; // at every quality tier
+        int targets[2];    // allocator handles, -1 if unused
+        bool doubleBuffered;
+        int latest;        // the target holding the newest frame
+        int renderedFrame; // frame the newest target was rendered at
+    };
+
+    std::vector<Pass> passes;
+    std::vector<int> schedule;
+    int imagePass;
+    int width;
+    int height;
+    std::string vertexPath;
+    unsigned int quadVAO;
+    unsigned int boundTextures[4];
+    TargetAllocator allocator;
+    std::string error;
+
+    bool fail(const std::string& message);
+    bool resolve();
+    bool createTargets();
+    unsigned int channelTexture(const Channel& channel, int frame) const;
+    void bindTexture(int unit, unsigned int texture);
+
+public:
+    RenderGraph();
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // read the pass file, build its programs and targets; the buffers are
+    // width x height, every pass draws 'quadVAO' with vertexPath. the pass
+    // programs are built together at 'tier' through 'loader', which keeps
+    // building them on reloads and tier changes and has to outlive the graph
+    bool load(const char* graphPath, const char* vertexPath, int width, int height, unsigned int quadVAO,
+              ShaderLoader& loader, const QualityTiers* tiers = nullptr, int tier = 0);
+    const std::string& getError() const { return error; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // render frame number 'frame', the Image pass into the bound framebuffer.
+    // 'globals' holds this frame's values, the Image pass reads its scene
+    // view and the buffers the buffer view, which should be getWidth x getHeight
+    void render(int frame, const FrameGlobals& globals, int outputWidth, int outputHeight);
+    // clear every buffer, the next frame starts the feedback from scratch
+    void reset();
+
+    // the shader files the passes are built from, vertex shader first
+    std::vector<std::string> getSources() const;
+    // rebuild the passes using 'path' in the background, false if none does
+    bool rebuild(const std::string& path);
+    // draw every pass at quality 'tier' once its program for it is built
+    void selectTier(int tier);
+    // build every pass at 'tier' in the background without switching to it
+    void prewarmTier(int tier);
+    // between frames: swap in the programs that finished building, a pass
+    // whose rebuild failed keeps its old one; true if any was swapped
+    bool update();
+
+    // pass names in the order they run, a * marks a ping-pong pass
+    std::string describe() const;
+    // how many textures the buffers took after aliasing, and how much memory
+    std::string memorySummary() const { return allocator.summary(); }
+    // true if a pass reads an earlier frame, frames then depend on all the previous ones
+    bool hasFeedback() const;
+};
+
+#endif
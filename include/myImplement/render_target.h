@@ -0,0 +1,54 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <iostream>
+
+/**
+ * @brief an off-screen framebuffer with one colour texture
+ * attachment and an optional depth-stencil render buffer.
+ * it owns the GL objects, so it can be moved but not copied.
+ */
+class RenderTarget
+{
+private:
+    unsigned int FBO;
+    unsigned int colourTex;
+    unsigned int depthRBO;
+
+    int width;
+    int height;
+    GLenum internalFormat;
+
+public:
+    RenderTarget();
+    RenderTarget(int width, int height, GLenum internalFormat = GL_RGBA8, bool withDepth = true);
+    ~RenderTarget();
+
+    RenderTarget(const RenderTarget&) = delete;
+    RenderTarget& operator=(const RenderTarget&) = delete;
+    RenderTarget(RenderTarget&& other);
+    RenderTarget& operator=(RenderTarget&& other);
+
+    // (re)build the framebuffer, returns false if it is not complete
+    bool create(int width, int height, GLenum internalFormat = GL_RGBA8, bool withDepth = true);
+    void release();
+
+    // bind as draw target and set the viewport to cover it
+    void bind() const;
+    static void bindDefault(int width, int height);
+
+    // read back the colour attachment as tightly packed RGBA8, bottom row first
+    void readPixels(std::vector<unsigned char>& pixels) const;
+
+    bool isValid() const { return FBO != 0; }
+    unsigned int getFBO() const { return FBO; }
+    unsigned int getTexture() const { return colourTex; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    GLenum getFormat() const { return internalFormat; }
+};
+
+#endif
@@ -4,25 +4,127 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "myImplement/program_cache.h"
+#include "myImplement/shader_preprocessor.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// the GL type a uniform must have to be set from a T
+template <typename T> struct UniformType;
+template <> struct UniformType<bool>      { static const GLenum value = GL_BOOL; };
+template <> struct UniformType<int>       { static const GLenum value = GL_INT; };
+template <> struct UniformType<float>     { static const GLenum value = GL_FLOAT; };
+template <> struct UniformType<glm::vec2> { static const GLenum value = GL_FLOAT_VEC2; };
+template <> struct UniformType<glm::vec3> { static const GLenum value = GL_FLOAT_VEC3; };
+template <> struct UniformType<glm::vec4> { static const GLenum value = GL_FLOAT_VEC4; };
+template <> struct UniformType<glm::mat2> { static const GLenum value = GL_FLOAT_MAT2; };
+template <> struct UniformType<glm::mat3> { static const GLenum value = GL_FLOAT_MAT3; };
+template <> struct UniformType<glm::mat4> { static const GLenum value = GL_FLOAT_MAT4; };
+
+/**
+ * @brief a typed handle to one active uniform of one Shader, resolved
+ * once with Shader::uniform<T>(name). setting through it skips the name
+ * lookup; an invalid handle (inactive or mistyped uniform) sets nothing.
+ */
+template <typename T>
+struct Uniform
+{
+    int index;
+
+    Uniform() : index(-1) {}
+    explicit Uniform(int index) : index(index) {}
+    bool isValid() const { return index >= 0; }
+};
 
 class Shader
 {
 private:
+    struct UniformSlot
+    {
+        GLint location;
+        GLenum type;
+        int cacheOffset; // into uniformCache
+        int cacheSize;   // in 32 bit words
+        mutable bool uploaded; // the cache holds what the program has
+        mutable bool mistyped; // a type mismatch was reported already
+    };
+
     unsigned int ID;
+    bool linked;
+    // active uniforms, reflected once after linking
+    std::vector<UniformSlot> uniforms;
+    std::unordered_map<std::string, int> uniformIndex;
+    // the last value uploaded to each uniform, so unchanged ones are skipped
+    mutable std::vector<GLuint> uniformCache;
+    // frame globals the sources read, they come from the shared block
+    std::vector<std::string> frameGlobalsRead;
+    // where linked programs are kept between runs, if anywhere
+    static ProgramCache* programCache;
+    // expands #include in the sources, if set
+    static ShaderPreprocessor* preprocessor;
+
+    // the build steps, ShaderLoader runs them spread over several frames
+    friend class ShaderLoader;
+    Shader();
+    static bool readSources(const char* vertexPath, const char* fragmentPath, std::string &vertexCode, std::string &fragmentCode);
+    // inject the frame globals, true if either source got the block
+    bool prepareSources(std::string &vertexCode, std::string &fragmentCode);
+    bool loadCached(unsigned long long sourceHash, bool frameGlobals);
+    // start compiling and linking into ID, without waiting for either
+    void submit(const std::string &vertexCode, const std::string &fragmentCode, unsigned int &vertex, unsigned int &fragment);
+    // once the link is done: report errors, store the binary, reflect
+    void complete(unsigned int vertex, unsigned int fragment, unsigned long long sourceHash, bool frameGlobals, double compileMs);
 
     void checkCompileErrors(unsigned int shader, std::string type);
+    // ask the linked program which uniforms survived the compiler
+    void reflectUniforms();
+    // point the program's frame block, if its sources got one, at the shared buffer
+    void bindFrameGlobals(bool injected);
+    int findUniform(const std::string &name, GLenum type) const;
+    // false, reported once per uniform, if a 'type' value cannot be uploaded to it
+    bool checkType(int index, const std::string &name, GLenum type) const;
+    // true if 'value' differs from the last upload, which it then becomes
+    bool changed(int index, const void* value, size_t bytes) const;
 
 public:
-    // constructor generates the shader on the fly
+    // constructor generates the shader on the fly, see ShaderLoader to build many at once
     Shader(const char* vertexPath, const char* fragmentPath);
     ~Shader();
+    // load and store programs through 'cache' from now on, nullptr to stop
+    static void setProgramCache(ProgramCache* cache) { programCache = cache; }
+    // expand #include through 'includes' from now on, nullptr to read sources as they are
+    static void setPreprocessor(ShaderPreprocessor* includes) { preprocessor = includes; }
     // activate the shader
     void use();
-    // utility uniform functions
+    // false if the program failed to build, drawing with it draws nothing
+    bool isLinked() const { return linked; }
+    // delete the program, e.g. once a rebuilt one has replaced it
+    void release();
+    // false for uniforms the program never reads, setting those is wasted work;
+    // a frame global counts as read if its source uses it
+    bool isUniformActive(const std::string &name) const;
+
+    // resolve a uniform once, outside the frame loop
+    template <typename T>
+    Uniform<T> uniform(const std::string &name) const { return Uniform<T>(findUniform(name, UniformType<T>::value)); }
+    // upload through a handle, only if the value changed; the program must be in use
+    void set(Uniform<bool> handle, bool value) const;
+    void set(Uniform<int> handle, int value) const;
+    void set(Uniform<float> handle, float value) const;
+    void set(Uniform<glm::vec2> handle, const glm::vec2 &value) const;
+    void set(Uniform<glm::vec3> handle, const glm::vec3 &value) const;
+    void set(Uniform<glm::vec4> handle, const glm::vec4 &value) const;
+    void set(Uniform<glm::mat2> handle, const glm::mat2 &value) const;
+    void set(Uniform<glm::mat3> handle, const glm::mat3 &value) const;
+    void set(Uniform<glm::mat4> handle, const glm::mat4 &value) const;
+
+    // utility uniform functions, by name: a table lookup, no GL query for
+    // active uniforms, and unchanged values are not uploaded again
     void setBool(const std::string &name, bool value) const;
     void setInt(const std::string &name, int value) const;
     void setFloat(const std::string &name, float value) const;
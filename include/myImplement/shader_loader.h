@@ -0,0 +1,102 @@
+#ifndef SHADER_LOADER_H
+#define SHADER_LOADER_H
+
+#include "myImplement/shader.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ShaderLoadStats
+{
+    int requested;   // programs asked for
+    int cached;      // of those, loaded from the program cache
+    double wallMs;   // from the first request until the last program was done
+    double busyMs;   // the sum of each program's own time from request to done
+
+    ShaderLoadStats() : requested(0), cached(0), wallMs(0.0), busyMs(0.0) {}
+    // one line: programs, cache loads, wall time and how many built at once on average
+    std::string summary() const;
+};
+
+class ShaderLoader;
+
+/**
+ * @brief one program ShaderLoader is building. check isReady() from the
+ * render loop, then take() the Shader; like the Shader constructor, a
+ * program that failed to build has printed its errors and is still
+ * handed out.
+ */
+class ShaderFuture
+{
+private:
+    friend class ShaderLoader;
+    struct State;
+    std::shared_ptr<State> state;
+
+public:
+    bool isValid() const { return state != nullptr; }
+    bool isReady() const;
+    // the built shader, once; nullptr before it is ready or after the first take
+    std::unique_ptr<Shader> take();
+};
+
+/**
+ * @brief builds many programs at once instead of one after another.
+ * sources are read on a few worker threads, and every compile and link
+ * is submitted as soon as its sources are in. with
+ * KHR/ARB_parallel_shader_compile the driver builds them in the
+ * background and poll() asks GL_COMPLETION_STATUS without waiting;
+ * without it a program is finished at the first poll() after it was
+ * submitted. all GL calls happen in poll() and wait(), on the thread
+ * that owns the context.
+ */
+class ShaderLoader
+{
+private:
+    std::vector<std::thread> readers;
+    std::mutex lock;
+    std::condition_variable hasWork;
+    std::deque<std::shared_ptr<ShaderFuture::State>> toRead;
+    std::vector<std::shared_ptr<ShaderFuture::State>> pending; // GL thread only
+    bool stopping;
+    bool parallel;   // the driver compiles in the background
+
+    std::chrono::steady_clock::time_point firstRequest;
+    std::chrono::steady_clock::time_point lastDone;
+    ShaderLoadStats stats;
+
+    void readerLoop();
+
+public:
+    // 'threads' source readers; needs a current context to look for the extension
+    explicit ShaderLoader(int threads = 2);
+    ~ShaderLoader();
+
+    ShaderLoader(const ShaderLoader&) = delete;
+    ShaderLoader& operator=(const ShaderLoader&) = delete;
+
+    // 'defines' replace the values of those #defines in the sources;
+    // 'countSteps' builds the fragment shader through instrumentStepCount()
+    ShaderFuture request(const std::string& vertexPath, const std::string& fragmentPath,
+                         const ShaderDefines& defines = ShaderDefines(), bool countSteps = false);
+    // submit what was read, finish what the driver is done with; only
+    // waits for a compile when the driver cannot build in the background
+    void poll();
+    // poll until 'future' is ready
+    void wait(const ShaderFuture& future);
+    // poll until every request is ready
+    void waitAll();
+
+    bool hasParallelCompile() const { return parallel; }
+    bool isIdle() const { return pending.empty(); }
+    ShaderLoadStats getStats() const { return stats; }
+};
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include "myImplement/shader.h"
+#include "myImplement/shader_loader.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief quality tiers, declared in YAML, cheapest first. each shader, by
+ * file name, lists the #defines the tiers override, one value per tier:
+ *
+ *   tiers: [low, medium, high]
+ *   shaders:
+ *     shadertoy_starfield_fs.glsl:
+ *       STAR_LAYERS: [2, 4, 6]
+ *
+ * a shader that is not listed builds the same at every tier.
+ */
+class QualityTiers
+{
+private:
+    struct Axis
+    {
+        std::string define;
+        std::vector<std::string> values; // one per tier
+    };
+
+    std::vector<std::string> names;
+    std::map<std::string, std::vector<Axis>> shaders; // by file name
+    std::string error;
+
+public:
+    bool load(const std::string& path);
+
+    int getCount() const { return int(names.size()); }
+    const std::string& getName(int tier) const { return names[tier]; }
+    // the tier called 'name', -1 if there is none
+    int find(const std::string& name) const;
+    // the #defines 'fragmentPath' is built with at 'tier'
+    ShaderDefines definesFor(const std::string& fragmentPath, int tier) const;
+    const std::string& getError() const { return error; }
+};
+
+/**
+ * @brief one vertex/fragment pair at every quality tier. a tier is built
+ * through ShaderLoader the first time it is selected and kept, so going
+ * back to it later is immediate; until the selected tier is built the
+ * current program keeps drawing. tiers that end up with the same #defines
+ * share one program. all calls belong to the thread that owns the context.
+ */
+class ShaderPermutations
+{
+private:
+    struct Permutation
+    {
+        ShaderDefines defines;
+        std::unique_ptr<Shader> shader; // built, nullptr until then
+        ShaderFuture build;             // while it builds
+    };
+
+    ShaderLoader& loader;
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<Permutation> permutations;
+    std::vector<int> tierPermutation;  // tier -> index into permutations
+    std::vector<ShaderFuture> discarded; // builds of sources that changed since
+    std::function<void(Shader&)> setup;
+    int current;   // tier drawn, -1 until the first program is built
+    int wanted;    // tier selected
+
+    void build(Permutation& permutation);
+
+public:
+    // starts building 'tier' right away; 'tiers' may be null for a single tier
+    ShaderPermutations(ShaderLoader& loader, const std::string& vertexPath, const std::string& fragmentPath,
+                       const QualityTiers* tiers, int tier);
+    ~ShaderPermutations();
+
+    ShaderPermutations(const ShaderPermutations&) = delete;
+    ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+    // run on every program once it is built, e.g. to point samplers at their units
+    void setSetup(const std::function<void(Shader&)>& setup) { this->setup = setup; }
+    // draw 'tier' from the first update() it is built at
+    void select(int tier);
+    // build 'tier' in the background without switching to it
+    void prewarm(int tier);
+    // the sources changed: forget the other tiers and rebuild the current
+    // one, which keeps drawing unless the rebuild links
+    void reload();
+    // between frames: take finished builds and switch to the selected
+    // tier if it is built; true if the program drawn changed
+    bool update();
+    // poll the loader until there is a program to draw
+    void wait();
+
+    // the program to draw with, nullptr until the first one is built
+    Shader* get() const;
+    int getTier() const { return current; }
+    int getSelectedTier() const { return wanted; }
+    int getTierCount() const { return int(tierPermutation.size()); }
+    // true if the tiers build more than one program
+    bool hasTiers() const { return permutations.size() > 1; }
+    const std::string& getFragmentPath() const { return fragmentPath; }
+};
+
+#endif
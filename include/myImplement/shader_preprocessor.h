@@ -0,0 +1,106 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// #define values to build a source with, name and replacement text
+typedef std::vector<std::pair<std::string, std::string>> ShaderDefines;
+
+// replace the value of each '#define NAME value' line in 'source' that
+// 'defines' names, keeping the line count; found[i] is set for the ones
+// this source has and left alone for the rest
+void overrideDefines(std::string& source, const ShaderDefines& defines, std::vector<bool>& found);
+
+// the fragment output, at location 1, an instrumented source writes its step count to
+#define STEP_COUNT_OUTPUT "StepCount_"
+
+// count the iterations of every loop in a fragment shader source that is
+// marked with a '#pragma count_steps' line right before it. the loops
+// add up in one counter per pixel, which main() writes as a float to a
+// second output at location 1, the first output is moved to location 0.
+// the counter is declared with that first output, marked loops have to
+// come after it and have braces. keeps the line count; returns the
+// number of loops counted, 0 with 'error' set if none could be
+int instrumentStepCount(std::string& source, std::string& error);
+
+struct PreprocessStats
+{
+    int expanded;    // sources run through expand()
+    int reused;      // of those, answered from the expansion cache
+    int filesRead;   // files read from disk, each unchanged file is read once
+
+    PreprocessStats() : expanded(0), reused(0), filesRead(0) {}
+    // one line: expansions, cache reuse and disk reads
+    std::string summary() const;
+};
+
+/**
+ * @brief resolves #include "name" in shader sources before they reach the
+ * driver (or the cpu/vm front end). a name is looked up next to the file
+ * that includes it, then in the library directory. every file is pulled in
+ * once per source, like #pragma once, and the directive line itself is
+ * blanked. each included file gets its own source string number through
+ * #line, so the driver's messages can be mapped back to path:line by
+ * mapLog().
+ *
+ * files are kept by path and only read again when their size or time
+ * changed; an expansion is reused while every file it pulled in still has
+ * the content hash it had. a source without includes comes back exactly as
+ * it was read. expand() may be called from any thread.
+ */
+class ShaderPreprocessor
+{
+private:
+    struct SourceFile
+    {
+        int id;                  // its source string number in #line
+        long long modified;      // stat time, nanoseconds where the system has them
+        long long size;
+        unsigned long long hash; // of the text
+        std::string text;
+    };
+    struct Expansion
+    {
+        std::vector<std::pair<std::string, unsigned long long>> files; // every file pulled in, with its hash
+        std::string text;
+    };
+
+    std::string library;
+    mutable std::mutex lock;
+    std::map<std::string, SourceFile> files;
+    std::map<std::string, Expansion> expansions;
+    std::vector<std::string> paths;     // by id, id 0 is left to the top level string
+    PreprocessStats stats;
+
+    // the file at 'path' as it is on disk now, nullptr if it cannot be read
+    const SourceFile* refresh(const std::string& path);
+    bool include(const std::string& path, std::vector<std::string>& seen, std::string& out,
+                 std::vector<std::pair<std::string, unsigned long long>>& pulled);
+    std::string resolve(const std::string& name, const std::string& from) const;
+
+public:
+    // 'library' is searched for names not found next to the including file
+    explicit ShaderPreprocessor(const std::string& library = "");
+
+    ShaderPreprocessor(const ShaderPreprocessor&) = delete;
+    ShaderPreprocessor& operator=(const ShaderPreprocessor&) = delete;
+
+    // the source at 'path' with its includes expanded; false, with the
+    // errors printed, if it or an include cannot be read. an include that
+    // is not found stays in 'source', so the compile fails on it
+    bool expand(const std::string& path, std::string& source);
+    // the driver's info log with source string numbers replaced by paths
+    std::string mapLog(const std::string& log) const;
+    // the files 'path' included the last time it was expanded
+    std::vector<std::string> includesOf(const std::string& path) const;
+    // the expanded sources that include 'path'
+    std::vector<std::string> includersOf(const std::string& path) const;
+
+    const std::string& getLibrary() const { return library; }
+    PreprocessStats getStats() const;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief a ring of frames in POSIX shared memory, written by one
+ * renderer and read by any number of local processes without copies.
+ *
+ * the segment starts with a ShmRingHeader, followed by 'slotCount'
+ * slots, each a ShmSlotHeader and one RGBA8 frame (bottom row first,
+ * like glReadPixels). frame n goes to slot n % slotCount and every slot
+ * is a seqlock: its sequence is odd while the writer fills it and
+ * 2n + 2 once frame n is complete. the writer never waits for readers;
+ * a reader checks the sequence before and after it looks at the pixels
+ * and knows the frame was overrun if it changed.
+ *
+ * readers only need this header and ShmFrameReader.
+ */
+
+const uint32_t SHM_RING_VERSION = 1;
+
+struct ShmRingHeader
+{
+    char magic[8];                   // "STOYRING"
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t width;
+    uint32_t height;
+    uint64_t frameBytes;             // width * height * 4
+    uint64_t slotStride;             // bytes from one slot header to the next
+    std::atomic<uint64_t> published; // frames completed so far
+    std::atomic<uint32_t> closed;    // 1 once the writer has gone
+};
+
+struct ShmSlotHeader
+{
+    std::atomic<uint64_t> sequence;
+    int64_t frameIndex;              // the renderer's frame number
+    double time;                     // the iTime it was rendered at
+};
+
+/**
+ * @brief the renderer side: creates the segment and publishes frames.
+ */
+class ShmFrameWriter
+{
+private:
+    std::string name;
+    unsigned char* base;
+    size_t size;
+    uint64_t published;
+
+public:
+    ShmFrameWriter();
+    ~ShmFrameWriter();
+
+    ShmFrameWriter(const ShmFrameWriter&) = delete;
+    ShmFrameWriter& operator=(const ShmFrameWriter&) = delete;
+
+    // create (or replace) the segment "/name", e.g. "/shadertoy"
+    bool open(const std::string& name, int width, int height, int slotCount);
+    // mark the ring closed and remove its name, mapped readers keep working
+    void close();
+
+    // copy one RGBA8 frame into the next slot and publish it
+    void publish(const unsigned char* rgba, int64_t frameIndex, double time);
+
+    bool isOpen() const { return base != nullptr; }
+    uint64_t getPublished() const { return published; }
+};
+
+struct ShmFrameView
+{
+    const unsigned char* pixels; // points into the shared mapping
+    uint64_t number;             // position in the ring's stream, 0 based
+    int64_t frameIndex;
+    double time;
+    int width;
+    int height;
+    uint64_t sequence;           // what release() checks against
+};
+
+enum ShmReadStatus
+{
+    SHM_READ_OK,
+    SHM_READ_NONE,    // nothing newer than the last frame acquired
+    SHM_READ_OVERRUN, // the wanted frame was already overwritten, skipped ahead
+    SHM_READ_CLOSED   // the writer has gone and every frame was seen
+};
+
+/**
+ * @brief the consumer side: maps the segment read-only and hands out
+ * views straight into it. a view stays usable until the writer comes
+ * round to its slot again, release() says whether that happened while
+ * the view was in use.
+ */
+class ShmFrameReader
+{
+private:
+    const unsigned char* base;
+    size_t size;
+    const ShmRingHeader* header;
+    uint64_t next;      // the next frame number to acquire
+    uint64_t overruns;  // frames lost because the writer lapped us
+    uint64_t torn;      // views invalidated while in use
+
+    const ShmSlotHeader* slotOf(uint64_t number) const;
+
+public:
+    ShmFrameReader();
+    ~ShmFrameReader();
+
+    ShmFrameReader(const ShmFrameReader&) = delete;
+    ShmFrameReader& operator=(const ShmFrameReader&) = delete;
+
+    bool open(const std::string& name);
+    void close();
+
+    // the frame after the last one acquired, in order
+    ShmReadStatus acquireNext(ShmFrameView& view);
+    // the newest complete frame, skipping any in between
+    ShmReadStatus acquireLatest(ShmFrameView& view);
+    // true if the pixels stayed intact while the view was used
+    bool release(const ShmFrameView& view);
+    // acquireLatest into 'pixels', retried until a copy comes out whole
+    ShmReadStatus copyLatest(std::vector<unsigned char>& pixels, ShmFrameView& view);
+
+    bool isOpen() const { return base != nullptr; }
+    int getWidth() const { return header ? int(header->width) : 0; }
+    int getHeight() const { return header ? int(header->height) : 0; }
+    uint64_t getOverruns() const { return overruns; }
+    uint64_t getTorn() const { return torn; }
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef STEP_HEATMAP_H
+#define STEP_HEATMAP_H
+
+#include <glad/glad.h>
+
+#include "myImplement/render_target.h"
+#include "myImplement/shader.h"
+
+#include <string>
+#include <vector>
+
+// how the counted steps of one frame spread over its pixels
+struct StepHistogram
+{
+    int pixels;           // pixels read back
+    int counted;          // of those, the ones a counted loop ran for
+    float mean, p50, p95, max; // steps per counted pixel
+    float overBudget;     // share of counted pixels at or past the budget
+    int budget;
+    std::vector<float> buckets; // share of counted pixels per budget / size() steps, the last one holds those past the budget too
+
+    StepHistogram() : pixels(0), counted(0), mean(0.0f), p50(0.0f), p95(0.0f), max(0.0f), overBudget(0.0f), budget(0) {}
+    // one line: counted pixels, mean/p50/p95/max steps and the share over budget
+    std::string summary() const;
+};
+
+/**
+ * @brief draws a program built with ShaderLoader's countSteps into an
+ * off-screen target with a second, R32F colour attachment for the step
+ * counts, then shows them as a false colour heatmap over the frame: blue
+ * for few steps, through green and yellow, red at the budget and white
+ * past it. collect() reads the counts back for a histogram; it waits for
+ * the GPU, so a live window only calls it every so often.
+ *
+ * the target is sized once, smaller frames use its lower left corner.
+ * all calls belong to the thread that owns the context.
+ */
+class StepHeatmap
+{
+private:
+    RenderTarget target;
+    unsigned int countTex;
+    int budget;
+    std::vector<float> counts;
+    StepHistogram histogram;
+    // the overlay program the handles below belong to
+    const Shader* overlayResolved;
+    Uniform<glm::vec2> overlaySize;
+    Uniform<float> overlayBudget;
+    Uniform<float> overlayOpacity;
+
+public:
+    // up to width x height pixels; 'budget' steps are at the top of the ramp
+    StepHeatmap(int width, int height, int budget);
+    ~StepHeatmap();
+
+    StepHeatmap(const StepHeatmap&) = delete;
+    StepHeatmap& operator=(const StepHeatmap&) = delete;
+
+    bool isValid() const { return target.isValid() && countTex != 0; }
+    // bind the target, cleared, with the viewport on its width x height corner
+    void bind(int width, int height);
+    // draw the heatmap of that corner over the frame with 'overlay' (a
+    // shadertoy_heatmap_fs program) into the bound framebuffer, 'opacity'
+    // 0 shows the frame alone; the caller binds the quad and the view.
+    // the overlay's uniforms are resolved the first time it is drawn
+    void present(Shader& overlay, int width, int height, float opacity);
+    // the histogram of the last width x height frame, 'size' buckets
+    const StepHistogram& collect(int width, int height, int size = 32);
+
+    void setBudget(int steps) { budget = steps > 0 ? steps : 1; }
+    int getBudget() const { return budget; }
+    const StepHistogram& getHistogram() const { return histogram; }
+};
+
+#endif
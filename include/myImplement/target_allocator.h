@@ -0,0 +1,66 @@
+#ifndef TARGET_ALLOCATOR_H
+#define TARGET_ALLOCATOR_H
+
+#include "myImplement/render_target.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief hands out the render targets of a frame made of passes.
+ * every request says at which pass its target is first written and
+ * at which pass it is last read; requests of the same size and
+ * format whose lifetimes do not overlap share one pooled target.
+ * persistent requests live across frames and never share.
+ *
+ * usage: request() every target, allocate() once, then get() by handle.
+ */
+class TargetAllocator
+{
+private:
+    struct Request
+    {
+        int width;
+        int height;
+        GLenum format;
+        bool withDepth;
+        int first; // first pass that writes it
+        int last;  // last pass that reads it
+        int slot;  // index into pool
+    };
+
+    std::vector<Request> requests;
+    std::vector<RenderTarget> pool;
+    std::vector<int> owners; // per pooled target, a request it was created for
+
+public:
+    // first/last for a target whose contents must survive to the next frame
+    static const int PERSISTENT_FIRST;
+    static const int PERSISTENT_LAST;
+
+    // a target written at pass 'first' and read up to pass 'last', returns its handle
+    int request(int width, int height, GLenum format, bool withDepth, int first, int last);
+    int requestPersistent(int width, int height, GLenum format, bool withDepth);
+
+    // alias the requests onto as few targets as their lifetimes allow and create them
+    bool allocate();
+    // drop every request and pooled target
+    void clear();
+
+    RenderTarget& get(int handle) { return pool[requests[handle].slot]; }
+    const RenderTarget& get(int handle) const { return pool[requests[handle].slot]; }
+    std::vector<RenderTarget>& getPool() { return pool; }
+
+    int requestCount() const { return int(requests.size()); }
+    int targetCount() const { return int(pool.size()); }
+    // memory of one target per request, and of the pooled targets actually created
+    size_t naiveBytes() const;
+    size_t pooledBytes() const;
+    // e.g. "3 targets for 5 requests, 9.5 MB instead of 15.8 MB"
+    std::string summary() const;
+
+    static size_t bytesOf(int width, int height, GLenum format, bool withDepth);
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// pixel rectangle [x0, x1) x [y0, y1)
+struct Tile
+{
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
+struct TileTiming
+{
+    Tile tile;
+    int thread; // the worker that shaded it
+    float ms;
+};
+
+struct TileStats
+{
+    std::vector<TileTiming> tiles; // in row-major tile order
+    std::vector<double> busyMs;    // shading time per worker
+    int steals;                    // successful steal operations
+    double frameMs;
+
+    TileStats() : steals(0), frameMs(0.0) {}
+    // one line: frame time, tile count and spread, steals and worker balance
+    std::string summary() const;
+};
+
+/**
+ * @brief splits a frame into tiles and shades them on a persistent
+ * pool of workers. every worker starts with a contiguous run of
+ * tiles in its own deque, takes from the front of it and, once it
+ * runs dry, steals the back half of another worker's deque, so the
+ * frame ends when the work does rather than when the unluckiest
+ * static band does. the frame buffer is first touched by the same
+ * contiguous runs, which puts its pages on the NUMA node of the
+ * worker that usually shades them.
+ */
+class TileScheduler
+{
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<int> tiles;
+    };
+
+    int tileWidth;
+    int tileHeight;
+    int threadCount;
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(int)>* job;
+    unsigned generation;
+    int running;
+    bool stopping;
+
+    std::vector<Tile> tiles;
+    std::atomic<int> steals;
+    TileStats stats;
+
+    std::unique_ptr<unsigned char[]> buffer;
+    size_t bufferSize;
+
+    void startWorkers();
+    void stopWorkers();
+    // 'seen' is the generation the worker was started at
+    void workerLoop(int index, unsigned seen);
+    // runs job(worker index) once on every worker, the caller being worker 0
+    void dispatch(const std::function<void(int)>& job);
+    // deals the tiles of a width x height frame out to the worker deques
+    void deal(int width, int height);
+    bool next(int worker, int& tile);
+
+public:
+    TileScheduler();
+    ~TileScheduler();
+    TileScheduler(const TileScheduler&) = delete;
+    TileScheduler& operator=(const TileScheduler&) = delete;
+
+    // 0 means one thread per hardware thread
+    void setThreadCount(int count);
+    void setTileSize(int width, int height);
+    int getThreadCount() const { return int(queues.size()); }
+
+    // an RGBA8 frame, kept between frames and first touched by the workers
+    unsigned char* frameBuffer(int width, int height);
+    // shade(tile, worker) for every tile of the frame, returns when all are done
+    void run(int width, int height, const std::function<void(const Tile&, int)>& shade);
+    // timings of the last run()
+    const TileStats& getStats() const { return stats; }
+};
+
+#endif
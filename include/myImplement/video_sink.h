@@ -0,0 +1,81 @@
+#ifndef VIDEO_SINK_H
+#define VIDEO_SINK_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// convert RGBA8 to 8 bit YUV 4:2:0, BT.601 limited range. rows are read
+// bottom row first when flipY, like glReadPixels gives them. chroma
+// samples are 'chromaStep' bytes apart: 1 for planar (I420), 2 with
+// vPlane = uPlane + 1 for NV12. odd sizes repeat the last column/row.
+void rgbaToYuv420(const unsigned char* rgba, int width, int height, bool flipY,
+                  unsigned char* yPlane, unsigned char* uPlane, unsigned char* vPlane, int chromaStep);
+
+struct VideoStats
+{
+    int frames;        // frames written
+    double stallMs;    // time push() waited for a free buffer
+    double convertMs;  // writer thread time spent converting
+    double writeMs;    // writer thread time spent writing
+    double megabytes;  // YUV data written
+
+    VideoStats() : frames(0), stallMs(0.0), convertMs(0.0), writeMs(0.0), megabytes(0.0) {}
+    // one line: frames, size, per frame conversion and write cost, stalls
+    std::string summary() const;
+};
+
+/**
+ * @brief streams frames as raw video: YUV4MPEG2 (4:2:0 planar), or
+ * headerless NV12 when the path ends in ".nv12"; "-" writes to
+ * stdout, e.g. to pipe into an encoder. push() copies the frame into
+ * one of a fixed number of buffers and returns; a writer thread
+ * converts and writes them in order. when every buffer is queued,
+ * push() waits, so a slow disk or encoder slows the renderer down
+ * instead of growing the queue.
+ */
+class VideoSink
+{
+private:
+    FILE* file;
+    bool ownsFile;
+    bool nv12;
+    int width;
+    int height;
+
+    std::vector<std::vector<unsigned char>> buffers;
+    std::deque<int> freeBuffers;
+    std::deque<int> queued;     // filled buffers, oldest first
+    std::thread writer;
+    mutable std::mutex lock;
+    std::condition_variable hasFrame;
+    std::condition_variable hasRoom;
+    bool closing;
+    bool failed;
+    VideoStats stats;
+
+    void writerLoop();
+
+public:
+    VideoSink();
+    ~VideoSink();
+
+    VideoSink(const VideoSink&) = delete;
+    VideoSink& operator=(const VideoSink&) = delete;
+
+    // open the stream for width x height frames at 'fps', with room for 'queueDepth' frames
+    bool open(const std::string& path, int width, int height, int fps, int queueDepth);
+    // queue one RGBA8 frame, bottom row first; false once a write has failed
+    bool push(const unsigned char* rgba);
+    // write out everything queued and close, false if any write failed
+    bool close();
+
+    bool isOpen() const { return file != nullptr; }
+    VideoStats getStats() const;
+};
+
+#endif
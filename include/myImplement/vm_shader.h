@@ -0,0 +1,33 @@
+#ifndef VM_SHADER_H
+#define VM_SHADER_H
+
+#include "myImplement/cpu_renderer.h"
+#include "myImplement/glsl_vm.h"
+#include "myImplement/shader_preprocessor.h"
+
+/**
+ * @brief runs a shadertoy fragment shader on the CPU without a host
+ * compiler: the shader is compiled to bytecode for the wide-lane
+ * interpreter in glsl_vm.h. slower than CpuShader, but ready as soon
+ * as the shader is parsed.
+ */
+class VmShader : public CpuRenderer
+{
+private:
+    glsl::VmProgram vm;
+    bool valid;
+
+protected:
+    void renderTile(const Tile& tile, int width, unsigned char* rgba) const override;
+
+public:
+    // compiles on the fly like Shader, check isValid() afterwards;
+    // #include is expanded through 'preprocessor' if there is one, then
+    // the #define lines 'defines' names get its values
+    explicit VmShader(const char* fragmentPath, ShaderPreprocessor* preprocessor = nullptr,
+                      const ShaderDefines& defines = ShaderDefines());
+
+    bool isValid() const override { return valid; }
+};
+
+#endif
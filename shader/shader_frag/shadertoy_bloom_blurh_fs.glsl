@@ -0,0 +1,25 @@
+#version 330 core
+
+// horizontal half of a separable gaussian for the bloom demo, 9 taps wide
+// with every other texel, chained twice for a wider glow
+
+uniform vec2  iResolution;
+uniform sampler2D iChannel0; // the pass before
+
+in  vec3 FragPos;
+out vec4 FragColor;
+
+const float weights[5] = float[](0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
+
+void main()
+{
+    vec2 uv = FragPos.xy / iResolution;
+    vec2 stride = vec2(1.0, 0.0) * 2.0 / iResolution;
+    vec3 col = texture(iChannel0, uv).rgb * weights[0];
+    for (int i = 1; i < 5; ++i)
+    {
+        col += texture(iChannel0, uv + stride * float(i)).rgb * weights[i];
+        col += texture(iChannel0, uv - stride * float(i)).rgb * weights[i];
+    }
+    FragColor = vec4(col, 1.0);
+}
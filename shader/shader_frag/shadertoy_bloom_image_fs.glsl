@@ -0,0 +1,17 @@
+#version 330 core
+
+// Image pass of the bloom demo: the scene plus its blurred glow
+
+uniform vec2  iResolution;
+uniform sampler2D iChannel0; // the scene
+uniform sampler2D iChannel1; // the scene blurred twice
+
+in  vec3 FragPos;
+out vec4 FragColor;
+
+void main()
+{
+    vec2 uv = FragPos.xy / iResolution;
+    vec3 glow = texture(iChannel1, uv).rgb;
+    FragColor = vec4(texture(iChannel0, uv).rgb + 0.6 * glow * glow, 1.0);
+}
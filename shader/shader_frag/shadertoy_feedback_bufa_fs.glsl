@@ -0,0 +1,32 @@
+#version 330 core
+
+// Buffer A of the feedback demo: last frame, swirled and faded, plus
+// three glowing emitters, so every frame paints on top of its trail
+
+uniform float iTime;
+uniform vec2  iResolution;
+uniform sampler2D iChannel0; // this buffer, previous frame
+
+in  vec3 FragPos;
+out vec4 FragColor;
+
+void main()
+{
+    vec2 uv = FragPos.xy / iResolution;
+
+    // pull the old frame slightly inwards and around the centre
+    float angle = 0.004;
+    mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+    vec2 source = rotation * (uv - 0.5) * 0.995 + 0.5;
+    vec3 col = texture(iChannel0, source).rgb * 0.985;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        float t = iTime * (0.7 + 0.2 * float(i)) + float(i) * 2.1;
+        vec2 centre = vec2(0.5) + 0.3 * vec2(sin(t * 1.3), cos(t * 0.9));
+        vec2 d = (uv - centre) * vec2(iResolution.x / iResolution.y, 1.0);
+        float glow = exp(-dot(d, d) * 2000.0);
+        col += glow * (0.5 + 0.5 * cos(vec3(0.0, 2.1, 4.2) + float(i) * 1.7));
+    }
+    FragColor = vec4(col, 1.0);
+}
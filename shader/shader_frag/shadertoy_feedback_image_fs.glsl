@@ -0,0 +1,15 @@
+#version 330 core
+
+// Image pass of the feedback demo: tone maps the unbounded Buffer A
+
+uniform vec2  iResolution;
+uniform sampler2D iChannel0; // Buffer A, this frame
+
+in  vec3 FragPos;
+out vec4 FragColor;
+
+void main()
+{
+    vec3 col = texture(iChannel0, FragPos.xy / iResolution).rgb;
+    FragColor = vec4(1.0 - exp(-1.5 * col), 1.0);
+}
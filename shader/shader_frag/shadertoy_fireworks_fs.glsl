@@ -10,13 +10,7 @@ out vec4 FragColor;
 #define PARTICALS_NUM 75
 #define FIREWORKS_NUM 3
 
-// basically scatter in a square
-vec2 hash12(float t)
-{
-    float x = fract(sin(t * 177.51) * 711.15);
-    float y = fract(sin((t + x) * 211.13) * 513.17);
-    return vec2(x, y);
-}
+#include "hash.glsl"
 
 // basically scatter in a circle
 vec2 hash12Polar(float t)
@@ -0,0 +1,31 @@
+#version 330 core
+
+// the step counts of a counted program (see instrumentStepCount) as a
+// false colour heatmap over the frame it drew: blue for few steps, through
+// green and yellow to red at the budget, white past it. pixels no counted
+// loop ran for show the frame alone
+
+uniform sampler2D sceneTex;
+uniform sampler2D countTex;
+uniform vec2 sourceSize;  // rendered pixels, the lower left corner of both textures
+uniform vec2 iResolution; // the window quad, in the pixels FragPos is given in
+uniform float budget;     // steps at the top of the ramp
+uniform float opacity;    // 0 shows the frame, 1 the heatmap alone
+
+in  vec3 FragPos;
+out vec4 FragColor;
+
+vec3 ramp(float t)
+{
+    return clamp(vec3(1.5) - abs(4.0 * t - vec3(3.5, 2.0, 0.5)), 0.0, 1.0);
+}
+
+void main()
+{
+    // the nearest rendered pixel, a count is never blended with its neighbours
+    vec2 texel = (floor(FragPos.xy / iResolution * sourceSize) + 0.5) / vec2(textureSize(countTex, 0));
+    float steps = texture(countTex, texel).r;
+    vec3 scene = texture(sceneTex, texel).rgb;
+    vec3 heat = steps > budget ? vec3(1.0) : ramp(steps / budget);
+    FragColor = vec4(mix(scene, heat, steps > 0.0 ? opacity : 0.0), 1.0);
+}
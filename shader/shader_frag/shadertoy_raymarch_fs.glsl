@@ -84,6 +84,8 @@ float rayMarching(vec3 ro, vec3 rd)
     float distOrg = 0.0;
     float distObj = 0.0;
     vec3 point;
+    // the step heatmap counts the iterations of this loop
+    #pragma count_steps
     for (int i = 0; i < MAX_STEPS; ++i)
     {
         point = ro + rd * distOrg;
@@ -9,20 +9,8 @@ uniform vec2  iMousePos;
 in  vec3 FragPos;
 out vec4 FragColor;
 
-mat2 rotateHorizontal(float angle)
-{
-    return mat2(
-        cos(angle), -sin(angle),
-        sin(angle),  cos(angle)
-    );
-}
-
-float hash21(vec2 uv)
-{
-    uv = fract(uv * vec2(123.34, 456.21));
-    uv += dot(uv, uv + 45.32);
-    return fract(uv.x * uv.y);
-}
+#include "transform.glsl"
+#include "hash.glsl"
 
 float crossStar(vec2 uv, float flare)
 {
@@ -0,0 +1,48 @@
+#version 330 core
+
+// upscales the part of sourceTex the shader pass rendered to the window,
+// Catmull-Rom bicubic in 9 bilinear taps instead of 16 point taps
+
+uniform sampler2D sourceTex;
+uniform vec2 sourceSize; // rendered pixels, the lower left corner of sourceTex
+uniform vec2 iResolution; // the window quad, in the pixels FragPos is given in
+
+in  vec3 FragPos;
+out vec4 FragColor;
+
+vec3 fetch(vec2 texel)
+{
+    // never reach into the part of the texture this frame did not render
+    texel = clamp(texel, vec2(0.5), sourceSize - 0.5);
+    return texture(sourceTex, texel / vec2(textureSize(sourceTex, 0))).rgb;
+}
+
+void main()
+{
+    vec2 samplePos = FragPos.xy / iResolution * sourceSize;
+    vec2 texPos1 = floor(samplePos - 0.5) + 0.5;
+    vec2 f = samplePos - texPos1;
+
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+
+    // the two middle taps of each axis merge into one bilinear fetch
+    vec2 w12 = w1 + w2;
+    vec2 texPos0 = texPos1 - 1.0;
+    vec2 texPos3 = texPos1 + 2.0;
+    vec2 texPos12 = texPos1 + w2 / w12;
+
+    vec3 colour = vec3(0.0);
+    colour += fetch(vec2(texPos0.x,  texPos0.y))  * w0.x  * w0.y;
+    colour += fetch(vec2(texPos12.x, texPos0.y))  * w12.x * w0.y;
+    colour += fetch(vec2(texPos3.x,  texPos0.y))  * w3.x  * w0.y;
+    colour += fetch(vec2(texPos0.x,  texPos12.y)) * w0.x  * w12.y;
+    colour += fetch(vec2(texPos12.x, texPos12.y)) * w12.x * w12.y;
+    colour += fetch(vec2(texPos3.x,  texPos12.y)) * w3.x  * w12.y;
+    colour += fetch(vec2(texPos0.x,  texPos3.y))  * w0.x  * w3.y;
+    colour += fetch(vec2(texPos12.x, texPos3.y))  * w12.x * w3.y;
+    colour += fetch(vec2(texPos3.x,  texPos3.y))  * w3.x  * w3.y;
+    FragColor = vec4(max(colour, 0.0), 1.0);
+}
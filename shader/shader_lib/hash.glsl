@@ -0,0 +1,18 @@
+// pseudo random values from coordinates, the name tells how many
+// values go in and how many come out: hash21 takes a vec2 and gives a float
+
+// random value between 0.0 and 1.0
+float hash21(vec2 uv)
+{
+    uv = fract(uv * vec2(123.34, 456.21));
+    uv += dot(uv, uv + 45.32);
+    return fract(uv.x * uv.y);
+}
+
+// basically scatter in a square
+vec2 hash12(float t)
+{
+    float x = fract(sin(t * 177.51) * 711.15);
+    float y = fract(sin((t + x) * 211.13) * 513.17);
+    return vec2(x, y);
+}
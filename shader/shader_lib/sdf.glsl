@@ -0,0 +1,54 @@
+// signed distance functions for ray marching, each returns the distance
+// from 'point' to the surface, negative inside where that is defined
+
+float getCapsuleDist(vec3 point, vec3 endA, vec3 endB, float radius)
+{
+    vec3 AB = endB - endA;
+    vec3 AP = point - endA;
+
+    float t = dot(AB, AP) / dot(AB, AB);
+    t = clamp(t, 0.0, 1.0);
+
+    vec3 c = endA + t * AB;
+
+    return length(point - c) - radius;
+}
+
+float getTorusDist(vec3 point, vec2 radiusBS)
+{
+    float x = length(point.xz) - radiusBS.x;
+    return length(vec2(x, point.y)) - radiusBS.y;
+}
+
+float getCuboidDist(vec3 point, vec3 abc)
+{
+    // cuboid means '长方体'
+    // 使用raymarching技术在着色器中表达长方体的碰撞非常简单
+    // 可以看作是一个数学处理的trick，当我们行进中的探测点的
+    // 位置在长方体某个平行于坐标轴面xy、yz或者zx的面所在的
+    // 方柱(和圆柱类似的概念)中，这个点与立方体表面做外切圆时
+    // ，半径就是行进点(x,y,z)中其中一个分量减去坐标系原点到
+    // 长方体对应面距离的值。
+
+    // 'abc' stands for the length, width, height
+    return length(max(abs(point) - abc, vec3(0.0)));
+}
+
+// some more complicated for cylinder
+float getCylinderDist(vec3 point, vec3 endA, vec3 endB, float radius)
+{
+    vec3 AB = endB - endA;
+    vec3 AP = point - endA;
+
+    float t = dot(AB, AP) / dot(AB, AB);
+
+    vec3 c = endA + t * AB;
+
+    float x = length(point - c) - radius;
+    float y = (abs(t - 0.5) - 0.5) * length(AB);
+
+    float externalDist = length(max(vec2(x, y), vec2(0.0))); // same trick concept used in cuboid
+    float internalDist = min(max(x, y), 0.0);
+    
+    return internalDist + externalDist;
+}
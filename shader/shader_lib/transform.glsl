@@ -0,0 +1,8 @@
+// 2D rotation, multiply uv from the left: uv *= rotateHorizontal(a)
+mat2 rotateHorizontal(float angle)
+{
+    return mat2(
+        cos(angle), -sin(angle),
+        sin(angle),  cos(angle)
+    );
+}
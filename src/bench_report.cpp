@@ -0,0 +1,193 @@
+#include "myImplement/bench_report.h"
+
+#include "yaml-cpp/yaml.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+namespace
+{
+    float rank(const std::vector<float>& sorted, float p)
+    {
+        return sorted[std::min(sorted.size() - 1, size_t(p * float(sorted.size() - 1) + 0.5f))];
+    }
+
+    std::string timingJson(const TimingSummary& timing)
+    {
+        char text[160];
+        snprintf(text, sizeof(text), "{\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+                 timing.mean, timing.p50, timing.p95, timing.p99, timing.max);
+        return text;
+    }
+
+    TimingSummary timingOf(const YAML::Node& node)
+    {
+        TimingSummary timing;
+        timing.mean = node["mean"].as<float>();
+        timing.p50 = node["p50"].as<float>();
+        timing.p95 = node["p95"].as<float>();
+        timing.p99 = node["p99"].as<float>();
+        timing.max = node["max"].as<float>();
+        return timing;
+    }
+
+    // file names and renderer strings, only quotes and backslashes need escaping
+    std::string jsonString(const std::string& text)
+    {
+        std::string out = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out + "\"";
+    }
+}
+
+TimingSummary TimingSummary::of(std::vector<float> samples)
+{
+    TimingSummary timing;
+    if (samples.empty())
+        return timing;
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (float sample : samples)
+        sum += sample;
+    timing.mean = float(sum / double(samples.size()));
+    timing.p50 = rank(samples, 0.50f);
+    timing.p95 = rank(samples, 0.95f);
+    timing.p99 = rank(samples, 0.99f);
+    timing.max = samples.back();
+    return timing;
+}
+
+std::string BenchResult::key() const
+{
+    return shader + (tier.empty() ? "" : "[" + tier + "]") + "@" + std::to_string(width) + "x" + std::to_string(height);
+}
+
+bool BenchReport::write(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file)
+        return false;
+    char numbers[128];
+    snprintf(numbers, sizeof(numbers), "  \"warmup\": %d,\n  \"frames\": %d,\n  \"time_start\": %.6f,\n  \"time_step\": %.6f,\n",
+             warmup, frames, timeStart, timeStep);
+    file << "{\n  \"renderer\": " << jsonString(renderer) << ",\n" << numbers << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult& result = results[i];
+        snprintf(numbers, sizeof(numbers), "\"width\": %d, \"height\": %d, \"compile_ms\": %.3f, \"pixels_per_s\": %.0f",
+                 result.width, result.height, result.compileMs, result.pixelsPerSecond);
+        file << (i ? ",\n" : "\n") << "    {\"shader\": " << jsonString(result.shader) << ", \"tier\": " << jsonString(result.tier)
+             << ", " << numbers << ",\n     \"gpu_ms\": " << timingJson(result.gpuMs)
+             << ",\n     \"wall_ms\": " << timingJson(result.wallMs) << "}";
+    }
+    file << "\n  ]\n}\n";
+    return bool(file);
+}
+
+bool BenchReport::load(const std::string& path, std::string& error)
+{
+    results.clear();
+    try
+    {
+        YAML::Node root = YAML::LoadFile(path);
+        if (!root["results"] || !root["results"].IsSequence())
+        {
+            error = "no 'results' list in " + path;
+            return false;
+        }
+        renderer = root["renderer"] ? root["renderer"].as<std::string>() : "";
+        warmup = root["warmup"] ? root["warmup"].as<int>() : 0;
+        frames = root["frames"] ? root["frames"].as<int>() : 0;
+        timeStart = root["time_start"] ? root["time_start"].as<float>() : 0.0f;
+        timeStep = root["time_step"] ? root["time_step"].as<float>() : 0.0f;
+        for (const YAML::Node& node : root["results"])
+        {
+            BenchResult result;
+            result.shader = node["shader"].as<std::string>();
+            result.tier = node["tier"] ? node["tier"].as<std::string>() : "";
+            result.width = node["width"].as<int>();
+            result.height = node["height"].as<int>();
+            result.compileMs = node["compile_ms"] ? node["compile_ms"].as<float>() : 0.0f;
+            result.pixelsPerSecond = node["pixels_per_s"] ? node["pixels_per_s"].as<double>() : 0.0;
+            result.gpuMs = timingOf(node["gpu_ms"]);
+            result.wallMs = node["wall_ms"] ? timingOf(node["wall_ms"]) : TimingSummary();
+            results.push_back(result);
+        }
+    }
+    catch (const YAML::Exception& e)
+    {
+        error = "cannot read " + path + ": " + e.what();
+        results.clear();
+        return false;
+    }
+    return true;
+}
+
+std::string BenchComparison::summary() const
+{
+    char text[128];
+    snprintf(text, sizeof(text), "%d compared, %d regressions, %d slower tails, %d improvements, %d missing",
+             compared, regressions, slowerTails, improvements, missing);
+    return text;
+}
+
+BenchComparison compareBench(const BenchReport& current, const BenchReport& baseline, float threshold)
+{
+    BenchComparison comparison;
+    std::map<std::string, const BenchResult*> before;
+    for (const BenchResult& result : baseline.results)
+        before[result.key()] = &result;
+
+    char line[256];
+    for (const BenchResult& result : current.results)
+    {
+        std::map<std::string, const BenchResult*>::iterator match = before.find(result.key());
+        if (match == before.end())
+        {
+            ++comparison.missing;
+            comparison.lines.push_back("new        " + result.key() + ", not in the baseline");
+            continue;
+        }
+        const BenchResult& old = *match->second;
+        before.erase(match);
+        ++comparison.compared;
+        // relative to the baseline
+        const float p50 = old.gpuMs.p50 > 0.0f ? result.gpuMs.p50 / old.gpuMs.p50 - 1.0f : 0.0f;
+        const float p95 = old.gpuMs.p95 > 0.0f ? result.gpuMs.p95 / old.gpuMs.p95 - 1.0f : 0.0f;
+        const char* verdict = nullptr;
+        if (p50 > threshold)
+        {
+            verdict = "REGRESSION";
+            ++comparison.regressions;
+        }
+        else if (p95 > threshold)
+        {
+            verdict = "tail      ";
+            ++comparison.slowerTails;
+        }
+        else if (p50 < -threshold)
+        {
+            verdict = "improved  ";
+            ++comparison.improvements;
+        }
+        if (!verdict)
+            continue;
+        snprintf(line, sizeof(line), "%s %s: p50 %.3f -> %.3f ms (%+.1f%%), p95 %.3f -> %.3f ms (%+.1f%%)",
+                 verdict, result.key().c_str(), old.gpuMs.p50, result.gpuMs.p50, p50 * 100.0f,
+                 old.gpuMs.p95, result.gpuMs.p95, p95 * 100.0f);
+        comparison.lines.push_back(line);
+    }
+    for (const std::pair<const std::string, const BenchResult*>& gone : before)
+    {
+        ++comparison.missing;
+        comparison.lines.push_back("missing    " + gone.first + ", in the baseline but not measured");
+    }
+    return comparison;
+}
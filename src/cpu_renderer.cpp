@@ -0,0 +1,98 @@
+#include "myImplement/cpu_renderer.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+void CpuRenderer::setLayout(const glsl::Program& program)
+{
+    int floatCount = 0;
+    slots.clear();
+    for (const glsl::UniformSlot& slot : glsl::uniformLayout(program, floatCount))
+        slots[slot.name] = slot;
+    uniforms.assign(size_t(floatCount), 0.0f);
+    activeUniforms = glsl::activeUniforms(program);
+    frameWidth = frameHeight = 0;
+}
+
+const unsigned char* CpuRenderer::render(int width, int height)
+{
+    unsigned char* rgba = scheduler.frameBuffer(width, height);
+    frameReused = width == frameWidth && height == frameHeight;
+    if (frameReused || !isValid())
+        return rgba;
+    frameWidth = width;
+    frameHeight = height;
+    scheduler.run(width, height, [&](const Tile& tile, int)
+    {
+        renderTile(tile, width, rgba);
+    });
+    return rgba;
+}
+
+void CpuRenderer::setFloats(const std::string& name, const float* values, int count)
+{
+    std::map<std::string, glsl::UniformSlot>::const_iterator it = slots.find(name);
+    if (it == slots.end())
+        return;
+    const glsl::Type& type = it->second.type;
+    count = std::min(count, type.rows * type.cols);
+    float* slot = uniforms.data() + it->second.offset;
+    if (std::equal(values, values + count, slot))
+        return;
+    std::copy(values, values + count, slot);
+    // the frame no longer matches, unless main() never reads this uniform
+    if (activeUniforms.count(name))
+        frameWidth = frameHeight = 0;
+}
+
+void CpuRenderer::setBool(const std::string &name, bool value)
+{
+    float v = value ? 1.0f : 0.0f;
+    setFloats(name, &v, 1);
+}
+void CpuRenderer::setInt(const std::string &name, int value)
+{
+    float v = float(value);
+    setFloats(name, &v, 1);
+}
+void CpuRenderer::setFloat(const std::string &name, float value)
+{
+    setFloats(name, &value, 1);
+}
+void CpuRenderer::setVec2(const std::string &name, const glm::vec2 &value)
+{
+    setFloats(name, glm::value_ptr(value), 2);
+}
+void CpuRenderer::setVec2(const std::string &name, float x, float y)
+{
+    setVec2(name, glm::vec2(x, y));
+}
+void CpuRenderer::setVec3(const std::string &name, const glm::vec3 &value)
+{
+    setFloats(name, glm::value_ptr(value), 3);
+}
+void CpuRenderer::setVec3(const std::string &name, float x, float y, float z)
+{
+    setVec3(name, glm::vec3(x, y, z));
+}
+void CpuRenderer::setVec4(const std::string &name, const glm::vec4 &value)
+{
+    setFloats(name, glm::value_ptr(value), 4);
+}
+void CpuRenderer::setVec4(const std::string &name, float x, float y, float z, float w)
+{
+    setVec4(name, glm::vec4(x, y, z, w));
+}
+void CpuRenderer::setMat2(const std::string &name, const glm::mat2 &mat)
+{
+    setFloats(name, glm::value_ptr(mat), 4);
+}
+void CpuRenderer::setMat3(const std::string &name, const glm::mat3 &mat)
+{
+    setFloats(name, glm::value_ptr(mat), 9);
+}
+void CpuRenderer::setMat4(const std::string &name, const glm::mat4 &mat)
+{
+    setFloats(name, glm::value_ptr(mat), 16);
+}
@@ -0,0 +1,187 @@
+#include "myImplement/cpu_shader.h"
+#include "myImplement/glsl_transpiler.h"
+#include "myImplement/image_io.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace
+{
+    // FNV-1a, only used to name cache entries
+    unsigned long long hashText(const std::string& text, unsigned long long hash = 1469598103934665603ULL)
+    {
+        for (unsigned char c : text)
+        {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    bool readText(const std::string& filePath, std::string& text)
+    {
+        std::ifstream file(filePath, std::ios::in | std::ios::binary);
+        if (!file)
+            return false;
+        std::stringstream stream;
+        stream << file.rdbuf();
+        text = stream.str();
+        return true;
+    }
+
+    bool fileExists(const std::string& filePath)
+    {
+        std::ifstream file(filePath, std::ios::in | std::ios::binary);
+        return file.good();
+    }
+
+    void* openLibrary(const std::string& filePath)
+    {
+#if defined(_WIN32)
+        return (void*)LoadLibraryA(filePath.c_str());
+#else
+        return dlopen(filePath.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+    }
+
+    void* findSymbol(void* library, const char* name)
+    {
+#if defined(_WIN32)
+        return (void*)GetProcAddress((HMODULE)library, name);
+#else
+        return dlsym(library, name);
+#endif
+    }
+
+    void closeLibrary(void* library)
+    {
+#if defined(_WIN32)
+        FreeLibrary((HMODULE)library);
+#else
+        dlclose(library);
+#endif
+    }
+}
+
+CpuShader::CpuShader(const char* fragmentPath, const std::string& compiler, const std::string& cacheDir, const std::string& includeDir,
+                     ShaderPreprocessor* preprocessor, const ShaderDefines& defines)
+    : library(nullptr), tileFunc(nullptr)
+{
+    std::string fragmentCode;
+    if (preprocessor)
+    {
+        // the preprocessor has printed what it could not read
+        if (!preprocessor->expand(fragmentPath, fragmentCode))
+            return;
+    }
+    else if (!readText(fragmentPath, fragmentCode))
+    {
+        std::cout << "ERROR::CPU_SHADER::FILE_NOT_SUCCESFULLY_READ: " << fragmentPath << std::endl;
+        return;
+    }
+    std::vector<bool> found;
+    overrideDefines(fragmentCode, defines, found);
+    glsl::Program program;
+    std::string source, error;
+    if (!glsl::parse(fragmentCode, program))
+        error = program.error;
+    else
+        glsl::transpile(program, source, error);
+    if (!error.empty())
+    {
+        std::cout << "ERROR::CPU_SHADER::TRANSLATION_ERROR in " << fragmentPath << "\n" << error << std::endl;
+        return;
+    }
+
+    setLayout(program);
+    build(source, compiler, cacheDir, includeDir);
+}
+
+CpuShader::~CpuShader()
+{
+    if (library)
+        closeLibrary(library);
+}
+
+bool CpuShader::build(const std::string& source, const std::string& compiler, const std::string& cacheDir, const std::string& includeDir)
+{
+#if defined(_WIN32)
+    const char* libraryExt = ".dll";
+#else
+    const char* libraryExt = ".so";
+#endif
+    // -march=native picks the widest lanes this machine has; no fused multiply-adds,
+    // hash functions like fract(sin(x) * 43758.5) must round like the GPU does
+    const std::string flags = "-std=c++14 -O3 -march=native -ffp-contract=off -fno-math-errno -fPIC -shared";
+    std::string runtime;
+    readText(includeDir + "/myImplement/glsl_runtime.h", runtime);
+
+    // anything that changes the binary is part of its name
+    char name[32];
+    snprintf(name, sizeof(name), "shader_%016llx", hashText(source, hashText(runtime, hashText(compiler + " " + flags))));
+    const std::string basePath = cacheDir + "/" + name;
+    const std::string libraryPath = basePath + libraryExt;
+
+    if (!fileExists(libraryPath))
+    {
+        if (!ensureDirectory(cacheDir))
+        {
+            std::cout << "ERROR::CPU_SHADER::CANNOT_CREATE_CACHE: " << cacheDir << std::endl;
+            return false;
+        }
+        const std::string sourcePath = basePath + ".cpp";
+        std::ofstream sourceFile(sourcePath, std::ios::out | std::ios::binary);
+        sourceFile << source;
+        sourceFile.close();
+        if (!sourceFile)
+        {
+            std::cout << "ERROR::CPU_SHADER::CANNOT_WRITE: " << sourcePath << std::endl;
+            return false;
+        }
+        // build next to the final name and rename, so a half written library is never loaded
+        const std::string tempPath = basePath + ".tmp" + libraryExt;
+        const std::string command = "\"" + compiler + "\" " + flags + " -I\"" + includeDir + "\" \"" + sourcePath + "\" -o \"" + tempPath + "\"";
+        std::cout << "building cpu shader: " << command << std::endl;
+        if (system(command.c_str()) != 0 || rename(tempPath.c_str(), libraryPath.c_str()) != 0)
+        {
+            std::cout << "ERROR::CPU_SHADER::BUILD_FAILED: " << command << std::endl;
+            remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    library = openLibrary(libraryPath);
+    if (!library)
+    {
+#if defined(_WIN32)
+        std::cout << "ERROR::CPU_SHADER::LOAD_FAILED: " << libraryPath << std::endl;
+#else
+        std::cout << "ERROR::CPU_SHADER::LOAD_FAILED: " << dlerror() << std::endl;
+#endif
+        return false;
+    }
+    tileFunc = (ShadertoyTileFunc)findSymbol(library, SHADERTOY_TILE_ENTRY);
+    if (!tileFunc)
+    {
+        std::cout << "ERROR::CPU_SHADER::NO_ENTRY_POINT in " << libraryPath << std::endl;
+        closeLibrary(library);
+        library = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void CpuShader::renderTile(const Tile& tile, int width, unsigned char* rgba) const
+{
+    tileFunc(uniforms.data(), tile.x0, tile.y0, tile.x1, tile.y1, width, rgba);
+}
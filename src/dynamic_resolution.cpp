@@ -0,0 +1,82 @@
+#include "myImplement/dynamic_resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+DynamicResolution::DynamicResolution(float targetMs, float minScale, float maxScale, float hysteresis)
+    : current(0), targetMs(std::max(targetMs, 0.1f)),
+      minScale(std::min(std::max(minScale, 0.05f), 1.0f)),
+      maxScale(std::min(std::max(maxScale, this->minScale), 1.0f)),
+      hysteresis(std::max(hysteresis, 0.0f)), scale(this->maxScale), smoothedMs(0.0f), settleFrames(QUERY_COUNT)
+{
+    glGenQueries(QUERY_COUNT, queries);
+    std::fill(pending, pending + QUERY_COUNT, false);
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    glDeleteQueries(QUERY_COUNT, queries);
+}
+
+void DynamicResolution::beginFrame()
+{
+    // collect whatever finished, oldest first, without stalling
+    for (int i = 0; i < QUERY_COUNT; ++i)
+    {
+        const int slot = (current + i) % QUERY_COUNT;
+        if (!pending[slot])
+            continue;
+        GLuint available = 0;
+        glGetQueryObjectuiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &ns);
+        pending[slot] = false;
+        submit(float(ns) * 1e-6f);
+    }
+    // all queries busy: skip timing this frame rather than wait
+    if (!pending[current])
+        glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+}
+
+void DynamicResolution::endFrame()
+{
+    if (pending[current])
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    pending[current] = true;
+    current = (current + 1) % QUERY_COUNT;
+}
+
+void DynamicResolution::restart()
+{
+    // results in flight timed the old program
+    smoothedMs = 0.0f;
+    settleFrames = QUERY_COUNT;
+}
+
+void DynamicResolution::submit(float ms)
+{
+    // the first frames pay for shader compilation, and results timed
+    // at the old scale say nothing about the new one
+    if (settleFrames > 0)
+    {
+        --settleFrames;
+        return;
+    }
+    smoothedMs = smoothedMs > 0.0f ? smoothedMs * 0.8f + ms * 0.2f : ms;
+    if (smoothedMs <= targetMs * (1.0f + hysteresis) && smoothedMs >= targetMs * (1.0f - hysteresis))
+        return;
+
+    // shading cost follows the pixel count, i.e. the square of the scale.
+    // drop quickly when over budget, climb back slowly
+    const float ratio = std::sqrt(targetMs / smoothedMs);
+    const float next = std::min(std::max(scale * std::min(std::max(ratio, 0.7f), 1.05f), minScale), maxScale);
+    if (std::fabs(next - scale) < 0.01f)
+        return;
+    // the smoothed time is rescaled to the estimate at the new size
+    smoothedMs *= (next * next) / (scale * scale);
+    scale = next;
+    settleFrames = QUERY_COUNT;
+}
@@ -0,0 +1,98 @@
+#include "myImplement/file_watcher.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher()
+    : fd(-1)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+#if defined(__linux__)
+    if (fd >= 0)
+        close(fd);
+#endif
+}
+
+bool FileWatcher::watch(const std::string& path)
+{
+#if defined(__linux__)
+    for (const WatchedFile& file : files)
+    {
+        if (file.path == path)
+            return true;
+    }
+    if (fd < 0)
+    {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+        {
+            std::cout << "ERROR::FILE_WATCHER:: inotify: " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    const size_t slash = path.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "." : path.substr(0, std::max<size_t>(slash, 1));
+    WatchedFile file;
+    file.path = path;
+    file.name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    std::map<std::string, int>::const_iterator known = directories.find(directory);
+    if (known == directories.end())
+    {
+        // a save is either a write that ends in close, or a new file moved in
+        const int descriptor = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (descriptor < 0)
+        {
+            std::cout << "ERROR::FILE_WATCHER:: cannot watch " << directory << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        known = directories.insert(std::make_pair(directory, descriptor)).first;
+    }
+    file.directory = known->second;
+    files.push_back(file);
+    return true;
+#else
+    std::cout << "ERROR::FILE_WATCHER:: watching files needs inotify, " << path << " is not watched" << std::endl;
+    return false;
+#endif
+}
+
+void FileWatcher::poll(std::vector<std::string>& changed)
+{
+    changed.clear();
+#if defined(__linux__)
+    if (fd < 0)
+        return;
+    alignas(inotify_event) char buffer[4096];
+    for (;;)
+    {
+        const ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0)
+            return;
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+            if (event->len == 0)
+                continue;
+            for (const WatchedFile& file : files)
+            {
+                if (file.directory == event->wd && file.name == event->name &&
+                    std::find(changed.begin(), changed.end(), file.path) == changed.end())
+                    changed.push_back(file.path);
+            }
+        }
+    }
+#endif
+}
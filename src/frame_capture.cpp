@@ -0,0 +1,228 @@
+#include "myImplement/frame_capture.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+std::string CaptureStats::summary() const
+{
+    char text[160];
+    snprintf(text, sizeof(text), "%d frames captured, %d dropped, %d failed, latency %.2f ms mean / %.2f ms max, %.1f fps, %.1f MB/s",
+             captured, dropped, failed, meanLatencyMs, maxLatencyMs,
+             seconds > 0.0 ? captured / seconds : 0.0, seconds > 0.0 ? megabytes / seconds : 0.0);
+    return text;
+}
+
+FrameCapture::FrameCapture(int width, int height, int depth, bool dropWhenFull, Consumer consumer)
+    : width(width), height(height), dropWhenFull(dropWhenFull), consumer(consumer),
+      stopping(false), totalLatencyMs(0.0), started(false)
+{
+    slots.resize(std::max(depth, 1));
+    for (Slot& slot : slots)
+    {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(width) * height * 4, NULL, GL_STREAM_READ);
+        slot.fence = 0;
+        slot.state = SLOT_FREE;
+        slot.frame = -1;
+        slot.pixels = nullptr;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    worker = std::thread(&FrameCapture::workerLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    finish();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    queued.notify_all();
+    worker.join();
+    for (Slot& slot : slots)
+        glDeleteBuffers(1, &slot.buffer);
+}
+
+bool FrameCapture::capture(GLuint framebuffer, GLenum readBuffer, int frame)
+{
+    poll();
+    int free = -1;
+    while (free < 0)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            for (size_t i = 0; i < slots.size() && free < 0; ++i)
+                if (slots[i].state == SLOT_FREE)
+                    free = int(i);
+            if (free >= 0)
+                break;
+            if (dropWhenFull)
+            {
+                ++stats.dropped;
+                return false;
+            }
+            // every buffer is with the consumer, wait until one comes back
+            if (reading.empty())
+                consumed.wait(guard, [this]()
+                {
+                    for (const Slot& slot : slots)
+                        if (slot.state == SLOT_CONSUMED)
+                            return true;
+                    return false;
+                });
+        }
+        // otherwise the oldest read frees a buffer once the consumer has it
+        mapOldest(true);
+        unmapConsumed();
+    }
+
+    Slot& slot = slots[free];
+    const Clock::time_point now = Clock::now();
+    if (!started)
+        firstCapture = now;
+    started = true;
+    GLint previous = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadBuffer(readBuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    // with a pack buffer bound the pointer is an offset, the copy runs asynchronously
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, GLuint(previous));
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // make sure the fence reaches the GPU, or polling it never sees it pass
+    glFlush();
+
+    std::lock_guard<std::mutex> guard(lock);
+    slot.state = SLOT_READING;
+    slot.frame = frame;
+    slot.start = now;
+    reading.push_back(free);
+    return true;
+}
+
+bool FrameCapture::mapOldest(bool block)
+{
+    if (reading.empty())
+        return false;
+    const int index = reading.front();
+    Slot& slot = slots[index];
+    GLenum status = glClientWaitSync(slot.fence, block ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 0);
+    while (block && status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(slot.fence, 0, 100000000);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return false;
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+    reading.pop_front();
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const unsigned char* pixels = static_cast<const unsigned char*>(
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(width) * height * 4, GL_MAP_READ_BIT));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        slot.pixels = pixels;
+        if (!pixels)
+        {
+            std::cout << "ERROR::FRAME_CAPTURE:: cannot map the pixels of frame " << slot.frame << std::endl;
+            ++stats.failed;
+            slot.state = SLOT_CONSUMED;
+            return true;
+        }
+        slot.state = SLOT_MAPPED;
+        mapped.push_back(index);
+    }
+    queued.notify_one();
+    return true;
+}
+
+void FrameCapture::unmapConsumed()
+{
+    std::vector<int> done;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (size_t i = 0; i < slots.size(); ++i)
+            if (slots[i].state == SLOT_CONSUMED)
+                done.push_back(int(i));
+    }
+    for (int index : done)
+    {
+        Slot& slot = slots[index];
+        if (slot.pixels)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        slot.pixels = nullptr;
+        slot.state = SLOT_FREE;
+    }
+}
+
+void FrameCapture::poll()
+{
+    while (mapOldest(false))
+        ;
+    unmapConsumed();
+}
+
+void FrameCapture::finish()
+{
+    while (!reading.empty())
+        mapOldest(true);
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        consumed.wait(guard, [this]()
+        {
+            for (const Slot& slot : slots)
+                if (slot.state == SLOT_MAPPED)
+                    return false;
+            return true;
+        });
+    }
+    unmapConsumed();
+}
+
+void FrameCapture::workerLoop()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;)
+    {
+        queued.wait(guard, [this]() { return stopping || !mapped.empty(); });
+        if (mapped.empty())
+            return;
+        const int index = mapped.front();
+        mapped.pop_front();
+        const int frame = slots[index].frame;
+        const unsigned char* pixels = slots[index].pixels;
+        guard.unlock();
+
+        const bool stored = consumer(frame, pixels);
+
+        const Clock::time_point now = Clock::now();
+        guard.lock();
+        const double latencyMs = std::chrono::duration<double, std::milli>(now - slots[index].start).count();
+        ++stats.captured;
+        stats.failed += stored ? 0 : 1;
+        stats.maxLatencyMs = std::max(stats.maxLatencyMs, latencyMs);
+        stats.megabytes += double(width) * height * 4 / (1024.0 * 1024.0);
+        stats.seconds = std::chrono::duration<double>(now - firstCapture).count();
+        totalLatencyMs += latencyMs;
+        slots[index].state = SLOT_CONSUMED;
+        consumed.notify_all();
+    }
+}
+
+CaptureStats FrameCapture::getStats() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    CaptureStats result = stats;
+    result.meanLatencyMs = stats.captured > 0 ? totalLatencyMs / stats.captured : 0.0;
+    return result;
+}
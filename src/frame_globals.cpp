@@ -0,0 +1,197 @@
+#include "myImplement/frame_globals.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <regex>
+#include <sstream>
+
+namespace
+{
+    // std140 layout of the block below, one record per view
+    struct FrameRecord
+    {
+        float resolution[2]; // offset 0
+        float mouse[2];      // offset 8
+        float time;          // offset 16
+        float timeDelta;     // offset 20
+        int frame;           // offset 24
+        float pad;
+        float date[4];       // offset 32, a vec4 starts on 16 bytes
+    };
+    static_assert(sizeof(FrameRecord) == 48, "FrameRecord must match the std140 block");
+
+    struct Member
+    {
+        const char* type;
+        const char* name;
+    };
+    const Member MEMBERS[] = {
+        { "vec2", "iResolution" }, { "vec2", "iMousePos" }, { "float", "iTime" },
+        { "float", "iTimeDelta" }, { "int", "iFrame" },     { "vec4", "iDate" },
+    };
+    const size_t MEMBER_COUNT = sizeof(MEMBERS) / sizeof(MEMBERS[0]);
+
+    // a single line, it replaces the first declaration it stands in for. a
+    // member the program declares with another type keeps its place in the
+    // layout under another name, the program's own uniform stays as it is
+    std::string blockSource(const std::vector<bool>& mistyped)
+    {
+        std::string block = "layout(std140) uniform FrameGlobals {";
+        for (size_t i = 0; i < MEMBER_COUNT; ++i)
+            block += std::string(" ") + MEMBERS[i].type + " " + MEMBERS[i].name + (mistyped[i] ? "_frameGlobal" : "") + ";";
+        return block + " };";
+    }
+}
+
+FrameInputs::FrameInputs()
+    : time(0.0f), timeDelta(0.0f), frame(0), mouse(0.0f), date(0.0f)
+{
+    for (int i = 0; i < FRAME_VIEW_COUNT; ++i)
+        resolution[i] = glm::vec2(0.0f);
+}
+
+glm::vec4 FrameInputs::dateNow()
+{
+    const std::time_t now = std::time(nullptr);
+    const std::tm* local = std::localtime(&now);
+    if (!local)
+        return glm::vec4(0.0f);
+    return glm::vec4(float(local->tm_year + 1900), float(local->tm_mon), float(local->tm_mday),
+                     float(local->tm_hour * 3600 + local->tm_min * 60 + local->tm_sec));
+}
+
+FrameGlobals::FrameGlobals()
+    : UBO(0), stride(0)
+{
+}
+
+FrameGlobals::~FrameGlobals()
+{
+    release();
+}
+
+bool FrameGlobals::create()
+{
+    release();
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = std::max(alignment, 1);
+    stride = (GLsizeiptr(sizeof(FrameRecord)) + alignment - 1) / alignment * alignment;
+    staging.assign(size_t(stride) * FRAME_VIEW_COUNT, 0);
+
+    glGenBuffers(1, &UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferData(GL_UNIFORM_BUFFER, GLsizeiptr(staging.size()), staging.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    if (glGetError() != GL_NO_ERROR)
+    {
+        std::cout << "ERROR::FRAME_GLOBALS:: cannot create the uniform buffer" << std::endl;
+        release();
+        return false;
+    }
+    bindView(FRAME_VIEW_SCENE);
+    return true;
+}
+
+void FrameGlobals::release()
+{
+    if (UBO)
+        glDeleteBuffers(1, &UBO);
+    UBO = 0;
+}
+
+void FrameGlobals::update(const FrameInputs& inputs)
+{
+    if (!UBO)
+        return;
+    FrameRecord record;
+    memset(&record, 0, sizeof(record));
+    record.mouse[0] = inputs.mouse.x;
+    record.mouse[1] = inputs.mouse.y;
+    record.time = inputs.time;
+    record.timeDelta = inputs.timeDelta;
+    record.frame = inputs.frame;
+    for (int i = 0; i < 4; ++i)
+        record.date[i] = inputs.date[i];
+    for (int view = 0; view < FRAME_VIEW_COUNT; ++view)
+    {
+        record.resolution[0] = inputs.resolution[view].x;
+        record.resolution[1] = inputs.resolution[view].y;
+        memcpy(&staging[size_t(stride) * view], &record, sizeof(record));
+    }
+    // respecifying the whole store orphans the old one, so draws of the
+    // last frame that still read it do not stall this upload
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferData(GL_UNIFORM_BUFFER, GLsizeiptr(staging.size()), staging.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    bindView(FRAME_VIEW_SCENE);
+}
+
+void FrameGlobals::bindView(FrameView view) const
+{
+    if (UBO)
+        glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_GLOBALS_BINDING, UBO, stride * view, GLsizeiptr(sizeof(FrameRecord)));
+}
+
+bool injectFrameGlobals(std::string& source, std::vector<std::string>& read)
+{
+    static const std::regex declaration("^\\s*uniform\\s+(\\w+)\\s+(\\w+)\\s*;.*$");
+    std::vector<std::string> lines;
+    std::istringstream input(source);
+    for (std::string line; std::getline(input, line);)
+        lines.push_back(line);
+
+    std::vector<size_t> declared; // lines holding a member's declaration
+    std::vector<const char*> names;
+    std::vector<bool> mistyped(MEMBER_COUNT, false);
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        std::smatch match;
+        if (!std::regex_match(lines[i], match, declaration))
+            continue;
+        for (size_t m = 0; m < MEMBER_COUNT; ++m)
+        {
+            const Member& member = MEMBERS[m];
+            if (match[2] != member.name)
+                continue;
+            // a program with its own idea of the type keeps its own uniform,
+            // the other members still come from the block
+            if (match[1] != member.type)
+            {
+                std::cout << "ERROR::FRAME_GLOBALS:: " << member.name << " is declared as " << match[1]
+                          << ", the frame block has a " << member.type << ", it is not set" << std::endl;
+                mistyped[m] = true;
+                continue;
+            }
+            declared.push_back(i);
+            names.push_back(member.name);
+        }
+    }
+    if (declared.empty())
+        return false;
+
+    // a declared name that never comes up again is not read
+    for (const char* name : names)
+    {
+        const std::regex use(std::string("\\b") + name + "\\b");
+        for (size_t i = 0; i < lines.size(); ++i)
+        {
+            if (std::find(declared.begin(), declared.end(), i) == declared.end() && std::regex_search(lines[i], use))
+            {
+                read.push_back(name);
+                break;
+            }
+        }
+    }
+
+    lines[declared[0]] = blockSource(mistyped);
+    for (size_t i = 1; i < declared.size(); ++i)
+        lines[declared[i]] = "";
+    std::string result;
+    for (const std::string& line : lines)
+        result += line + "\n";
+    source.swap(result);
+    return true;
+}
@@ -0,0 +1,251 @@
+#include "myImplement/frame_profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+    // the 'p'-th percentile of the filled part of a ring
+    float percentile(std::vector<float> values, float p)
+    {
+        if (values.empty())
+            return 0.0f;
+        const size_t rank = std::min(values.size() - 1, size_t(p * float(values.size() - 1) + 0.5f));
+        std::nth_element(values.begin(), values.begin() + rank, values.end());
+        return values[rank];
+    }
+
+    // phase names come from the code, only quotes and backslashes need escaping
+    std::string jsonString(const std::string& text)
+    {
+        std::string out = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out + "\"";
+    }
+}
+
+std::string PhaseStats::summary() const
+{
+    char text[200];
+    snprintf(text, sizeof(text), "%-10s cpu %6.2f / %6.2f / %6.2f / %6.2f ms  gpu %6.2f / %6.2f / %6.2f / %6.2f ms (p50/p95/p99/max)",
+             name.c_str(), cpuP50, cpuP95, cpuP99, cpuMax, gpuP50, gpuP95, gpuP99, gpuMax);
+    return text;
+}
+
+FrameProfiler::FrameProfiler(bool gpu, int history, int traceFrames)
+    : gpu(gpu), history(std::max(history, 1)), traceFrames(std::max(traceFrames, 0)),
+      start(std::chrono::steady_clock::now()), gpuOffsetUs(0.0), current(0), timingGpu(false)
+{
+    for (FrameSlot& slot : slots)
+    {
+        slot.frame = -1;
+        slot.pending = false;
+        slot.queriesUsed = 0;
+    }
+    if (gpu)
+        syncClocks();
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    for (FrameSlot& slot : slots)
+    {
+        if (!slot.queries.empty())
+            glDeleteQueries(GLsizei(slot.queries.size()), slot.queries.data());
+    }
+}
+
+double FrameProfiler::nowUs() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+void FrameProfiler::syncClocks()
+{
+    // the GPU clock read right now, against the CPU clock around the read
+    GLint64 gpuNs = 0;
+    const double before = nowUs();
+    glGetInteger64v(GL_TIMESTAMP, &gpuNs);
+    const double after = nowUs();
+    gpuOffsetUs = (before + after) * 0.5 - double(gpuNs) * 1e-3;
+}
+
+int FrameProfiler::phaseIndex(const char* name)
+{
+    for (size_t i = 0; i < phases.size(); ++i)
+    {
+        if (phases[i].name == name)
+            return int(i);
+    }
+    Phase phase;
+    phase.name = name;
+    phase.cpuNext = 0;
+    phase.gpuNext = 0;
+    phases.push_back(phase);
+    return int(phases.size()) - 1;
+}
+
+void FrameProfiler::addSample(std::vector<float>& ring, int& next, float ms)
+{
+    if (int(ring.size()) < history)
+        ring.push_back(ms);
+    else
+        ring[next] = ms;
+    next = (next + 1) % history;
+}
+
+void FrameProfiler::addTrace(const TraceEvent& event)
+{
+    if (traceFrames == 0)
+        return;
+    trace.push_back(event);
+    // CPU events of the newest frame arrive before the GPU ones of older
+    // frames, drop by frame number rather than by arrival
+    while (!trace.empty() && trace.front().frame <= event.frame - traceFrames)
+        trace.pop_front();
+}
+
+void FrameProfiler::beginFrame(int frame)
+{
+    FrameSlot& slot = slots[current];
+    // a slot the GPU has not finished with yet is not waited for: its
+    // results are given up and this frame goes without GPU times
+    if (slot.pending)
+        collect(slot);
+    timingGpu = gpu && !slot.pending;
+    slot.pending = false;
+    slot.frame = frame;
+    slot.records.clear();
+    slot.queriesUsed = 0;
+    open.clear();
+}
+
+void FrameProfiler::begin(const char* phase)
+{
+    FrameSlot& slot = slots[current];
+    Record record;
+    record.phase = phaseIndex(phase);
+    record.depth = int(open.size());
+    record.query = -1;
+    if (timingGpu)
+    {
+        if (slot.queriesUsed + 2 > int(slot.queries.size()))
+        {
+            const size_t had = slot.queries.size();
+            slot.queries.resize(had + 8);
+            glGenQueries(8, slot.queries.data() + had);
+        }
+        record.query = slot.queriesUsed;
+        slot.queriesUsed += 2;
+        glQueryCounter(slot.queries[record.query], GL_TIMESTAMP);
+    }
+    record.cpuBegin = nowUs();
+    record.cpuEnd = record.cpuBegin;
+    open.push_back(int(slot.records.size()));
+    slot.records.push_back(record);
+}
+
+void FrameProfiler::end()
+{
+    if (open.empty())
+        return;
+    FrameSlot& slot = slots[current];
+    Record& record = slot.records[open.back()];
+    open.pop_back();
+    record.cpuEnd = nowUs();
+    if (record.query >= 0)
+        glQueryCounter(slot.queries[record.query + 1], GL_TIMESTAMP);
+
+    Phase& phase = phases[record.phase];
+    addSample(phase.cpuMs, phase.cpuNext, float((record.cpuEnd - record.cpuBegin) * 1e-3));
+    TraceEvent event{ record.phase, slot.frame, false, record.cpuBegin, record.cpuEnd - record.cpuBegin };
+    addTrace(event);
+}
+
+void FrameProfiler::endFrame()
+{
+    // phases left open are closed with the frame
+    while (!open.empty())
+        end();
+    slots[current].pending = timingGpu && slots[current].queriesUsed > 0;
+    current = (current + 1) % FRAME_SLOTS;
+    // oldest first, a frame only finishes after the ones before it
+    for (int i = 0; i < FRAME_SLOTS; ++i)
+    {
+        FrameSlot& slot = slots[(current + i) % FRAME_SLOTS];
+        if (slot.pending)
+            collect(slot);
+        if (slot.pending)
+            break;
+    }
+}
+
+void FrameProfiler::collect(FrameSlot& slot)
+{
+    // the last query written is the last to finish
+    GLint available = 0;
+    glGetQueryObjectiv(slot.queries[slot.queriesUsed - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return;
+    slot.pending = false;
+    for (const Record& record : slot.records)
+    {
+        if (record.query < 0)
+            continue;
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(slot.queries[record.query], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(slot.queries[record.query + 1], GL_QUERY_RESULT, &end);
+        const double duration = double(end - std::min(begin, end)) * 1e-3;
+        Phase& phase = phases[record.phase];
+        addSample(phase.gpuMs, phase.gpuNext, float(duration * 1e-3));
+        TraceEvent event{ record.phase, slot.frame, true, double(begin) * 1e-3 + gpuOffsetUs, duration };
+        addTrace(event);
+    }
+}
+
+std::vector<PhaseStats> FrameProfiler::getStats() const
+{
+    std::vector<PhaseStats> stats;
+    for (const Phase& phase : phases)
+    {
+        PhaseStats line;
+        line.name = phase.name;
+        line.samples = int(phase.cpuMs.size());
+        line.cpuP50 = percentile(phase.cpuMs, 0.50f);
+        line.cpuP95 = percentile(phase.cpuMs, 0.95f);
+        line.cpuP99 = percentile(phase.cpuMs, 0.99f);
+        line.cpuMax = phase.cpuMs.empty() ? 0.0f : *std::max_element(phase.cpuMs.begin(), phase.cpuMs.end());
+        line.gpuP50 = percentile(phase.gpuMs, 0.50f);
+        line.gpuP95 = percentile(phase.gpuMs, 0.95f);
+        line.gpuP99 = percentile(phase.gpuMs, 0.99f);
+        line.gpuMax = phase.gpuMs.empty() ? 0.0f : *std::max_element(phase.gpuMs.begin(), phase.gpuMs.end());
+        stats.push_back(line);
+    }
+    return stats;
+}
+
+bool FrameProfiler::writeTrace(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file)
+        return false;
+    // complete ("X") events in microseconds, one track per side
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+    char numbers[96];
+    for (const TraceEvent& event : trace)
+    {
+        snprintf(numbers, sizeof(numbers), "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d", event.begin, event.duration, event.gpu ? 2 : 1);
+        file << ",\n{\"name\":" << jsonString(phases[event.phase].name) << ",\"cat\":\"" << (event.gpu ? "gpu" : "cpu")
+             << "\",\"ph\":\"X\"," << numbers << ",\"args\":{\"frame\":" << event.frame << "}}";
+    }
+    file << "\n]}\n";
+    return bool(file);
+}
@@ -0,0 +1,1784 @@
+#include "myImplement/glsl_front.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <sstream>
+
+namespace glsl
+{
+namespace
+{
+    // ================================== lexer ==================================
+
+    enum TokenKind
+    {
+        TK_IDENT,
+        TK_INT,
+        TK_FLOAT,
+        TK_PUNCT,
+        TK_END
+    };
+
+    struct Token
+    {
+        TokenKind kind;
+        std::string text;
+        int line;
+    };
+
+    // thrown internally, reported to the caller through Program::error
+    struct CompileError
+    {
+        std::string message;
+    };
+
+    [[noreturn]] void fail(int line, const std::string& message)
+    {
+        throw CompileError{ "line " + std::to_string(line) + ": " + message };
+    }
+
+    bool isIdentStart(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+    bool isDigit(char c) { return c >= '0' && c <= '9'; }
+    bool isIdentChar(char c) { return isIdentStart(c) || isDigit(c); }
+
+    void tokenize(const std::string& text, int line, std::vector<Token>& out)
+    {
+        static const char* puncts[] = {
+            "<<=", ">>=", "++", "--", "+=", "-=", "*=", "/=", "%=", "==", "!=", "<=", ">=",
+            "&&", "||", "^^", "<<", ">>", "&=", "|=", "^=", "##"
+        };
+        size_t i = 0;
+        while (i < text.size())
+        {
+            char c = text[i];
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v')
+            {
+                ++i;
+                continue;
+            }
+            if (isIdentStart(c))
+            {
+                size_t j = i;
+                while (j < text.size() && isIdentChar(text[j]))
+                    ++j;
+                out.push_back(Token{ TK_IDENT, text.substr(i, j - i), line });
+                i = j;
+                continue;
+            }
+            if (isDigit(c) || (c == '.' && i + 1 < text.size() && isDigit(text[i + 1])))
+            {
+                size_t j = i;
+                bool isFloat = false;
+                if (c == '0' && j + 1 < text.size() && (text[j + 1] == 'x' || text[j + 1] == 'X'))
+                {
+                    j += 2;
+                    while (j < text.size() && isxdigit((unsigned char)text[j]))
+                        ++j;
+                }
+                else
+                {
+                    while (j < text.size() && isDigit(text[j]))
+                        ++j;
+                    if (j < text.size() && text[j] == '.')
+                    {
+                        isFloat = true;
+                        ++j;
+                        while (j < text.size() && isDigit(text[j]))
+                            ++j;
+                    }
+                    if (j < text.size() && (text[j] == 'e' || text[j] == 'E'))
+                    {
+                        isFloat = true;
+                        ++j;
+                        if (j < text.size() && (text[j] == '+' || text[j] == '-'))
+                            ++j;
+                        while (j < text.size() && isDigit(text[j]))
+                            ++j;
+                    }
+                }
+                std::string number = text.substr(i, j - i);
+                if (j < text.size() && (text[j] == 'f' || text[j] == 'F'))
+                {
+                    isFloat = true;
+                    ++j;
+                }
+                else if (j < text.size() && (text[j] == 'u' || text[j] == 'U'))
+                    ++j;
+                out.push_back(Token{ isFloat ? TK_FLOAT : TK_INT, number, line });
+                i = j;
+                continue;
+            }
+            bool matched = false;
+            for (const char* p : puncts)
+            {
+                size_t n = strlen(p);
+                if (text.compare(i, n, p) == 0)
+                {
+                    out.push_back(Token{ TK_PUNCT, p, line });
+                    i += n;
+                    matched = true;
+                    break;
+                }
+            }
+            if (!matched)
+            {
+                out.push_back(Token{ TK_PUNCT, std::string(1, c), line });
+                ++i;
+            }
+        }
+    }
+
+    // replace comments by blanks, newlines are kept so line numbers survive
+    std::string stripComments(const std::string& source)
+    {
+        std::string out = source;
+        size_t i = 0;
+        while (i < out.size())
+        {
+            if (out[i] == '/' && i + 1 < out.size() && out[i + 1] == '/')
+            {
+                while (i < out.size() && out[i] != '\n')
+                    out[i++] = ' ';
+            }
+            else if (out[i] == '/' && i + 1 < out.size() && out[i + 1] == '*')
+            {
+                while (i < out.size() && !(out[i] == '*' && i + 1 < out.size() && out[i + 1] == '/'))
+                {
+                    if (out[i] != '\n')
+                        out[i] = ' ';
+                    ++i;
+                }
+                if (i < out.size())
+                    out[i++] = ' ';
+                if (i < out.size())
+                    out[i++] = ' ';
+            }
+            else
+                ++i;
+        }
+        return out;
+    }
+
+    // ============================== preprocessor ===============================
+
+    struct Macro
+    {
+        bool functionLike;
+        std::vector<std::string> params;
+        std::vector<Token> body;
+    };
+
+    class Preprocessor
+    {
+    private:
+        std::map<std::string, Macro> macros;
+
+        bool isPunct(const Token& token, const char* text) const
+        {
+            return token.kind == TK_PUNCT && token.text == text;
+        }
+
+        void expand(const std::vector<Token>& in, std::vector<Token>& out, std::set<std::string>& active, int line)
+        {
+            for (size_t i = 0; i < in.size(); ++i)
+            {
+                const Token& token = in[i];
+                std::map<std::string, Macro>::const_iterator it = token.kind == TK_IDENT ? macros.find(token.text) : macros.end();
+                if (it == macros.end() || active.count(token.text))
+                {
+                    out.push_back(Token{ token.kind, token.text, line });
+                    continue;
+                }
+                const Macro& macro = it->second;
+                std::vector<Token> replaced;
+                if (!macro.functionLike)
+                    replaced = macro.body;
+                else
+                {
+                    if (i + 1 >= in.size() || !isPunct(in[i + 1], "("))
+                    {
+                        out.push_back(Token{ token.kind, token.text, line });
+                        continue;
+                    }
+                    std::vector<std::vector<Token>> args(1);
+                    int depth = 0;
+                    size_t j = i + 2;
+                    for (; j < in.size(); ++j)
+                    {
+                        if (isPunct(in[j], "("))
+                            ++depth;
+                        else if (isPunct(in[j], ")"))
+                        {
+                            if (depth == 0)
+                                break;
+                            --depth;
+                        }
+                        else if (isPunct(in[j], ",") && depth == 0)
+                        {
+                            args.emplace_back();
+                            continue;
+                        }
+                        args.back().push_back(in[j]);
+                    }
+                    if (j >= in.size())
+                        fail(line, "unterminated call of macro '" + token.text + "'");
+                    if (macro.params.empty() && args.size() == 1 && args[0].empty())
+                        args.clear();
+                    if (args.size() != macro.params.size())
+                        fail(line, "wrong number of arguments for macro '" + token.text + "'");
+                    for (std::vector<Token>& arg : args)
+                    {
+                        std::vector<Token> expanded;
+                        expand(arg, expanded, active, line);
+                        arg.swap(expanded);
+                    }
+                    for (const Token& bodyToken : macro.body)
+                    {
+                        size_t p = 0;
+                        while (p < macro.params.size() && !(bodyToken.kind == TK_IDENT && bodyToken.text == macro.params[p]))
+                            ++p;
+                        if (p < macro.params.size())
+                            replaced.insert(replaced.end(), args[p].begin(), args[p].end());
+                        else
+                            replaced.push_back(bodyToken);
+                    }
+                    i = j;
+                }
+                active.insert(token.text);
+                expand(replaced, out, active, line);
+                active.erase(token.text);
+            }
+        }
+
+        // integer expression evaluator for #if / #elif
+        struct Evaluator
+        {
+            const std::vector<Token>& tokens;
+            size_t pos;
+            int line;
+
+            long primary()
+            {
+                if (pos >= tokens.size())
+                    fail(line, "incomplete #if expression");
+                const Token& token = tokens[pos++];
+                if (token.kind == TK_INT)
+                    return strtol(token.text.c_str(), nullptr, 0);
+                if (token.kind == TK_IDENT)
+                    return 0; // undefined identifiers evaluate to zero
+                if (token.text == "(")
+                {
+                    long value = expression(0);
+                    if (pos >= tokens.size() || tokens[pos].text != ")")
+                        fail(line, "missing ')' in #if expression");
+                    ++pos;
+                    return value;
+                }
+                if (token.text == "!")
+                    return !primary();
+                if (token.text == "-")
+                    return -primary();
+                if (token.text == "+")
+                    return primary();
+                fail(line, "unexpected '" + token.text + "' in #if expression");
+            }
+
+            static int precedence(const std::string& op)
+            {
+                if (op == "||") return 1;
+                if (op == "&&") return 2;
+                if (op == "==" || op == "!=") return 3;
+                if (op == "<" || op == ">" || op == "<=" || op == ">=") return 4;
+                if (op == "+" || op == "-") return 5;
+                if (op == "*" || op == "/" || op == "%") return 6;
+                return -1;
+            }
+
+            long expression(int minPrec)
+            {
+                long lhs = primary();
+                while (pos < tokens.size() && tokens[pos].kind == TK_PUNCT)
+                {
+                    std::string op = tokens[pos].text;
+                    int prec = precedence(op);
+                    if (prec < 0 || prec <= minPrec - 1 || prec < minPrec)
+                        break;
+                    ++pos;
+                    long rhs = expression(prec + 1);
+                    if (op == "||") lhs = lhs || rhs;
+                    else if (op == "&&") lhs = lhs && rhs;
+                    else if (op == "==") lhs = lhs == rhs;
+                    else if (op == "!=") lhs = lhs != rhs;
+                    else if (op == "<") lhs = lhs < rhs;
+                    else if (op == ">") lhs = lhs > rhs;
+                    else if (op == "<=") lhs = lhs <= rhs;
+                    else if (op == ">=") lhs = lhs >= rhs;
+                    else if (op == "+") lhs = lhs + rhs;
+                    else if (op == "-") lhs = lhs - rhs;
+                    else if (op == "*") lhs = lhs * rhs;
+                    else if (rhs == 0) fail(line, "division by zero in #if expression");
+                    else if (op == "/") lhs = lhs / rhs;
+                    else lhs = lhs % rhs;
+                }
+                return lhs;
+            }
+        };
+
+        bool evaluateCondition(const std::vector<Token>& tokens, int line)
+        {
+            // resolve defined(X) before macro expansion touches X
+            std::vector<Token> resolved;
+            for (size_t i = 0; i < tokens.size(); ++i)
+            {
+                if (tokens[i].kind == TK_IDENT && tokens[i].text == "defined")
+                {
+                    bool paren = i + 1 < tokens.size() && isPunct(tokens[i + 1], "(");
+                    size_t nameAt = paren ? i + 2 : i + 1;
+                    if (nameAt >= tokens.size() || tokens[nameAt].kind != TK_IDENT)
+                        fail(line, "'defined' needs a macro name");
+                    resolved.push_back(Token{ TK_INT, macros.count(tokens[nameAt].text) ? "1" : "0", line });
+                    i = paren ? nameAt + 1 : nameAt;
+                    continue;
+                }
+                resolved.push_back(tokens[i]);
+            }
+            std::vector<Token> expanded;
+            std::set<std::string> active;
+            expand(resolved, expanded, active, line);
+            Evaluator evaluator{ expanded, 0, line };
+            long value = evaluator.expression(0);
+            if (evaluator.pos != expanded.size())
+                fail(line, "junk at the end of #if expression");
+            return value != 0;
+        }
+
+        void defineMacro(const std::vector<Token>& tokens, const std::string& rawLine, int line)
+        {
+            if (tokens.size() < 2 || tokens[1].kind != TK_IDENT)
+                fail(line, "#define needs a macro name");
+            Macro macro;
+            macro.functionLike = false;
+            size_t bodyAt = 2;
+            // a '(' glued to the name makes it function-like
+            size_t namePos = rawLine.find(tokens[1].text);
+            size_t afterName = namePos == std::string::npos ? std::string::npos : namePos + tokens[1].text.size();
+            if (tokens.size() > 2 && isPunct(tokens[2], "(") && afterName < rawLine.size() && rawLine[afterName] == '(')
+            {
+                macro.functionLike = true;
+                bodyAt = 3;
+                while (bodyAt < tokens.size() && !isPunct(tokens[bodyAt], ")"))
+                {
+                    if (tokens[bodyAt].kind == TK_IDENT)
+                        macro.params.push_back(tokens[bodyAt].text);
+                    ++bodyAt;
+                }
+                if (bodyAt >= tokens.size())
+                    fail(line, "unterminated macro parameter list");
+                ++bodyAt;
+            }
+            macro.body.assign(tokens.begin() + bodyAt, tokens.end());
+            macros[tokens[1].text] = macro;
+        }
+
+    public:
+        void define(const std::string& name, const std::string& value)
+        {
+            Macro macro;
+            macro.functionLike = false;
+            tokenize(value, 0, macro.body);
+            macros[name] = macro;
+        }
+
+        std::vector<Token> run(const std::string& source)
+        {
+            struct Conditional
+            {
+                bool active;    // this branch is being emitted
+                bool taken;     // some branch of this #if was already taken
+                bool enclosing; // the surrounding region is active
+            };
+            std::vector<Conditional> conditionals;
+            std::vector<Token> out;
+            std::string text = stripComments(source);
+            std::istringstream stream(text);
+            std::string rawLine;
+            int line = 0;
+            while (std::getline(stream, rawLine))
+            {
+                ++line;
+                int firstLine = line;
+                // join continuation lines
+                while (!rawLine.empty() && rawLine.back() == '\\')
+                {
+                    rawLine.pop_back();
+                    std::string next;
+                    if (!std::getline(stream, next))
+                        break;
+                    rawLine += next;
+                    ++line;
+                }
+                bool active = conditionals.empty() || conditionals.back().active;
+                size_t first = rawLine.find_first_not_of(" \t\r");
+                if (first != std::string::npos && rawLine[first] == '#')
+                {
+                    std::vector<Token> tokens;
+                    tokenize(rawLine.substr(first + 1), firstLine, tokens);
+                    tokens.insert(tokens.begin(), Token{ TK_PUNCT, "#", firstLine });
+                    std::string directive = tokens.size() > 1 ? tokens[1].text : "";
+                    std::vector<Token> rest(tokens.size() > 2 ? tokens.begin() + 2 : tokens.end(), tokens.end());
+                    if (directive == "ifdef" || directive == "ifndef")
+                    {
+                        bool defined = !rest.empty() && macros.count(rest[0].text);
+                        bool result = directive == "ifdef" ? defined : !defined;
+                        conditionals.push_back(Conditional{ active && result, result, active });
+                    }
+                    else if (directive == "if")
+                    {
+                        bool result = active && evaluateCondition(rest, firstLine);
+                        conditionals.push_back(Conditional{ result, result, active });
+                    }
+                    else if (directive == "elif")
+                    {
+                        if (conditionals.empty())
+                            fail(firstLine, "#elif without #if");
+                        Conditional& top = conditionals.back();
+                        bool result = top.enclosing && !top.taken && evaluateCondition(rest, firstLine);
+                        top.active = result;
+                        top.taken = top.taken || result;
+                    }
+                    else if (directive == "else")
+                    {
+                        if (conditionals.empty())
+                            fail(firstLine, "#else without #if");
+                        Conditional& top = conditionals.back();
+                        top.active = top.enclosing && !top.taken;
+                        top.taken = true;
+                    }
+                    else if (directive == "endif")
+                    {
+                        if (conditionals.empty())
+                            fail(firstLine, "#endif without #if");
+                        conditionals.pop_back();
+                    }
+                    else if (!active)
+                        continue;
+                    else if (directive == "define")
+                        defineMacro(std::vector<Token>(tokens.begin() + 1, tokens.end()), rawLine, firstLine);
+                    else if (directive == "undef")
+                    {
+                        if (!rest.empty())
+                            macros.erase(rest[0].text);
+                    }
+                    else if (directive == "line")
+                    {
+                        // "#line N" numbers the next line N
+                        if (!rest.empty() && rest[0].kind == TK_INT)
+                            line = atoi(rest[0].text.c_str()) - 1;
+                    }
+                    else if (directive == "error")
+                        fail(firstLine, "#error" + rawLine.substr(rawLine.find("error") + 5));
+                    // #version, #extension, #pragma and friends do not matter here
+                    continue;
+                }
+                if (!active)
+                    continue;
+                std::vector<Token> tokens;
+                tokenize(rawLine, firstLine, tokens);
+                std::set<std::string> expanding;
+                expand(tokens, out, expanding, firstLine);
+            }
+            if (!conditionals.empty())
+                fail(line, "missing #endif");
+            out.push_back(Token{ TK_END, "", line });
+            return out;
+        }
+    };
+
+    // ================================= parser ==================================
+
+    struct BuiltinInfo
+    {
+        const char* name;
+        int minArgs;
+        int maxArgs;
+        bool intAllowed; // keeps int arguments as int (abs, sign, min, max, clamp)
+    };
+
+    const BuiltinInfo builtinTable[BI_COUNT] = {
+        { "radians", 1, 1, false }, { "degrees", 1, 1, false }, { "sin", 1, 1, false }, { "cos", 1, 1, false },
+        { "tan", 1, 1, false }, { "asin", 1, 1, false }, { "acos", 1, 1, false }, { "atan", 1, 2, false },
+        { "exp", 1, 1, false }, { "log", 1, 1, false }, { "exp2", 1, 1, false }, { "log2", 1, 1, false },
+        { "sqrt", 1, 1, false }, { "inversesqrt", 1, 1, false },
+        { "abs", 1, 1, true }, { "sign", 1, 1, true }, { "floor", 1, 1, false }, { "ceil", 1, 1, false },
+        { "fract", 1, 1, false }, { "trunc", 1, 1, false }, { "round", 1, 1, false },
+        { "pow", 2, 2, false }, { "mod", 2, 2, false }, { "min", 2, 2, true }, { "max", 2, 2, true },
+        { "step", 2, 2, false },
+        { "clamp", 3, 3, true }, { "mix", 3, 3, false }, { "smoothstep", 3, 3, false },
+        { "length", 1, 1, false }, { "distance", 2, 2, false }, { "dot", 2, 2, false }, { "cross", 2, 2, false },
+        { "normalize", 1, 1, false }, { "reflect", 2, 2, false }
+    };
+
+    class Parser
+    {
+    private:
+        std::vector<Token> tokens;
+        size_t pos;
+        Program& program;
+        std::vector<std::map<std::string, Variable*>> scopes;
+        std::map<std::string, int> structIds;
+        std::multimap<std::string, Function*> functions;
+        std::set<Function*> called;
+        Function* current;
+        int loopDepth;
+
+        // ---------------------------- token helpers ----------------------------
+        const Token& peek(size_t ahead = 0) const
+        {
+            size_t at = pos + ahead;
+            return at < tokens.size() ? tokens[at] : tokens.back();
+        }
+        int line() const { return peek().line; }
+        bool isPunct(const char* text, size_t ahead = 0) const
+        {
+            const Token& token = peek(ahead);
+            return token.kind == TK_PUNCT && token.text == text;
+        }
+        bool isKeyword(const char* text, size_t ahead = 0) const
+        {
+            const Token& token = peek(ahead);
+            return token.kind == TK_IDENT && token.text == text;
+        }
+        bool accept(const char* text)
+        {
+            if (isPunct(text))
+            {
+                ++pos;
+                return true;
+            }
+            return false;
+        }
+        bool acceptKeyword(const char* text)
+        {
+            if (isKeyword(text))
+            {
+                ++pos;
+                return true;
+            }
+            return false;
+        }
+        void expect(const char* text)
+        {
+            if (!accept(text))
+                fail(line(), std::string("expected '") + text + "' but found '" + peek().text + "'");
+        }
+        std::string expectIdent()
+        {
+            if (peek().kind != TK_IDENT)
+                fail(line(), "expected an identifier but found '" + peek().text + "'");
+            return tokens[pos++].text;
+        }
+
+        // ----------------------------- types -----------------------------------
+        bool builtinType(const std::string& name, Type& type) const
+        {
+            if (name == "void") { type = Type(TY_VOID); return true; }
+            if (name == "float") { type = Type(TY_FLOAT); return true; }
+            if (name == "int" || name == "uint") { type = Type(TY_INT); return true; }
+            if (name == "bool") { type = Type(TY_BOOL); return true; }
+            if (name.size() == 4 && name.compare(0, 3, "vec") == 0 && name[3] >= '2' && name[3] <= '4')
+            {
+                type = Type(TY_FLOAT, name[3] - '0');
+                return true;
+            }
+            if (name.size() == 5 && (name[0] == 'i' || name[0] == 'b' || name[0] == 'u')
+                && name.compare(1, 3, "vec") == 0 && name[4] >= '2' && name[4] <= '4')
+            {
+                type = Type(name[0] == 'b' ? TY_BOOL : TY_INT, name[4] - '0');
+                return true;
+            }
+            if (name.size() == 4 && name.compare(0, 3, "mat") == 0 && name[3] >= '2' && name[3] <= '4')
+            {
+                type = Type(TY_FLOAT, name[3] - '0', name[3] - '0');
+                return true;
+            }
+            if (name.size() == 6 && name.compare(0, 3, "mat") == 0 && name[4] == 'x' && name[3] == name[5]
+                && name[3] >= '2' && name[3] <= '4')
+            {
+                type = Type(TY_FLOAT, name[3] - '0', name[3] - '0');
+                return true;
+            }
+            return false;
+        }
+
+        bool isTypeName(size_t ahead = 0) const
+        {
+            const Token& token = peek(ahead);
+            if (token.kind != TK_IDENT)
+                return false;
+            Type type;
+            return builtinType(token.text, type) || structIds.count(token.text) > 0
+                || token.text.compare(0, 7, "sampler") == 0;
+        }
+
+        Type parseType()
+        {
+            int at = line();
+            std::string name = expectIdent();
+            Type type;
+            if (builtinType(name, type))
+                return type;
+            std::map<std::string, int>::const_iterator it = structIds.find(name);
+            if (it != structIds.end())
+                return Type(TY_STRUCT, 1, 1, it->second);
+            if (name.compare(0, 7, "sampler") == 0)
+                fail(at, "sampler types are not supported by the CPU back ends");
+            fail(at, "unknown type '" + name + "'");
+        }
+
+        void skipPrecision()
+        {
+            while (acceptKeyword("highp") || acceptKeyword("mediump") || acceptKeyword("lowp"))
+                ;
+        }
+
+        // ---------------------------- symbols ----------------------------------
+        Variable* newVariable(const std::string& name, const Type& type, Storage storage, bool isConst)
+        {
+            std::unique_ptr<Variable> variable(new Variable());
+            variable->name = name;
+            variable->type = type;
+            variable->storage = storage;
+            variable->qualifier = PQ_IN;
+            variable->isConst = isConst;
+            variable->id = int(program.variables.size());
+            program.variables.push_back(std::move(variable));
+            return program.variables.back().get();
+        }
+
+        void declare(Variable* variable, int at)
+        {
+            std::map<std::string, Variable*>& scope = scopes.back();
+            if (scope.count(variable->name))
+                fail(at, "redefinition of '" + variable->name + "'");
+            scope[variable->name] = variable;
+        }
+
+        Variable* lookup(const std::string& name) const
+        {
+            for (size_t i = scopes.size(); i-- > 0;)
+            {
+                std::map<std::string, Variable*>::const_iterator it = scopes[i].find(name);
+                if (it != scopes[i].end())
+                    return it->second;
+            }
+            return nullptr;
+        }
+
+        // ------------------------- conversions ---------------------------------
+        ExprPtr construct(const Type& type, ExprPtr arg, int at)
+        {
+            // fold literal conversions right away, it keeps generated code tidy
+            if (arg->kind == EX_LITERAL && type.isScalar())
+            {
+                arg->type = type;
+                if (type.base == TY_INT)
+                    arg->number = double(long(arg->number));
+                else if (type.base == TY_BOOL)
+                    arg->number = arg->number != 0.0 ? 1.0 : 0.0;
+                return arg;
+            }
+            ExprPtr expr(new Expr(EX_CONSTRUCT, type, at));
+            expr->args.push_back(std::move(arg));
+            return expr;
+        }
+
+        ExprPtr castBase(ExprPtr expr, BaseType base)
+        {
+            if (expr->type.base == base)
+                return expr;
+            Type type = expr->type;
+            type.base = base;
+            int at = expr->line;
+            return construct(type, std::move(expr), at);
+        }
+
+        // implicit conversions: only int -> float of the same shape
+        ExprPtr convert(ExprPtr expr, const Type& target)
+        {
+            if (expr->type == target)
+                return expr;
+            if (expr->type.base == TY_INT && target.base == TY_FLOAT
+                && expr->type.rows == target.rows && expr->type.cols == target.cols)
+                return castBase(std::move(expr), TY_FLOAT);
+            fail(expr->line, "cannot convert from '" + typeName(expr->type, program) + "' to '" + typeName(target, program) + "'");
+        }
+
+        bool convertible(const Type& from, const Type& to) const
+        {
+            return from == to || (from.base == TY_INT && to.base == TY_FLOAT && from.rows == to.rows && from.cols == to.cols);
+        }
+
+        ExprPtr broadcast(ExprPtr expr, int size)
+        {
+            if (size <= 1 || !expr->type.isScalar())
+                return expr;
+            int at = expr->line;
+            Type type(expr->type.base, size);
+            return construct(type, std::move(expr), at);
+        }
+
+        bool isLvalue(const Expr& expr) const
+        {
+            switch (expr.kind)
+            {
+            case EX_VARIABLE:
+                return !expr.variable->isConst && expr.variable->storage != VS_UNIFORM && expr.variable->storage != VS_INPUT;
+            case EX_SWIZZLE:
+                for (int i = 0; i < expr.swizzleCount; ++i)
+                    for (int j = i + 1; j < expr.swizzleCount; ++j)
+                        if (expr.swizzle[i] == expr.swizzle[j])
+                            return false;
+                return isLvalue(*expr.args[0]);
+            case EX_FIELD:
+            case EX_INDEX:
+                return isLvalue(*expr.args[0]);
+            default:
+                return false;
+            }
+        }
+
+        // ------------------------- typed builders ------------------------------
+        ExprPtr makeBinary(Operator op, ExprPtr a, ExprPtr b, int at)
+        {
+            if (op == OP_AND || op == OP_OR || op == OP_XOR)
+            {
+                if (a->type != Type(TY_BOOL) || b->type != Type(TY_BOOL))
+                    fail(at, "logical operators need bool operands");
+                ExprPtr expr(new Expr(EX_BINARY, Type(TY_BOOL), at));
+                expr->op = op;
+                expr->args.push_back(std::move(a));
+                expr->args.push_back(std::move(b));
+                return expr;
+            }
+            if (op == OP_EQ || op == OP_NE)
+            {
+                if (a->type.base != b->type.base && a->type.isNumeric() && b->type.isNumeric())
+                {
+                    a = castBase(std::move(a), TY_FLOAT);
+                    b = castBase(std::move(b), TY_FLOAT);
+                }
+                if (a->type != b->type)
+                    fail(at, "cannot compare '" + typeName(a->type, program) + "' with '" + typeName(b->type, program) + "'");
+                if (a->type.base == TY_STRUCT)
+                    fail(at, "struct comparison is not supported");
+                ExprPtr expr(new Expr(EX_BINARY, Type(TY_BOOL), at));
+                expr->op = op;
+                expr->args.push_back(std::move(a));
+                expr->args.push_back(std::move(b));
+                return expr;
+            }
+            if (!a->type.isNumeric() || !b->type.isNumeric())
+                fail(at, "arithmetic needs numeric operands");
+            if (a->type.base != b->type.base)
+            {
+                a = castBase(std::move(a), TY_FLOAT);
+                b = castBase(std::move(b), TY_FLOAT);
+            }
+            const Type A = a->type;
+            const Type B = b->type;
+            Type result;
+            if (op >= OP_LT && op <= OP_GE)
+            {
+                if (!A.isScalar() || !B.isScalar())
+                    fail(at, "relational operators need scalar operands");
+                result = Type(TY_BOOL);
+            }
+            else if (op == OP_MOD)
+            {
+                if (A.base != TY_INT)
+                    fail(at, "'%' needs integer operands, use mod() for floats");
+                if (!A.isScalar() && !B.isScalar() && A != B)
+                    fail(at, "mismatched operands for '%'");
+                result = A.isScalar() ? B : A;
+            }
+            else if (op == OP_MUL && (A.isMatrix() || B.isMatrix()) && !A.isScalar() && !B.isScalar())
+            {
+                // linear algebra product
+                if (A.isMatrix() && B.isMatrix() && A.cols == B.rows)
+                    result = Type(TY_FLOAT, A.rows, B.cols);
+                else if (A.isMatrix() && B.isVector() && A.cols == B.rows)
+                    result = Type(TY_FLOAT, A.rows);
+                else if (A.isVector() && B.isMatrix() && A.rows == B.rows)
+                    result = Type(TY_FLOAT, B.cols);
+                else
+                    fail(at, "mismatched matrix product '" + typeName(A, program) + " * " + typeName(B, program) + "'");
+            }
+            else if (A.isScalar())
+                result = B;
+            else if (B.isScalar())
+                result = A;
+            else if (A == B)
+                result = A;
+            else
+                fail(at, "mismatched operands '" + typeName(A, program) + "' and '" + typeName(B, program) + "'");
+            ExprPtr expr(new Expr(EX_BINARY, result, at));
+            expr->op = op;
+            expr->args.push_back(std::move(a));
+            expr->args.push_back(std::move(b));
+            return expr;
+        }
+
+        ExprPtr makeBuiltin(Builtin builtin, std::vector<ExprPtr>& args, int at)
+        {
+            const BuiltinInfo& info = builtinTable[builtin];
+            if (int(args.size()) < info.minArgs || int(args.size()) > info.maxArgs)
+                fail(at, std::string("wrong number of arguments for ") + info.name + "()");
+            int size = 1;
+            bool allInt = true;
+            for (ExprPtr& arg : args)
+            {
+                if (!arg->type.isNumeric() || arg->type.isMatrix())
+                    fail(at, std::string("bad argument type for ") + info.name + "()");
+                if (arg->type.isVector())
+                {
+                    if (size != 1 && size != arg->type.rows)
+                        fail(at, std::string("mismatched vector sizes in ") + info.name + "()");
+                    size = arg->type.rows;
+                }
+                allInt = allInt && arg->type.base == TY_INT;
+            }
+            BaseType base = info.intAllowed && allInt ? TY_INT : TY_FLOAT;
+            for (ExprPtr& arg : args)
+                arg = broadcast(castBase(std::move(arg), base), size);
+
+            Type result(base, size);
+            if (builtin == BI_LENGTH || builtin == BI_DISTANCE || builtin == BI_DOT)
+                result = Type(TY_FLOAT);
+            else if (builtin == BI_CROSS && size != 3)
+                fail(at, "cross() needs vec3 arguments");
+
+            ExprPtr expr(new Expr(EX_BUILTIN, result, at));
+            expr->builtin = builtin;
+            for (ExprPtr& arg : args)
+                expr->args.push_back(std::move(arg));
+            return expr;
+        }
+
+        ExprPtr makeSwizzle(ExprPtr base, const int* components, int count, int at)
+        {
+            ExprPtr expr(new Expr(EX_SWIZZLE, Type(base->type.base, count), at));
+            for (int i = 0; i < count; ++i)
+                expr->swizzle[i] = components[i];
+            expr->swizzleCount = count;
+            expr->args.push_back(std::move(base));
+            return expr;
+        }
+
+        ExprPtr makeConstructor(const Type& type, std::vector<ExprPtr>& args, int at)
+        {
+            const std::string name = typeName(type, program);
+            if (args.empty())
+                fail(at, "constructor " + name + "() needs arguments");
+            if (type.base == TY_STRUCT)
+            {
+                const StructDecl& decl = program.structs[type.structId];
+                if (args.size() != decl.fieldTypes.size())
+                    fail(at, "wrong number of fields for " + name);
+                ExprPtr expr(new Expr(EX_CONSTRUCT, type, at));
+                for (size_t i = 0; i < args.size(); ++i)
+                    expr->args.push_back(convert(std::move(args[i]), decl.fieldTypes[i]));
+                return expr;
+            }
+            for (ExprPtr& arg : args)
+                if (arg->type.base == TY_STRUCT || arg->type.base == TY_VOID)
+                    fail(at, "bad argument for " + name);
+            if (args.size() == 1)
+            {
+                ExprPtr arg = std::move(args[0]);
+                if (arg->type == type)
+                    return arg;
+                if (type.isScalar())
+                {
+                    // float(vec3) takes the first component
+                    if (!arg->type.isScalar())
+                    {
+                        if (arg->type.isMatrix())
+                            fail(at, "cannot build a scalar from a matrix");
+                        int first = 0;
+                        arg = makeSwizzle(std::move(arg), &first, 1, at);
+                    }
+                    return construct(type, std::move(arg), at);
+                }
+                if (arg->type.isScalar())
+                    return construct(type, castBase(std::move(arg), type.base), at); // broadcast or diagonal
+                if (type.isVector() && arg->type.isVector() && arg->type.rows > type.rows)
+                {
+                    int components[4] = { 0, 1, 2, 3 };
+                    arg = makeSwizzle(std::move(arg), components, type.rows, at);
+                    return castBase(std::move(arg), type.base);
+                }
+                if (type.isMatrix() && arg->type.isMatrix())
+                    fail(at, "matrix resizing constructors are not supported");
+                args[0] = std::move(arg);
+            }
+            int total = 0;
+            for (ExprPtr& arg : args)
+            {
+                if (arg->type.isMatrix())
+                    fail(at, "matrix arguments are only allowed alone in " + name);
+                total += arg->type.rows;
+                arg = castBase(std::move(arg), type.base);
+            }
+            if (total != type.rows * type.cols)
+                fail(at, "wrong number of components for " + name);
+            ExprPtr expr(new Expr(EX_CONSTRUCT, type, at));
+            for (ExprPtr& arg : args)
+                expr->args.push_back(std::move(arg));
+            return expr;
+        }
+
+        ExprPtr makeCall(const std::string& name, std::vector<ExprPtr>& args, int at)
+        {
+            std::pair<std::multimap<std::string, Function*>::iterator, std::multimap<std::string, Function*>::iterator>
+                range = functions.equal_range(name);
+            if (range.first == range.second)
+                fail(at, "unknown function '" + name + "'");
+            Function* exact = nullptr;
+            Function* loose = nullptr;
+            int looseCount = 0;
+            for (std::multimap<std::string, Function*>::iterator it = range.first; it != range.second; ++it)
+            {
+                Function* candidate = it->second;
+                if (candidate->params.size() != args.size())
+                    continue;
+                bool same = true;
+                bool ok = true;
+                for (size_t i = 0; i < args.size(); ++i)
+                {
+                    const Type& param = candidate->params[i]->type;
+                    same = same && param == args[i]->type;
+                    ok = ok && (candidate->params[i]->qualifier == PQ_IN ? convertible(args[i]->type, param) : param == args[i]->type);
+                }
+                if (same)
+                    exact = candidate;
+                else if (ok)
+                {
+                    loose = candidate;
+                    ++looseCount;
+                }
+            }
+            Function* function = exact ? exact : (looseCount == 1 ? loose : nullptr);
+            if (!function)
+                fail(at, "no matching overload for '" + name + "'");
+            ExprPtr expr(new Expr(EX_CALL, function->returnType, at));
+            expr->function = function;
+            for (size_t i = 0; i < args.size(); ++i)
+            {
+                if (function->params[i]->qualifier != PQ_IN && !isLvalue(*args[i]))
+                    fail(at, "out argument of '" + name + "' is not assignable");
+                expr->args.push_back(convert(std::move(args[i]), function->params[i]->type));
+            }
+            called.insert(function);
+            return expr;
+        }
+
+        // ---------------------------- expressions ------------------------------
+        std::vector<ExprPtr> parseArguments()
+        {
+            std::vector<ExprPtr> args;
+            expect("(");
+            if (acceptKeyword("void") || isPunct(")"))
+            {
+                expect(")");
+                return args;
+            }
+            do
+                args.push_back(parseAssignment());
+            while (accept(","));
+            expect(")");
+            return args;
+        }
+
+        ExprPtr parsePrimary()
+        {
+            const Token token = peek();
+            int at = token.line;
+            if (token.kind == TK_INT || token.kind == TK_FLOAT)
+            {
+                ++pos;
+                ExprPtr expr(new Expr(EX_LITERAL, Type(token.kind == TK_INT ? TY_INT : TY_FLOAT), at));
+                expr->number = token.kind == TK_INT ? double(strtol(token.text.c_str(), nullptr, 0)) : strtod(token.text.c_str(), nullptr);
+                return expr;
+            }
+            if (accept("("))
+            {
+                ExprPtr expr = parseExpression();
+                expect(")");
+                return expr;
+            }
+            if (token.kind != TK_IDENT)
+                fail(at, "unexpected '" + token.text + "'");
+            if (token.text == "true" || token.text == "false")
+            {
+                ++pos;
+                ExprPtr expr(new Expr(EX_LITERAL, Type(TY_BOOL), at));
+                expr->number = token.text == "true" ? 1.0 : 0.0;
+                return expr;
+            }
+            if (isPunct("(", 1))
+            {
+                if (isTypeName())
+                {
+                    Type type = parseType();
+                    std::vector<ExprPtr> args = parseArguments();
+                    return makeConstructor(type, args, at);
+                }
+                ++pos;
+                std::vector<ExprPtr> args = parseArguments();
+                for (int b = 0; b < BI_COUNT; ++b)
+                    if (token.text == builtinTable[b].name)
+                        return makeBuiltin(Builtin(b), args, at);
+                if (token.text.compare(0, 7, "texture") == 0)
+                    fail(at, "texture sampling is not supported by the CPU back ends");
+                return makeCall(token.text, args, at);
+            }
+            ++pos;
+            Variable* variable = lookup(token.text);
+            if (!variable)
+            {
+                if (token.text == "gl_FragCoord")
+                    fail(at, "use the interpolated position input instead of gl_FragCoord");
+                fail(at, "undeclared identifier '" + token.text + "'");
+            }
+            ExprPtr expr(new Expr(EX_VARIABLE, variable->type, at));
+            expr->variable = variable;
+            return expr;
+        }
+
+        ExprPtr parsePostfix()
+        {
+            ExprPtr expr = parsePrimary();
+            for (;;)
+            {
+                int at = line();
+                if (accept("."))
+                {
+                    std::string member = expectIdent();
+                    if (expr->type.base == TY_STRUCT)
+                    {
+                        const StructDecl& decl = program.structs[expr->type.structId];
+                        size_t field = 0;
+                        while (field < decl.fieldNames.size() && decl.fieldNames[field] != member)
+                            ++field;
+                        if (field == decl.fieldNames.size())
+                            fail(at, "'" + decl.name + "' has no field '" + member + "'");
+                        ExprPtr access(new Expr(EX_FIELD, decl.fieldTypes[field], at));
+                        access->swizzle[0] = int(field);
+                        access->args.push_back(std::move(expr));
+                        expr = std::move(access);
+                        continue;
+                    }
+                    if (expr->type.isMatrix() || expr->type.base == TY_VOID || member.size() > 4)
+                        fail(at, "bad swizzle '." + member + "'");
+                    static const char* sets[] = { "xyzw", "rgba", "stpq" };
+                    int components[4];
+                    int set = -1;
+                    for (size_t i = 0; i < member.size(); ++i)
+                    {
+                        int found = -1;
+                        for (int s = 0; s < 3 && found < 0; ++s)
+                        {
+                            const char* hit = strchr(sets[s], member[i]);
+                            if (hit && (set < 0 || set == s))
+                            {
+                                found = int(hit - sets[s]);
+                                set = s;
+                            }
+                        }
+                        if (found < 0 || found >= expr->type.rows)
+                            fail(at, "bad swizzle '." + member + "' on " + typeName(expr->type, program));
+                        components[i] = found;
+                    }
+                    expr = makeSwizzle(std::move(expr), components, int(member.size()), at);
+                }
+                else if (accept("["))
+                {
+                    ExprPtr index = parseExpression();
+                    expect("]");
+                    if (index->type != Type(TY_INT))
+                        fail(at, "index must be an int");
+                    if (!expr->type.isVector() && !expr->type.isMatrix())
+                        fail(at, "only vectors and matrices can be indexed");
+                    Type type = expr->type.isMatrix() ? Type(TY_FLOAT, expr->type.rows) : Type(expr->type.base);
+                    ExprPtr access(new Expr(EX_INDEX, type, at));
+                    access->args.push_back(std::move(expr));
+                    access->args.push_back(std::move(index));
+                    expr = std::move(access);
+                }
+                else if (isPunct("++") || isPunct("--"))
+                {
+                    Operator op = isPunct("++") ? OP_INC : OP_DEC;
+                    ++pos;
+                    expr = makeIncDec(op, std::move(expr), false, at);
+                }
+                else
+                    return expr;
+            }
+        }
+
+        ExprPtr makeIncDec(Operator op, ExprPtr target, bool prefix, int at)
+        {
+            if (!target->type.isNumeric() || !isLvalue(*target))
+                fail(at, "'++'/'--' need an assignable numeric operand");
+            ExprPtr expr(new Expr(EX_INCDEC, target->type, at));
+            expr->op = op;
+            expr->prefix = prefix;
+            expr->args.push_back(std::move(target));
+            return expr;
+        }
+
+        ExprPtr parseUnary()
+        {
+            int at = line();
+            if (accept("-") || accept("+"))
+            {
+                bool negate = tokens[pos - 1].text == "-";
+                ExprPtr operand = parseUnary();
+                if (!operand->type.isNumeric())
+                    fail(at, "unary '-' needs a numeric operand");
+                if (!negate)
+                    return operand;
+                if (operand->kind == EX_LITERAL)
+                {
+                    operand->number = -operand->number;
+                    return operand;
+                }
+                ExprPtr expr(new Expr(EX_UNARY, operand->type, at));
+                expr->op = OP_NEG;
+                expr->args.push_back(std::move(operand));
+                return expr;
+            }
+            if (accept("!"))
+            {
+                ExprPtr operand = parseUnary();
+                if (operand->type != Type(TY_BOOL))
+                    fail(at, "'!' needs a bool operand");
+                ExprPtr expr(new Expr(EX_UNARY, Type(TY_BOOL), at));
+                expr->op = OP_NOT;
+                expr->args.push_back(std::move(operand));
+                return expr;
+            }
+            if (isPunct("++") || isPunct("--"))
+            {
+                Operator op = isPunct("++") ? OP_INC : OP_DEC;
+                ++pos;
+                return makeIncDec(op, parseUnary(), true, at);
+            }
+            if (isPunct("~"))
+                fail(at, "bitwise operators are not supported");
+            return parsePostfix();
+        }
+
+        static int binaryPrecedence(const Token& token, Operator& op)
+        {
+            if (token.kind != TK_PUNCT)
+                return -1;
+            const std::string& t = token.text;
+            if (t == "||") { op = OP_OR; return 1; }
+            if (t == "^^") { op = OP_XOR; return 2; }
+            if (t == "&&") { op = OP_AND; return 3; }
+            if (t == "==") { op = OP_EQ; return 4; }
+            if (t == "!=") { op = OP_NE; return 4; }
+            if (t == "<") { op = OP_LT; return 5; }
+            if (t == "<=") { op = OP_LE; return 5; }
+            if (t == ">") { op = OP_GT; return 5; }
+            if (t == ">=") { op = OP_GE; return 5; }
+            if (t == "+") { op = OP_ADD; return 6; }
+            if (t == "-") { op = OP_SUB; return 6; }
+            if (t == "*") { op = OP_MUL; return 7; }
+            if (t == "/") { op = OP_DIV; return 7; }
+            if (t == "%") { op = OP_MOD; return 7; }
+            return -1;
+        }
+
+        ExprPtr parseBinary(int minPrec)
+        {
+            ExprPtr lhs = parseUnary();
+            for (;;)
+            {
+                Operator op = OP_ADD;
+                int prec = binaryPrecedence(peek(), op);
+                if (prec < minPrec)
+                {
+                    if (isPunct("&") || isPunct("|") || isPunct("^") || isPunct("<<") || isPunct(">>"))
+                        fail(line(), "bitwise operators are not supported");
+                    return lhs;
+                }
+                int at = line();
+                ++pos;
+                ExprPtr rhs = parseBinary(prec + 1);
+                lhs = makeBinary(op, std::move(lhs), std::move(rhs), at);
+            }
+        }
+
+        ExprPtr parseTernary()
+        {
+            ExprPtr cond = parseBinary(1);
+            int at = line();
+            if (!accept("?"))
+                return cond;
+            if (cond->type != Type(TY_BOOL))
+                fail(at, "'?:' needs a bool condition");
+            ExprPtr a = parseAssignment();
+            expect(":");
+            ExprPtr b = parseAssignment();
+            if (a->type != b->type && a->type.isNumeric() && b->type.isNumeric())
+            {
+                a = castBase(std::move(a), TY_FLOAT);
+                b = castBase(std::move(b), TY_FLOAT);
+            }
+            if (a->type != b->type)
+                fail(at, "'?:' branches have different types");
+            ExprPtr expr(new Expr(EX_TERNARY, a->type, at));
+            expr->args.push_back(std::move(cond));
+            expr->args.push_back(std::move(a));
+            expr->args.push_back(std::move(b));
+            return expr;
+        }
+
+        ExprPtr parseAssignment()
+        {
+            ExprPtr lhs = parseTernary();
+            static const struct { const char* text; Operator op; } assigns[] = {
+                { "=", OP_ASSIGN }, { "+=", OP_ADD }, { "-=", OP_SUB }, { "*=", OP_MUL }, { "/=", OP_DIV }, { "%=", OP_MOD }
+            };
+            for (const auto& assign : assigns)
+            {
+                if (!isPunct(assign.text))
+                    continue;
+                int at = line();
+                ++pos;
+                if (!isLvalue(*lhs))
+                    fail(at, "left side of assignment is not assignable");
+                ExprPtr rhs = parseAssignment();
+                if (assign.op == OP_ASSIGN)
+                    rhs = convert(std::move(rhs), lhs->type);
+                else
+                {
+                    // type check 'a op b' and make sure it fits back into 'a'
+                    Type target = lhs->type;
+                    ExprPtr probeLhs(new Expr(EX_LITERAL, target, at));
+                    ExprPtr probe = makeBinary(assign.op, std::move(probeLhs), std::move(rhs), at);
+                    if (probe->type != target)
+                        fail(at, "compound assignment changes the type of its target");
+                    rhs = std::move(probe->args[1]);
+                }
+                ExprPtr expr(new Expr(EX_ASSIGN, lhs->type, at));
+                expr->op = assign.op;
+                expr->args.push_back(std::move(lhs));
+                expr->args.push_back(std::move(rhs));
+                return expr;
+            }
+            if (isPunct("&=") || isPunct("|=") || isPunct("^=") || isPunct("<<=") || isPunct(">>="))
+                fail(line(), "bitwise operators are not supported");
+            return lhs;
+        }
+
+        ExprPtr parseExpression()
+        {
+            ExprPtr expr = parseAssignment();
+            if (isPunct(","))
+                fail(line(), "the comma operator is not supported");
+            return expr;
+        }
+
+        ExprPtr parseCondition()
+        {
+            ExprPtr cond = parseExpression();
+            if (cond->type != Type(TY_BOOL))
+                fail(cond->line, "condition must be a bool");
+            return cond;
+        }
+
+        // ---------------------------- statements -------------------------------
+        StmtPtr parseDeclaration(Storage storage)
+        {
+            StmtPtr stmt(new Stmt(SK_DECL, line()));
+            bool isConst = acceptKeyword("const");
+            skipPrecision();
+            Type type = parseType();
+            if (type.base == TY_VOID)
+                fail(stmt->line, "variables cannot be void");
+            do
+            {
+                int at = line();
+                std::string name = expectIdent();
+                if (isPunct("["))
+                    fail(at, "arrays are not supported");
+                ExprPtr init;
+                if (accept("="))
+                    init = convert(parseAssignment(), type);
+                else if (isConst)
+                    fail(at, "const variable '" + name + "' needs an initializer");
+                // the name comes into scope after its initializer
+                Variable* variable = newVariable(name, type, storage, isConst);
+                declare(variable, at);
+                stmt->vars.push_back(variable);
+                stmt->inits.push_back(std::move(init));
+            } while (accept(","));
+            expect(";");
+            return stmt;
+        }
+
+        bool atDeclaration() const
+        {
+            if (isKeyword("const"))
+                return true;
+            return isTypeName() && peek(1).kind == TK_IDENT;
+        }
+
+        // a statement that introduces its own scope when it is not a block
+        StmtPtr parseScopedStatement()
+        {
+            scopes.emplace_back();
+            StmtPtr stmt = parseStatement();
+            scopes.pop_back();
+            return stmt;
+        }
+
+        StmtPtr parseBlock(bool newScope)
+        {
+            StmtPtr block(new Stmt(SK_BLOCK, line()));
+            expect("{");
+            if (newScope)
+                scopes.emplace_back();
+            while (!accept("}"))
+            {
+                if (peek().kind == TK_END)
+                    fail(line(), "missing '}'");
+                block->body.push_back(parseStatement());
+            }
+            if (newScope)
+                scopes.pop_back();
+            return block;
+        }
+
+        StmtPtr parseStatement()
+        {
+            int at = line();
+            if (isPunct("{"))
+                return parseBlock(true);
+            if (accept(";"))
+                return StmtPtr(new Stmt(SK_EMPTY, at));
+            if (acceptKeyword("if"))
+            {
+                StmtPtr stmt(new Stmt(SK_IF, at));
+                expect("(");
+                stmt->expr = parseCondition();
+                expect(")");
+                stmt->then = parseScopedStatement();
+                if (acceptKeyword("else"))
+                    stmt->otherwise = parseScopedStatement();
+                return stmt;
+            }
+            if (acceptKeyword("for"))
+            {
+                StmtPtr stmt(new Stmt(SK_FOR, at));
+                scopes.emplace_back();
+                expect("(");
+                if (atDeclaration())
+                    stmt->init = parseDeclaration(VS_LOCAL);
+                else if (!accept(";"))
+                {
+                    stmt->init.reset(new Stmt(SK_EXPR, line()));
+                    stmt->init->expr = parseExpression();
+                    expect(";");
+                }
+                if (!isPunct(";"))
+                    stmt->expr = parseCondition();
+                expect(";");
+                if (!isPunct(")"))
+                    stmt->step = parseExpression();
+                expect(")");
+                ++loopDepth;
+                stmt->then = parseScopedStatement();
+                --loopDepth;
+                scopes.pop_back();
+                return stmt;
+            }
+            if (acceptKeyword("while"))
+            {
+                StmtPtr stmt(new Stmt(SK_WHILE, at));
+                expect("(");
+                stmt->expr = parseCondition();
+                expect(")");
+                ++loopDepth;
+                stmt->then = parseScopedStatement();
+                --loopDepth;
+                return stmt;
+            }
+            if (acceptKeyword("do"))
+            {
+                StmtPtr stmt(new Stmt(SK_DO, at));
+                ++loopDepth;
+                stmt->then = parseScopedStatement();
+                --loopDepth;
+                if (!acceptKeyword("while"))
+                    fail(line(), "expected 'while' after do body");
+                expect("(");
+                stmt->expr = parseCondition();
+                expect(")");
+                expect(";");
+                return stmt;
+            }
+            if (acceptKeyword("break") || acceptKeyword("continue"))
+            {
+                bool isBreak = tokens[pos - 1].text == "break";
+                if (loopDepth == 0)
+                    fail(at, std::string(isBreak ? "'break'" : "'continue'") + " outside of a loop");
+                expect(";");
+                return StmtPtr(new Stmt(isBreak ? SK_BREAK : SK_CONTINUE, at));
+            }
+            if (acceptKeyword("return"))
+            {
+                StmtPtr stmt(new Stmt(SK_RETURN, at));
+                if (!isPunct(";"))
+                {
+                    if (current->returnType.base == TY_VOID)
+                        fail(at, "void function returns a value");
+                    stmt->expr = convert(parseExpression(), current->returnType);
+                }
+                else if (current->returnType.base != TY_VOID)
+                    fail(at, "missing return value");
+                expect(";");
+                return stmt;
+            }
+            if (isKeyword("discard"))
+                fail(at, "'discard' is not supported by the CPU back ends");
+            if (atDeclaration())
+                return parseDeclaration(VS_LOCAL);
+            StmtPtr stmt(new Stmt(SK_EXPR, at));
+            stmt->expr = parseExpression();
+            expect(";");
+            return stmt;
+        }
+
+        // ----------------------------- top level -------------------------------
+        void parseStruct()
+        {
+            int at = line();
+            std::string name = expectIdent();
+            if (structIds.count(name))
+                fail(at, "redefinition of struct '" + name + "'");
+            StructDecl decl;
+            decl.name = name;
+            expect("{");
+            while (!accept("}"))
+            {
+                skipPrecision();
+                Type type = parseType();
+                do
+                {
+                    decl.fieldNames.push_back(expectIdent());
+                    decl.fieldTypes.push_back(type);
+                } while (accept(","));
+                expect(";");
+            }
+            expect(";");
+            structIds[name] = int(program.structs.size());
+            program.structs.push_back(decl);
+        }
+
+        void parseFunction(const Type& returnType, const std::string& name, int at)
+        {
+            std::unique_ptr<Function> function(new Function());
+            function->name = name;
+            function->returnType = returnType;
+            scopes.emplace_back();
+            expect("(");
+            if (!(isKeyword("void") && isPunct(")", 1)) && !isPunct(")"))
+            {
+                do
+                {
+                    acceptKeyword("const");
+                    ParamQualifier qualifier = PQ_IN;
+                    if (acceptKeyword("out"))
+                        qualifier = PQ_OUT;
+                    else if (acceptKeyword("inout"))
+                        qualifier = PQ_INOUT;
+                    else
+                        acceptKeyword("in");
+                    skipPrecision();
+                    Type type = parseType();
+                    std::string paramName = peek().kind == TK_IDENT ? expectIdent() : "";
+                    if (isPunct("["))
+                        fail(line(), "array parameters are not supported");
+                    Variable* param = newVariable(paramName, type, VS_PARAM, false);
+                    param->qualifier = qualifier;
+                    if (!paramName.empty())
+                        declare(param, at);
+                    function->params.push_back(param);
+                } while (accept(","));
+            }
+            else
+                acceptKeyword("void");
+            expect(")");
+
+            // a definition completes an earlier prototype with the same signature
+            Function* target = nullptr;
+            std::pair<std::multimap<std::string, Function*>::iterator, std::multimap<std::string, Function*>::iterator>
+                range = functions.equal_range(name);
+            for (std::multimap<std::string, Function*>::iterator it = range.first; it != range.second; ++it)
+            {
+                Function* other = it->second;
+                bool same = other->params.size() == function->params.size();
+                for (size_t i = 0; same && i < other->params.size(); ++i)
+                    same = other->params[i]->type == function->params[i]->type;
+                if (same)
+                    target = other;
+            }
+            if (target && target->returnType != returnType)
+                fail(at, "'" + name + "' redeclared with a different return type");
+            if (!target)
+            {
+                target = function.get();
+                functions.insert(std::make_pair(name, target));
+                program.functions.push_back(std::move(function));
+            }
+            else
+                target->params = function->params;
+
+            if (accept(";"))
+            {
+                scopes.pop_back();
+                return;
+            }
+            if (target->body)
+                fail(at, "redefinition of function '" + name + "'");
+            current = target;
+            target->body = parseBlock(false);
+            current = nullptr;
+            scopes.pop_back();
+            if (name == "main")
+            {
+                if (!target->params.empty() || returnType.base != TY_VOID)
+                    fail(at, "main() must be 'void main()'");
+                program.entry = target;
+            }
+        }
+
+        void parseGlobal()
+        {
+            int at = line();
+            if (acceptKeyword("precision"))
+            {
+                while (!accept(";"))
+                    ++pos;
+                return;
+            }
+            if (acceptKeyword("layout"))
+            {
+                expect("(");
+                while (!accept(")"))
+                    ++pos;
+            }
+            if (acceptKeyword("struct"))
+            {
+                parseStruct();
+                return;
+            }
+            Storage storage = VS_GLOBAL;
+            bool isConst = false;
+            for (;;)
+            {
+                if (acceptKeyword("uniform"))
+                    storage = VS_UNIFORM;
+                else if (acceptKeyword("in") || acceptKeyword("varying"))
+                    storage = VS_INPUT;
+                else if (acceptKeyword("out"))
+                    storage = VS_OUTPUT;
+                else if (acceptKeyword("const"))
+                    isConst = true;
+                else if (!(acceptKeyword("flat") || acceptKeyword("smooth") || acceptKeyword("noperspective")
+                           || acceptKeyword("highp") || acceptKeyword("mediump") || acceptKeyword("lowp")))
+                    break;
+            }
+            Type type = parseType();
+            std::string name = expectIdent();
+            if (isPunct("(") && storage == VS_GLOBAL && !isConst)
+            {
+                parseFunction(type, name, at);
+                return;
+            }
+            for (;;)
+            {
+                if (isPunct("["))
+                    fail(line(), "arrays are not supported");
+                ExprPtr init;
+                if (accept("="))
+                {
+                    if (storage != VS_GLOBAL)
+                        fail(at, "only plain globals can be initialized");
+                    init = convert(parseAssignment(), type);
+                }
+                else if (isConst)
+                    fail(at, "const variable '" + name + "' needs an initializer");
+                Variable* variable = newVariable(name, type, storage, isConst);
+                declare(variable, at);
+                switch (storage)
+                {
+                case VS_UNIFORM: program.uniforms.push_back(variable); break;
+                case VS_INPUT: program.inputs.push_back(variable); break;
+                case VS_OUTPUT: program.outputs.push_back(variable); break;
+                default:
+                    program.globals.push_back(variable);
+                    program.globalInits.push_back(std::move(init));
+                    break;
+                }
+                if (!accept(","))
+                    break;
+                name = expectIdent();
+            }
+            expect(";");
+        }
+
+    public:
+        Parser(std::vector<Token>&& tokens, Program& program)
+            : tokens(std::move(tokens)), pos(0), program(program), current(nullptr), loopDepth(0)
+        {
+        }
+
+        void parseProgram()
+        {
+            scopes.emplace_back();
+            while (peek().kind != TK_END)
+            {
+                if (accept(";"))
+                    continue;
+                parseGlobal();
+            }
+            if (!program.entry)
+                fail(line(), "no main() function");
+            for (Function* function : called)
+                if (!function->body)
+                    fail(line(), "function '" + function->name + "' is called but never defined");
+        }
+    };
+
+    // variables read by an expression and by every function it calls
+    void collectReads(const Stmt* stmt, std::set<const Variable*>& read, std::set<const Function*>& visited);
+
+    void collectReads(const Expr* expr, std::set<const Variable*>& read, std::set<const Function*>& visited)
+    {
+        if (!expr)
+            return;
+        if (expr->kind == EX_VARIABLE)
+            read.insert(expr->variable);
+        if (expr->kind == EX_CALL && visited.insert(expr->function).second)
+            collectReads(expr->function->body.get(), read, visited);
+        for (const ExprPtr& arg : expr->args)
+            collectReads(arg.get(), read, visited);
+    }
+
+    void collectReads(const Stmt* stmt, std::set<const Variable*>& read, std::set<const Function*>& visited)
+    {
+        if (!stmt)
+            return;
+        for (const ExprPtr& init : stmt->inits)
+            collectReads(init.get(), read, visited);
+        collectReads(stmt->expr.get(), read, visited);
+        collectReads(stmt->step.get(), read, visited);
+        collectReads(stmt->init.get(), read, visited);
+        collectReads(stmt->then.get(), read, visited);
+        collectReads(stmt->otherwise.get(), read, visited);
+        for (const StmtPtr& child : stmt->body)
+            collectReads(child.get(), read, visited);
+    }
+}
+
+    bool parse(const std::string& source, Program& program, const std::map<std::string, std::string>& defines)
+    {
+        try
+        {
+            Preprocessor preprocessor;
+            for (const std::pair<const std::string, std::string>& define : defines)
+                preprocessor.define(define.first, define.second);
+            Parser parser(preprocessor.run(source), program);
+            parser.parseProgram();
+            return true;
+        }
+        catch (const CompileError& error)
+        {
+            program.error = error.message;
+            return false;
+        }
+    }
+
+    std::string typeName(const Type& type, const Program& program)
+    {
+        switch (type.base)
+        {
+        case TY_VOID:
+            return "void";
+        case TY_STRUCT:
+            return program.structs[type.structId].name;
+        default:
+            break;
+        }
+        if (type.isMatrix())
+            return "mat" + std::to_string(type.cols);
+        const char* scalar = type.base == TY_FLOAT ? "float" : (type.base == TY_INT ? "int" : "bool");
+        if (type.rows == 1)
+            return scalar;
+        const char* prefix = type.base == TY_FLOAT ? "" : (type.base == TY_INT ? "i" : "b");
+        return std::string(prefix) + "vec" + std::to_string(type.rows);
+    }
+
+    const char* builtinName(Builtin builtin)
+    {
+        return builtin < BI_COUNT ? builtinTable[builtin].name : "?";
+    }
+
+    int componentCount(const Type& type, const Program& program)
+    {
+        if (type.base == TY_VOID)
+            return 0;
+        if (type.base != TY_STRUCT)
+            return type.rows * type.cols;
+        int total = 0;
+        for (const Type& field : program.structs[type.structId].fieldTypes)
+            total += componentCount(field, program);
+        return total;
+    }
+
+    std::vector<UniformSlot> uniformLayout(const Program& program, int& floatCount)
+    {
+        std::vector<UniformSlot> slots;
+        floatCount = 0;
+        for (const Variable* uniform : program.uniforms)
+        {
+            slots.push_back(UniformSlot{ uniform->name, uniform->type, floatCount });
+            floatCount += componentCount(uniform->type, program);
+        }
+        return slots;
+    }
+
+    std::set<std::string> activeUniforms(const Program& program)
+    {
+        std::set<const Variable*> read;
+        std::set<const Function*> visited;
+        for (const ExprPtr& init : program.globalInits)
+            collectReads(init.get(), read, visited);
+        if (program.entry)
+        {
+            visited.insert(program.entry);
+            collectReads(program.entry->body.get(), read, visited);
+        }
+        std::set<std::string> names;
+        for (const Variable* uniform : program.uniforms)
+            if (read.count(uniform))
+                names.insert(uniform->name);
+        return names;
+    }
+}
@@ -0,0 +1,691 @@
+#include "myImplement/glsl_transpiler.h"
+
+#include <cstdio>
+#include <sstream>
+
+namespace glsl
+{
+namespace
+{
+    struct TranspileError
+    {
+        std::string message;
+    };
+
+    // where a statement list may bail out once no lane is left executing
+    enum ExitKind
+    {
+        EXIT_NONE,
+        EXIT_FUNCTION,
+        EXIT_LOOP
+    };
+
+    bool hasReturn(const Stmt* stmt)
+    {
+        if (!stmt)
+            return false;
+        if (stmt->kind == SK_RETURN)
+            return true;
+        for (const StmtPtr& child : stmt->body)
+            if (hasReturn(child.get()))
+                return true;
+        return hasReturn(stmt->then.get()) || hasReturn(stmt->otherwise.get());
+    }
+
+    // break / continue of the innermost loop, nested loops own theirs
+    bool hasLoopJump(const Stmt* stmt, StmtKind kind)
+    {
+        if (!stmt || stmt->kind == SK_FOR || stmt->kind == SK_WHILE || stmt->kind == SK_DO)
+            return false;
+        if (stmt->kind == kind)
+            return true;
+        for (const StmtPtr& child : stmt->body)
+            if (hasLoopJump(child.get(), kind))
+                return true;
+        return hasLoopJump(stmt->then.get(), kind) || hasLoopJump(stmt->otherwise.get(), kind);
+    }
+
+    bool hasLoopJump(const Stmt* stmt)
+    {
+        return hasLoopJump(stmt, SK_BREAK) || hasLoopJump(stmt, SK_CONTINUE);
+    }
+
+    /**
+     * @brief every GLSL value becomes LANES values, one per pixel, and
+     * control flow becomes masking: 'exec' holds the lanes that are
+     * executing, stores only touch those, and break / continue / return
+     * move lanes into kill masks instead of jumping. branches and loops
+     * are skipped as soon as no lane wants them.
+     */
+    class Transpiler
+    {
+    private:
+        struct LoopMasks
+        {
+            std::string brk;
+            std::string cnt; // empty when the body never continues
+        };
+
+        const Program& program;
+        std::ostringstream out;
+        int depth;
+        int counter;                 // unique mask names within a function
+        bool hasDone;                // the current function has a 'done' mask
+        bool isVoid;
+        std::vector<LoopMasks> loops;
+
+        [[noreturn]] void fail(int line, const std::string& message)
+        {
+            throw TranspileError{ "line " + std::to_string(line) + ": " + message };
+        }
+
+        std::string indent() const { return std::string(size_t(depth) * 4, ' '); }
+
+        std::string cppType(const Type& type) const
+        {
+            switch (type.base)
+            {
+            case TY_VOID:
+                return "void";
+            case TY_STRUCT:
+                return "S_" + program.structs[type.structId].name;
+            default:
+                break;
+            }
+            if (type.isMatrix())
+            {
+                if (type.rows == type.cols)
+                    return "mat" + std::to_string(type.cols);
+                return "tmat<" + std::to_string(type.cols) + ", " + std::to_string(type.rows) + ">";
+            }
+            if (type.rows == 1)
+                return type.base == TY_FLOAT ? "vfloat" : (type.base == TY_INT ? "vint" : "vbool");
+            const char* prefix = type.base == TY_FLOAT ? "" : (type.base == TY_INT ? "i" : "b");
+            return prefix + std::string("vec") + std::to_string(type.rows);
+        }
+
+        std::string name(const Variable* variable) const
+        {
+            return "v" + std::to_string(variable->id) + "_" + variable->name;
+        }
+
+        std::string literal(const Expr& expr) const
+        {
+            char text[64];
+            switch (expr.type.base)
+            {
+            case TY_BOOL:
+                return expr.number != 0.0 ? "vbool(true)" : "vbool(false)";
+            case TY_INT:
+                snprintf(text, sizeof(text), "vint(%ld)", long(expr.number));
+                return text;
+            default:
+                break;
+            }
+            // GLSL literals are single precision, 9 digits round trip a float
+            snprintf(text, sizeof(text), "%.9g", double(float(expr.number)));
+            std::string number = text;
+            if (number.find_first_of(".e") == std::string::npos)
+                number += ".0";
+            return "vfloat(" + number + "f)";
+        }
+
+        std::string one(const Type& type, bool negative) const
+        {
+            if (type.base == TY_FLOAT)
+                return negative ? "vfloat(-1.0f)" : "vfloat(1.0f)";
+            return negative ? "vint(-1)" : "vint(1)";
+        }
+
+        // fold v.zyx.xy into v.zy, so only one swizzle ever touches a value
+        const Expr& swizzleBase(const Expr& expr, int* components, int& count) const
+        {
+            const Expr* base = &expr;
+            count = expr.swizzleCount;
+            for (int i = 0; i < count; ++i)
+                components[i] = expr.swizzle[i];
+            while (base->args[0]->kind == EX_SWIZZLE)
+            {
+                base = base->args[0].get();
+                for (int i = 0; i < count; ++i)
+                    components[i] = base->swizzle[components[i]];
+            }
+            return *base->args[0];
+        }
+
+        std::string swizzleArgs(const int* components, int count) const
+        {
+            std::string text;
+            for (int i = 0; i < count; ++i)
+                text += (i ? ", " : "") + std::to_string(components[i]);
+            return text;
+        }
+
+        bool constantIndex(const Expr& expr) const
+        {
+            return expr.kind == EX_INDEX && expr.args[1]->kind == EX_LITERAL;
+        }
+
+        // targets that are a C++ lvalue as they stand: a, a.field, a[2]
+        bool plainLvalue(const Expr& expr) const
+        {
+            if (expr.kind == EX_VARIABLE)
+                return true;
+            if (expr.kind == EX_FIELD || constantIndex(expr))
+                return plainLvalue(*expr.args[0]);
+            return false;
+        }
+
+        std::string lvalue(const Expr& expr)
+        {
+            if (!plainLvalue(expr))
+                fail(expr.line, "unsupported assignment target");
+            return expression(expr);
+        }
+
+        // assign 'value' to the executing lanes of an lvalue
+        std::string store(const Expr& target, const std::string& value)
+        {
+            if (target.kind == EX_SWIZZLE)
+            {
+                int components[4];
+                int count;
+                const Expr& base = swizzleBase(target, components, count);
+                if (base.type.isScalar())
+                    return store(base, value);
+                return "glsl_rt::swzSet<" + swizzleArgs(components, count) + ">(" + lvalue(base) + ", " + value + ", exec)";
+            }
+            if (target.kind == EX_INDEX && !constantIndex(target))
+                return "glsl_rt::atSet(" + lvalue(*target.args[0]) + ", " + expression(*target.args[1]) + ", " + value + ", exec)";
+            return "glsl_rt::assign(" + lvalue(target) + ", " + value + ", exec)";
+        }
+
+        static const char* operatorText(Operator op)
+        {
+            switch (op)
+            {
+            case OP_ADD: return "+";
+            case OP_SUB: return "-";
+            case OP_MUL: return "*";
+            case OP_DIV: return "/";
+            case OP_MOD: return "%";
+            case OP_LT: return "<";
+            case OP_LE: return "<=";
+            case OP_GT: return ">";
+            case OP_GE: return ">=";
+            case OP_AND: return "&";
+            case OP_OR: return "|";
+            case OP_XOR: return "^";
+            default: return "?";
+            }
+        }
+
+        std::string arguments(const Expr& expr)
+        {
+            std::string text;
+            for (size_t i = 0; i < expr.args.size(); ++i)
+                text += (i ? ", " : "") + expression(*expr.args[i]);
+            return text;
+        }
+
+        std::string expression(const Expr& expr)
+        {
+            switch (expr.kind)
+            {
+            case EX_LITERAL:
+                return literal(expr);
+            case EX_VARIABLE:
+                return name(expr.variable);
+            case EX_UNARY:
+                return std::string("(") + (expr.op == OP_NOT ? "!" : "-") + expression(*expr.args[0]) + ")";
+            case EX_BINARY:
+                // both sides of && and || run, masking makes that harmless
+                if (expr.op == OP_EQ || expr.op == OP_NE)
+                    return std::string(expr.op == OP_EQ ? "glsl_rt::eq(" : "glsl_rt::ne(") + arguments(expr) + ")";
+                return "(" + expression(*expr.args[0]) + " " + operatorText(expr.op) + " " + expression(*expr.args[1]) + ")";
+            case EX_ASSIGN:
+                if (expr.op == OP_ASSIGN)
+                    return store(*expr.args[0], expression(*expr.args[1]));
+                // a op= b is a = a op b, GLSL's v *= m included
+                return store(*expr.args[0], "(" + expression(*expr.args[0]) + " " + operatorText(expr.op) + " " + expression(*expr.args[1]) + ")");
+            case EX_INCDEC:
+            {
+                const Expr& target = *expr.args[0];
+                std::string step = one(target.type, expr.op == OP_DEC);
+                if (plainLvalue(target))
+                    return std::string(expr.prefix ? "glsl_rt::preAdd(" : "glsl_rt::postAdd(") + expression(target) + ", " + step + ", exec)";
+                // the value of a postfix ++ on a swizzle is the new one, nobody relies on it
+                return store(target, "(" + expression(target) + " + " + step + ")");
+            }
+            case EX_CALL:
+            {
+                std::string text = "f_" + expr.function->name + "(exec";
+                for (size_t i = 0; i < expr.args.size(); ++i)
+                {
+                    if (expr.function->params[i]->qualifier != PQ_IN && !plainLvalue(*expr.args[i]))
+                        fail(expr.line, "out arguments must be variables or fields");
+                    text += ", " + expression(*expr.args[i]);
+                }
+                return text + ")";
+            }
+            case EX_BUILTIN:
+                return std::string("glsl_rt::") + builtinName(expr.builtin) + "(" + arguments(expr) + ")";
+            case EX_CONSTRUCT:
+            {
+                const std::string type = cppType(expr.type);
+                if (expr.type.base == TY_STRUCT)
+                    return type + "{ " + arguments(expr) + " }";
+                if (expr.args.size() == 1)
+                {
+                    const Type& from = expr.args[0]->type;
+                    if (from.isScalar() && expr.type.isVector())
+                        return "glsl_rt::splat<" + type + ">(" + arguments(expr) + ")";
+                    if (from.isScalar() && expr.type.isMatrix())
+                        return "glsl_rt::diagonal<" + type + ">(" + arguments(expr) + ")";
+                    if (from.rows == expr.type.rows && from.cols == expr.type.cols)
+                        return "glsl_rt::convert<" + type + ">(" + arguments(expr) + ")";
+                }
+                return "glsl_rt::make<" + type + ">(" + arguments(expr) + ")";
+            }
+            case EX_SWIZZLE:
+            {
+                int components[4];
+                int count;
+                const Expr& base = swizzleBase(expr, components, count);
+                if (base.type.isScalar())
+                    return count == 1 ? expression(base) : "glsl_rt::splat<" + cppType(expr.type) + ">(" + expression(base) + ")";
+                return "glsl_rt::swz<" + swizzleArgs(components, count) + ">(" + expression(base) + ")";
+            }
+            case EX_FIELD:
+            {
+                const StructDecl& decl = program.structs[expr.args[0]->type.structId];
+                return expression(*expr.args[0]) + ".m_" + decl.fieldNames[expr.swizzle[0]];
+            }
+            case EX_INDEX:
+                if (constantIndex(expr))
+                {
+                    long index = long(expr.args[1]->number);
+                    int size = expr.args[0]->type.isMatrix() ? expr.args[0]->type.cols : expr.args[0]->type.rows;
+                    if (index < 0 || index >= size)
+                        fail(expr.line, "index out of range");
+                    return expression(*expr.args[0]) + ".c[" + std::to_string(index) + "]";
+                }
+                return "glsl_rt::at(" + arguments(expr) + ")";
+            case EX_TERNARY:
+                return "select(" + arguments(expr) + ")";
+            }
+            fail(expr.line, "unknown expression");
+        }
+
+        // ----------------------------- statements ------------------------------
+        std::string fresh(const char* prefix)
+        {
+            return prefix + std::to_string(++counter);
+        }
+
+        // lanes that left the current block through a jump
+        std::string jumped() const
+        {
+            std::string mask = hasDone ? "done" : "";
+            if (!loops.empty())
+            {
+                mask += (mask.empty() ? "" : " | ") + loops.back().brk;
+                if (!loops.back().cnt.empty())
+                    mask += " | " + loops.back().cnt;
+            }
+            return mask;
+        }
+
+        std::string notDone() const
+        {
+            return hasDone ? " & ~done" : "";
+        }
+
+        void line(const std::string& text)
+        {
+            out << indent() << text << "\n";
+        }
+
+        void declaration(const Stmt& stmt)
+        {
+            for (size_t i = 0; i < stmt.vars.size(); ++i)
+            {
+                const Variable* variable = stmt.vars[i];
+                // uninitialized GLSL locals are undefined, zero is as good as any
+                if (stmt.inits[i])
+                    line(cppType(variable->type) + " " + name(variable) + " = " + expression(*stmt.inits[i]) + ";");
+                else
+                    line(cppType(variable->type) + " " + name(variable) + "{};");
+            }
+        }
+
+        void statementList(const std::vector<StmtPtr>& list, ExitKind exit)
+        {
+            for (size_t i = 0; i < list.size(); ++i)
+            {
+                const Stmt* stmt = list[i].get();
+                statement(*stmt);
+                if (i + 1 == list.size() || exit == EXIT_NONE)
+                    continue;
+                // the rest of the list has nothing left to run
+                if (exit == EXIT_FUNCTION && hasReturn(stmt))
+                    line(isVoid ? "if (glsl_rt::none(exec)) return;" : "if (glsl_rt::none(exec)) return ret;");
+                else if (exit == EXIT_LOOP && (hasLoopJump(stmt) || hasReturn(stmt)))
+                    line("if (glsl_rt::none(exec)) break;");
+            }
+        }
+
+        // the body of an if, always braced
+        void nested(const Stmt& stmt)
+        {
+            line("{");
+            ++depth;
+            if (stmt.kind == SK_BLOCK)
+                statementList(stmt.body, EXIT_NONE);
+            else
+                statement(stmt);
+            --depth;
+            line("}");
+        }
+
+        // loop bodies sit in do { } while (false) so a 'break' skips what is left
+        void loopBody(const Stmt& stmt)
+        {
+            line("do");
+            line("{");
+            ++depth;
+            if (stmt.kind == SK_BLOCK)
+                statementList(stmt.body, EXIT_LOOP);
+            else
+                statement(stmt);
+            --depth;
+            line("} while (false);");
+        }
+
+        void loop(const Stmt& stmt)
+        {
+            const std::string saved = fresh("m");
+            const std::string cond = fresh("c");
+            LoopMasks masks;
+            masks.brk = fresh("brk");
+            if (hasLoopJump(stmt.then.get(), SK_CONTINUE))
+                masks.cnt = fresh("cnt");
+            const std::string active = "exec = " + saved + " & ~" + masks.brk + notDone() + ";";
+
+            line("{");
+            ++depth;
+            if (stmt.init)
+                statement(*stmt.init);
+            line("const vbool " + saved + " = exec;");
+            line("vbool " + masks.brk + "(false);");
+            line("for (;;)");
+            line("{");
+            ++depth;
+            line(active);
+            if (stmt.kind != SK_DO && stmt.expr)
+            {
+                line("const vbool " + cond + " = " + expression(*stmt.expr) + ";");
+                line(masks.brk + " = " + masks.brk + " | (exec & ~" + cond + ");");
+                line("exec = exec & " + cond + ";");
+            }
+            line("if (glsl_rt::none(exec))");
+            line("    break;");
+            if (!masks.cnt.empty())
+                line("vbool " + masks.cnt + "(false);");
+            loops.push_back(masks);
+            loopBody(*stmt.then);
+            loops.pop_back();
+            // lanes that finished the body or continued go on to the step
+            line(active);
+            if (stmt.step)
+                line(expression(*stmt.step) + ";");
+            if (stmt.kind == SK_DO)
+            {
+                line("const vbool " + cond + " = " + expression(*stmt.expr) + ";");
+                line(masks.brk + " = " + masks.brk + " | (exec & ~" + cond + ");");
+            }
+            --depth;
+            line("}");
+            line("exec = " + saved + notDone() + ";");
+            --depth;
+            line("}");
+        }
+
+        void statement(const Stmt& stmt)
+        {
+            switch (stmt.kind)
+            {
+            case SK_BLOCK:
+                line("{");
+                ++depth;
+                statementList(stmt.body, EXIT_NONE);
+                --depth;
+                line("}");
+                break;
+            case SK_DECL:
+                declaration(stmt);
+                break;
+            case SK_EXPR:
+                line(expression(*stmt.expr) + ";");
+                break;
+            case SK_IF:
+            {
+                const std::string saved = fresh("m");
+                const std::string cond = fresh("c");
+                bool jumps = hasReturn(&stmt) || hasLoopJump(&stmt);
+                line("{");
+                ++depth;
+                line("const vbool " + saved + " = exec;");
+                line("const vbool " + cond + " = " + expression(*stmt.expr) + ";");
+                line("exec = " + saved + " & " + cond + ";");
+                line("if (glsl_rt::any(exec))");
+                nested(*stmt.then);
+                if (stmt.otherwise)
+                {
+                    line("exec = " + saved + " & ~" + cond + ";");
+                    line("if (glsl_rt::any(exec))");
+                    nested(*stmt.otherwise);
+                }
+                line("exec = " + saved + (jumps ? " & ~(" + jumped() + ")" : "") + ";");
+                --depth;
+                line("}");
+                break;
+            }
+            case SK_FOR:
+            case SK_WHILE:
+            case SK_DO:
+                loop(stmt);
+                break;
+            case SK_BREAK:
+                line(loops.back().brk + " = " + loops.back().brk + " | exec;");
+                line("exec = vbool(false);");
+                break;
+            case SK_CONTINUE:
+                line(loops.back().cnt + " = " + loops.back().cnt + " | exec;");
+                line("exec = vbool(false);");
+                break;
+            case SK_RETURN:
+                if (stmt.expr)
+                    line("glsl_rt::assign(ret, " + expression(*stmt.expr) + ", exec);");
+                line("done = done | exec;");
+                line("exec = vbool(false);");
+                break;
+            case SK_EMPTY:
+                break;
+            }
+        }
+
+        void function(const Function& function)
+        {
+            std::string header = cppType(function.returnType) + " f_" + function.name + "(vbool exec";
+            for (const Variable* param : function.params)
+                header += ", " + cppType(param->type) + (param->qualifier == PQ_IN ? " " : "& ") + name(param);
+            line(header + ")");
+            line("{");
+            ++depth;
+            counter = 0;
+            isVoid = function.returnType.base == TY_VOID;
+            hasDone = hasReturn(function.body.get());
+            if (hasDone)
+                line("vbool done(false);");
+            if (!isVoid)
+                line(cppType(function.returnType) + " ret{};");
+            statementList(function.body->body, EXIT_FUNCTION);
+            if (!isVoid)
+                line("return ret;");
+            --depth;
+            line("}");
+        }
+
+        // ------------------------------- glue ----------------------------------
+        std::string loadUniform(const Type& type, int offset)
+        {
+            if (type.base == TY_STRUCT)
+                fail(0, "struct uniforms are not supported");
+            std::vector<std::string> lanes;
+            for (int i = 0; i < type.rows * type.cols; ++i)
+            {
+                std::string value = "uniforms[" + std::to_string(offset + i) + "]";
+                if (type.base == TY_FLOAT)
+                    lanes.push_back("vfloat(" + value + ")");
+                else if (type.base == TY_INT)
+                    lanes.push_back("vint(int(" + value + "))");
+                else
+                    lanes.push_back("vbool(" + value + " != 0.0f)");
+            }
+            if (lanes.size() == 1)
+                return lanes[0];
+            std::string text = "glsl_rt::make<" + cppType(type) + ">(";
+            for (size_t i = 0; i < lanes.size(); ++i)
+                text += (i ? ", " : "") + lanes[i];
+            return text + ")";
+        }
+
+        std::string pixelInput(const Variable& input)
+        {
+            if (input.type.base != TY_FLOAT || input.type.isMatrix())
+                fail(0, "input '" + input.name + "' must be a float vector");
+            static const char* components[] = { "x", "y", "vfloat(0.0f)", "vfloat(1.0f)" };
+            if (input.type.rows == 1)
+                return "x";
+            std::string value = "glsl_rt::make<" + cppType(input.type) + ">(";
+            for (int i = 0; i < input.type.rows; ++i)
+                value += (i ? ", " : "") + std::string(components[i]);
+            return value + ")";
+        }
+
+        std::string outputColour(const Variable& output)
+        {
+            static const char* fill[] = { "", ", vfloat(0.0f), vfloat(0.0f), vfloat(1.0f)", ", vfloat(0.0f), vfloat(1.0f)", ", vfloat(1.0f)", "" };
+            if (output.type.rows == 4)
+                return "shader." + name(&output);
+            return "glsl_rt::make<vec4>(shader." + name(&output) + fill[output.type.rows] + ")";
+        }
+
+    public:
+        explicit Transpiler(const Program& program)
+            : program(program), depth(0), counter(0), hasDone(false), isVoid(true)
+        {
+        }
+
+        std::string run()
+        {
+            if (program.outputs.empty())
+                fail(0, "the shader has no output");
+            const Variable& output = *program.outputs[0];
+            if (output.type.base != TY_FLOAT || output.type.isMatrix())
+                fail(0, "output '" + output.name + "' must be a float vector");
+
+            out << "// generated from a GLSL fragment shader, do not edit\n";
+            out << "#define GLSL_LANE_TYPES\n";
+            out << "#include \"myImplement/glsl_runtime.h\"\n\n";
+            out << "using namespace glsl_rt;\n\n";
+            out << "namespace\n{\n";
+            for (const StructDecl& decl : program.structs)
+            {
+                out << "struct S_" << decl.name << "\n{\n";
+                for (size_t i = 0; i < decl.fieldNames.size(); ++i)
+                    out << "    " << cppType(decl.fieldTypes[i]) << " m_" << decl.fieldNames[i] << ";\n";
+                out << "};\n\n";
+                // masked stores and ?: blend whole structs field by field
+                out << "inline S_" << decl.name << " select(vbool m, const S_" << decl.name << "& a, const S_" << decl.name << "& b)\n{\n";
+                out << "    S_" << decl.name << " r;\n";
+                for (const std::string& field : decl.fieldNames)
+                    out << "    r.m_" << field << " = select(m, a.m_" << field << ", b.m_" << field << ");\n";
+                out << "    return r;\n}\n\n";
+            }
+
+            // all shader state lives in one object, main() and friends are members
+            out << "struct ShaderProgram\n{\n";
+            depth = 1;
+            for (const Variable* uniform : program.uniforms)
+                line(cppType(uniform->type) + " " + name(uniform) + ";");
+            for (const Variable* input : program.inputs)
+                line(cppType(input->type) + " " + name(input) + ";");
+            for (const Variable* output : program.outputs)
+                line(cppType(output->type) + " " + name(output) + ";");
+            for (const Variable* global : program.globals)
+                line(cppType(global->type) + " " + name(global) + ";");
+
+            out << "\n";
+            line("void reset(vfloat x, vfloat y)");
+            line("{");
+            ++depth;
+            if (!program.globals.empty())
+                line("const vbool exec(true);");
+            for (const Variable* input : program.inputs)
+                line(name(input) + " = " + pixelInput(*input) + ";");
+            for (const Variable* output : program.outputs)
+                line(name(output) + " = " + cppType(output->type) + "{};");
+            for (size_t i = 0; i < program.globals.size(); ++i)
+            {
+                const Variable* global = program.globals[i];
+                line(name(global) + " = " + (program.globalInits[i] ? expression(*program.globalInits[i]) : cppType(global->type) + "{}") + ";");
+            }
+            --depth;
+            line("}");
+
+            for (const std::unique_ptr<Function>& function : program.functions)
+            {
+                if (!function->body)
+                    continue;
+                out << "\n";
+                this->function(*function);
+            }
+            depth = 0;
+            out << "};\n}\n\n";
+
+            int floatCount = 0;
+            std::vector<UniformSlot> slots = uniformLayout(program, floatCount);
+            out << "SHADERTOY_EXPORT void shadertoy_run_tile(const float* uniforms, int x0, int y0, int x1, int y1, int width, unsigned char* rgba)\n{\n";
+            out << "    ShaderProgram shader;\n";
+            for (size_t i = 0; i < slots.size(); ++i)
+                out << "    shader." << name(program.uniforms[i]) << " = " << loadUniform(slots[i].type, slots[i].offset) << ";\n";
+            out << "    const vfloat lanes = glsl_rt::laneOffsets();\n";
+            out << "    for (int y = y0; y < y1; ++y)\n    {\n";
+            out << "        for (int x = x0; x < x1; x += LANES)\n        {\n";
+            out << "            const int count = x1 - x < LANES ? x1 - x : LANES;\n";
+            out << "            shader.reset(vfloat(x + 0.5f) + lanes, vfloat(y + 0.5f));\n";
+            out << "            shader.f_main(glsl_rt::lanesBelow(count));\n";
+            out << "            glsl_rt::storePixels(rgba + ((size_t)y * width + x) * 4, count, " << outputColour(output) << ");\n";
+            out << "        }\n    }\n}\n";
+            return out.str();
+        }
+    };
+}
+
+    bool transpile(const Program& program, std::string& source, std::string& error)
+    {
+        try
+        {
+            Transpiler transpiler(program);
+            source = transpiler.run();
+            return true;
+        }
+        catch (const TranspileError& failure)
+        {
+            error = failure.message;
+            return false;
+        }
+    }
+}
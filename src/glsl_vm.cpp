@@ -0,0 +1,1260 @@
+#include "myImplement/glsl_vm.h"
+
+#define GLSL_LANE_TYPES
+#include "myImplement/glsl_runtime.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <set>
+
+namespace glsl
+{
+namespace
+{
+    enum VmOp
+    {
+        // moves, SEL is dst = a ? b : c lane by lane
+        VM_MOV, VM_SEL,
+        // float
+        VM_FADD, VM_FSUB, VM_FMUL, VM_FDIV, VM_FNEG, VM_FMOD, VM_FMIN, VM_FMAX,
+        VM_FABS, VM_FSIGN, VM_FLOOR, VM_CEIL, VM_FRACT, VM_TRUNC, VM_ROUND,
+        VM_SQRT, VM_INVSQRT, VM_RADIANS, VM_DEGREES,
+        VM_SIN, VM_COS, VM_TAN, VM_ASIN, VM_ACOS, VM_ATAN, VM_ATAN2,
+        VM_EXP, VM_LOG, VM_EXP2, VM_LOG2, VM_POW,
+        VM_STEP, VM_FCLAMP, VM_MIX, VM_SMOOTHSTEP,
+        VM_FLT, VM_FLE, VM_FEQ,
+        // int
+        VM_IADD, VM_ISUB, VM_IMUL, VM_IDIV, VM_IMOD, VM_INEG, VM_IABS, VM_ISIGN,
+        VM_IMIN, VM_IMAX, VM_ICLAMP, VM_ILT, VM_ILE, VM_IEQ,
+        // conversions
+        VM_ITOF, VM_FTOI, VM_BTOF, VM_BTOI, VM_FTOB, VM_ITOB,
+        // masks
+        VM_AND, VM_OR, VM_XOR, VM_NOT, VM_ANDN,
+        // control, target in 'a', JNONE tests the mask in 'b'
+        VM_JMP, VM_JNONE
+    };
+
+    struct CompileError
+    {
+        std::string message;
+    };
+
+    // where a statement list may bail out once no lane is left executing
+    enum ExitKind
+    {
+        EXIT_NONE,
+        EXIT_FUNCTION,
+        EXIT_LOOP
+    };
+
+    bool hasReturn(const Stmt* stmt)
+    {
+        if (!stmt)
+            return false;
+        if (stmt->kind == SK_RETURN)
+            return true;
+        for (const StmtPtr& child : stmt->body)
+            if (hasReturn(child.get()))
+                return true;
+        return hasReturn(stmt->then.get()) || hasReturn(stmt->otherwise.get());
+    }
+
+    // break / continue of the innermost loop, nested loops own theirs
+    bool hasLoopJump(const Stmt* stmt, StmtKind kind)
+    {
+        if (!stmt || stmt->kind == SK_FOR || stmt->kind == SK_WHILE || stmt->kind == SK_DO)
+            return false;
+        if (stmt->kind == kind)
+            return true;
+        for (const StmtPtr& child : stmt->body)
+            if (hasLoopJump(child.get(), kind))
+                return true;
+        return hasLoopJump(stmt->then.get(), kind) || hasLoopJump(stmt->otherwise.get(), kind);
+    }
+
+    bool hasLoopJump(const Stmt* stmt)
+    {
+        return hasLoopJump(stmt, SK_BREAK) || hasLoopJump(stmt, SK_CONTINUE);
+    }
+
+    const Variable* rootVariable(const Expr& expr)
+    {
+        const Expr* e = &expr;
+        while (e->kind == EX_SWIZZLE || e->kind == EX_FIELD || e->kind == EX_INDEX)
+            e = e->args[0].get();
+        return e->kind == EX_VARIABLE ? e->variable : nullptr;
+    }
+
+    // variables a function body writes to, so unwritten 'in' parameters can share the caller's registers
+    void collectWrites(const Expr* expr, std::set<const Variable*>& written)
+    {
+        if (!expr)
+            return;
+        if (expr->kind == EX_ASSIGN || expr->kind == EX_INCDEC)
+            written.insert(rootVariable(*expr->args[0]));
+        if (expr->kind == EX_CALL)
+            for (size_t i = 0; i < expr->args.size(); ++i)
+                if (expr->function->params[i]->qualifier != PQ_IN)
+                    written.insert(rootVariable(*expr->args[i]));
+        for (const ExprPtr& arg : expr->args)
+            collectWrites(arg.get(), written);
+    }
+
+    void collectWrites(const Stmt* stmt, std::set<const Variable*>& written)
+    {
+        if (!stmt)
+            return;
+        for (const ExprPtr& init : stmt->inits)
+            collectWrites(init.get(), written);
+        collectWrites(stmt->expr.get(), written);
+        collectWrites(stmt->step.get(), written);
+        collectWrites(stmt->init.get(), written);
+        collectWrites(stmt->then.get(), written);
+        collectWrites(stmt->otherwise.get(), written);
+        for (const StmtPtr& child : stmt->body)
+            collectWrites(child.get(), written);
+    }
+
+    // the scalar registers of a value, vectors in order, matrices column by column
+    typedef std::vector<int> Regs;
+
+    /**
+     * @brief lowers the typed syntax tree to register bytecode. registers
+     * are handed out like a stack: variables live until their block ends,
+     * temporaries until their statement ends. constants and uniforms get
+     * negative ids while compiling and are moved above the stack at the end.
+     */
+    class VmCompiler
+    {
+    private:
+        struct LoopFrame
+        {
+            int brk;
+            int cnt; // -1 when the body never continues
+            std::vector<size_t> continueJumps;
+        };
+
+        struct FunctionFrame
+        {
+            const Function* function;
+            int done; // -1 when the function never returns early
+            Regs ret;
+            std::vector<size_t> endJumps;
+            std::vector<LoopFrame> loops;
+        };
+
+        const Program& program;
+        VmProgram& vm;
+        int top;
+        int permanentTop; // exec, inputs, outputs and globals live below this
+        int fixedCount;   // constants and uniforms
+        std::map<unsigned, int> constants;
+        std::map<const Variable*, Regs> variables;
+        std::map<const Function*, std::set<const Variable*>> writes;
+        std::vector<FunctionFrame> frames;
+        int exec;
+
+        [[noreturn]] void fail(int line, const std::string& message)
+        {
+            throw CompileError{ "line " + std::to_string(line) + ": " + message };
+        }
+
+        // ------------------------------ registers -------------------------------
+        Regs alloc(int count)
+        {
+            Regs regs;
+            for (int i = 0; i < count; ++i)
+                regs.push_back(top++);
+            vm.registerCount = std::max(vm.registerCount, top);
+            return regs;
+        }
+
+        int alloc()
+        {
+            return alloc(1)[0];
+        }
+
+        int fixed()
+        {
+            return -(++fixedCount);
+        }
+
+        int constant(unsigned bits)
+        {
+            std::map<unsigned, int>::iterator it = constants.find(bits);
+            if (it != constants.end())
+                return it->second;
+            int reg = fixed();
+            constants[bits] = reg;
+            vm.constants.push_back(VmConstant{ reg, bits });
+            return reg;
+        }
+
+        int constantFloat(float value)
+        {
+            unsigned bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return constant(bits);
+        }
+
+        int constantInt(int value) { return constant(unsigned(value)); }
+        int constantBool(bool value) { return constant(value ? 0xffffffffu : 0u); }
+
+        int zero(BaseType base)
+        {
+            return base == TY_FLOAT ? constantFloat(0.0f) : constantInt(0);
+        }
+
+        int count(const Type& type) const
+        {
+            return componentCount(type, program);
+        }
+
+        // ----------------------------- instructions -----------------------------
+        size_t emit(int op, int dst, int a = 0, int b = 0, int c = 0)
+        {
+            vm.code.push_back(VmInstr{ op, dst, a, b, c });
+            return vm.code.size() - 1;
+        }
+
+        int op1(int op, int a)
+        {
+            int dst = alloc();
+            emit(op, dst, a);
+            return dst;
+        }
+
+        int op2(int op, int a, int b)
+        {
+            int dst = alloc();
+            emit(op, dst, a, b);
+            return dst;
+        }
+
+        int op3(int op, int a, int b, int c)
+        {
+            int dst = alloc();
+            emit(op, dst, a, b, c);
+            return dst;
+        }
+
+        size_t jumpIfNone(int mask)
+        {
+            return emit(VM_JNONE, 0, -1, mask);
+        }
+
+        size_t jump()
+        {
+            return emit(VM_JMP, 0, -1);
+        }
+
+        void patch(size_t at, size_t target)
+        {
+            vm.code[at].a = int(target);
+        }
+
+        size_t here() const
+        {
+            return vm.code.size();
+        }
+
+        void move(int dst, int src)
+        {
+            if (dst != src)
+                emit(VM_MOV, dst, src);
+        }
+
+        Regs copy(const Regs& regs)
+        {
+            Regs out = alloc(int(regs.size()));
+            for (size_t i = 0; i < regs.size(); ++i)
+                move(out[i], regs[i]);
+            return out;
+        }
+
+        // writes 'value' into 'target' for the lanes set in 'mask'
+        void store(const Regs& target, Regs value, int mask)
+        {
+            // v = v.yx must read both components before writing either
+            for (size_t i = 0; i < value.size(); ++i)
+                for (size_t j = 0; j < target.size(); ++j)
+                    if (value[i] == target[j] && i != j)
+                    {
+                        value = copy(value);
+                        i = value.size();
+                        break;
+                    }
+            for (size_t i = 0; i < target.size(); ++i)
+                emit(VM_SEL, target[i], mask, value[i], target[i]);
+        }
+
+        // ------------------------------ lvalues --------------------------------
+        int fieldOffset(const Type& type, int field) const
+        {
+            const StructDecl& decl = program.structs[type.structId];
+            int offset = 0;
+            for (int i = 0; i < field; ++i)
+                offset += count(decl.fieldTypes[i]);
+            return offset;
+        }
+
+        Regs slice(const Regs& regs, int offset, int size) const
+        {
+            return Regs(regs.begin() + offset, regs.begin() + offset + size);
+        }
+
+        // the element an index picks: a component of a vector, a column of a matrix
+        int elementSize(const Type& type) const
+        {
+            return type.isMatrix() ? type.rows : 1;
+        }
+
+        int elementCount(const Type& type) const
+        {
+            return type.isMatrix() ? type.cols : type.rows;
+        }
+
+        Regs swizzle(const Expr& expr, const Regs& base) const
+        {
+            if (expr.args[0]->type.isScalar())
+                return Regs(size_t(expr.swizzleCount), base[0]);
+            Regs regs;
+            for (int i = 0; i < expr.swizzleCount; ++i)
+                regs.push_back(base[expr.swizzle[i]]);
+            return regs;
+        }
+
+        long constantIndex(const Expr& expr)
+        {
+            long index = long(expr.args[1]->number);
+            if (index < 0 || index >= elementCount(expr.args[0]->type))
+                fail(expr.line, "index out of range");
+            return index;
+        }
+
+        // registers of a target without a dynamic index, so it can be written in place
+        Regs lvalue(const Expr& expr)
+        {
+            switch (expr.kind)
+            {
+            case EX_VARIABLE:
+                return variables.at(expr.variable);
+            case EX_SWIZZLE:
+                return swizzle(expr, lvalue(*expr.args[0]));
+            case EX_FIELD:
+                return slice(lvalue(*expr.args[0]), fieldOffset(expr.args[0]->type, expr.swizzle[0]), count(expr.type));
+            case EX_INDEX:
+                if (expr.args[1]->kind == EX_LITERAL)
+                {
+                    int size = elementSize(expr.args[0]->type);
+                    return slice(lvalue(*expr.args[0]), int(constantIndex(expr)) * size, size);
+                }
+                break;
+            default:
+                break;
+            }
+            fail(expr.line, "unsupported assignment target");
+        }
+
+        // assign 'value' to the executing lanes of an lvalue
+        void assign(const Expr& target, const Regs& value)
+        {
+            if (target.kind == EX_INDEX && target.args[1]->kind != EX_LITERAL)
+            {
+                // v[i] = x writes element k where i == k
+                const Regs base = lvalue(*target.args[0]);
+                const int index = expression(*target.args[1])[0];
+                const int size = elementSize(target.args[0]->type);
+                for (int k = 0; k < elementCount(target.args[0]->type); ++k)
+                {
+                    int mask = op2(VM_AND, exec, op2(VM_IEQ, index, constantInt(k)));
+                    store(slice(base, k * size, size), value, mask);
+                }
+                return;
+            }
+            store(lvalue(target), value, exec);
+        }
+
+        // ----------------------------- expressions -----------------------------
+        int component(const Regs& regs, size_t i) const
+        {
+            return regs.size() == 1 ? regs[0] : regs[i];
+        }
+
+        int arithmetic(Operator op, BaseType base, int a, int b)
+        {
+            static const int floatOps[] = { VM_FADD, VM_FSUB, VM_FMUL, VM_FDIV, VM_FMOD };
+            static const int intOps[] = { VM_IADD, VM_ISUB, VM_IMUL, VM_IDIV, VM_IMOD };
+            return op2(base == TY_INT ? intOps[op - OP_ADD] : floatOps[op - OP_ADD], a, b);
+        }
+
+        // sum of a[i] * b[i] in the same order as the runtime's dot()
+        int dot(const Regs& a, const Regs& b)
+        {
+            int r = op2(VM_FMUL, a[0], b[0]);
+            for (size_t i = 1; i < a.size(); ++i)
+                r = op2(VM_FADD, r, op2(VM_FMUL, a[i], b[i]));
+            return r;
+        }
+
+        Regs matrixTimesVector(const Type& m, const Regs& a, const Regs& v)
+        {
+            Regs r;
+            for (int k = 0; k < m.rows; ++k)
+            {
+                int sum = op2(VM_FMUL, a[k], v[0]);
+                for (int i = 1; i < m.cols; ++i)
+                    sum = op2(VM_FADD, sum, op2(VM_FMUL, a[i * m.rows + k], v[i]));
+                r.push_back(sum);
+            }
+            return r;
+        }
+
+        Regs binary(Operator op, const Type& ta, const Regs& a, const Type& tb, const Regs& b)
+        {
+            const BaseType base = ta.base;
+            if (op == OP_AND || op == OP_OR || op == OP_XOR)
+                return Regs{ op2(op == OP_AND ? VM_AND : (op == OP_OR ? VM_OR : VM_XOR), a[0], b[0]) };
+            if (op == OP_EQ || op == OP_NE)
+            {
+                int all = op2(base == TY_FLOAT ? VM_FEQ : VM_IEQ, a[0], b[0]);
+                for (size_t i = 1; i < a.size(); ++i)
+                    all = op2(VM_AND, all, op2(base == TY_FLOAT ? VM_FEQ : VM_IEQ, a[i], b[i]));
+                return Regs{ op == OP_EQ ? all : op1(VM_NOT, all) };
+            }
+            if (op >= OP_LT && op <= OP_GE)
+            {
+                // a > b is b < a, which compares the same way for NaNs too
+                const bool swap = op == OP_GT || op == OP_GE;
+                const bool strict = op == OP_LT || op == OP_GT;
+                int opcode = base == TY_FLOAT ? (strict ? VM_FLT : VM_FLE) : (strict ? VM_ILT : VM_ILE);
+                return Regs{ swap ? op2(opcode, b[0], a[0]) : op2(opcode, a[0], b[0]) };
+            }
+            if (op == OP_MUL && !ta.isScalar() && !tb.isScalar() && (ta.isMatrix() || tb.isMatrix()))
+            {
+                if (ta.isMatrix() && tb.isVector())
+                    return matrixTimesVector(ta, a, b);
+                if (ta.isVector())
+                {
+                    Regs r;
+                    for (int i = 0; i < tb.cols; ++i)
+                        r.push_back(dot(a, slice(b, i * tb.rows, tb.rows)));
+                    return r;
+                }
+                Regs r;
+                for (int i = 0; i < tb.cols; ++i)
+                {
+                    Regs column = matrixTimesVector(ta, a, slice(b, i * tb.rows, tb.rows));
+                    r.insert(r.end(), column.begin(), column.end());
+                }
+                return r;
+            }
+            Regs r;
+            for (size_t i = 0; i < std::max(a.size(), b.size()); ++i)
+                r.push_back(arithmetic(op, base, component(a, i), component(b, i)));
+            return r;
+        }
+
+        int convert(BaseType from, BaseType to, int reg)
+        {
+            if (from == to)
+                return reg;
+            if (to == TY_FLOAT)
+                return op1(from == TY_INT ? VM_ITOF : VM_BTOF, reg);
+            if (to == TY_INT)
+                return op1(from == TY_FLOAT ? VM_FTOI : VM_BTOI, reg);
+            return op1(from == TY_FLOAT ? VM_FTOB : VM_ITOB, reg);
+        }
+
+        Regs construct(const Expr& expr)
+        {
+            const Type& type = expr.type;
+            if (expr.args.size() == 1 && type.base != TY_STRUCT)
+            {
+                const Type& from = expr.args[0]->type;
+                const Regs arg = expression(*expr.args[0]);
+                if (from.rows == type.rows && from.cols == type.cols)
+                {
+                    Regs r;
+                    for (int reg : arg)
+                        r.push_back(convert(from.base, type.base, reg));
+                    return r;
+                }
+                if (from.isScalar() && type.isVector())
+                    return Regs(size_t(type.rows), arg[0]);
+                if (from.isScalar() && type.isMatrix())
+                {
+                    Regs r(size_t(type.rows * type.cols), constantFloat(0.0f));
+                    for (int i = 0; i < std::min(type.rows, type.cols); ++i)
+                        r[i * type.rows + i] = arg[0];
+                    return r;
+                }
+            }
+            // the front end already converted every argument to the target base type
+            Regs r;
+            for (const ExprPtr& arg : expr.args)
+            {
+                Regs regs = expression(*arg);
+                r.insert(r.end(), regs.begin(), regs.end());
+            }
+            r.resize(size_t(count(type)));
+            return r;
+        }
+
+        Regs builtin(const Expr& expr)
+        {
+            std::vector<Regs> args;
+            for (const ExprPtr& arg : expr.args)
+                args.push_back(expression(*arg));
+            const Regs& x = args[0];
+            const bool isInt = expr.args[0]->type.base == TY_INT;
+            switch (expr.builtin)
+            {
+            case BI_DOT:
+                return Regs{ dot(x, args[1]) };
+            case BI_LENGTH:
+                return Regs{ x.size() == 1 ? op1(VM_FABS, x[0]) : op1(VM_SQRT, dot(x, x)) };
+            case BI_DISTANCE:
+            {
+                Regs d = binary(OP_SUB, expr.args[0]->type, x, expr.args[1]->type, args[1]);
+                return Regs{ d.size() == 1 ? op1(VM_FABS, d[0]) : op1(VM_SQRT, dot(d, d)) };
+            }
+            case BI_NORMALIZE:
+            {
+                if (x.size() == 1)
+                    return Regs{ op2(VM_FDIV, x[0], op1(VM_FABS, x[0])) };
+                int scale = op1(VM_INVSQRT, dot(x, x));
+                Regs r;
+                for (int reg : x)
+                    r.push_back(op2(VM_FMUL, reg, scale));
+                return r;
+            }
+            case BI_REFLECT:
+            {
+                int twice = op2(VM_FMUL, constantFloat(2.0f), dot(args[1], x));
+                Regs r;
+                for (size_t i = 0; i < x.size(); ++i)
+                    r.push_back(op2(VM_FSUB, x[i], op2(VM_FMUL, twice, args[1][i])));
+                return r;
+            }
+            case BI_CROSS:
+            {
+                const Regs& y = args[1];
+                Regs r;
+                r.push_back(op2(VM_FSUB, op2(VM_FMUL, x[1], y[2]), op2(VM_FMUL, y[1], x[2])));
+                r.push_back(op2(VM_FSUB, op2(VM_FMUL, x[2], y[0]), op2(VM_FMUL, y[2], x[0])));
+                r.push_back(op2(VM_FSUB, op2(VM_FMUL, x[0], y[1]), op2(VM_FMUL, y[0], x[1])));
+                return r;
+            }
+            default:
+                break;
+            }
+
+            int opcode;
+            switch (expr.builtin)
+            {
+            case BI_RADIANS: opcode = VM_RADIANS; break;
+            case BI_DEGREES: opcode = VM_DEGREES; break;
+            case BI_SIN: opcode = VM_SIN; break;
+            case BI_COS: opcode = VM_COS; break;
+            case BI_TAN: opcode = VM_TAN; break;
+            case BI_ASIN: opcode = VM_ASIN; break;
+            case BI_ACOS: opcode = VM_ACOS; break;
+            case BI_ATAN: opcode = args.size() == 2 ? VM_ATAN2 : VM_ATAN; break;
+            case BI_EXP: opcode = VM_EXP; break;
+            case BI_LOG: opcode = VM_LOG; break;
+            case BI_EXP2: opcode = VM_EXP2; break;
+            case BI_LOG2: opcode = VM_LOG2; break;
+            case BI_SQRT: opcode = VM_SQRT; break;
+            case BI_INVERSESQRT: opcode = VM_INVSQRT; break;
+            case BI_ABS: opcode = isInt ? VM_IABS : VM_FABS; break;
+            case BI_SIGN: opcode = isInt ? VM_ISIGN : VM_FSIGN; break;
+            case BI_FLOOR: opcode = VM_FLOOR; break;
+            case BI_CEIL: opcode = VM_CEIL; break;
+            case BI_FRACT: opcode = VM_FRACT; break;
+            case BI_TRUNC: opcode = VM_TRUNC; break;
+            case BI_ROUND: opcode = VM_ROUND; break;
+            case BI_POW: opcode = VM_POW; break;
+            case BI_MOD: opcode = VM_FMOD; break;
+            case BI_MIN: opcode = isInt ? VM_IMIN : VM_FMIN; break;
+            case BI_MAX: opcode = isInt ? VM_IMAX : VM_FMAX; break;
+            case BI_STEP: opcode = VM_STEP; break;
+            case BI_CLAMP: opcode = isInt ? VM_ICLAMP : VM_FCLAMP; break;
+            case BI_MIX: opcode = VM_MIX; break;
+            case BI_SMOOTHSTEP: opcode = VM_SMOOTHSTEP; break;
+            default:
+                fail(expr.line, std::string("unsupported built-in ") + builtinName(expr.builtin) + "()");
+            }
+            // the front end broadcast scalar arguments, so every argument has all components
+            Regs r;
+            for (size_t i = 0; i < x.size(); ++i)
+            {
+                int dst = alloc();
+                emit(opcode, dst, x[i], args.size() > 1 ? args[1][i] : 0, args.size() > 2 ? args[2][i] : 0);
+                r.push_back(dst);
+            }
+            return r;
+        }
+
+        Regs call(const Expr& expr)
+        {
+            const Function& function = *expr.function;
+            for (const FunctionFrame& frame : frames)
+                if (frame.function == &function)
+                    fail(expr.line, "recursion is not supported");
+
+            std::vector<Regs> args;
+            for (const ExprPtr& arg : expr.args)
+                args.push_back(expression(*arg));
+            Regs ret = alloc(count(function.returnType));
+            for (int reg : ret)
+                move(reg, constantInt(0));
+            const int mark = top;
+
+            // 'in' parameters the body never writes read the argument in place,
+            // unless a global could change under them
+            const std::set<const Variable*>& written = writes[&function];
+            for (size_t i = 0; i < function.params.size(); ++i)
+            {
+                const Variable* param = function.params[i];
+                bool shared = param->qualifier == PQ_IN && !written.count(param);
+                for (int reg : args[i])
+                    shared = shared && (reg < 0 || reg >= permanentTop);
+                if (shared)
+                {
+                    variables[param] = args[i];
+                    continue;
+                }
+                Regs regs = alloc(count(param->type));
+                for (size_t k = 0; k < regs.size(); ++k)
+                    move(regs[k], param->qualifier == PQ_OUT ? zero(param->type.base) : args[i][k]);
+                variables[param] = regs;
+            }
+
+            const int saved = alloc();
+            move(saved, exec);
+            frames.push_back(FunctionFrame{ &function, -1, ret, std::vector<size_t>(), std::vector<LoopFrame>() });
+            if (hasReturn(function.body.get()))
+            {
+                frames.back().done = alloc();
+                move(frames.back().done, constantBool(false));
+            }
+            statementList(function.body->body, EXIT_FUNCTION);
+            for (size_t at : frames.back().endJumps)
+                patch(at, here());
+            frames.pop_back();
+            move(exec, saved);
+
+            // copy out and inout parameters back for the lanes that made the call
+            for (size_t i = 0; i < function.params.size(); ++i)
+                if (function.params[i]->qualifier != PQ_IN)
+                    assign(*expr.args[i], variables[function.params[i]]);
+            top = mark;
+            return ret;
+        }
+
+        Regs expression(const Expr& expr)
+        {
+            switch (expr.kind)
+            {
+            case EX_LITERAL:
+                if (expr.type.base == TY_FLOAT)
+                    return Regs{ constantFloat(float(expr.number)) };
+                if (expr.type.base == TY_INT)
+                    return Regs{ constantInt(int(expr.number)) };
+                return Regs{ constantBool(expr.number != 0.0) };
+            case EX_VARIABLE:
+                return variables.at(expr.variable);
+            case EX_UNARY:
+            {
+                const Regs a = expression(*expr.args[0]);
+                if (expr.op == OP_PLUS)
+                    return a;
+                Regs r;
+                for (int reg : a)
+                    r.push_back(op1(expr.op == OP_NOT ? VM_NOT : (expr.type.base == TY_INT ? VM_INEG : VM_FNEG), reg));
+                return r;
+            }
+            case EX_BINARY:
+                // both sides of && and || run, masking makes that harmless
+                return binary(expr.op, expr.args[0]->type, expression(*expr.args[0]), expr.args[1]->type, expression(*expr.args[1]));
+            case EX_ASSIGN:
+            {
+                const Expr& target = *expr.args[0];
+                Regs value = expression(*expr.args[1]);
+                if (expr.op != OP_ASSIGN)
+                    value = binary(expr.op, target.type, expression(target), expr.args[1]->type, value);
+                assign(target, value);
+                return value;
+            }
+            case EX_INCDEC:
+            {
+                const Expr& target = *expr.args[0];
+                const Regs old = copy(expression(target));
+                const Type one(target.type.base);
+                const Regs step{ target.type.base == TY_FLOAT ? constantFloat(1.0f) : constantInt(1) };
+                const Regs value = binary(expr.op == OP_DEC ? OP_SUB : OP_ADD, target.type, old, one, step);
+                assign(target, value);
+                return expr.prefix ? value : old;
+            }
+            case EX_CALL:
+                return call(expr);
+            case EX_BUILTIN:
+                return builtin(expr);
+            case EX_CONSTRUCT:
+                return construct(expr);
+            case EX_SWIZZLE:
+                return swizzle(expr, expression(*expr.args[0]));
+            case EX_FIELD:
+                return slice(expression(*expr.args[0]), fieldOffset(expr.args[0]->type, expr.swizzle[0]), count(expr.type));
+            case EX_INDEX:
+            {
+                const Type& type = expr.args[0]->type;
+                const Regs base = expression(*expr.args[0]);
+                const int size = elementSize(type);
+                if (expr.args[1]->kind == EX_LITERAL)
+                    return slice(base, int(constantIndex(expr)) * size, size);
+                // pick element k where the index is k
+                const int index = expression(*expr.args[1])[0];
+                Regs r = slice(base, 0, size);
+                for (int k = 1; k < elementCount(type); ++k)
+                {
+                    int mask = op2(VM_IEQ, index, constantInt(k));
+                    for (int i = 0; i < size; ++i)
+                        r[i] = op3(VM_SEL, mask, base[k * size + i], r[i]);
+                }
+                return r;
+            }
+            case EX_TERNARY:
+            {
+                const int cond = expression(*expr.args[0])[0];
+                const Regs a = expression(*expr.args[1]);
+                const Regs b = expression(*expr.args[2]);
+                Regs r;
+                for (size_t i = 0; i < a.size(); ++i)
+                    r.push_back(op3(VM_SEL, cond, a[i], b[i]));
+                return r;
+            }
+            }
+            fail(expr.line, "unknown expression");
+        }
+
+        // ----------------------------- statements ------------------------------
+        // lanes that left the current block through a jump
+        int jumped()
+        {
+            const FunctionFrame& frame = frames.back();
+            int mask = frame.done;
+            if (!frame.loops.empty())
+            {
+                const LoopFrame& loop = frame.loops.back();
+                mask = mask < 0 ? loop.brk : op2(VM_OR, mask, loop.brk);
+                if (loop.cnt >= 0)
+                    mask = op2(VM_OR, mask, loop.cnt);
+            }
+            return mask;
+        }
+
+        void notDone(int dst, int src)
+        {
+            if (frames.back().done >= 0)
+                emit(VM_ANDN, dst, src, frames.back().done);
+            else
+                move(dst, src);
+        }
+
+        void statementList(const std::vector<StmtPtr>& list, ExitKind exit)
+        {
+            for (size_t i = 0; i < list.size(); ++i)
+            {
+                const Stmt* stmt = list[i].get();
+                statement(*stmt);
+                if (i + 1 == list.size() || exit == EXIT_NONE)
+                    continue;
+                // the rest of the list has nothing left to run
+                if (exit == EXIT_FUNCTION && hasReturn(stmt))
+                    frames.back().endJumps.push_back(jumpIfNone(exec));
+                else if (exit == EXIT_LOOP && (hasLoopJump(stmt) || hasReturn(stmt)))
+                    frames.back().loops.back().continueJumps.push_back(jumpIfNone(exec));
+            }
+        }
+
+        void body(const Stmt& stmt, ExitKind exit)
+        {
+            const int mark = top;
+            if (stmt.kind == SK_BLOCK)
+                statementList(stmt.body, exit);
+            else
+                statement(stmt);
+            top = mark;
+        }
+
+        void declaration(const Stmt& stmt)
+        {
+            for (size_t i = 0; i < stmt.vars.size(); ++i)
+            {
+                const Variable* variable = stmt.vars[i];
+                // uninitialized GLSL locals are undefined, zero is as good as any
+                Regs regs = alloc(count(variable->type));
+                const int mark = top;
+                if (stmt.inits[i])
+                {
+                    Regs value = expression(*stmt.inits[i]);
+                    for (size_t k = 0; k < regs.size(); ++k)
+                        move(regs[k], value[k]);
+                }
+                else
+                {
+                    for (int reg : regs)
+                        move(reg, constantInt(0));
+                }
+                top = mark;
+                // the new variable only comes into scope after its initializer
+                variables[variable] = regs;
+            }
+        }
+
+        void branch(const Stmt& stmt)
+        {
+            const bool jumps = hasReturn(&stmt) || hasLoopJump(&stmt);
+            const int saved = alloc();
+            move(saved, exec);
+            const int cond = expression(*stmt.expr)[0];
+            emit(VM_AND, exec, saved, cond);
+            size_t skipThen = jumpIfNone(exec);
+            body(*stmt.then, EXIT_NONE);
+            patch(skipThen, here());
+            if (stmt.otherwise)
+            {
+                emit(VM_ANDN, exec, saved, cond);
+                size_t skipElse = jumpIfNone(exec);
+                body(*stmt.otherwise, EXIT_NONE);
+                patch(skipElse, here());
+            }
+            if (jumps)
+                emit(VM_ANDN, exec, saved, jumped());
+            else
+                move(exec, saved);
+        }
+
+        // the loop condition moves failing lanes into 'brk'
+        void loopCondition(const Stmt& stmt, int brk)
+        {
+            const int mark = top;
+            const int cond = expression(*stmt.expr)[0];
+            emit(VM_OR, brk, brk, op2(VM_ANDN, exec, cond));
+            emit(VM_AND, exec, exec, cond);
+            top = mark;
+        }
+
+        void loop(const Stmt& stmt)
+        {
+            if (stmt.init)
+                statement(*stmt.init);
+            const int saved = alloc();
+            move(saved, exec);
+            LoopFrame frame{ alloc(), -1, std::vector<size_t>() };
+            move(frame.brk, constantBool(false));
+            if (hasLoopJump(stmt.then.get(), SK_CONTINUE))
+                frame.cnt = alloc();
+
+            const size_t start = here();
+            emit(VM_ANDN, exec, saved, frame.brk);
+            notDone(exec, exec);
+            if (stmt.kind != SK_DO && stmt.expr)
+                loopCondition(stmt, frame.brk);
+            const size_t exitJump = jumpIfNone(exec);
+            if (frame.cnt >= 0)
+                move(frame.cnt, constantBool(false));
+
+            frames.back().loops.push_back(frame);
+            body(*stmt.then, EXIT_LOOP);
+            for (size_t at : frames.back().loops.back().continueJumps)
+                patch(at, here());
+            frames.back().loops.pop_back();
+
+            // lanes that finished the body or continued go on to the step
+            emit(VM_ANDN, exec, saved, frame.brk);
+            notDone(exec, exec);
+            if (stmt.step)
+            {
+                const int mark = top;
+                expression(*stmt.step);
+                top = mark;
+            }
+            if (stmt.kind == SK_DO)
+                loopCondition(stmt, frame.brk);
+            patch(jump(), start);
+            patch(exitJump, here());
+            notDone(exec, saved);
+        }
+
+        void statement(const Stmt& stmt)
+        {
+            const int mark = top;
+            switch (stmt.kind)
+            {
+            case SK_BLOCK:
+                statementList(stmt.body, EXIT_NONE);
+                break;
+            case SK_DECL:
+                declaration(stmt);
+                return; // keeps its registers until the enclosing block ends
+            case SK_EXPR:
+                expression(*stmt.expr);
+                break;
+            case SK_IF:
+                branch(stmt);
+                break;
+            case SK_FOR:
+            case SK_WHILE:
+            case SK_DO:
+                loop(stmt);
+                break;
+            case SK_BREAK:
+                emit(VM_OR, frames.back().loops.back().brk, frames.back().loops.back().brk, exec);
+                move(exec, constantBool(false));
+                break;
+            case SK_CONTINUE:
+                emit(VM_OR, frames.back().loops.back().cnt, frames.back().loops.back().cnt, exec);
+                move(exec, constantBool(false));
+                break;
+            case SK_RETURN:
+                if (stmt.expr)
+                    store(frames.back().ret, expression(*stmt.expr), exec);
+                emit(VM_OR, frames.back().done, frames.back().done, exec);
+                move(exec, constantBool(false));
+                break;
+            case SK_EMPTY:
+                break;
+            }
+            top = mark;
+        }
+
+        Regs permanent(const Variable* variable)
+        {
+            Regs regs = alloc(count(variable->type));
+            variables[variable] = regs;
+            return regs;
+        }
+
+    public:
+        VmCompiler(const Program& program, VmProgram& vm)
+            : program(program), vm(vm), top(0), permanentTop(0), fixedCount(0), exec(0)
+        {
+        }
+
+        void run()
+        {
+            if (program.outputs.empty())
+                fail(0, "the shader has no output");
+            const Variable& output = *program.outputs[0];
+            if (output.type.base != TY_FLOAT || output.type.isMatrix())
+                fail(0, "output '" + output.name + "' must be a float vector");
+            if (!program.entry || !program.entry->body)
+                fail(0, "the shader has no main()");
+
+            for (const std::unique_ptr<Function>& function : program.functions)
+                if (function->body)
+                    collectWrites(function->body.get(), writes[function.get()]);
+
+            exec = alloc();
+            vm.execRegister = exec;
+            for (const Variable* input : program.inputs)
+            {
+                if (input->type.base != TY_FLOAT || input->type.isMatrix())
+                    fail(0, "input '" + input->name + "' must be a float vector");
+                Regs regs = permanent(input);
+                if (vm.input.empty())
+                    vm.input = regs;
+            }
+            for (const Variable* out : program.outputs)
+                permanent(out);
+            vm.output = variables[&output];
+            for (const Variable* global : program.globals)
+                permanent(global);
+            permanentTop = top;
+
+            int floatCount = 0;
+            std::vector<UniformSlot> slots = uniformLayout(program, floatCount);
+            for (size_t i = 0; i < slots.size(); ++i)
+            {
+                if (slots[i].type.base == TY_STRUCT)
+                    fail(0, "struct uniforms are not supported");
+                Regs regs;
+                for (int k = 0; k < slots[i].type.rows * slots[i].type.cols; ++k)
+                {
+                    regs.push_back(fixed());
+                    vm.uniforms.push_back(VmUniform{ regs.back(), slots[i].offset + k, slots[i].type.base });
+                }
+                variables[program.uniforms[i]] = regs;
+            }
+
+            // main() runs as an inlined call after the per pixel reset of outputs and globals
+            frames.push_back(FunctionFrame{ program.entry, -1, Regs(), std::vector<size_t>(), std::vector<LoopFrame>() });
+            for (const Variable* out : program.outputs)
+                for (int reg : variables[out])
+                    move(reg, constantInt(0));
+            for (size_t i = 0; i < program.globals.size(); ++i)
+            {
+                const Regs& regs = variables[program.globals[i]];
+                const int mark = top;
+                const Regs value = program.globalInits[i] ? expression(*program.globalInits[i]) : Regs(regs.size(), constantInt(0));
+                for (size_t k = 0; k < regs.size(); ++k)
+                    move(regs[k], value[k]);
+                top = mark;
+            }
+            if (hasReturn(program.entry->body.get()))
+            {
+                frames.back().done = alloc();
+                move(frames.back().done, constantBool(false));
+            }
+            statementList(program.entry->body->body, EXIT_FUNCTION);
+            for (size_t at : frames.back().endJumps)
+                patch(at, here());
+            frames.pop_back();
+
+            // constants and uniforms go above everything the stack ever used
+            const int base = vm.registerCount;
+            auto place = [base](int& reg) { if (reg < 0) reg = base - reg - 1; };
+            for (VmInstr& in : vm.code)
+            {
+                if (in.op == VM_JMP || in.op == VM_JNONE)
+                {
+                    place(in.b);
+                    continue;
+                }
+                place(in.dst);
+                place(in.a);
+                place(in.b);
+                place(in.c);
+            }
+            for (VmConstant& c : vm.constants)
+                place(c.reg);
+            for (VmUniform& u : vm.uniforms)
+                place(u.reg);
+            vm.registerCount = base + fixedCount;
+        }
+    };
+
+    // ------------------------------- interpreter -------------------------------
+    using namespace glsl_rt;
+
+    const int VM_CHUNKS = GLSL_VM_LANES / LANES;
+    static_assert(GLSL_VM_LANES % GLSL_LANES == 0, "GLSL_VM_LANES must be a multiple of the lane width");
+
+    struct Register
+    {
+        vfloat c[VM_CHUNKS];
+    };
+
+    // registers hold raw bits, the opcode says how to read them
+    inline vint asInt(const vfloat& v) { return vint((lanei)v.v); }
+    inline vbool asBool(const vfloat& v) { return vbool((lanei)v.v); }
+    inline vfloat bits(const vfloat& v) { return v; }
+    inline vfloat bits(const vint& v) { return vfloat((lanef)v.v); }
+    inline vfloat bits(const vbool& v) { return vfloat((lanef)v.v); }
+
+#define VM_CASE1(op, read, expr)                                                        \
+    case op:                                                                            \
+        for (int k = 0; k < VM_CHUNKS; ++k)                                             \
+        {                                                                               \
+            const auto a = read(r[in.a].c[k]);                                          \
+            r[in.dst].c[k] = bits(expr);                                                \
+        }                                                                               \
+        break;
+#define VM_CASE2(op, read, expr)                                                        \
+    case op:                                                                            \
+        for (int k = 0; k < VM_CHUNKS; ++k)                                             \
+        {                                                                               \
+            const auto a = read(r[in.a].c[k]);                                          \
+            const auto b = read(r[in.b].c[k]);                                          \
+            r[in.dst].c[k] = bits(expr);                                                \
+        }                                                                               \
+        break;
+#define VM_CASE3(op, read, expr)                                                        \
+    case op:                                                                            \
+        for (int k = 0; k < VM_CHUNKS; ++k)                                             \
+        {                                                                               \
+            const auto a = read(r[in.a].c[k]);                                          \
+            const auto b = read(r[in.b].c[k]);                                          \
+            const auto c = read(r[in.c].c[k]);                                          \
+            r[in.dst].c[k] = bits(expr);                                                \
+        }                                                                               \
+        break;
+
+    void execute(const VmProgram& vm, Register* r)
+    {
+        const VmInstr* code = vm.code.data();
+        const size_t end = vm.code.size();
+        size_t pc = 0;
+        while (pc < end)
+        {
+            const VmInstr& in = code[pc++];
+            switch (in.op)
+            {
+            VM_CASE1(VM_MOV, bits, a)
+            case VM_SEL:
+                for (int k = 0; k < VM_CHUNKS; ++k)
+                    r[in.dst].c[k] = select(asBool(r[in.a].c[k]), r[in.b].c[k], r[in.c].c[k]);
+                break;
+
+            VM_CASE2(VM_FADD, bits, a + b)
+            VM_CASE2(VM_FSUB, bits, a - b)
+            VM_CASE2(VM_FMUL, bits, a * b)
+            VM_CASE2(VM_FDIV, bits, a / b)
+            VM_CASE1(VM_FNEG, bits, -a)
+            VM_CASE2(VM_FMOD, bits, mod(a, b))
+            VM_CASE2(VM_FMIN, bits, min(a, b))
+            VM_CASE2(VM_FMAX, bits, max(a, b))
+            VM_CASE1(VM_FABS, bits, abs(a))
+            VM_CASE1(VM_FSIGN, bits, sign(a))
+            VM_CASE1(VM_FLOOR, bits, floor(a))
+            VM_CASE1(VM_CEIL, bits, ceil(a))
+            VM_CASE1(VM_FRACT, bits, fract(a))
+            VM_CASE1(VM_TRUNC, bits, trunc(a))
+            VM_CASE1(VM_ROUND, bits, round(a))
+            VM_CASE1(VM_SQRT, bits, sqrt(a))
+            VM_CASE1(VM_INVSQRT, bits, inversesqrt(a))
+            VM_CASE1(VM_RADIANS, bits, radians(a))
+            VM_CASE1(VM_DEGREES, bits, degrees(a))
+            VM_CASE1(VM_SIN, bits, sin(a))
+            VM_CASE1(VM_COS, bits, cos(a))
+            VM_CASE1(VM_TAN, bits, tan(a))
+            VM_CASE1(VM_ASIN, bits, asin(a))
+            VM_CASE1(VM_ACOS, bits, acos(a))
+            VM_CASE1(VM_ATAN, bits, atan(a))
+            VM_CASE2(VM_ATAN2, bits, atan(a, b))
+            VM_CASE1(VM_EXP, bits, exp(a))
+            VM_CASE1(VM_LOG, bits, log(a))
+            VM_CASE1(VM_EXP2, bits, exp2(a))
+            VM_CASE1(VM_LOG2, bits, log2(a))
+            VM_CASE2(VM_POW, bits, pow(a, b))
+            VM_CASE2(VM_STEP, bits, step(a, b))
+            VM_CASE3(VM_FCLAMP, bits, clamp(a, b, c))
+            VM_CASE3(VM_MIX, bits, mix(a, b, c))
+            VM_CASE3(VM_SMOOTHSTEP, bits, smoothstep(a, b, c))
+            VM_CASE2(VM_FLT, bits, a < b)
+            VM_CASE2(VM_FLE, bits, a <= b)
+            VM_CASE2(VM_FEQ, bits, eq(a, b))
+
+            VM_CASE2(VM_IADD, asInt, a + b)
+            VM_CASE2(VM_ISUB, asInt, a - b)
+            VM_CASE2(VM_IMUL, asInt, a * b)
+            VM_CASE2(VM_IDIV, asInt, a / b)
+            VM_CASE2(VM_IMOD, asInt, a % b)
+            VM_CASE1(VM_INEG, asInt, -a)
+            VM_CASE1(VM_IABS, asInt, abs(a))
+            VM_CASE1(VM_ISIGN, asInt, sign(a))
+            VM_CASE2(VM_IMIN, asInt, min(a, b))
+            VM_CASE2(VM_IMAX, asInt, max(a, b))
+            VM_CASE3(VM_ICLAMP, asInt, clamp(a, b, c))
+            VM_CASE2(VM_ILT, asInt, a < b)
+            VM_CASE2(VM_ILE, asInt, a <= b)
+            VM_CASE2(VM_IEQ, asInt, eq(a, b))
+
+            VM_CASE1(VM_ITOF, asInt, convert<vfloat>(a))
+            VM_CASE1(VM_FTOI, bits, convert<vint>(a))
+            VM_CASE1(VM_BTOF, asBool, convert<vfloat>(a))
+            VM_CASE1(VM_BTOI, asBool, convert<vint>(a))
+            VM_CASE1(VM_FTOB, bits, convert<vbool>(a))
+            VM_CASE1(VM_ITOB, asInt, convert<vbool>(a))
+
+            VM_CASE2(VM_AND, asBool, a & b)
+            VM_CASE2(VM_OR, asBool, a | b)
+            VM_CASE2(VM_XOR, asBool, a ^ b)
+            VM_CASE1(VM_NOT, asBool, ~a)
+            VM_CASE2(VM_ANDN, asBool, a & ~b)
+
+            case VM_JMP:
+                pc = size_t(in.a);
+                break;
+            case VM_JNONE:
+            {
+                vbool m = asBool(r[in.b].c[0]);
+                for (int k = 1; k < VM_CHUNKS; ++k)
+                    m = m | asBool(r[in.b].c[k]);
+                if (none(m))
+                    pc = size_t(in.a);
+                break;
+            }
+            }
+        }
+    }
+
+#undef VM_CASE1
+#undef VM_CASE2
+#undef VM_CASE3
+
+    void broadcast(Register& reg, const vfloat& value)
+    {
+        for (int k = 0; k < VM_CHUNKS; ++k)
+            reg.c[k] = value;
+    }
+}
+
+    bool compileVm(const Program& program, VmProgram& vm, std::string& error)
+    {
+        try
+        {
+            vm = VmProgram();
+            VmCompiler compiler(program, vm);
+            compiler.run();
+            return true;
+        }
+        catch (const CompileError& failure)
+        {
+            error = failure.message;
+            return false;
+        }
+    }
+
+    void runVm(const VmProgram& vm, const float* uniforms, int x0, int y0, int x1, int y1, int width, unsigned char* rgba)
+    {
+        // operator new only promises 16 byte alignment, AVX registers want more
+        const size_t alignment = sizeof(Register) < 64 ? sizeof(Register) : 64;
+        // one register file per thread, reused from tile to tile
+        thread_local std::vector<unsigned char> storage;
+        storage.resize(vm.registerCount * sizeof(Register) + alignment);
+        Register* r = reinterpret_cast<Register*>((reinterpret_cast<size_t>(storage.data()) + alignment - 1) / alignment * alignment);
+
+        for (const VmConstant& constant : vm.constants)
+            broadcast(r[constant.reg], bits(vint(int(constant.bits))));
+        for (const VmUniform& uniform : vm.uniforms)
+        {
+            const float value = uniforms[uniform.offset];
+            if (uniform.base == TY_FLOAT)
+                broadcast(r[uniform.reg], vfloat(value));
+            else if (uniform.base == TY_INT)
+                broadcast(r[uniform.reg], bits(vint(int(value))));
+            else
+                broadcast(r[uniform.reg], bits(vbool(value != 0.0f)));
+        }
+
+        const vfloat lanes = laneOffsets();
+        const vfloat fill[4] = { vfloat(0.0f), vfloat(0.0f), vfloat(0.0f), vfloat(1.0f) };
+        for (int y = y0; y < y1; ++y)
+        {
+            for (int x = x0; x < x1; x += GLSL_VM_LANES)
+            {
+                const int count = std::min(x1 - x, GLSL_VM_LANES);
+                for (int k = 0; k < VM_CHUNKS; ++k)
+                {
+                    const vfloat position[4] = { vfloat(x + k * LANES + 0.5f) + lanes, vfloat(y + 0.5f), fill[2], fill[3] };
+                    for (size_t i = 0; i < vm.input.size(); ++i)
+                        r[vm.input[i]].c[k] = position[i];
+                    r[vm.execRegister].c[k] = bits(lanesBelow(count - k * LANES));
+                }
+                execute(vm, r);
+                for (int k = 0; k * LANES < count; ++k)
+                {
+                    vec4 colour;
+                    for (int i = 0; i < 4; ++i)
+                        colour.c[i] = i < int(vm.output.size()) ? r[vm.output[i]].c[k] : fill[i];
+                    storePixels(rgba + ((size_t)y * width + x + k * LANES) * 4, std::min(count - k * LANES, LANES), colour);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,155 @@
+#include "myImplement/headless.h"
+
+#include <iostream>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include "GLFW/glfw3.h"
+#endif
+
+HeadlessContext::HeadlessContext()
+    : display(nullptr), surface(nullptr), context(nullptr), window(nullptr)
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    destroy();
+}
+
+#if defined(__linux__)
+
+bool HeadlessContext::create(int major, int minor)
+{
+    // prefer the surfaceless platform, it needs neither X11 nor a DRM device
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (dpy == EGL_NO_DISPLAY)
+        dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint eglMajor, eglMinor;
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &eglMajor, &eglMinor))
+    {
+        std::cout << "ERROR::HEADLESS:: failed to initialize EGL display" << std::endl;
+        return false;
+    }
+    display = dpy;
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cout << "ERROR::HEADLESS:: EGL does not support desktop OpenGL" << std::endl;
+        destroy();
+        return false;
+    }
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config = NULL;
+    EGLint numConfigs = 0;
+    eglChooseConfig(dpy, configAttribs, &config, 1, &numConfigs);
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, major,
+        EGL_CONTEXT_MINOR_VERSION, minor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    context = eglCreateContext(dpy, numConfigs > 0 ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT)
+    {
+        std::cout << "ERROR::HEADLESS:: failed to create EGL context: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+        context = nullptr;
+        destroy();
+        return false;
+    }
+
+    // surfaceless first, a 1x1 pbuffer if the driver insists on a surface
+    if (!eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, (EGLContext)context))
+    {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        if (numConfigs > 0)
+            surface = eglCreatePbufferSurface(dpy, config, pbufferAttribs);
+        if (!surface || surface == EGL_NO_SURFACE || !eglMakeCurrent(dpy, surface, surface, (EGLContext)context))
+        {
+            std::cout << "ERROR::HEADLESS:: failed to make EGL context current" << std::endl;
+            destroy();
+            return false;
+        }
+    }
+    return true;
+}
+
+void HeadlessContext::destroy()
+{
+    if (!display)
+        return;
+    eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface && surface != EGL_NO_SURFACE)
+        eglDestroySurface((EGLDisplay)display, (EGLSurface)surface);
+    if (context)
+        eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+    eglTerminate((EGLDisplay)display);
+    display = surface = context = nullptr;
+}
+
+void HeadlessContext::makeCurrent()
+{
+    if (display)
+        eglMakeCurrent((EGLDisplay)display, (EGLSurface)surface, (EGLSurface)surface, (EGLContext)context);
+}
+
+GLADloadproc HeadlessContext::getProcLoader()
+{
+    return (GLADloadproc)eglGetProcAddress;
+}
+
+#else
+
+bool HeadlessContext::create(int major, int minor)
+{
+    if (!glfwInit())
+        return false;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    window = glfwCreateWindow(1, 1, "headless", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "ERROR::HEADLESS:: failed to create hidden GLFW window" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+    glfwMakeContextCurrent((GLFWwindow*)window);
+    return true;
+}
+
+void HeadlessContext::destroy()
+{
+    if (!window)
+        return;
+    glfwDestroyWindow((GLFWwindow*)window);
+    glfwTerminate();
+    window = nullptr;
+}
+
+void HeadlessContext::makeCurrent()
+{
+    if (window)
+        glfwMakeContextCurrent((GLFWwindow*)window);
+}
+
+GLADloadproc HeadlessContext::getProcLoader()
+{
+    return (GLADloadproc)glfwGetProcAddress;
+}
+
+#endif
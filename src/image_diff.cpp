@@ -0,0 +1,257 @@
+#include "myImplement/image_diff.h"
+#include "myImplement/image_io.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    const int WINDOW = 8;
+    // the usual SSIM stabilisers for 8 bit values, (0.01 * 255)^2 and (0.03 * 255)^2
+    const double C1 = 6.5025;
+    const double C2 = 58.5225;
+
+    // integer sums over one 8x8 window, the frame's luma is x, the golden's y
+    struct WindowSums
+    {
+        long long x, y, xx, yy, xy;
+        long long squared;  // squared R, G and B differences
+        int maxError;
+    };
+
+    // BT.601 full range in 8 bit fixed point
+    inline int lumaOf(const unsigned char* p)
+    {
+        return (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+    }
+
+    // squared differences of one pixel, 'peak' keeps the largest channel difference
+    inline int squaredError(const unsigned char* a, const unsigned char* b, int& peak)
+    {
+        int sum = 0;
+        for (int c = 0; c < 3; ++c)
+        {
+            const int d = a[c] - b[c];
+            sum += d * d;
+            peak = std::max(peak, std::abs(d));
+        }
+        return sum;
+    }
+
+    float ssimOf(const WindowSums& sums)
+    {
+        const double n = WINDOW * WINDOW;
+        const double mx = sums.x / n;
+        const double my = sums.y / n;
+        const double vx = sums.xx / n - mx * mx;
+        const double vy = sums.yy / n - my * my;
+        const double cxy = sums.xy / n - mx * my;
+        return float(((2.0 * mx * my + C1) * (2.0 * cxy + C2)) / ((mx * mx + my * my + C1) * (vx + vy + C2)));
+    }
+
+    float psnrOf(double mse)
+    {
+        return mse > 0.0 ? std::min(99.0f, float(10.0 * std::log10(255.0 * 255.0 / mse))) : 99.0f;
+    }
+
+#if defined(__GNUC__)
+    // a window row at a time, one pixel per 32 bit lane. per lane the sums
+    // of 8 rows stay below 2^21, int32 does not overflow
+    typedef uint32_t pixel8 __attribute__((vector_size(32)));
+    typedef int32_t int8v __attribute__((vector_size(32)));
+
+    // vectors go by reference, by value their ABI depends on -mavx
+    inline void splitChannels(const pixel8& p, int8v& r, int8v& g, int8v& b)
+    {
+        r = (int8v)(p & 0xffu);
+        g = (int8v)((p >> 8) & 0xffu);
+        b = (int8v)((p >> 16) & 0xffu);
+    }
+
+    inline void keepLarger(int8v& peak, const int8v& value)
+    {
+        const int8v larger = value > peak;
+        peak = (value & larger) | (peak & ~larger);
+    }
+
+    void windowSums(const unsigned char* a, const unsigned char* b, size_t stride, WindowSums& sums)
+    {
+        int8v sx = {}, sy = {}, sxx = {}, syy = {}, sxy = {}, squared = {}, peak = {};
+        for (int row = 0; row < WINDOW; ++row)
+        {
+            pixel8 pa, pb;
+            memcpy(&pa, a + stride * row, sizeof(pa));
+            memcpy(&pb, b + stride * row, sizeof(pb));
+            int8v ra, ga, ba, rb, gb, bb;
+            splitChannels(pa, ra, ga, ba);
+            splitChannels(pb, rb, gb, bb);
+            const int8v x = (77 * ra + 150 * ga + 29 * ba + 128) >> 8;
+            const int8v y = (77 * rb + 150 * gb + 29 * bb + 128) >> 8;
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            syy += y * y;
+            sxy += x * y;
+            const int8v dr = (ra - rb) * (ra - rb);
+            const int8v dg = (ga - gb) * (ga - gb);
+            const int8v db = (ba - bb) * (ba - bb);
+            squared += dr + dg + db;
+            keepLarger(peak, dr);
+            keepLarger(peak, dg);
+            keepLarger(peak, db);
+        }
+        sums = WindowSums();
+        int peakSquared = 0;
+        for (int i = 0; i < WINDOW; ++i)
+        {
+            sums.x += sx[i];
+            sums.y += sy[i];
+            sums.xx += sxx[i];
+            sums.yy += syy[i];
+            sums.xy += sxy[i];
+            sums.squared += squared[i];
+            peakSquared = std::max(peakSquared, int(peak[i]));
+        }
+        sums.maxError = int(std::sqrt(double(peakSquared)) + 0.5);
+    }
+#else
+    void windowSums(const unsigned char* a, const unsigned char* b, size_t stride, WindowSums& sums)
+    {
+        sums = WindowSums();
+        for (int row = 0; row < WINDOW; ++row)
+        {
+            for (int i = 0; i < WINDOW; ++i)
+            {
+                const unsigned char* pa = a + stride * row + i * 4;
+                const unsigned char* pb = b + stride * row + i * 4;
+                const int x = lumaOf(pa);
+                const int y = lumaOf(pb);
+                sums.x += x;
+                sums.y += y;
+                sums.xx += x * x;
+                sums.yy += y * y;
+                sums.xy += x * y;
+                sums.squared += squaredError(pa, pb, sums.maxError);
+            }
+        }
+    }
+#endif
+
+    struct TileSums
+    {
+        long long squared;
+        long long pixels;
+        double ssim;
+        int windows;
+    };
+}
+
+const TileError* ImageDiff::worstTile() const
+{
+    const TileError* worst = nullptr;
+    for (const TileError& tile : tiles)
+    {
+        if (!worst || tile.ssim < worst->ssim || (tile.ssim == worst->ssim && tile.mse > worst->mse))
+            worst = &tile;
+    }
+    return worst;
+}
+
+std::string ImageDiff::summary() const
+{
+    char text[200];
+    const TileError* worst = worstTile();
+    if (!worst)
+        return "empty image";
+    snprintf(text, sizeof(text), "PSNR %.2f dB, SSIM %.5f, max error %d, worst tile (%d, %d): PSNR %.2f dB, SSIM %.4f",
+             psnr, ssim, maxError, worst->x, worst->y, worst->psnr, worst->ssim);
+    return text;
+}
+
+ImageDiff diffImages(const unsigned char* rgba, const unsigned char* golden, int width, int height, int tileSize)
+{
+    ImageDiff diff;
+    if (width <= 0 || height <= 0)
+        return diff;
+    diff.width = width;
+    diff.height = height;
+    diff.tileSize = std::max(WINDOW, (tileSize + WINDOW - 1) / WINDOW * WINDOW);
+    diff.tilesX = (width + diff.tileSize - 1) / diff.tileSize;
+    diff.tilesY = (height + diff.tileSize - 1) / diff.tileSize;
+    std::vector<TileSums> tiles(size_t(diff.tilesX) * diff.tilesY, TileSums());
+    const size_t stride = size_t(width) * 4;
+
+    const int windowsX = width / WINDOW;
+    const int windowsY = height / WINDOW;
+    double ssimSum = 0.0;
+    for (int wy = 0; wy < windowsY; ++wy)
+    {
+        for (int wx = 0; wx < windowsX; ++wx)
+        {
+            const size_t offset = stride * wy * WINDOW + size_t(wx) * WINDOW * 4;
+            WindowSums sums;
+            windowSums(rgba + offset, golden + offset, stride, sums);
+            const float ssim = ssimOf(sums);
+            TileSums& tile = tiles[size_t(wy * WINDOW / diff.tileSize) * diff.tilesX + wx * WINDOW / diff.tileSize];
+            tile.squared += sums.squared;
+            tile.pixels += WINDOW * WINDOW;
+            tile.ssim += ssim;
+            ++tile.windows;
+            ssimSum += ssim;
+            diff.maxError = std::max(diff.maxError, sums.maxError);
+        }
+    }
+    // the columns right of the last whole window and the rows above it
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = y < windowsY * WINDOW ? windowsX * WINDOW : 0; x < width; ++x)
+        {
+            const size_t offset = stride * y + size_t(x) * 4;
+            TileSums& tile = tiles[size_t(y / diff.tileSize) * diff.tilesX + x / diff.tileSize];
+            tile.squared += squaredError(rgba + offset, golden + offset, diff.maxError);
+            ++tile.pixels;
+        }
+    }
+
+    long long squared = 0;
+    diff.tiles.resize(tiles.size());
+    for (size_t i = 0; i < tiles.size(); ++i)
+    {
+        TileError& tile = diff.tiles[i];
+        tile.x = int(i % diff.tilesX);
+        tile.y = int(i / diff.tilesX);
+        tile.mse = tiles[i].pixels ? double(tiles[i].squared) / double(tiles[i].pixels * 3) : 0.0;
+        tile.psnr = psnrOf(tile.mse);
+        tile.ssim = tiles[i].windows ? float(tiles[i].ssim / tiles[i].windows) : 1.0f;
+        squared += tiles[i].squared;
+    }
+    diff.mse = double(squared) / (double(width) * height * 3.0);
+    diff.psnr = psnrOf(diff.mse);
+    diff.ssim = windowsX * windowsY > 0 ? float(ssimSum / (double(windowsX) * windowsY)) : 1.0f;
+    return diff;
+}
+
+bool writeErrorMap(const std::string& filePath, const ImageDiff& diff, const unsigned char* rgba, const unsigned char* golden)
+{
+    if (diff.tiles.empty())
+        return false;
+    std::vector<unsigned char> map(size_t(diff.width) * diff.height * 3);
+    for (int y = 0; y < diff.height; ++y)
+    {
+        for (int x = 0; x < diff.width; ++x)
+        {
+            const size_t pixel = size_t(y) * diff.width + x;
+            const TileError& tile = diff.tiles[size_t(y / diff.tileSize) * diff.tilesX + x / diff.tileSize];
+            int peak = 0;
+            squaredError(rgba + pixel * 4, golden + pixel * 4, peak);
+            map[pixel * 3] = (unsigned char)std::min(255.0f, std::max(0.0f, (1.0f - tile.ssim) * 2550.0f));
+            map[pixel * 3 + 1] = (unsigned char)std::min(255, peak * 8);
+            map[pixel * 3 + 2] = (unsigned char)(lumaOf(golden + pixel * 4) / 3);
+        }
+    }
+    return writePPM(filePath, diff.width, diff.height, 3, map.data());
+}
@@ -0,0 +1,126 @@
+#include "myImplement/image_io.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <direct.h>
+#endif
+
+bool writePPM(const std::string& filePath, int width, int height, int channels, const unsigned char* pixels, bool flipY)
+{
+    FILE* file = fopen(filePath.c_str(), "wb");
+    if (!file)
+    {
+        std::cerr << "failed to open for writing: " << filePath << std::endl;
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> row(size_t(width) * 3);
+    for (int y = 0; y < height; ++y)
+    {
+        int srcY = flipY ? height - 1 - y : y;
+        const unsigned char* src = pixels + size_t(srcY) * width * channels;
+        for (int x = 0; x < width; ++x)
+        {
+            row[x * 3 + 0] = src[x * channels + 0];
+            row[x * 3 + 1] = src[x * channels + 1];
+            row[x * 3 + 2] = src[x * channels + 2];
+        }
+        fwrite(row.data(), 1, row.size(), file);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+// skip whitespace and '#' comments between PPM header fields
+static int readHeaderInt(FILE* file)
+{
+    int c = fgetc(file);
+    while (c == '#' || c == ' ' || c == '\n' || c == '\r' || c == '\t')
+    {
+        if (c == '#')
+            while (c != '\n' && c != EOF)
+                c = fgetc(file);
+        c = fgetc(file);
+    }
+    int value = 0;
+    while (c >= '0' && c <= '9')
+    {
+        value = value * 10 + (c - '0');
+        c = fgetc(file);
+    }
+    return value;
+}
+
+bool readPPM(const std::string& filePath, int& width, int& height, std::vector<unsigned char>& pixels)
+{
+    FILE* file = fopen(filePath.c_str(), "rb");
+    if (!file)
+        return false;
+    char magic[2] = { 0, 0 };
+    if (fread(magic, 1, 2, file) != 2 || magic[0] != 'P' || magic[1] != '6')
+    {
+        std::cerr << "not a binary PPM: " << filePath << std::endl;
+        fclose(file);
+        return false;
+    }
+    // the single whitespace after maxval is consumed by readHeaderInt
+    width = readHeaderInt(file);
+    height = readHeaderInt(file);
+    int maxValue = readHeaderInt(file);
+    if (width <= 0 || height <= 0 || maxValue != 255)
+    {
+        std::cerr << "unsupported PPM: " << filePath << std::endl;
+        fclose(file);
+        return false;
+    }
+    std::vector<unsigned char> rgb(size_t(width) * height * 3);
+    bool ok = fread(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    fclose(file);
+    if (!ok)
+        return false;
+    pixels.resize(size_t(width) * height * 4);
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char* src = rgb.data() + size_t(height - 1 - y) * width * 3;
+        unsigned char* dst = pixels.data() + size_t(y) * width * 4;
+        for (int x = 0; x < width; ++x)
+        {
+            dst[x * 4 + 0] = src[x * 3 + 0];
+            dst[x * 4 + 1] = src[x * 3 + 1];
+            dst[x * 4 + 2] = src[x * 3 + 2];
+            dst[x * 4 + 3] = 255;
+        }
+    }
+    return true;
+}
+
+bool ensureDirectory(const std::string& dirPath)
+{
+    struct stat info;
+    if (stat(dirPath.c_str(), &info) == 0)
+        return (info.st_mode & S_IFDIR) != 0;
+    // the parents first, "../output" for "../output/farm"
+    const size_t slash = dirPath.find_last_of("/\\");
+    if (slash != std::string::npos && slash > 0)
+    {
+        const std::string parent = dirPath.substr(0, slash);
+        if (parent != ".." && parent != "." && !ensureDirectory(parent))
+            return false;
+    }
+#if defined(_WIN32)
+    return _mkdir(dirPath.c_str()) == 0 || errno == EEXIST;
+#else
+    return mkdir(dirPath.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+std::string framePath(const std::string& dirPath, const std::string& prefix, int frameIndex, const char* ext)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%05d.%s", frameIndex, ext);
+    return dirPath + "/" + prefix + name;
+}
@@ -0,0 +1,193 @@
+#include "myImplement/input_record.h"
+
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+    const char LOG_MAGIC[8] = { 'S', 'T', 'O', 'Y', 'I', 'N', 'P', 'T' };
+    const unsigned int LOG_VERSION = 1;
+
+    struct LogHeader
+    {
+        char magic[8];
+        unsigned int version;
+        int width, height;
+        float date[4];   // iDate when the log started
+    };
+
+    // record tags, an event's tag is its InputEventType
+    const unsigned char TAG_FRAME = 0;
+    // f64 time + u32 keys, f32 x + f32 y; a key goes in x's place
+    const size_t FRAME_SIZE = 12;
+    const size_t EVENT_SIZE = 8;
+
+    template <typename T>
+    void read(const char* data, T& value)
+    {
+        memcpy(&value, data, sizeof(value));
+    }
+}
+
+InputRecorder::InputRecorder()
+    : frames(0)
+{
+}
+
+bool InputRecorder::open(const std::string& filePath, int width, int height, const glm::vec4& date)
+{
+    close();
+    file.open(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "ERROR::INPUT_RECORD:: cannot write " << filePath << std::endl;
+        return false;
+    }
+    path = filePath;
+    frames = 0;
+    LogHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LOG_MAGIC, sizeof(LOG_MAGIC));
+    header.version = LOG_VERSION;
+    header.width = width;
+    header.height = height;
+    for (int i = 0; i < 4; ++i)
+        header.date[i] = date[i];
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    return bool(file);
+}
+
+void InputRecorder::frame(double time, unsigned int keys)
+{
+    if (!file.is_open())
+        return;
+    char record[1 + FRAME_SIZE];
+    record[0] = char(TAG_FRAME);
+    memcpy(record + 1, &time, sizeof(time));
+    memcpy(record + 1 + sizeof(time), &keys, sizeof(keys));
+    file.write(record, sizeof(record));
+    ++frames;
+}
+
+void InputRecorder::writeEvent(InputEventType type, float x, float y)
+{
+    if (!file.is_open())
+        return;
+    char record[1 + EVENT_SIZE];
+    record[0] = char(type);
+    memcpy(record + 1, &x, sizeof(x));
+    memcpy(record + 1 + sizeof(x), &y, sizeof(y));
+    file.write(record, sizeof(record));
+}
+
+void InputRecorder::mouse(double x, double y)
+{
+    writeEvent(INPUT_MOUSE, float(x), float(y));
+}
+
+void InputRecorder::scroll(double x, double y)
+{
+    writeEvent(INPUT_SCROLL, float(x), float(y));
+}
+
+void InputRecorder::key(int key)
+{
+    float bits;
+    memcpy(&bits, &key, sizeof(bits));
+    writeEvent(INPUT_KEY, bits, 0.0f);
+}
+
+bool InputRecorder::close()
+{
+    if (!file.is_open())
+        return true;
+    file.close();
+    if (!file)
+    {
+        std::cout << "ERROR::INPUT_RECORD:: cannot write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+InputReplay::InputReplay()
+    : cursor(0), width(0), height(0), date(0.0f)
+{
+}
+
+bool InputReplay::open(const std::string& filePath)
+{
+    frames.clear();
+    cursor = 0;
+    std::ifstream file(filePath, std::ios::in | std::ios::binary);
+    if (!file)
+    {
+        std::cout << "ERROR::INPUT_REPLAY:: cannot read " << filePath << std::endl;
+        return false;
+    }
+    const std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    LogHeader header;
+    if (data.size() < sizeof(header))
+    {
+        std::cout << "ERROR::INPUT_REPLAY:: " << filePath << " is not an input log" << std::endl;
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (memcmp(header.magic, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0 || header.version != LOG_VERSION)
+    {
+        std::cout << "ERROR::INPUT_REPLAY:: " << filePath << " is not an input log of version " << LOG_VERSION << std::endl;
+        return false;
+    }
+    width = header.width;
+    height = header.height;
+    date = glm::vec4(header.date[0], header.date[1], header.date[2], header.date[3]);
+
+    // events gather until the frame record they precede
+    InputFrame pending;
+    size_t offset = sizeof(header);
+    while (offset < data.size())
+    {
+        const unsigned char tag = (unsigned char)data[offset++];
+        if (tag == TAG_FRAME)
+        {
+            if (offset + FRAME_SIZE > data.size())
+                break;
+            read(&data[offset], pending.time);
+            read(&data[offset + sizeof(pending.time)], pending.keys);
+            offset += FRAME_SIZE;
+            frames.push_back(std::move(pending));
+            pending = InputFrame();
+            continue;
+        }
+        if (tag < INPUT_MOUSE || tag > INPUT_KEY)
+        {
+            std::cout << "ERROR::INPUT_REPLAY:: unknown record " << int(tag) << " in " << filePath
+                      << ", replaying the " << frames.size() << " frames before it" << std::endl;
+            break;
+        }
+        if (offset + EVENT_SIZE > data.size())
+            break;
+        InputEvent event;
+        event.type = InputEventType(tag);
+        read(&data[offset], event.x);
+        read(&data[offset + sizeof(event.x)], event.y);
+        read(&data[offset], event.key);
+        offset += EVENT_SIZE;
+        pending.events.push_back(event);
+    }
+    if (frames.empty())
+    {
+        std::cout << "ERROR::INPUT_REPLAY:: " << filePath << " holds no frames" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool InputReplay::next(InputFrame& frame)
+{
+    if (cursor >= frames.size())
+        return false;
+    frame = frames[cursor++];
+    return true;
+}
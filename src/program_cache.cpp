@@ -0,0 +1,225 @@
+#include "myImplement/program_cache.h"
+#include "myImplement/image_io.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace
+{
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+    // one set per process, every context here comes from the same driver
+    GetProgramBinaryProc getProgramBinary = nullptr;
+    ProgramBinaryProc programBinary = nullptr;
+    ProgramParameteriProc programParameteri = nullptr;
+
+    const char ENTRY_MAGIC[8] = { 'S', 'T', 'O', 'Y', 'P', 'R', 'O', 'G' };
+    const unsigned int ENTRY_VERSION = 1;
+
+    struct EntryHeader
+    {
+        char magic[8];
+        unsigned int version;
+        unsigned int format;           // the driver's binary format
+        unsigned long long driverHash; // vendor, renderer and version that wrote it
+        unsigned long long sourceHash;
+        unsigned long long length;     // bytes of binary after the header
+        double compileMs;              // what building it from source cost
+    };
+
+    // FNV-1a, only used to name cache entries
+    unsigned long long hashText(const std::string& text, unsigned long long hash = 1469598103934665603ULL)
+    {
+        for (unsigned char c : text)
+        {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    std::string glString(GLenum name)
+    {
+        const GLubyte* text = glGetString(name);
+        return text ? reinterpret_cast<const char*>(text) : "";
+    }
+
+    // move 'from' over 'to'; rename() on Windows fails if 'to' exists, so a
+    // rebuilt program could never replace its entry there
+    bool replaceFile(const std::string& from, const std::string& to)
+    {
+#if defined(_WIN32)
+        remove(to.c_str());
+#endif
+        return rename(from.c_str(), to.c_str()) == 0;
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+std::string ProgramCacheStats::summary() const
+{
+    const int lookups = hits + misses;
+    char text[200];
+    snprintf(text, sizeof(text), "%d/%d hits (%.0f%%), %d rejected, %d stored, load %.1f ms, compile %.1f ms, saved %.1f ms",
+             hits, lookups, lookups ? 100.0 * hits / lookups : 0.0, rejected, stored, loadMs, compileMs, savedMs);
+    return text;
+}
+
+ProgramCache::ProgramCache()
+    : driverHash(0), enabled(false)
+{
+}
+
+bool ProgramCache::open(const std::string& directory, GLADloadproc loader)
+{
+    enabled = false;
+    getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(loader("glGetProgramBinary"));
+    programBinary = reinterpret_cast<ProgramBinaryProc>(loader("glProgramBinary"));
+    programParameteri = reinterpret_cast<ProgramParameteriProc>(loader("glProgramParameteri"));
+    while (glGetError() != GL_NO_ERROR)
+        ;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    // a driver without program binaries does not know the enum
+    if (glGetError() != GL_NO_ERROR)
+        formats = 0;
+    if (!getProgramBinary || !programBinary || !programParameteri || formats <= 0)
+    {
+        std::cout << "ERROR::PROGRAM_CACHE:: the driver has no program binaries, shaders are built from source" << std::endl;
+        return false;
+    }
+    if (!ensureDirectory(directory))
+    {
+        std::cout << "ERROR::PROGRAM_CACHE:: cannot create " << directory << std::endl;
+        return false;
+    }
+    this->directory = directory;
+    driverHash = hashText(glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION));
+    enabled = true;
+    return true;
+}
+
+std::string ProgramCache::entryPath(unsigned long long sourceHash) const
+{
+    char name[40];
+    snprintf(name, sizeof(name), "program_%016llx.bin", sourceHash);
+    return directory + "/" + name;
+}
+
+unsigned long long ProgramCache::hashSources(const std::string& vertexCode, const std::string& fragmentCode)
+{
+    // the separator keeps "ab" + "c" apart from "a" + "bc"
+    return hashText(fragmentCode, hashText(std::string(1, '\0'), hashText(vertexCode)));
+}
+
+GLuint ProgramCache::load(unsigned long long sourceHash)
+{
+    if (!enabled)
+        return 0;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::ifstream file(entryPath(sourceHash), std::ios::in | std::ios::binary);
+    EntryHeader header;
+    if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        ++stats.misses;
+        return 0;
+    }
+    // another driver's binary is never handed to this one, the compile overwrites it
+    if (memcmp(header.magic, ENTRY_MAGIC, sizeof(ENTRY_MAGIC)) != 0 || header.version != ENTRY_VERSION ||
+        header.driverHash != driverHash || header.sourceHash != sourceHash || header.length == 0)
+    {
+        ++stats.rejected;
+        ++stats.misses;
+        return 0;
+    }
+    std::vector<char> binary(size_t(header.length));
+    if (!file.read(binary.data(), std::streamsize(binary.size())))
+    {
+        ++stats.rejected;
+        ++stats.misses;
+        return 0;
+    }
+
+    const GLuint program = glCreateProgram();
+    programBinary(program, GLenum(header.format), binary.data(), GLsizei(binary.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        glDeleteProgram(program);
+        while (glGetError() != GL_NO_ERROR)
+            ;
+        ++stats.rejected;
+        ++stats.misses;
+        return 0;
+    }
+    const double ms = millisecondsSince(start);
+    ++stats.hits;
+    stats.loadMs += ms;
+    stats.savedMs += header.compileMs - ms;
+    return program;
+}
+
+void ProgramCache::prepare(GLuint program) const
+{
+    if (enabled)
+        programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache::store(GLuint program, unsigned long long sourceHash, double compileMs)
+{
+    if (!enabled)
+        return;
+    stats.compileMs += compileMs;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    std::vector<char> binary = std::vector<char>(size_t(length));
+    GLenum format = 0;
+    GLsizei written = 0;
+    getProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0)
+        return;
+
+    EntryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+    header.version = ENTRY_VERSION;
+    header.format = format;
+    header.driverHash = driverHash;
+    header.sourceHash = sourceHash;
+    header.length = (unsigned long long)written;
+    header.compileMs = compileMs;
+
+    // write next to the final name and rename, so a half written entry is never loaded
+    const std::string path = entryPath(sourceHash);
+    const std::string tempPath = path + ".tmp";
+    std::ofstream file(tempPath, std::ios::out | std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), written);
+    file.close();
+    if (!file || !replaceFile(tempPath, path))
+    {
+        std::cout << "ERROR::PROGRAM_CACHE:: cannot write " << path << std::endl;
+        remove(tempPath.c_str());
+        return;
+    }
+    ++stats.stored;
+}
@@ -0,0 +1,130 @@
+#include "myImplement/quality_controller.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+std::string QualityControlStats::summary() const
+{
+    char text[160];
+    snprintf(text, sizeof(text), "%d of %d frames over budget, %d tier drops, %d tier raises (%d held back), %d scale changes",
+             overBudget, frames, tierDowns, tierUps, heldBack, scaleChanges);
+    return text;
+}
+
+QualityController::QualityController(float targetMs, int tierCount, int tier, float hysteresis, int dwell)
+    : targetMs(std::max(targetMs, 0.1f)), hysteresis(std::max(hysteresis, 0.0f)), dwell(std::max(dwell, 1)),
+      tierCount(std::max(tierCount, 1)), tier(std::min(std::max(tier, 0), this->tierCount - 1)), frame(0), cpuMs(0.0f),
+      lastScale(-1.0f), overFrames(0), underFrames(0), settleFrames(0), prewarm(-1), cooldownTier(-1),
+      cooldownUntil(0), cooldownFrames(this->dwell * 8)
+{
+}
+
+bool QualityController::setLog(const std::string& path)
+{
+    log.open(path, std::ios::out | std::ios::app);
+    if (!log)
+        return false;
+    if (log.tellp() == 0)
+        log << "time,frame,gpu_ms,cpu_ms,cost_ms,target_ms,scale,decision,reason\n";
+    return true;
+}
+
+void QualityController::decide(float time, float gpuMs, float cost, float scale, const std::string& what, const std::string& reason)
+{
+    char text[256];
+    snprintf(text, sizeof(text), "quality control: frame %d, %.2f ms (gpu %.2f, cpu %.2f) at scale %.2f: %s, %s",
+             frame, cost, gpuMs, cpuMs, scale, what.c_str(), reason.c_str());
+    std::cout << text << std::endl;
+    if (log)
+    {
+        snprintf(text, sizeof(text), "%.3f,%d,%.3f,%.3f,%.3f,%.3f,%.3f,", time, frame, gpuMs, cpuMs, cost, targetMs, scale);
+        log << text << what << "," << reason << std::endl;
+    }
+}
+
+void QualityController::setTier(float time, int tier)
+{
+    tier = std::min(std::max(tier, 0), tierCount - 1);
+    if (tier == this->tier)
+        return;
+    decide(time, 0.0f, cpuMs, lastScale, "tier " + std::to_string(this->tier) + " -> " + std::to_string(tier), "selected by hand");
+    this->tier = tier;
+    overFrames = 0;
+    underFrames = 0;
+    prewarm = -1;
+    // a tier picked by hand is not held back
+    cooldownTier = -1;
+    settleFrames = dwell;
+}
+
+bool QualityController::submit(float time, float gpuMs, float frameCpuMs, float scale, float minScale, float maxScale)
+{
+    ++frame;
+    ++stats.frames;
+    cpuMs = cpuMs > 0.0f ? cpuMs * 0.9f + frameCpuMs * 0.1f : frameCpuMs;
+    if (lastScale >= 0.0f && scale != lastScale)
+    {
+        ++stats.scaleChanges;
+        char what[64];
+        snprintf(what, sizeof(what), "scale %.2f -> %.2f", lastScale, scale);
+        decide(time, gpuMs, std::max(gpuMs, cpuMs), scale, what, scale < lastScale ? "over budget" : "under budget");
+    }
+    lastScale = scale;
+    // the new program's first frames pay for its first use, and the GPU
+    // time still describes the old one until it has been measured again
+    if (settleFrames > 0 || gpuMs <= 0.0f)
+    {
+        settleFrames = std::max(settleFrames - 1, 0);
+        return false;
+    }
+
+    const float cost = std::max(gpuMs, cpuMs);
+    const bool over = cost > targetMs * (1.0f + hysteresis);
+    const bool under = cost < targetMs * (1.0f - hysteresis);
+    stats.overBudget += over ? 1 : 0;
+    // the scale goes first, the tier only moves once the scale cannot;
+    // far over budget the tier does not wait for the scale to get there
+    const bool atMin = scale <= minScale + 0.01f;
+    const bool atMax = scale >= maxScale - 0.01f;
+    overFrames = over && tier > 0 && (atMin || cost > targetMs * 1.5f) ? overFrames + 1 : 0;
+    underFrames = under && atMax && tier + 1 < tierCount ? underFrames + 1 : 0;
+
+    if (underFrames > 0 && tier + 1 == cooldownTier && frame < cooldownUntil)
+    {
+        // counted once per stretch of spare time, not every frame
+        if (underFrames == dwell)
+            ++stats.heldBack;
+        underFrames = std::min(underFrames, dwell);
+        return false;
+    }
+    prewarm = underFrames >= dwell / 2 ? tier + 1 : -1;
+
+    const int from = tier;
+    if (overFrames >= dwell)
+    {
+        --tier;
+        ++stats.tierDowns;
+        // leaving the same tier again soon after means it is not sustainable,
+        // wait twice as long before the next try
+        cooldownFrames = cooldownTier == from && frame < cooldownUntil + cooldownFrames ? cooldownFrames * 2 : dwell * 8;
+        cooldownTier = from;
+        cooldownUntil = frame + cooldownFrames;
+        decide(time, gpuMs, cost, scale, "tier " + std::to_string(from) + " -> " + std::to_string(tier),
+               atMin ? "over budget at the minimum scale" : "far over budget");
+    }
+    else if (underFrames >= dwell * 2)
+    {
+        ++tier;
+        ++stats.tierUps;
+        decide(time, gpuMs, cost, scale, "tier " + std::to_string(from) + " -> " + std::to_string(tier),
+               "under budget at the maximum scale");
+    }
+    else
+        return false;
+    overFrames = 0;
+    underFrames = 0;
+    prewarm = -1;
+    settleFrames = dwell;
+    return true;
+}
@@ -0,0 +1,871 @@
+#include "myImplement/render_farm.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+std::vector<FarmJob> splitFrames(int frameBeg, int frameEnd, int width, int height, int tileWidth, int tileHeight)
+{
+    if (tileWidth <= 0 || tileWidth > width)
+        tileWidth = width;
+    if (tileHeight <= 0 || tileHeight > height)
+        tileHeight = height;
+    std::vector<FarmJob> jobs;
+    for (int frame = frameBeg; frame < frameEnd; ++frame)
+    {
+        for (int y = 0; y < height; y += tileHeight)
+        {
+            for (int x = 0; x < width; x += tileWidth)
+            {
+                FarmJob job;
+                job.frame = frame;
+                job.x = x;
+                job.y = y;
+                job.width = std::min(tileWidth, width - x);
+                job.height = std::min(tileHeight, height - y);
+                jobs.push_back(job);
+            }
+        }
+    }
+    return jobs;
+}
+
+std::string FarmStats::summary() const
+{
+    char text[200];
+    snprintf(text, sizeof(text), "%d frames (%d jobs) in %.2f s, %.2f frames/s, %d steals, %d retries, %d workers lost, at most %d frames held, jobs per worker",
+             frames, jobs, seconds, seconds > 0.0 ? frames / seconds : 0.0, steals, retries, workersLost, peakFrames);
+    std::string line = text;
+    for (size_t i = 0; i < jobsPerWorker.size(); ++i)
+        line += (i ? "/" : " ") + std::to_string(jobsPerWorker[i]);
+    return line;
+}
+
+#if !defined(_WIN32)
+
+namespace
+{
+    const char FARM_MAGIC[8] = { 'S', 'T', 'O', 'Y', 'F', 'A', 'R', 'M' };
+    const uint32_t FARM_VERSION = 1;
+
+    // every message is a u32 type and a u32 body length, then the body.
+    // numbers go in network byte order, pixels as they are
+    enum MessageType
+    {
+        MSG_HELLO = 1,  // coordinator: magic, version and the FarmSetup
+        MSG_READY,      // worker: built or not, its source hash, its renderer or error
+        MSG_JOB,        // coordinator: job id, frame, x, y, width, height
+        MSG_RESULT,     // worker: job id, then width x height RGBA8
+        MSG_FAILED,     // worker: job id and why
+        MSG_BYE         // coordinator: no more jobs
+    };
+    const size_t HEADER_SIZE = 8;
+    const uint32_t MAX_BODY = 1u << 30;
+
+    class Packet
+    {
+    public:
+        std::vector<unsigned char> data;
+
+        void putU32(uint32_t value)
+        {
+            value = htonl(value);
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+            data.insert(data.end(), bytes, bytes + 4);
+        }
+        void putI32(int value) { putU32(uint32_t(value)); }
+        void putU64(uint64_t value)
+        {
+            putU32(uint32_t(value >> 32));
+            putU32(uint32_t(value));
+        }
+        void putFloat(float value)
+        {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            putU32(bits);
+        }
+        void putString(const std::string& text)
+        {
+            putU32(uint32_t(text.size()));
+            data.insert(data.end(), text.begin(), text.end());
+        }
+    };
+
+    // reads a body back, 'ok' goes false on the first read past its end
+    class Reader
+    {
+    private:
+        const unsigned char* data;
+        size_t size;
+        size_t offset;
+
+    public:
+        bool ok;
+
+        Reader(const unsigned char* body, size_t bodySize) : data(body), size(bodySize), offset(0), ok(true) {}
+
+        uint32_t getU32()
+        {
+            uint32_t value = 0;
+            if (offset + 4 > size)
+            {
+                ok = false;
+                return 0;
+            }
+            memcpy(&value, data + offset, 4);
+            offset += 4;
+            return ntohl(value);
+        }
+        int getI32() { return int(getU32()); }
+        uint64_t getU64()
+        {
+            const uint64_t high = getU32();
+            return (high << 32) | getU32();
+        }
+        float getFloat()
+        {
+            const uint32_t bits = getU32();
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+        std::string getString()
+        {
+            const uint32_t length = getU32();
+            if (!ok || offset + length > size)
+            {
+                ok = false;
+                return "";
+            }
+            offset += length;
+            return std::string(reinterpret_cast<const char*>(data + offset - length), length);
+        }
+        const unsigned char* rest(size_t& length) const
+        {
+            length = size - offset;
+            return data + offset;
+        }
+    };
+
+    bool sendAll(int fd, const void* data, size_t size)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0)
+        {
+            const ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR)
+                continue;
+            if (sent <= 0)
+                return false;
+            bytes += sent;
+            size -= size_t(sent);
+        }
+        return true;
+    }
+
+    bool recvAll(int fd, void* data, size_t size)
+    {
+        char* bytes = static_cast<char*>(data);
+        while (size > 0)
+        {
+            const ssize_t got = recv(fd, bytes, size, 0);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got <= 0)
+                return false;
+            bytes += got;
+            size -= size_t(got);
+        }
+        return true;
+    }
+
+    // 'pixels' follow the body without being copied into it
+    bool sendMessage(int fd, uint32_t type, const Packet& body, const unsigned char* pixels = nullptr, size_t pixelBytes = 0)
+    {
+        Packet header;
+        header.putU32(type);
+        header.putU32(uint32_t(body.data.size() + pixelBytes));
+        return sendAll(fd, header.data.data(), header.data.size()) &&
+               (body.data.empty() || sendAll(fd, body.data.data(), body.data.size())) &&
+               (pixelBytes == 0 || sendAll(fd, pixels, pixelBytes));
+    }
+
+    // the worker side reads one message at a time and waits for it
+    bool readMessage(int fd, uint32_t& type, std::vector<unsigned char>& body)
+    {
+        unsigned char header[HEADER_SIZE];
+        if (!recvAll(fd, header, sizeof(header)))
+            return false;
+        Reader reader(header, sizeof(header));
+        type = reader.getU32();
+        const uint32_t length = reader.getU32();
+        if (length > MAX_BODY)
+            return false;
+        body.resize(length);
+        return length == 0 || recvAll(fd, body.data(), length);
+    }
+
+    Packet helloOf(const FarmSetup& setup)
+    {
+        Packet hello;
+        hello.data.insert(hello.data.end(), FARM_MAGIC, FARM_MAGIC + sizeof(FARM_MAGIC));
+        hello.putU32(FARM_VERSION);
+        hello.putI32(setup.width);
+        hello.putI32(setup.height);
+        hello.putFloat(setup.timeStart);
+        hello.putFloat(setup.timeStep);
+        hello.putFloat(setup.mouseX);
+        hello.putFloat(setup.mouseY);
+        hello.putString(setup.vertexPath);
+        hello.putString(setup.fragmentPath);
+        hello.putString(setup.library);
+        hello.putString(setup.quality);
+        hello.putString(setup.tier);
+        hello.putU64(setup.sourceHash);
+        return hello;
+    }
+
+    bool parseHello(const std::vector<unsigned char>& body, FarmSetup& setup)
+    {
+        if (body.size() < sizeof(FARM_MAGIC) || memcmp(body.data(), FARM_MAGIC, sizeof(FARM_MAGIC)) != 0)
+            return false;
+        Reader reader(body.data() + sizeof(FARM_MAGIC), body.size() - sizeof(FARM_MAGIC));
+        if (reader.getU32() != FARM_VERSION)
+            return false;
+        setup.width = reader.getI32();
+        setup.height = reader.getI32();
+        setup.timeStart = reader.getFloat();
+        setup.timeStep = reader.getFloat();
+        setup.mouseX = reader.getFloat();
+        setup.mouseY = reader.getFloat();
+        setup.vertexPath = reader.getString();
+        setup.fragmentPath = reader.getString();
+        setup.library = reader.getString();
+        setup.quality = reader.getString();
+        setup.tier = reader.getString();
+        setup.sourceHash = reader.getU64();
+        return reader.ok && setup.width > 0 && setup.height > 0;
+    }
+
+    // jobs and results are small and frequent, Nagle would hold them back
+    void noDelay(int fd)
+    {
+        const int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+}
+
+bool serveFarm(int fd, const FarmHandler& handler)
+{
+    uint32_t type = 0;
+    std::vector<unsigned char> body;
+    FarmSetup setup;
+    if (!readMessage(fd, type, body) || type != MSG_HELLO || !parseHello(body, setup))
+    {
+        std::cout << "ERROR::FARM:: the peer is not a farm coordinator of version " << FARM_VERSION << std::endl;
+        close(fd);
+        return false;
+    }
+    unsigned long long sourceHash = 0;
+    std::string message;
+    const bool built = handler.setup(setup, sourceHash, message);
+    Packet ready;
+    ready.putU32(built ? 1 : 0);
+    ready.putU64(sourceHash);
+    ready.putString(message);
+    bool serving = sendMessage(fd, MSG_READY, ready) && built;
+
+    std::vector<unsigned char> rgba;
+    while (serving && readMessage(fd, type, body))
+    {
+        if (type == MSG_BYE)
+        {
+            close(fd);
+            return true;
+        }
+        Reader reader(body.data(), body.size());
+        const int id = reader.getI32();
+        FarmJob job;
+        job.frame = reader.getI32();
+        job.x = reader.getI32();
+        job.y = reader.getI32();
+        job.width = reader.getI32();
+        job.height = reader.getI32();
+        if (type != MSG_JOB || !reader.ok || job.width <= 0 || job.height <= 0)
+            break;
+        rgba.resize(size_t(job.width) * job.height * 4);
+        Packet reply;
+        reply.putI32(id);
+        if (handler.render(job, rgba))
+        {
+            serving = sendMessage(fd, MSG_RESULT, reply, rgba.data(), rgba.size());
+        }
+        else
+        {
+            reply.putString("frame " + std::to_string(job.frame) + " did not render");
+            serving = sendMessage(fd, MSG_FAILED, reply);
+        }
+    }
+    close(fd);
+    return false;
+}
+
+bool listenFarm(int port, const FarmHandler& handler)
+{
+    sockaddr_in6 address;
+    memset(&address, 0, sizeof(address));
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_any;
+    address.sin6_port = htons(uint16_t(port));
+    const int listener = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener >= 0)
+    {
+        // both IPv6 and IPv4 coordinators on one socket
+        const int on = 1, off = 0;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        setsockopt(listener, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    }
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 4) != 0)
+    {
+        std::cout << "ERROR::FARM:: cannot listen on port " << port << ": " << strerror(errno) << std::endl;
+        if (listener >= 0)
+            close(listener);
+        return false;
+    }
+    std::cout << "farm: worker listening on port " << port << std::endl;
+    while (true)
+    {
+        const int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            std::cout << "ERROR::FARM:: accept failed: " << strerror(errno) << std::endl;
+            close(listener);
+            return false;
+        }
+        noDelay(fd);
+        std::cout << "farm: " << (serveFarm(fd, handler) ? "served" : "lost") << " a coordinator" << std::endl;
+    }
+}
+
+FarmCoordinator::FarmCoordinator(const FarmSetup& setup)
+    : setup(setup), depth(2), reorder(16), retries(3), timeout(30.0), jobs(nullptr), flushed(0)
+{
+    // a worker that went away must not take the coordinator with it
+    signal(SIGPIPE, SIG_IGN);
+}
+
+FarmCoordinator::~FarmCoordinator()
+{
+    for (Worker& worker : workers)
+    {
+        if (worker.state != LOST)
+            lose(worker, "");
+    }
+}
+
+bool FarmCoordinator::join(Worker& worker)
+{
+    worker.state = JOINING;
+    worker.lastHeard = std::chrono::steady_clock::now();
+    worker.done = 0;
+    if (!sendMessage(worker.fd, MSG_HELLO, helloOf(setup)))
+    {
+        lose(worker, "did not take the setup");
+        return false;
+    }
+    return true;
+}
+
+bool FarmCoordinator::addLocal(const std::vector<std::string>& command)
+{
+    int pair[2];
+    if (command.empty() || socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0)
+    {
+        std::cout << "ERROR::FARM:: cannot make a socket for a local worker: " << strerror(errno) << std::endl;
+        return false;
+    }
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+        // only the worker's end stays open across exec
+        fcntl(pair[1], F_SETFD, 0);
+        std::vector<std::string> arguments = command;
+        arguments.push_back(std::to_string(pair[1]));
+        std::vector<char*> argv;
+        for (std::string& argument : arguments)
+            argv.push_back(&argument[0]);
+        argv.push_back(nullptr);
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+    close(pair[1]);
+    if (pid < 0)
+    {
+        std::cout << "ERROR::FARM:: cannot start a local worker: " << strerror(errno) << std::endl;
+        close(pair[0]);
+        return false;
+    }
+    Worker worker;
+    worker.name = "local:" + std::to_string(pid);
+    worker.fd = pair[0];
+    worker.pid = int(pid);
+    workers.push_back(worker);
+    return join(workers.back());
+}
+
+bool FarmCoordinator::addRemote(const std::string& address)
+{
+    const size_t colon = address.find_last_of(':');
+    if (colon == std::string::npos)
+    {
+        std::cout << "ERROR::FARM:: '" << address << "' is not host:port" << std::endl;
+        return false;
+    }
+    std::string host = address.substr(0, colon);
+    // [::1]:port for IPv6 addresses
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']')
+        host = host.substr(1, host.size() - 2);
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    const int looked = getaddrinfo(host.c_str(), address.substr(colon + 1).c_str(), &hints, &found);
+    if (looked != 0)
+    {
+        std::cout << "ERROR::FARM:: cannot resolve " << address << ": " << gai_strerror(looked) << std::endl;
+        return false;
+    }
+    int fd = -1;
+    for (addrinfo* candidate = found; candidate && fd < 0; candidate = candidate->ai_next)
+    {
+        fd = socket(candidate->ai_family, candidate->ai_socktype | SOCK_CLOEXEC, candidate->ai_protocol);
+        if (fd >= 0 && connect(fd, candidate->ai_addr, candidate->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(found);
+    if (fd < 0)
+    {
+        std::cout << "ERROR::FARM:: cannot connect to " << address << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    noDelay(fd);
+    Worker worker;
+    worker.name = address;
+    worker.fd = fd;
+    worker.pid = 0;
+    workers.push_back(worker);
+    return join(workers.back());
+}
+
+void FarmCoordinator::lose(Worker& worker, const std::string& reason)
+{
+    worker.state = LOST;
+    if (worker.fd >= 0)
+        close(worker.fd);
+    worker.fd = -1;
+    if (worker.pid > 0)
+    {
+        kill(worker.pid, SIGKILL);
+        waitpid(worker.pid, nullptr, 0);
+        worker.pid = 0;
+    }
+    worker.received.clear();
+    if (reason.empty())
+        return;
+
+    ++stats.workersLost;
+    std::cout << "ERROR::FARM:: " << worker.name << " " << reason << ", " << (worker.inFlight.size() + worker.queue.size())
+              << " of its jobs go to the other workers" << std::endl;
+    // the jobs it was rendering may be what killed it, those count as failed
+    const std::vector<int> inFlight = std::move(worker.inFlight);
+    const std::deque<int> queued = std::move(worker.queue);
+    worker.inFlight.clear();
+    worker.queue.clear();
+    for (int job : inFlight)
+    {
+        ++stats.retries;
+        if (!requeue(job, true))
+            return;
+    }
+    for (int job : queued)
+    {
+        if (!requeue(job, false))
+            return;
+    }
+}
+
+bool FarmCoordinator::requeue(int job, bool failed)
+{
+    if (failed && ++attempts[job] >= retries)
+    {
+        if (error.empty())
+            error = "frame " + std::to_string((*jobs)[job].frame) + " failed on " + std::to_string(attempts[job]) + " workers";
+        return false;
+    }
+    Worker* target = nullptr;
+    for (Worker& worker : workers)
+    {
+        // a ready worker before one that is still building
+        if (worker.state == LOST)
+            continue;
+        if (!target || (worker.state == READY && target->state != READY) ||
+            (worker.state == target->state && worker.queue.size() < target->queue.size()))
+            target = &worker;
+    }
+    if (!target)
+    {
+        if (error.empty())
+            error = "no workers left";
+        return false;
+    }
+    target->queue.insert(std::lower_bound(target->queue.begin(), target->queue.end(), job), job);
+    return true;
+}
+
+bool FarmCoordinator::next(Worker& worker, int& job)
+{
+    if (worker.queue.empty())
+    {
+        // the older half of the longest queue, the frames the consumer waits for first
+        Worker* victim = nullptr;
+        for (Worker& other : workers)
+        {
+            if (&other != &worker && other.state != LOST && !other.queue.empty() &&
+                (!victim || other.queue.size() > victim->queue.size()))
+                victim = &other;
+        }
+        if (!victim)
+            return false;
+        const size_t half = (victim->queue.size() + 1) / 2;
+        worker.queue.assign(victim->queue.begin(), victim->queue.begin() + half);
+        victim->queue.erase(victim->queue.begin(), victim->queue.begin() + half);
+        ++stats.steals;
+    }
+    if (ordinal[worker.queue.front()] >= flushed + reorder)
+        return false;
+    job = worker.queue.front();
+    worker.queue.pop_front();
+    return true;
+}
+
+void FarmCoordinator::dispatch(Worker& worker)
+{
+    int job;
+    while (worker.state == READY && int(worker.inFlight.size()) < depth && next(worker, job))
+    {
+        const FarmJob& piece = (*jobs)[job];
+        Frame& frame = frames[ordinal[job]];
+        if (frame.pixels.empty())
+        {
+            frame.pixels.resize(size_t(setup.width) * setup.height * 4);
+            frame.missing = jobsInFrame[ordinal[job]];
+        }
+        Packet message;
+        message.putI32(job);
+        message.putI32(piece.frame);
+        message.putI32(piece.x);
+        message.putI32(piece.y);
+        message.putI32(piece.width);
+        message.putI32(piece.height);
+        // the timeout runs from the first job it was given, not from the last one it finished
+        if (worker.inFlight.empty())
+            worker.lastHeard = std::chrono::steady_clock::now();
+        worker.inFlight.push_back(job);
+        if (!sendMessage(worker.fd, MSG_JOB, message))
+        {
+            lose(worker, "closed the connection");
+            return;
+        }
+    }
+}
+
+void FarmCoordinator::receive(Worker& worker)
+{
+    const size_t CHUNK = 1 << 16;
+    while (true)
+    {
+        const size_t held = worker.received.size();
+        worker.received.resize(held + CHUNK);
+        const ssize_t got = recv(worker.fd, worker.received.data() + held, CHUNK, MSG_DONTWAIT);
+        worker.received.resize(held + size_t(std::max<ssize_t>(got, 0)));
+        if (got > 0)
+        {
+            worker.lastHeard = std::chrono::steady_clock::now();
+            continue;
+        }
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        lose(worker, "closed the connection");
+        return;
+    }
+
+    size_t offset = 0;
+    while (worker.state != LOST && worker.received.size() - offset >= HEADER_SIZE)
+    {
+        Reader header(worker.received.data() + offset, HEADER_SIZE);
+        const uint32_t type = header.getU32();
+        const uint32_t length = header.getU32();
+        if (length > MAX_BODY)
+        {
+            lose(worker, "sent a message of " + std::to_string(length) + " bytes");
+            return;
+        }
+        if (worker.received.size() - offset - HEADER_SIZE < length)
+        {
+            // the rest of a result is on its way, make room for it at once
+            worker.received.reserve(offset + HEADER_SIZE + length + CHUNK);
+            break;
+        }
+        if (!handle(worker, type, worker.received.data() + offset + HEADER_SIZE, length))
+            return;
+        offset += HEADER_SIZE + length;
+    }
+    if (worker.state != LOST)
+        worker.received.erase(worker.received.begin(), worker.received.begin() + offset);
+}
+
+bool FarmCoordinator::handle(Worker& worker, unsigned int type, const unsigned char* body, size_t length)
+{
+    Reader reader(body, length);
+    if (type == MSG_READY && worker.state == JOINING)
+    {
+        const bool built = reader.getU32() != 0;
+        const unsigned long long sourceHash = reader.getU64();
+        const std::string message = reader.getString();
+        if (!reader.ok || !built)
+        {
+            lose(worker, "could not build the shader" + (message.empty() ? std::string() : ": " + message));
+            return false;
+        }
+        if (sourceHash != setup.sourceHash)
+        {
+            lose(worker, "has other sources for " + setup.fragmentPath + " (another checkout or quality file?)");
+            return false;
+        }
+        worker.state = READY;
+        std::cout << "farm: " << worker.name << " ready, " << message << std::endl;
+        return true;
+    }
+
+    const int job = reader.getI32();
+    std::vector<int>::iterator taken = std::find(worker.inFlight.begin(), worker.inFlight.end(), job);
+    if (!reader.ok || taken == worker.inFlight.end() || (type != MSG_RESULT && type != MSG_FAILED))
+    {
+        lose(worker, "broke the protocol");
+        return false;
+    }
+    if (type == MSG_FAILED)
+    {
+        lose(worker, "failed a job: " + reader.getString());
+        return false;
+    }
+
+    const FarmJob& piece = (*jobs)[job];
+    size_t pixelBytes = 0;
+    const unsigned char* pixels = reader.rest(pixelBytes);
+    if (pixelBytes != size_t(piece.width) * piece.height * 4)
+    {
+        lose(worker, "sent a tile of the wrong size");
+        return false;
+    }
+    // rows of the tile go into the frame, both bottom row first
+    Frame& frame = frames[ordinal[job]];
+    const size_t rowBytes = size_t(piece.width) * 4;
+    for (int row = 0; row < piece.height; ++row)
+        memcpy(frame.pixels.data() + ((size_t(piece.y) + row) * setup.width + piece.x) * 4, pixels + row * rowBytes, rowBytes);
+    --frame.missing;
+    worker.inFlight.erase(taken);
+    ++worker.done;
+    ++stats.jobs;
+    return true;
+}
+
+bool FarmCoordinator::run(const std::vector<FarmJob>& frameJobs, const Consumer& consumer)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    error.clear();
+    stats = FarmStats();
+    jobs = &frameJobs;
+    attempts.assign(frameJobs.size(), 0);
+    frames.clear();
+    flushed = 0;
+    // jobs come frame after frame, ordinals number the frames in that order
+    ordinal.resize(frameJobs.size());
+    frameNumbers.clear();
+    jobsInFrame.clear();
+    for (size_t i = 0; i < frameJobs.size(); ++i)
+    {
+        if (frameNumbers.empty() || frameJobs[i].frame != frameNumbers.back())
+        {
+            frameNumbers.push_back(frameJobs[i].frame);
+            jobsInFrame.push_back(0);
+        }
+        ordinal[i] = int(frameNumbers.size()) - 1;
+        ++jobsInFrame.back();
+    }
+
+    // round robin, so every worker starts on the oldest frames
+    std::vector<Worker*> live;
+    for (Worker& worker : workers)
+    {
+        worker.queue.clear();
+        worker.inFlight.clear();
+        if (worker.state != LOST)
+            live.push_back(&worker);
+    }
+    if (live.empty())
+        error = "no workers";
+    for (size_t i = 0; i < frameJobs.size() && !live.empty(); ++i)
+        live[i % live.size()]->queue.push_back(int(i));
+
+    std::vector<pollfd> polled;
+    std::vector<Worker*> polledWorkers;
+    while (error.empty() && flushed < int(frameNumbers.size()))
+    {
+        polled.clear();
+        polledWorkers.clear();
+        for (Worker& worker : workers)
+        {
+            dispatch(worker);
+            if (worker.state == LOST)
+                continue;
+            pollfd entry;
+            entry.fd = worker.fd;
+            entry.events = POLLIN;
+            entry.revents = 0;
+            polled.push_back(entry);
+            polledWorkers.push_back(&worker);
+        }
+        if (!error.empty())
+            break;
+        if (polled.empty())
+        {
+            error = "no workers left";
+            break;
+        }
+        if (poll(polled.data(), nfds_t(polled.size()), 100) < 0 && errno != EINTR)
+        {
+            error = std::string("poll failed: ") + strerror(errno);
+            break;
+        }
+        for (size_t i = 0; i < polled.size(); ++i)
+        {
+            if (polled[i].revents != 0 && polledWorkers[i]->state != LOST)
+                receive(*polledWorkers[i]);
+        }
+
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for (Worker& worker : workers)
+        {
+            const bool waiting = worker.state == JOINING || (worker.state == READY && !worker.inFlight.empty());
+            const double silent = std::chrono::duration<double>(now - worker.lastHeard).count();
+            if (waiting && timeout > 0.0 && silent > timeout)
+                lose(worker, "did not answer for " + std::to_string(int(silent)) + " s");
+        }
+
+        // the finished frames at the front of the range go out in order
+        while (error.empty() && flushed < int(frameNumbers.size()))
+        {
+            std::map<int, Frame>::iterator frame = frames.find(flushed);
+            if (frame == frames.end() || frame->second.missing > 0)
+                break;
+            if (!consumer(frameNumbers[flushed], frame->second.pixels.data()))
+                error = "frame " + std::to_string(frameNumbers[flushed]) + " could not be stored";
+            frames.erase(frame);
+            ++flushed;
+            ++stats.frames;
+        }
+        stats.peakFrames = std::max(stats.peakFrames, int(frames.size()));
+    }
+
+    for (Worker& worker : workers)
+    {
+        if (worker.state == LOST)
+            continue;
+        // the worker exits once it has read this, a local one is reaped
+        sendMessage(worker.fd, MSG_BYE, Packet());
+        close(worker.fd);
+        worker.fd = -1;
+        if (worker.pid > 0)
+            waitpid(worker.pid, nullptr, 0);
+        worker.pid = 0;
+        worker.state = LOST;
+    }
+    for (const Worker& worker : workers)
+        stats.jobsPerWorker.push_back(worker.done);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    frames.clear();
+    return error.empty();
+}
+
+#else
+
+bool serveFarm(int fd, const FarmHandler& handler)
+{
+    std::cout << "ERROR::FARM:: farm workers need POSIX sockets" << std::endl;
+    return false;
+}
+
+bool listenFarm(int port, const FarmHandler& handler)
+{
+    std::cout << "ERROR::FARM:: farm workers need POSIX sockets" << std::endl;
+    return false;
+}
+
+FarmCoordinator::FarmCoordinator(const FarmSetup& setup)
+    : setup(setup), depth(2), reorder(16), retries(3), timeout(30.0), jobs(nullptr), flushed(0)
+{
+}
+
+FarmCoordinator::~FarmCoordinator()
+{
+}
+
+bool FarmCoordinator::addLocal(const std::vector<std::string>& command)
+{
+    std::cout << "ERROR::FARM:: farm workers need POSIX processes and sockets" << std::endl;
+    return false;
+}
+
+bool FarmCoordinator::addRemote(const std::string& address)
+{
+    std::cout << "ERROR::FARM:: farm workers need POSIX sockets, cannot reach " << address << std::endl;
+    return false;
+}
+
+bool FarmCoordinator::run(const std::vector<FarmJob>& frameJobs, const Consumer& consumer)
+{
+    error = "no workers";
+    return false;
+}
+
+#endif
@@ -0,0 +1,367 @@
+#include "myImplement/render_graph.h"
+
+#include "yaml-cpp/yaml.h"
+
+#include <algorithm>
+#include <map>
+
+namespace
+{
+    bool formatOf(const std::string& name, GLenum& format)
+    {
+        if (name == "rgba8")
+            format = GL_RGBA8;
+        else if (name == "rgba16f")
+            format = GL_RGBA16F;
+        else if (name == "rgba32f")
+            format = GL_RGBA32F;
+        else
+            return false;
+        return true;
+    }
+
+    const char* const channelUniforms[4] = { "iChannel0", "iChannel1", "iChannel2", "iChannel3" };
+}
+
+RenderGraph::RenderGraph()
+    : imagePass(-1), width(0), height(0), quadVAO(0)
+{
+    std::fill(boundTextures, boundTextures + 4, 0u);
+}
+
+bool RenderGraph::fail(const std::string& message)
+{
+    error = message;
+    return false;
+}
+
+bool RenderGraph::load(const char* graphPath, const char* vertexPath, int width, int height, unsigned int quadVAO,
+                       ShaderLoader& loader, const QualityTiers* tiers, int tier)
+{
+    passes.clear();
+    schedule.clear();
+    allocator.clear();
+    imagePass = -1;
+    error.clear();
+    this->width = width;
+    this->height = height;
+    this->vertexPath = vertexPath;
+    this->quadVAO = quadVAO;
+
+    try
+    {
+        YAML::Node root = YAML::LoadFile(graphPath);
+        const YAML::Node list = root["passes"];
+        if (!list || !list.IsSequence() || list.size() == 0)
+            return fail(std::string("no 'passes' list in ") + graphPath);
+        passes.reserve(list.size());
+        for (const YAML::Node& node : list)
+        {
+            Pass pass;
+            pass.name = node["name"] ? node["name"].as<std::string>() : "";
+            pass.fragmentPath = node["fragment"] ? node["fragment"].as<std::string>() : "";
+            if (pass.name.empty() || pass.fragmentPath.empty())
+                return fail("every pass needs a name and a fragment shader");
+            if (!formatOf(node["format"] ? node["format"].as<std::string>() : "rgba16f", pass.format))
+                return fail("pass '" + pass.name + "' has an unknown format");
+            if (node["channels"])
+                pass.channelNames = node["channels"].as<std::vector<std::string>>();
+            if (pass.channelNames.size() > 4)
+                return fail("pass '" + pass.name + "' has more than 4 channels");
+            pass.targets[0] = pass.targets[1] = -1;
+            pass.doubleBuffered = false;
+            pass.latest = 0;
+            pass.renderedFrame = -1;
+            passes.push_back(std::move(pass));
+        }
+    }
+    catch (const YAML::Exception& e)
+    {
+        return fail(std::string("cannot read ") + graphPath + ": " + e.what());
+    }
+    if (!resolve())
+        return false;
+
+    // every pass compiles at once, then they are set up in order
+    for (int index : schedule)
+    {
+        Pass& pass = passes[index];
+        pass.program.reset(new ShaderPermutations(loader, vertexPath, pass.fragmentPath, tiers, tier));
+        // samplers never change unit, set them once per program
+        const size_t channelCount = pass.channels.size();
+        pass.program->setSetup([channelCount](Shader& shader)
+        {
+            shader.use();
+            for (size_t i = 0; i < channelCount; ++i)
+                shader.setInt(channelUniforms[i], int(i));
+        });
+    }
+    for (int index : schedule)
+        passes[index].program->wait();
+    return createTargets() || fail("cannot create the pass targets");
+}
+
+std::vector<std::string> RenderGraph::getSources() const
+{
+    std::vector<std::string> sources(1, vertexPath);
+    for (const Pass& pass : passes)
+    {
+        if (std::find(sources.begin(), sources.end(), pass.fragmentPath) == sources.end())
+            sources.push_back(pass.fragmentPath);
+    }
+    return sources;
+}
+
+bool RenderGraph::rebuild(const std::string& path)
+{
+    bool used = false;
+    for (Pass& pass : passes)
+    {
+        if (path != vertexPath && path != pass.fragmentPath)
+            continue;
+        // a newer edit supersedes a build still running
+        pass.program->reload();
+        used = true;
+    }
+    return used;
+}
+
+void RenderGraph::selectTier(int tier)
+{
+    for (Pass& pass : passes)
+        pass.program->select(tier);
+}
+
+void RenderGraph::prewarmTier(int tier)
+{
+    for (Pass& pass : passes)
+        pass.program->prewarm(tier);
+}
+
+bool RenderGraph::update()
+{
+    bool swapped = false;
+    for (Pass& pass : passes)
+    {
+        const int tier = pass.program->getTier();
+        if (!pass.program->update())
+            continue;
+        swapped = true;
+        if (pass.program->getTier() == tier)
+            std::cout << "render graph: reloaded " << pass.name << std::endl;
+    }
+    return swapped;
+}
+
+bool RenderGraph::resolve()
+{
+    std::map<std::string, int> byName;
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        if (!byName.insert(std::make_pair(passes[i].name, int(i))).second)
+            return fail("pass '" + passes[i].name + "' is declared twice");
+        if (passes[i].name == "Image")
+            imagePass = int(i);
+    }
+    if (imagePass < 0)
+        return fail("no 'Image' pass, it is the one that reaches the screen");
+
+    // edges of this frame decide the order, .prev edges only the buffering
+    std::vector<std::vector<int>> readers(passes.size());
+    std::vector<int> pending(passes.size(), 0);
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        Pass& pass = passes[i];
+        for (const std::string& name : pass.channelNames)
+        {
+            const bool previous = name.size() > 5 && name.compare(name.size() - 5, 5, ".prev") == 0;
+            std::map<std::string, int>::const_iterator it = byName.find(previous ? name.substr(0, name.size() - 5) : name);
+            if (it == byName.end())
+                return fail("pass '" + pass.name + "' reads unknown pass '" + name + "'");
+            if (it->second == imagePass)
+                return fail("pass '" + pass.name + "' reads Image, which has no target to read back");
+            Channel channel{ it->second, previous || it->second == int(i) };
+            pass.channels.push_back(channel);
+            if (!channel.previous)
+            {
+                readers[it->second].push_back(int(i));
+                ++pending[i];
+            }
+        }
+    }
+
+    // Kahn's algorithm, ties broken by declaration order so the schedule is stable
+    std::vector<int> order;
+    std::vector<bool> done(passes.size(), false);
+    while (order.size() < passes.size())
+    {
+        int next = -1;
+        for (size_t i = 0; i < passes.size() && next < 0; ++i)
+            if (!done[i] && pending[i] == 0)
+                next = int(i);
+        if (next < 0)
+        {
+            std::string cycle;
+            for (size_t i = 0; i < passes.size(); ++i)
+                if (!done[i])
+                    cycle += (cycle.empty() ? "" : ", ") + passes[i].name;
+            return fail("passes " + cycle + " read each other in a cycle, make one of the reads .prev");
+        }
+        done[next] = true;
+        order.push_back(next);
+        for (int reader : readers[next])
+            --pending[reader];
+    }
+
+    // only what the Image pass needs, this frame or through earlier frames, gets rendered
+    std::vector<bool> needed(passes.size(), false);
+    std::vector<int> stack(1, imagePass);
+    needed[imagePass] = true;
+    while (!stack.empty())
+    {
+        const int index = stack.back();
+        stack.pop_back();
+        for (const Channel& channel : passes[index].channels)
+            if (!needed[channel.pass])
+            {
+                needed[channel.pass] = true;
+                stack.push_back(channel.pass);
+            }
+    }
+    std::vector<int> position(passes.size(), -1);
+    for (int index : order)
+        if (needed[index])
+        {
+            position[index] = int(schedule.size());
+            schedule.push_back(index);
+        }
+
+    // a .prev read after the pass has rendered again needs the older of two targets
+    for (int index : schedule)
+        for (const Channel& channel : passes[index].channels)
+            if (channel.previous && position[index] >= position[channel.pass])
+                passes[channel.pass].doubleBuffered = true;
+    return true;
+}
+
+bool RenderGraph::createTargets()
+{
+    std::vector<int> position(passes.size(), -1);
+    for (size_t i = 0; i < schedule.size(); ++i)
+        position[schedule[i]] = int(i);
+    // a buffer lives from its pass to its last reader in this frame, unless
+    // some frame after this one reads it too
+    std::vector<int> lastRead(passes.size(), -1);
+    std::vector<bool> persistent(passes.size(), false);
+    for (int index : schedule)
+        for (const Channel& channel : passes[index].channels)
+        {
+            if (channel.previous)
+                persistent[channel.pass] = true;
+            else
+                lastRead[channel.pass] = std::max(lastRead[channel.pass], position[index]);
+        }
+
+    for (int index : schedule)
+    {
+        Pass& pass = passes[index];
+        if (index == imagePass)
+            continue;
+        for (int i = 0; i < (pass.doubleBuffered ? 2 : 1); ++i)
+            pass.targets[i] = persistent[index]
+                ? allocator.requestPersistent(width, height, pass.format, false)
+                : allocator.request(width, height, pass.format, false, position[index], lastRead[index]);
+    }
+    if (!allocator.allocate())
+        return false;
+    reset();
+    return true;
+}
+
+void RenderGraph::reset()
+{
+    GLint previous = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    for (RenderTarget& target : allocator.getPool())
+    {
+        target.bind();
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    for (Pass& pass : passes)
+    {
+        pass.latest = 0;
+        pass.renderedFrame = -1;
+    }
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GLuint(previous));
+}
+
+unsigned int RenderGraph::channelTexture(const Channel& channel, int frame) const
+{
+    const Pass& source = passes[channel.pass];
+    // once the source has rendered this frame, its previous frame is in the other target
+    int target = source.latest;
+    if (channel.previous && source.renderedFrame == frame)
+        target = source.doubleBuffered ? 1 - source.latest : source.latest;
+    return allocator.get(source.targets[target]).getTexture();
+}
+
+void RenderGraph::bindTexture(int unit, unsigned int texture)
+{
+    if (boundTextures[unit] == texture)
+        return;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    boundTextures[unit] = texture;
+}
+
+void RenderGraph::render(int frame, const FrameGlobals& globals, int outputWidth, int outputHeight)
+{
+    GLint output = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &output);
+    // someone else may have used the units since the last frame
+    std::fill(boundTextures, boundTextures + 4, 0u);
+    glBindVertexArray(quadVAO);
+
+    for (int index : schedule)
+    {
+        Pass& pass = passes[index];
+        int write = pass.doubleBuffered ? 1 - pass.latest : 0;
+        if (index == imagePass)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, GLuint(output));
+            glViewport(0, 0, outputWidth, outputHeight);
+            globals.bindView(FRAME_VIEW_SCENE);
+        }
+        else
+        {
+            allocator.get(pass.targets[write]).bind();
+            globals.bindView(FRAME_VIEW_BUFFER);
+        }
+
+        pass.program->get()->use();
+        for (size_t i = 0; i < pass.channels.size(); ++i)
+            bindTexture(int(i), channelTexture(pass.channels[i], frame));
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+
+        pass.latest = write;
+        pass.renderedFrame = frame;
+    }
+}
+
+std::string RenderGraph::describe() const
+{
+    std::string text;
+    for (int index : schedule)
+        text += (text.empty() ? "" : " -> ") + passes[index].name + (passes[index].doubleBuffered ? "*" : "");
+    return text;
+}
+
+bool RenderGraph::hasFeedback() const
+{
+    for (int index : schedule)
+        for (const Channel& channel : passes[index].channels)
+            if (channel.previous)
+                return true;
+    return false;
+}
@@ -0,0 +1,136 @@
+#include "myImplement/render_target.h"
+
+#include <utility>
+
+// the client side format matching a sized internal format
+static void pixelFormatOf(GLenum internalFormat, GLenum& format, GLenum& type)
+{
+    switch (internalFormat)
+    {
+    case GL_RGBA16F:
+    case GL_RGBA32F:
+        format = GL_RGBA;
+        type = GL_FLOAT;
+        break;
+    case GL_R32F:
+    case GL_R16F:
+        format = GL_RED;
+        type = GL_FLOAT;
+        break;
+    case GL_RGB8:
+        format = GL_RGB;
+        type = GL_UNSIGNED_BYTE;
+        break;
+    default:
+        format = GL_RGBA;
+        type = GL_UNSIGNED_BYTE;
+        break;
+    }
+}
+
+RenderTarget::RenderTarget()
+    : FBO(0), colourTex(0), depthRBO(0), width(0), height(0), internalFormat(GL_RGBA8)
+{
+}
+
+RenderTarget::RenderTarget(int width, int height, GLenum internalFormat, bool withDepth)
+    : RenderTarget()
+{
+    create(width, height, internalFormat, withDepth);
+}
+
+RenderTarget::~RenderTarget()
+{
+    release();
+}
+
+RenderTarget::RenderTarget(RenderTarget&& other)
+    : RenderTarget()
+{
+    *this = std::move(other);
+}
+
+RenderTarget& RenderTarget::operator=(RenderTarget&& other)
+{
+    if (this != &other)
+    {
+        release();
+        std::swap(FBO, other.FBO);
+        std::swap(colourTex, other.colourTex);
+        std::swap(depthRBO, other.depthRBO);
+        std::swap(width, other.width);
+        std::swap(height, other.height);
+        std::swap(internalFormat, other.internalFormat);
+    }
+    return *this;
+}
+
+bool RenderTarget::create(int width, int height, GLenum internalFormat, bool withDepth)
+{
+    release();
+    this->width = width;
+    this->height = height;
+    this->internalFormat = internalFormat;
+
+    GLenum format, type;
+    pixelFormatOf(internalFormat, format, type);
+
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    // colour attachment texture
+    glGenTextures(1, &colourTex);
+    glBindTexture(GL_TEXTURE_2D, colourTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colourTex, 0);
+    // depth and stencil go to a render buffer, we never sample them
+    if (withDepth)
+    {
+        glGenRenderbuffers(1, &depthRBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+    }
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!complete)
+        std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+void RenderTarget::release()
+{
+    if (depthRBO)
+        glDeleteRenderbuffers(1, &depthRBO);
+    if (colourTex)
+        glDeleteTextures(1, &colourTex);
+    if (FBO)
+        glDeleteFramebuffers(1, &FBO);
+    FBO = colourTex = depthRBO = 0;
+    width = height = 0;
+}
+
+void RenderTarget::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glViewport(0, 0, width, height);
+}
+
+void RenderTarget::bindDefault(int width, int height)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+}
+
+void RenderTarget::readPixels(std::vector<unsigned char>& pixels) const
+{
+    pixels.resize(size_t(width) * height * 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
@@ -1,4 +1,12 @@
 #include "myImplement/shader.h"
+#include "myImplement/frame_globals.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+ProgramCache* Shader::programCache = nullptr;
+ShaderPreprocessor* Shader::preprocessor = nullptr;
 
 void Shader::checkCompileErrors(unsigned int shader, std::string type)
 {
@@ -10,7 +18,9 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type)
         if (!success)
         {
             glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            // name included files instead of their source string numbers
+            const std::string log = preprocessor ? preprocessor->mapLog(infoLog) : std::string(infoLog);
+            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << log << "\n -- --------------------------------------------------- -- " << std::endl;
         }
     }
     else
@@ -24,11 +34,158 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type)
     }
 }
 
+namespace
+{
+    // 32 bit words a uniform of this type holds, arrays only cache element 0
+    int wordsOf(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_BOOL_VEC2:
+            return 2;
+        case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_BOOL_VEC3:
+            return 3;
+        case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_BOOL_VEC4: case GL_FLOAT_MAT2:
+            return 4;
+        case GL_FLOAT_MAT3:
+            return 9;
+        case GL_FLOAT_MAT4:
+            return 16;
+        default:
+            return type == GL_FLOAT || type == GL_INT || type == GL_BOOL || type == GL_UNSIGNED_INT ? 1 : 16;
+        }
+    }
+
+    bool isSampler(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_MULTISAMPLE:
+        case GL_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_SAMPLER_BUFFER:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // whether a value of 'type' may be uploaded to a uniform of type 'actual'
+    // with the call that type uses: samplers take their texture unit, bools
+    // take ints and floats (and setBool's glUniform1i fits an int)
+    bool acceptsType(GLenum actual, GLenum type)
+    {
+        if (actual == type || (type == GL_INT && isSampler(actual)))
+            return true;
+        switch (actual)
+        {
+        case GL_BOOL:      return type == GL_INT || type == GL_FLOAT;
+        case GL_BOOL_VEC2: return type == GL_FLOAT_VEC2;
+        case GL_BOOL_VEC3: return type == GL_FLOAT_VEC3;
+        case GL_BOOL_VEC4: return type == GL_FLOAT_VEC4;
+        case GL_INT:       return type == GL_BOOL;
+        default:           return false;
+        }
+    }
+}
+
+void Shader::reflectUniforms()
+{
+    int count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> name(size_t(maxLength) + 1);
+    for (int i = 0; i < count; ++i)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, GLuint(i), GLsizei(name.size()), &length, &size, &type, name.data());
+        std::string uniform(name.data(), size_t(length));
+        // arrays are reported as "name[0]"
+        if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+            uniform.resize(uniform.size() - 3);
+        // block members have no location, they are set through their buffer
+        const GLint location = glGetUniformLocation(ID, uniform.c_str());
+        if (location < 0)
+            continue;
+        UniformSlot slot;
+        slot.location = location;
+        slot.type = type;
+        slot.cacheOffset = int(uniformCache.size());
+        slot.cacheSize = wordsOf(type);
+        slot.uploaded = false;
+        slot.mistyped = false;
+        uniformCache.resize(uniformCache.size() + size_t(slot.cacheSize));
+        uniformIndex[uniform] = int(uniforms.size());
+        uniforms.push_back(slot);
+    }
+}
+
+int Shader::findUniform(const std::string &name, GLenum type) const
+{
+    std::unordered_map<std::string, int>::const_iterator it = uniformIndex.find(name);
+    if (it == uniformIndex.end())
+        return -1;
+    return checkType(it->second, name, type) ? it->second : -1;
+}
+
+bool Shader::checkType(int index, const std::string &name, GLenum type) const
+{
+    const UniformSlot& slot = uniforms[index];
+    if (acceptsType(slot.type, type))
+        return true;
+    // once per uniform, a by-name set in the frame loop would repeat it every frame
+    if (!slot.mistyped)
+        std::cout << "ERROR::SHADER::UNIFORM_TYPE: " << name << " is not set from a value of that type" << std::endl;
+    slot.mistyped = true;
+    return false;
+}
+
+bool Shader::changed(int index, const void* value, size_t bytes) const
+{
+    const UniformSlot& slot = uniforms[index];
+    GLuint* cached = &uniformCache[size_t(slot.cacheOffset)];
+    bytes = std::min(bytes, size_t(slot.cacheSize) * sizeof(GLuint));
+    if (slot.uploaded && memcmp(cached, value, bytes) == 0)
+        return false;
+    memcpy(cached, value, bytes);
+    slot.uploaded = true;
+    return true;
+}
+
+Shader::Shader()
+    : ID(0), linked(false)
+{
+}
+
 Shader::Shader(const char* vertexPath, const char* fragmentPath)
+    : ID(0), linked(false)
 {
-    // 1. retrieve the vertex/fragment source code from filePath
     std::string vertexCode;
     std::string fragmentCode;
+    readSources(vertexPath, fragmentPath, vertexCode, fragmentCode);
+    // the per-frame uniforms come from the shared block
+    const bool frameGlobals = prepareSources(vertexCode, fragmentCode);
+    // a program built from these exact sources before is loaded as a binary
+    const unsigned long long sourceHash = ProgramCache::hashSources(vertexCode, fragmentCode);
+    if (loadCached(sourceHash, frameGlobals))
+        return;
+    const std::chrono::steady_clock::time_point compileStart = std::chrono::steady_clock::now();
+    unsigned int vertex, fragment;
+    submit(vertexCode, fragmentCode, vertex, fragment);
+    complete(vertex, fragment, sourceHash, frameGlobals,
+             std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compileStart).count());
+}
+
+bool Shader::readSources(const char* vertexPath, const char* fragmentPath, std::string &vertexCode, std::string &fragmentCode)
+{
+    if (preprocessor)
+    {
+        const bool vertexRead = preprocessor->expand(vertexPath, vertexCode);
+        const bool fragmentRead = preprocessor->expand(fragmentPath, fragmentCode);
+        return vertexRead && fragmentRead;
+    }
+    // 1. retrieve the vertex/fragment source code from filePath
     std::ifstream vShaderFile;
     std::ifstream fShaderFile;
     // ensure ifstream objects can throw exceptions:
@@ -53,31 +210,69 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
     catch (std::ifstream::failure& e)
     {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
+        return false;
     }
+    return true;
+}
+
+bool Shader::prepareSources(std::string &vertexCode, std::string &fragmentCode)
+{
+    const bool vertexGlobals = injectFrameGlobals(vertexCode, frameGlobalsRead);
+    const bool fragmentGlobals = injectFrameGlobals(fragmentCode, frameGlobalsRead);
+    return vertexGlobals || fragmentGlobals;
+}
+
+bool Shader::loadCached(unsigned long long sourceHash, bool frameGlobals)
+{
+    ID = programCache ? programCache->load(sourceHash) : 0;
+    if (!ID)
+        return false;
+    linked = true;
+    reflectUniforms();
+    bindFrameGlobals(frameGlobals);
+    return true;
+}
+
+void Shader::submit(const std::string &vertexCode, const std::string &fragmentCode, unsigned int &vertex, unsigned int &fragment)
+{
     const char* vShaderCode = vertexCode.c_str();
     const char * fShaderCode = fragmentCode.c_str();
-    // 2. compile shaders
-    unsigned int vertex, fragment;
+    // 2. compile shaders, a driver with parallel compiles returns right away
     // vertex shader
     vertex = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(vertex, 1, &vShaderCode, NULL);
     glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
     // fragment Shader
     fragment = glCreateShader(GL_FRAGMENT_SHADER);
     glShaderSource(fragment, 1, &fShaderCode, NULL);
     glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
     // shader Program
     ID = glCreateProgram();
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
+    if (programCache)
+        programCache->prepare(ID);
     glLinkProgram(ID);
+}
+
+void Shader::complete(unsigned int vertex, unsigned int fragment, unsigned long long sourceHash, bool frameGlobals, double compileMs)
+{
+    // asking for the status waits for the compile, so only do it once it is done
+    checkCompileErrors(vertex, "VERTEX");
+    checkCompileErrors(fragment, "FRAGMENT");
     checkCompileErrors(ID, "PROGRAM");
+    GLint status = GL_FALSE;
+    glGetProgramiv(ID, GL_LINK_STATUS, &status);
+    linked = status == GL_TRUE;
+    if (programCache && linked)
+        programCache->store(ID, sourceHash, compileMs);
+    reflectUniforms();
+    bindFrameGlobals(frameGlobals);
     // delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
 }
+
 Shader::~Shader()
 {
     
@@ -88,52 +283,136 @@ void Shader::use()
     glUseProgram(ID); 
 }
 
-// other utilities
+void Shader::release()
+{
+    if (ID)
+        glDeleteProgram(ID);
+    ID = 0;
+    linked = false;
+}
+
+void Shader::bindFrameGlobals(bool injected)
+{
+    const GLuint block = glGetUniformBlockIndex(ID, "FrameGlobals");
+    if (injected && block != GL_INVALID_INDEX)
+        glUniformBlockBinding(ID, block, FRAME_GLOBALS_BINDING);
+}
+
+bool Shader::isUniformActive(const std::string &name) const
+{
+    return uniformIndex.count(name) != 0 ||
+           std::find(frameGlobalsRead.begin(), frameGlobalsRead.end(), name) != frameGlobalsRead.end();
+}
+
+// typed handles
+void Shader::set(Uniform<bool> handle, bool value) const
+{
+    const int word = value ? 1 : 0;
+    if (handle.isValid() && changed(handle.index, &word, sizeof(word)))
+        glUniform1i(uniforms[handle.index].location, word);
+}
+void Shader::set(Uniform<int> handle, int value) const
+{
+    if (handle.isValid() && changed(handle.index, &value, sizeof(value)))
+        glUniform1i(uniforms[handle.index].location, value);
+}
+void Shader::set(Uniform<float> handle, float value) const
+{
+    if (handle.isValid() && changed(handle.index, &value, sizeof(value)))
+        glUniform1f(uniforms[handle.index].location, value);
+}
+void Shader::set(Uniform<glm::vec2> handle, const glm::vec2 &value) const
+{
+    if (handle.isValid() && changed(handle.index, &value[0], sizeof(value)))
+        glUniform2fv(uniforms[handle.index].location, 1, &value[0]);
+}
+void Shader::set(Uniform<glm::vec3> handle, const glm::vec3 &value) const
+{
+    if (handle.isValid() && changed(handle.index, &value[0], sizeof(value)))
+        glUniform3fv(uniforms[handle.index].location, 1, &value[0]);
+}
+void Shader::set(Uniform<glm::vec4> handle, const glm::vec4 &value) const
+{
+    if (handle.isValid() && changed(handle.index, &value[0], sizeof(value)))
+        glUniform4fv(uniforms[handle.index].location, 1, &value[0]);
+}
+void Shader::set(Uniform<glm::mat2> handle, const glm::mat2 &value) const
+{
+    if (handle.isValid() && changed(handle.index, &value[0][0], sizeof(value)))
+        glUniformMatrix2fv(uniforms[handle.index].location, 1, GL_FALSE, &value[0][0]);
+}
+void Shader::set(Uniform<glm::mat3> handle, const glm::mat3 &value) const
+{
+    if (handle.isValid() && changed(handle.index, &value[0][0], sizeof(value)))
+        glUniformMatrix3fv(uniforms[handle.index].location, 1, GL_FALSE, &value[0][0]);
+}
+void Shader::set(Uniform<glm::mat4> handle, const glm::mat4 &value) const
+{
+    if (handle.isValid() && changed(handle.index, &value[0][0], sizeof(value)))
+        glUniformMatrix4fv(uniforms[handle.index].location, 1, GL_FALSE, &value[0][0]);
+}
+
+// other utilities: an active uniform goes through the table, type checked
+// like a handle, anything else (an element like "lights[2]") is looked up
+// by GL as before
+#define SHADER_SET_BY_NAME(TYPE, VALUE, UPLOAD)                                \
+    std::unordered_map<std::string, int>::const_iterator it = uniformIndex.find(name); \
+    if (it != uniformIndex.end())                                              \
+    {                                                                          \
+        if (checkType(it->second, name, UniformType<TYPE>::value))             \
+            set(Uniform<TYPE>(it->second), VALUE);                             \
+    }                                                                          \
+    else if (name.find('[') != std::string::npos)                              \
+    {                                                                          \
+        const GLint location = glGetUniformLocation(ID, name.c_str());         \
+        UPLOAD;                                                                \
+    }
+
 void Shader::setBool(const std::string &name, bool value) const
-{         
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+{
+    SHADER_SET_BY_NAME(bool, value, glUniform1i(location, (int)value))
 }
 void Shader::setInt(const std::string &name, int value) const
-{ 
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+{
+    SHADER_SET_BY_NAME(int, value, glUniform1i(location, value))
 }
 void Shader::setFloat(const std::string &name, float value) const
-{ 
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+{
+    SHADER_SET_BY_NAME(float, value, glUniform1f(location, value))
 }
 void Shader::setVec2(const std::string &name, const glm::vec2 &value) const
-{ 
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+{
+    SHADER_SET_BY_NAME(glm::vec2, value, glUniform2fv(location, 1, &value[0]))
 }
 void Shader::setVec2(const std::string &name, float x, float y) const
-{ 
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+{
+    setVec2(name, glm::vec2(x, y));
 }
 void Shader::setVec3(const std::string &name, const glm::vec3 &value) const
-{ 
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+{
+    SHADER_SET_BY_NAME(glm::vec3, value, glUniform3fv(location, 1, &value[0]))
 }
 void Shader::setVec3(const std::string &name, float x, float y, float z) const
-{ 
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+{
+    setVec3(name, glm::vec3(x, y, z));
 }
 void Shader::setVec4(const std::string &name, const glm::vec4 &value) const
-{ 
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+{
+    SHADER_SET_BY_NAME(glm::vec4, value, glUniform4fv(location, 1, &value[0]))
 }
 void Shader::setVec4(const std::string &name, float x, float y, float z, float w) 
 { 
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+    setVec4(name, glm::vec4(x, y, z, w));
 }
 void Shader::setMat2(const std::string &name, const glm::mat2 &mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    SHADER_SET_BY_NAME(glm::mat2, mat, glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]))
 }
 void Shader::setMat3(const std::string &name, const glm::mat3 &mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    SHADER_SET_BY_NAME(glm::mat3, mat, glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]))
 }
 void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
-}
\ No newline at end of file
+    SHADER_SET_BY_NAME(glm::mat4, mat, glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]))
+}
@@ -0,0 +1,218 @@
+#include "myImplement/shader_loader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+struct ShaderFuture::State
+{
+    std::string vertexPath;
+    std::string fragmentPath;
+    ShaderDefines defines;
+    bool countSteps;
+    std::string vertexCode;
+    std::string fragmentCode;
+    std::atomic<bool> read;   // set by a reader once the sources are in
+
+    // the rest belongs to the GL thread
+    std::unique_ptr<Shader> shader;
+    bool submitted;
+    bool ready;
+    bool frameGlobals;
+    unsigned long long sourceHash;
+    unsigned int vertex;
+    unsigned int fragment;
+    std::chrono::steady_clock::time_point requested;
+    std::chrono::steady_clock::time_point compileStart;
+
+    State() : countSteps(false), read(false), submitted(false), ready(false), frameGlobals(false), sourceHash(0), vertex(0), fragment(0) {}
+};
+
+namespace
+{
+    double millisecondsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+    {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    bool hasExtension(const char* name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i)
+        {
+            const GLubyte* extension = glGetStringi(GL_EXTENSIONS, GLuint(i));
+            if (extension && strcmp(reinterpret_cast<const char*>(extension), name) == 0)
+                return true;
+        }
+        return false;
+    }
+}
+
+std::string ShaderLoadStats::summary() const
+{
+    char text[160];
+    snprintf(text, sizeof(text), "%d programs, %d from cache, %.1f ms wall, %.1f ms summed over programs (%.1fx in flight)",
+             requested, cached, wallMs, busyMs, wallMs > 0.0 ? busyMs / wallMs : 1.0);
+    return text;
+}
+
+bool ShaderFuture::isReady() const
+{
+    return state && state->ready;
+}
+
+std::unique_ptr<Shader> ShaderFuture::take()
+{
+    if (!isReady())
+        return nullptr;
+    return std::move(state->shader);
+}
+
+ShaderLoader::ShaderLoader(int threads)
+    : stopping(false), parallel(false)
+{
+    // both extensions report through the same enum
+    parallel = hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile");
+    for (int i = 0; i < std::max(threads, 1); ++i)
+        readers.emplace_back(&ShaderLoader::readerLoop, this);
+}
+
+ShaderLoader::~ShaderLoader()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    hasWork.notify_all();
+    for (std::thread& reader : readers)
+        reader.join();
+}
+
+void ShaderLoader::readerLoop()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;)
+    {
+        hasWork.wait(guard, [this]() { return stopping || !toRead.empty(); });
+        if (stopping)
+            return;
+        std::shared_ptr<ShaderFuture::State> state = toRead.front();
+        toRead.pop_front();
+        guard.unlock();
+
+        // a missing file has printed its error, the compile then fails like the constructor's would
+        Shader::readSources(state->vertexPath.c_str(), state->fragmentPath.c_str(), state->vertexCode, state->fragmentCode);
+        if (!state->defines.empty())
+        {
+            std::vector<bool> inVertex, inFragment;
+            overrideDefines(state->vertexCode, state->defines, inVertex);
+            overrideDefines(state->fragmentCode, state->defines, inFragment);
+            for (size_t i = 0; i < state->defines.size(); ++i)
+            {
+                if (!inVertex[i] && !inFragment[i])
+                    std::cout << "ERROR::SHADER:: " << state->fragmentPath << " has no #define " << state->defines[i].first << " to override" << std::endl;
+            }
+        }
+        // a source that cannot be counted builds as it is, without the count output
+        std::string error;
+        if (state->countSteps && !instrumentStepCount(state->fragmentCode, error))
+            std::cout << "ERROR::SHADER:: " << state->fragmentPath << ": " << error << std::endl;
+        state->read.store(true, std::memory_order_release);
+
+        guard.lock();
+    }
+}
+
+ShaderFuture ShaderLoader::request(const std::string& vertexPath, const std::string& fragmentPath, const ShaderDefines& defines,
+                                   bool countSteps)
+{
+    ShaderFuture future;
+    future.state = std::make_shared<ShaderFuture::State>();
+    future.state->vertexPath = vertexPath;
+    future.state->fragmentPath = fragmentPath;
+    future.state->defines = defines;
+    future.state->countSteps = countSteps;
+    future.state->requested = std::chrono::steady_clock::now();
+    if (stats.requested++ == 0)
+        firstRequest = future.state->requested;
+    pending.push_back(future.state);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        toRead.push_back(future.state);
+    }
+    hasWork.notify_one();
+    return future;
+}
+
+void ShaderLoader::poll()
+{
+    // submit everything that was read before finishing anything, so the
+    // driver has all of it to work on
+    for (const std::shared_ptr<ShaderFuture::State>& state : pending)
+    {
+        if (state->submitted || !state->read.load(std::memory_order_acquire))
+            continue;
+        state->submitted = true;
+        state->shader.reset(new Shader());
+        state->frameGlobals = state->shader->prepareSources(state->vertexCode, state->fragmentCode);
+        state->sourceHash = ProgramCache::hashSources(state->vertexCode, state->fragmentCode);
+        if (state->shader->loadCached(state->sourceHash, state->frameGlobals))
+        {
+            state->ready = true;
+            ++stats.cached;
+            continue;
+        }
+        state->compileStart = std::chrono::steady_clock::now();
+        state->shader->submit(state->vertexCode, state->fragmentCode, state->vertex, state->fragment);
+    }
+
+    for (const std::shared_ptr<ShaderFuture::State>& state : pending)
+    {
+        if (!state->submitted || state->ready)
+            continue;
+        GLint done = GL_TRUE;
+        if (parallel)
+            glGetProgramiv(state->shader->ID, GL_COMPLETION_STATUS_KHR, &done);
+        if (!done)
+            continue;
+        state->shader->complete(state->vertex, state->fragment, state->sourceHash, state->frameGlobals,
+                                millisecondsBetween(state->compileStart, std::chrono::steady_clock::now()));
+        state->ready = true;
+    }
+
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < pending.size();)
+    {
+        if (!pending[i]->ready)
+        {
+            ++i;
+            continue;
+        }
+        stats.busyMs += millisecondsBetween(pending[i]->requested, now);
+        lastDone = now;
+        stats.wallMs = millisecondsBetween(firstRequest, lastDone);
+        // the sources are not needed any more, the future keeps the rest
+        pending[i]->vertexCode.clear();
+        pending[i]->fragmentCode.clear();
+        pending.erase(pending.begin() + i);
+    }
+}
+
+void ShaderLoader::wait(const ShaderFuture& future)
+{
+    if (!future.isValid())
+        return;
+    for (poll(); !future.isReady(); poll())
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+}
+
+void ShaderLoader::waitAll()
+{
+    for (poll(); !pending.empty(); poll())
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+}
@@ -0,0 +1,218 @@
+#include "myImplement/shader_permutations.h"
+
+#include "yaml-cpp/yaml.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    std::string fileName(const std::string& path)
+    {
+        const size_t slash = path.find_last_of('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+}
+
+bool QualityTiers::load(const std::string& path)
+{
+    names.clear();
+    shaders.clear();
+    error.clear();
+    try
+    {
+        YAML::Node root = YAML::LoadFile(path);
+        if (!root["tiers"] || !root["tiers"].IsSequence() || root["tiers"].size() == 0)
+        {
+            error = "no 'tiers' list in " + path;
+            return false;
+        }
+        names = root["tiers"].as<std::vector<std::string>>();
+        const YAML::Node list = root["shaders"];
+        if (list && list.IsMap())
+        {
+            for (const std::pair<YAML::Node, YAML::Node>& shader : list)
+            {
+                std::vector<Axis>& axes = shaders[shader.first.as<std::string>()];
+                for (const std::pair<YAML::Node, YAML::Node>& define : shader.second)
+                {
+                    Axis axis;
+                    axis.define = define.first.as<std::string>();
+                    axis.values = define.second.as<std::vector<std::string>>();
+                    if (axis.values.size() != names.size())
+                    {
+                        error = shader.first.as<std::string>() + ": " + axis.define + " needs one value per tier";
+                        names.clear();
+                        shaders.clear();
+                        return false;
+                    }
+                    axes.push_back(axis);
+                }
+            }
+        }
+    }
+    catch (const YAML::Exception& e)
+    {
+        error = "cannot read " + path + ": " + e.what();
+        names.clear();
+        shaders.clear();
+        return false;
+    }
+    return true;
+}
+
+int QualityTiers::find(const std::string& name) const
+{
+    std::vector<std::string>::const_iterator it = std::find(names.begin(), names.end(), name);
+    return it == names.end() ? -1 : int(it - names.begin());
+}
+
+ShaderDefines QualityTiers::definesFor(const std::string& fragmentPath, int tier) const
+{
+    ShaderDefines defines;
+    std::map<std::string, std::vector<Axis>>::const_iterator shader = shaders.find(fileName(fragmentPath));
+    if (shader == shaders.end() || tier < 0 || tier >= getCount())
+        return defines;
+    for (const Axis& axis : shader->second)
+        defines.push_back(std::make_pair(axis.define, axis.values[tier]));
+    return defines;
+}
+
+ShaderPermutations::ShaderPermutations(ShaderLoader& loader, const std::string& vertexPath, const std::string& fragmentPath,
+                                       const QualityTiers* tiers, int tier)
+    : loader(loader), vertexPath(vertexPath), fragmentPath(fragmentPath), current(-1), wanted(0)
+{
+    const int tierCount = tiers && tiers->getCount() > 0 ? tiers->getCount() : 1;
+    for (int t = 0; t < tierCount; ++t)
+    {
+        const ShaderDefines defines = tiers ? tiers->definesFor(fragmentPath, t) : ShaderDefines();
+        size_t index = 0;
+        while (index < permutations.size() && permutations[index].defines != defines)
+            ++index;
+        if (index == permutations.size())
+        {
+            permutations.push_back(Permutation());
+            permutations.back().defines = defines;
+        }
+        tierPermutation.push_back(int(index));
+    }
+    select(tier);
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+    for (Permutation& permutation : permutations)
+    {
+        if (permutation.shader)
+            permutation.shader->release();
+    }
+}
+
+void ShaderPermutations::build(Permutation& permutation)
+{
+    permutation.build = loader.request(vertexPath, fragmentPath, permutation.defines);
+}
+
+void ShaderPermutations::select(int tier)
+{
+    wanted = std::min(std::max(tier, 0), getTierCount() - 1);
+    prewarm(wanted);
+}
+
+void ShaderPermutations::prewarm(int tier)
+{
+    tier = std::min(std::max(tier, 0), getTierCount() - 1);
+    Permutation& permutation = permutations[tierPermutation[tier]];
+    if (!permutation.shader && !permutation.build.isValid())
+        build(permutation);
+}
+
+void ShaderPermutations::reload()
+{
+    const int drawn = current >= 0 ? tierPermutation[current] : -1;
+    for (size_t i = 0; i < permutations.size(); ++i)
+    {
+        Permutation& permutation = permutations[i];
+        // a build still running compiles the old sources, its program is released once done
+        if (permutation.build.isValid())
+            discarded.push_back(permutation.build);
+        permutation.build = ShaderFuture();
+        if (int(i) != drawn && permutation.shader)
+        {
+            permutation.shader->release();
+            permutation.shader.reset();
+        }
+    }
+    if (drawn >= 0)
+        build(permutations[drawn]);
+    prewarm(wanted);
+}
+
+bool ShaderPermutations::update()
+{
+    for (size_t i = 0; i < discarded.size();)
+    {
+        if (!discarded[i].isReady())
+        {
+            ++i;
+            continue;
+        }
+        std::unique_ptr<Shader> shader = discarded[i].take();
+        if (shader)
+            shader->release();
+        discarded.erase(discarded.begin() + i);
+    }
+
+    bool changed = false;
+    const int drawn = current >= 0 ? tierPermutation[current] : -1;
+    for (size_t i = 0; i < permutations.size(); ++i)
+    {
+        Permutation& permutation = permutations[i];
+        if (!permutation.build.isReady())
+            continue;
+        std::unique_ptr<Shader> shader = permutation.build.take();
+        permutation.build = ShaderFuture();
+        // the very first program is drawn even if it failed, like the Shader constructor's
+        if (!shader->isLinked() && (permutation.shader || current >= 0))
+        {
+            if (permutation.shader)
+                std::cout << "ERROR::SHADER:: " << fragmentPath << " did not build, keeping the previous program" << std::endl;
+            else
+                std::cout << "ERROR::SHADER:: " << fragmentPath << " did not build at this tier, staying at the current one" << std::endl;
+            shader->release();
+            if (!permutation.shader && tierPermutation[wanted] == int(i))
+                wanted = current;
+            continue;
+        }
+        if (setup)
+            setup(*shader);
+        if (permutation.shader)
+            permutation.shader->release();
+        permutation.shader = std::move(shader);
+        changed = changed || int(i) == drawn;
+    }
+
+    if (wanted != current && permutations[tierPermutation[wanted]].shader)
+    {
+        changed = changed || drawn != tierPermutation[wanted];
+        current = wanted;
+    }
+    return changed;
+}
+
+void ShaderPermutations::wait()
+{
+    for (update(); current < 0; update())
+    {
+        loader.poll();
+        if (!permutations[tierPermutation[wanted]].build.isReady())
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+}
+
+Shader* ShaderPermutations::get() const
+{
+    return current >= 0 ? permutations[tierPermutation[current]].shader.get() : nullptr;
+}
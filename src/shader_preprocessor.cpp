@@ -0,0 +1,495 @@
+#include "myImplement/shader_preprocessor.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    // FNV-1a, only used to notice changed files
+    unsigned long long hashText(const std::string& text)
+    {
+        unsigned long long hash = 1469598103934665603ULL;
+        for (unsigned char c : text)
+        {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    // "a/./b/../c" -> "a/c", so one file reached two ways is included once
+    std::string normalize(const std::string& path)
+    {
+        std::vector<std::string> parts;
+        std::stringstream stream(path);
+        std::string part;
+        while (std::getline(stream, part, '/'))
+        {
+            if (part.empty() || part == ".")
+                continue;
+            if (part == ".." && !parts.empty() && parts.back() != "..")
+                parts.pop_back();
+            else
+                parts.push_back(part);
+        }
+        std::string result = !path.empty() && path[0] == '/' ? "/" : "";
+        for (size_t i = 0; i < parts.size(); ++i)
+            result += (i ? "/" : "") + parts[i];
+        return result.empty() ? "." : result;
+    }
+
+    std::string directoryOf(const std::string& path)
+    {
+        const size_t slash = path.find_last_of('/');
+        return slash == std::string::npos ? "." : path.substr(0, slash);
+    }
+
+    bool fileExists(const std::string& path)
+    {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 && (info.st_mode & S_IFDIR) == 0;
+    }
+
+    // the name in '#include "name"' or '#include <name>', empty for any other line
+    std::string includedName(const std::string& line)
+    {
+        size_t i = line.find_first_not_of(" \t");
+        if (i == std::string::npos || line[i] != '#')
+            return "";
+        i = line.find_first_not_of(" \t", i + 1);
+        if (i == std::string::npos || line.compare(i, 7, "include") != 0)
+            return "";
+        i = line.find_first_not_of(" \t", i + 7);
+        if (i == std::string::npos || (line[i] != '"' && line[i] != '<'))
+            return "";
+        const size_t end = line.find(line[i] == '"' ? '"' : '>', i + 1);
+        return end == std::string::npos ? "" : line.substr(i + 1, end - i - 1);
+    }
+
+    std::string lineDirective(int line, int id)
+    {
+        return "#line " + std::to_string(line) + " " + std::to_string(id) + "\n";
+    }
+
+    bool isWordChar(char c)
+    {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    // 'word' at 'at' in 'text', not as part of a longer name
+    bool wordAt(const std::string& text, size_t at, const std::string& word)
+    {
+        return text.compare(at, word.size(), word) == 0 && (at == 0 || !isWordChar(text[at - 1])) &&
+               (at + word.size() >= text.size() || !isWordChar(text[at + word.size()]));
+    }
+
+    size_t skipSpace(const std::string& text, size_t at)
+    {
+        const size_t next = text.find_first_not_of(" \t\r\n", at);
+        return next == std::string::npos ? text.size() : next;
+    }
+
+    int lineOf(const std::string& text, size_t at)
+    {
+        return 1 + int(std::count(text.begin(), text.begin() + std::min(at, text.size()), '\n'));
+    }
+
+    // text to put in at 'at' in place of 'length' characters
+    struct Edit
+    {
+        size_t at;
+        size_t length;
+        std::string text;
+    };
+}
+
+void overrideDefines(std::string& source, const ShaderDefines& defines, std::vector<bool>& found)
+{
+    found.resize(defines.size(), false);
+    if (defines.empty())
+        return;
+    std::string out;
+    out.reserve(source.size());
+    size_t start = 0;
+    while (start < source.size())
+    {
+        size_t end = source.find('\n', start);
+        end = end == std::string::npos ? source.size() : end;
+        const std::string line = source.substr(start, end - start);
+        size_t i = line.find_first_not_of(" \t");
+        bool replaced = false;
+        if (i != std::string::npos && line[i] == '#')
+        {
+            i = line.find_first_not_of(" \t", i + 1);
+            if (i != std::string::npos && line.compare(i, 6, "define") == 0)
+            {
+                const size_t name = line.find_first_not_of(" \t", i + 6);
+                const size_t nameEnd = name == std::string::npos ? name : line.find_first_of(" \t(", name);
+                const std::string defined = name == std::string::npos ? "" : line.substr(name, nameEnd - name);
+                // function-like macros are left alone
+                const bool functionLike = nameEnd != std::string::npos && line[nameEnd] == '(';
+                for (size_t d = 0; d < defines.size() && !functionLike; ++d)
+                {
+                    if (defines[d].first != defined)
+                        continue;
+                    out += "#define " + defined + " " + defines[d].second;
+                    found[d] = true;
+                    replaced = true;
+                    break;
+                }
+            }
+        }
+        if (!replaced)
+            out += line;
+        if (end < source.size())
+            out += '\n';
+        start = end + 1;
+    }
+    source = out;
+}
+
+int instrumentStepCount(std::string& source, std::string& error)
+{
+    std::vector<Edit> edits;
+    // the first output, every other global follows it
+    size_t output = std::string::npos;
+    size_t lineStart = 0;
+    while (lineStart < source.size() && output == std::string::npos)
+    {
+        size_t lineEnd = source.find('\n', lineStart);
+        lineEnd = lineEnd == std::string::npos ? source.size() : lineEnd;
+        const size_t first = skipSpace(source, lineStart);
+        if (first < lineEnd && (wordAt(source, first, "out") || wordAt(source, first, "layout")))
+        {
+            const size_t semicolon = source.find(';', first);
+            for (size_t i = first; i < std::min(lineEnd, semicolon); ++i)
+            {
+                if (wordAt(source, i, "out"))
+                {
+                    output = first;
+                    break;
+                }
+            }
+            if (output != std::string::npos && semicolon < lineEnd)
+            {
+                if (wordAt(source, first, "out"))
+                    edits.push_back(Edit{ first, 0, "layout(location = 0) " });
+                else
+                {
+                    const size_t location = source.find("location", first);
+                    const size_t value = location < semicolon ? source.find_first_not_of(" \t=", location + 8) : std::string::npos;
+                    if (value >= semicolon || source[value] != '0')
+                    {
+                        error = "the first fragment output, line " + std::to_string(lineOf(source, first)) + ", is not at location 0";
+                        return 0;
+                    }
+                }
+                edits.push_back(Edit{ semicolon + 1, 0, " layout(location = 1) out float " STEP_COUNT_OUTPUT "; int stepCount_ = 0;" });
+            }
+            else if (output != std::string::npos)
+            {
+                error = "the fragment output on line " + std::to_string(lineOf(source, first)) + " is not declared on one line";
+                return 0;
+            }
+        }
+        lineStart = lineEnd + 1;
+    }
+    if (output == std::string::npos)
+    {
+        error = "no fragment output is declared";
+        return 0;
+    }
+
+    int loops = 0;
+    for (size_t at = source.find("count_steps"); at != std::string::npos; at = source.find("count_steps", at + 1))
+    {
+        // '#pragma count_steps', alone on its line
+        const size_t start = source.rfind('\n', at) == std::string::npos ? 0 : source.rfind('\n', at) + 1;
+        const size_t hash = skipSpace(source, start);
+        const size_t pragma = hash < at && source[hash] == '#' ? skipSpace(source, hash + 1) : at;
+        if (pragma >= at || !wordAt(source, pragma, "pragma") || skipSpace(source, pragma + 6) != at)
+            continue;
+        const std::string where = "the loop marked on line " + std::to_string(lineOf(source, at));
+        if (at < output)
+        {
+            error = where + " comes before the fragment output";
+            return 0;
+        }
+        size_t loop = skipSpace(source, source.find('\n', at) == std::string::npos ? source.size() : source.find('\n', at));
+        size_t body = std::string::npos;
+        if (wordAt(source, loop, "do"))
+            body = skipSpace(source, loop + 2);
+        else if (wordAt(source, loop, "for") || wordAt(source, loop, "while"))
+        {
+            size_t i = skipSpace(source, loop + (source[loop] == 'f' ? 3 : 5));
+            int depth = 0;
+            for (; i < source.size(); ++i)
+            {
+                depth += source[i] == '(' ? 1 : source[i] == ')' ? -1 : 0;
+                if (depth == 0)
+                    break;
+            }
+            body = skipSpace(source, i + 1);
+        }
+        if (body >= source.size() || source[body] != '{')
+        {
+            error = where + " is not a for, while or do loop with braces";
+            return 0;
+        }
+        edits.push_back(Edit{ body + 1, 0, " ++stepCount_;" });
+        ++loops;
+    }
+    if (loops == 0)
+    {
+        error = "no loop is marked with #pragma count_steps";
+        return 0;
+    }
+
+    // main() runs as a function of the new main, which writes the count
+    size_t main = std::string::npos;
+    for (size_t at = source.find("main"); at != std::string::npos && main == std::string::npos; at = source.find("main", at + 1))
+    {
+        const size_t before = source.find_last_not_of(" \t\r\n", at == 0 ? 0 : at - 1);
+        if (wordAt(source, at, "main") && before != std::string::npos && before >= 3 &&
+            wordAt(source, before - 3, "void") && source[skipSpace(source, at + 4)] == '(')
+            main = at;
+    }
+    if (main == std::string::npos)
+    {
+        error = "no main() to count the steps of";
+        return 0;
+    }
+    edits.push_back(Edit{ main, 4, "countedMain_" });
+    edits.push_back(Edit{ source.size(), 0,
+        "\nvoid main()\n{\n    countedMain_();\n    " STEP_COUNT_OUTPUT " = float(stepCount_);\n}\n" });
+
+    // from the back, so the positions before each edit still hold
+    std::sort(edits.begin(), edits.end(), [](const Edit& a, const Edit& b) { return a.at > b.at; });
+    for (const Edit& edit : edits)
+        source.replace(edit.at, edit.length, edit.text);
+    return loops;
+}
+
+std::string PreprocessStats::summary() const
+{
+    char text[128];
+    snprintf(text, sizeof(text), "%d sources expanded, %d reused unchanged, %d files read",
+             expanded, reused, filesRead);
+    return text;
+}
+
+ShaderPreprocessor::ShaderPreprocessor(const std::string& library)
+    : library(library), paths(1)
+{
+}
+
+const ShaderPreprocessor::SourceFile* ShaderPreprocessor::refresh(const std::string& path)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return nullptr;
+#if defined(__linux__)
+    const long long modified = (long long)info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+#else
+    const long long modified = (long long)info.st_mtime;
+#endif
+    std::map<std::string, SourceFile>::iterator known = files.find(path);
+    if (known != files.end() && known->second.modified == modified && known->second.size == (long long)info.st_size)
+        return &known->second;
+
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file)
+        return nullptr;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    ++stats.filesRead;
+    if (known == files.end())
+    {
+        known = files.insert(std::make_pair(path, SourceFile())).first;
+        known->second.id = int(paths.size());
+        paths.push_back(path);
+    }
+    SourceFile& source = known->second;
+    source.modified = modified;
+    source.size = (long long)info.st_size;
+    source.text = stream.str();
+    source.hash = hashText(source.text);
+    return &source;
+}
+
+std::string ShaderPreprocessor::resolve(const std::string& name, const std::string& from) const
+{
+    const std::string nextTo = normalize(directoryOf(from) + "/" + name);
+    if (fileExists(nextTo))
+        return nextTo;
+    if (!library.empty())
+    {
+        const std::string inLibrary = normalize(library + "/" + name);
+        if (fileExists(inLibrary))
+            return inLibrary;
+    }
+    return "";
+}
+
+bool ShaderPreprocessor::include(const std::string& path, std::vector<std::string>& seen, std::string& out,
+                                 std::vector<std::pair<std::string, unsigned long long>>& pulled)
+{
+    const SourceFile* source = refresh(path);
+    if (!source)
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+        return false;
+    }
+    const int id = source->id;
+    const std::string& text = source->text;
+    seen.push_back(path);
+    pulled.push_back(std::make_pair(path, source->hash));
+
+    bool ok = true;
+    std::istringstream stream(text);
+    std::string line;
+    int number = 0;
+    while (std::getline(stream, line))
+    {
+        ++number;
+        const std::string name = includedName(line);
+        if (name.empty())
+        {
+            out += line;
+            // keep the last line as it was, with or without its newline
+            if (!stream.eof())
+                out += '\n';
+            continue;
+        }
+        const std::string resolved = resolve(name, path);
+        const SourceFile* included = resolved.empty() ? nullptr : refresh(resolved);
+        if (!included)
+        {
+            std::cout << "ERROR::SHADER::INCLUDE:: " << path << ":" << number << ": cannot find \"" << name << "\"" << std::endl;
+            out += line + "\n";
+            ok = false;
+            continue;
+        }
+        if (std::find(seen.begin(), seen.end(), resolved) != seen.end())
+        {
+            out += "\n";
+            continue;
+        }
+        out += lineDirective(1, included->id);
+        ok = include(resolved, seen, out, pulled) && ok;
+        if (!out.empty() && out.back() != '\n')
+            out += '\n';
+        out += lineDirective(number + 1, id);
+    }
+    return ok;
+}
+
+bool ShaderPreprocessor::expand(const std::string& path, std::string& source)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    ++stats.expanded;
+    std::map<std::string, Expansion>::const_iterator cached = expansions.find(path);
+    if (cached != expansions.end())
+    {
+        bool unchanged = true;
+        for (const std::pair<std::string, unsigned long long>& file : cached->second.files)
+        {
+            const SourceFile* current = refresh(file.first);
+            unchanged = unchanged && current && current->hash == file.second;
+        }
+        if (unchanged)
+        {
+            ++stats.reused;
+            source = cached->second.text;
+            return true;
+        }
+    }
+
+    Expansion expansion;
+    std::vector<std::string> seen;
+    const bool ok = include(path, seen, expansion.text, expansion.files);
+    if (expansion.files.size() > 1)
+    {
+        // the lines before the first include belong to this file too, name
+        // it from the start; #version has to stay the first directive
+        const int id = files[path].id;
+        const size_t version = expansion.text.find("#version");
+        const size_t end = version == std::string::npos ? version : expansion.text.find('\n', version);
+        if (end != std::string::npos)
+        {
+            const int next = int(std::count(expansion.text.begin(), expansion.text.begin() + end, '\n')) + 2;
+            expansion.text.insert(end + 1, lineDirective(next, id));
+        }
+        else
+            expansion.text.insert(0, lineDirective(1, id));
+    }
+    source = expansion.text;
+    if (ok)
+        expansions[path] = expansion;
+    else
+        expansions.erase(path);
+    return ok;
+}
+
+std::string ShaderPreprocessor::mapLog(const std::string& log) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::istringstream stream(log);
+    std::string line;
+    std::string out;
+    while (std::getline(stream, line))
+    {
+        // "3:12(5): error" (Mesa) or "3(12) : error" (NVIDIA), 3 being the source string
+        size_t digits = 0;
+        while (digits < line.size() && isdigit((unsigned char)line[digits]))
+            ++digits;
+        if (digits > 0 && digits < line.size() && (line[digits] == ':' || line[digits] == '('))
+        {
+            const size_t id = size_t(atoi(line.substr(0, digits).c_str()));
+            if (id > 0 && id < paths.size())
+                line = paths[id] + line.substr(digits);
+        }
+        out += line + "\n";
+    }
+    return out;
+}
+
+std::vector<std::string> ShaderPreprocessor::includesOf(const std::string& path) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<std::string> includes;
+    std::map<std::string, Expansion>::const_iterator expansion = expansions.find(path);
+    if (expansion == expansions.end())
+        return includes;
+    // the first file pulled in is the source itself
+    for (size_t i = 1; i < expansion->second.files.size(); ++i)
+        includes.push_back(expansion->second.files[i].first);
+    return includes;
+}
+
+std::vector<std::string> ShaderPreprocessor::includersOf(const std::string& path) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<std::string> includers;
+    for (const std::pair<const std::string, Expansion>& expansion : expansions)
+    {
+        for (size_t i = 1; i < expansion.second.files.size(); ++i)
+        {
+            if (expansion.second.files[i].first == path)
+                includers.push_back(expansion.first);
+        }
+    }
+    return includers;
+}
+
+PreprocessStats ShaderPreprocessor::getStats() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
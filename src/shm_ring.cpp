@@ -0,0 +1,284 @@
+#include "myImplement/shm_ring.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char SHM_MAGIC[8] = { 'S', 'T', 'O', 'Y', 'R', 'I', 'N', 'G' };
+    // the ring header gets the first page, every slot starts on a page and
+    // its pixels 64 bytes in, so readers can hand them to SIMD code or a GPU upload
+    const size_t PAGE = 4096;
+    const size_t PIXEL_OFFSET = 64;
+
+    static_assert(sizeof(ShmRingHeader) <= PAGE, "the ring header must fit its page");
+    static_assert(sizeof(ShmSlotHeader) <= PIXEL_OFFSET, "the slot header must fit before the pixels");
+
+    size_t roundUp(size_t bytes, size_t alignment)
+    {
+        return (bytes + alignment - 1) / alignment * alignment;
+    }
+}
+
+// ================================= writer =================================
+ShmFrameWriter::ShmFrameWriter()
+    : base(nullptr), size(0), published(0)
+{
+}
+
+ShmFrameWriter::~ShmFrameWriter()
+{
+    close();
+}
+
+bool ShmFrameWriter::open(const std::string& name, int width, int height, int slotCount)
+{
+    close();
+#if defined(_WIN32)
+    std::cout << "ERROR::SHM_RING:: shared memory frames need POSIX shm, " << name << " not created" << std::endl;
+    return false;
+#else
+    if (slotCount < 2)
+        slotCount = 2;
+    const size_t frameBytes = size_t(width) * height * 4;
+    const size_t slotStride = roundUp(PIXEL_OFFSET + frameBytes, PAGE);
+    const size_t bytes = PAGE + slotStride * slotCount;
+
+    // a ring left behind by a crashed run would keep its old size
+    shm_unlink(name.c_str());
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        std::cout << "ERROR::SHM_RING:: cannot create " << name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    void* mapping = MAP_FAILED;
+    if (ftruncate(fd, off_t(bytes)) == 0)
+        mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        std::cout << "ERROR::SHM_RING:: cannot map " << bytes << " bytes for " << name << ": " << strerror(errno) << std::endl;
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    this->name = name;
+    base = static_cast<unsigned char*>(mapping);
+    size = bytes;
+    published = 0;
+
+    ShmRingHeader* header = reinterpret_cast<ShmRingHeader*>(base);
+    header->version = SHM_RING_VERSION;
+    header->slotCount = uint32_t(slotCount);
+    header->width = uint32_t(width);
+    header->height = uint32_t(height);
+    header->frameBytes = frameBytes;
+    header->slotStride = slotStride;
+    new (&header->published) std::atomic<uint64_t>(0);
+    new (&header->closed) std::atomic<uint32_t>(0);
+    for (int i = 0; i < slotCount; ++i)
+    {
+        ShmSlotHeader* slot = reinterpret_cast<ShmSlotHeader*>(base + PAGE + slotStride * i);
+        new (&slot->sequence) std::atomic<uint64_t>(0);
+        slot->frameIndex = -1;
+        slot->time = 0.0;
+    }
+    // readers check the magic first, everything above must be visible by then
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, SHM_MAGIC, sizeof(SHM_MAGIC));
+    return true;
+#endif
+}
+
+void ShmFrameWriter::close()
+{
+#if !defined(_WIN32)
+    if (!base)
+        return;
+    reinterpret_cast<ShmRingHeader*>(base)->closed.store(1, std::memory_order_release);
+    munmap(base, size);
+    shm_unlink(name.c_str());
+#endif
+    base = nullptr;
+    size = 0;
+}
+
+void ShmFrameWriter::publish(const unsigned char* rgba, int64_t frameIndex, double time)
+{
+    if (!base)
+        return;
+    ShmRingHeader* header = reinterpret_cast<ShmRingHeader*>(base);
+    unsigned char* slotBase = base + PAGE + header->slotStride * (published % header->slotCount);
+    ShmSlotHeader* slot = reinterpret_cast<ShmSlotHeader*>(slotBase);
+
+    // seqlock: odd while the pixels change, and that store lands before them
+    slot->sequence.store(2 * published + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(slotBase + PIXEL_OFFSET, rgba, header->frameBytes);
+    slot->frameIndex = frameIndex;
+    slot->time = time;
+    slot->sequence.store(2 * published + 2, std::memory_order_release);
+
+    ++published;
+    header->published.store(published, std::memory_order_release);
+}
+
+// ================================= reader =================================
+ShmFrameReader::ShmFrameReader()
+    : base(nullptr), size(0), header(nullptr), next(0), overruns(0), torn(0)
+{
+}
+
+ShmFrameReader::~ShmFrameReader()
+{
+    close();
+}
+
+bool ShmFrameReader::open(const std::string& name)
+{
+    close();
+#if defined(_WIN32)
+    std::cout << "ERROR::SHM_RING:: shared memory frames need POSIX shm, cannot open " << name << std::endl;
+    return false;
+#else
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        std::cout << "ERROR::SHM_RING:: cannot open " << name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && size_t(info.st_size) >= PAGE)
+        mapping = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        std::cout << "ERROR::SHM_RING:: cannot map " << name << std::endl;
+        return false;
+    }
+    base = static_cast<const unsigned char*>(mapping);
+    size = size_t(info.st_size);
+    header = reinterpret_cast<const ShmRingHeader*>(base);
+
+    const bool valid = memcmp(header->magic, SHM_MAGIC, sizeof(SHM_MAGIC)) == 0 && header->version == SHM_RING_VERSION &&
+                       header->slotCount >= 2 && PAGE + header->slotStride * header->slotCount <= size &&
+                       header->frameBytes + PIXEL_OFFSET <= header->slotStride;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!valid)
+    {
+        std::cout << "ERROR::SHM_RING:: " << name << " is not a frame ring of version " << SHM_RING_VERSION << std::endl;
+        close();
+        return false;
+    }
+    // start with whatever is newest, older frames may be overwritten any moment
+    const uint64_t published = header->published.load(std::memory_order_acquire);
+    next = published > 0 ? published - 1 : 0;
+    overruns = 0;
+    torn = 0;
+    return true;
+#endif
+}
+
+void ShmFrameReader::close()
+{
+#if !defined(_WIN32)
+    if (base)
+        munmap(const_cast<unsigned char*>(base), size);
+#endif
+    base = nullptr;
+    header = nullptr;
+    size = 0;
+}
+
+const ShmSlotHeader* ShmFrameReader::slotOf(uint64_t number) const
+{
+    return reinterpret_cast<const ShmSlotHeader*>(base + PAGE + header->slotStride * (number % header->slotCount));
+}
+
+ShmReadStatus ShmFrameReader::acquireNext(ShmFrameView& view)
+{
+    if (!base)
+        return SHM_READ_CLOSED;
+    ShmReadStatus status = SHM_READ_OK;
+    for (;;)
+    {
+        const uint64_t published = header->published.load(std::memory_order_acquire);
+        if (next >= published)
+            return header->closed.load(std::memory_order_acquire) ? SHM_READ_CLOSED : SHM_READ_NONE;
+        // the slot after the newest frame is the one the writer fills next
+        const uint64_t oldest = published > header->slotCount - 1 ? published - (header->slotCount - 1) : 0;
+        if (next < oldest)
+        {
+            overruns += oldest - next;
+            next = oldest;
+            status = SHM_READ_OVERRUN;
+        }
+        const ShmSlotHeader* slot = slotOf(next);
+        const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence == 2 * next + 2)
+        {
+            view.pixels = reinterpret_cast<const unsigned char*>(slot) + PIXEL_OFFSET;
+            view.number = next;
+            view.frameIndex = slot->frameIndex;
+            view.time = slot->time;
+            view.width = int(header->width);
+            view.height = int(header->height);
+            view.sequence = sequence;
+            ++next;
+            return status;
+        }
+        // lapped between the two loads, this frame is gone
+        ++overruns;
+        ++next;
+        status = SHM_READ_OVERRUN;
+    }
+}
+
+ShmReadStatus ShmFrameReader::acquireLatest(ShmFrameView& view)
+{
+    if (!base)
+        return SHM_READ_CLOSED;
+    const uint64_t published = header->published.load(std::memory_order_acquire);
+    if (next >= published)
+        return header->closed.load(std::memory_order_acquire) ? SHM_READ_CLOSED : SHM_READ_NONE;
+    // skipping frames on purpose is not an overrun
+    next = published - 1;
+    const ShmReadStatus status = acquireNext(view);
+    return status == SHM_READ_OVERRUN ? SHM_READ_OK : status;
+}
+
+bool ShmFrameReader::release(const ShmFrameView& view)
+{
+    if (!base)
+        return false;
+    // the pixel reads above must not move past the second sequence load
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const bool intact = slotOf(view.number)->sequence.load(std::memory_order_relaxed) == view.sequence;
+    if (!intact)
+        ++torn;
+    return intact;
+}
+
+ShmReadStatus ShmFrameReader::copyLatest(std::vector<unsigned char>& pixels, ShmFrameView& view)
+{
+    for (;;)
+    {
+        const ShmReadStatus status = acquireLatest(view);
+        if (status != SHM_READ_OK)
+            return status;
+        pixels.assign(view.pixels, view.pixels + size_t(view.width) * view.height * 4);
+        if (release(view))
+            return SHM_READ_OK;
+    }
+}
@@ -0,0 +1,136 @@
+#include "myImplement/step_heatmap.h"
+
+#include <algorithm>
+#include <cstdio>
+
+std::string StepHistogram::summary() const
+{
+    char text[200];
+    snprintf(text, sizeof(text), "%d of %d pixels counted, steps mean %.1f p50 %.0f p95 %.0f max %.0f, %.1f%% at the budget of %d",
+             counted, pixels, mean, p50, p95, max, overBudget * 100.0f, budget);
+    return text;
+}
+
+StepHeatmap::StepHeatmap(int width, int height, int budget)
+    : target(width, height, GL_RGBA8, false), countTex(0), budget(std::max(budget, 1)), overlayResolved(nullptr)
+{
+    if (!target.isValid())
+        return;
+    // counts are read as they are, never filtered
+    glGenTextures(1, &countTex);
+    glBindTexture(GL_TEXTURE_2D, countTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target.getFBO());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, countTex, 0);
+    const GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, buffers);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::FRAMEBUFFER:: the step count attachment is not complete!" << std::endl;
+        glDeleteTextures(1, &countTex);
+        countTex = 0;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+StepHeatmap::~StepHeatmap()
+{
+    if (countTex)
+        glDeleteTextures(1, &countTex);
+}
+
+void StepHeatmap::bind(int width, int height)
+{
+    target.bind();
+    // a pixel the counted program does not draw keeps 0 steps
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glViewport(0, 0, width, height);
+}
+
+void StepHeatmap::present(Shader& overlay, int width, int height, float opacity)
+{
+    overlay.use();
+    if (&overlay != overlayResolved)
+    {
+        // the samplers never change unit, set them once per program
+        overlay.set(overlay.uniform<int>("sceneTex"), 0);
+        overlay.set(overlay.uniform<int>("countTex"), 1);
+        overlaySize = overlay.uniform<glm::vec2>("sourceSize");
+        overlayBudget = overlay.uniform<float>("budget");
+        overlayOpacity = overlay.uniform<float>("opacity");
+        overlayResolved = &overlay;
+    }
+    overlay.set(overlaySize, glm::vec2(float(width), float(height)));
+    overlay.set(overlayBudget, float(budget));
+    overlay.set(overlayOpacity, opacity);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, target.getTexture());
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, countTex);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+const StepHistogram& StepHeatmap::collect(int width, int height, int size)
+{
+    width = std::min(width, target.getWidth());
+    height = std::min(height, target.getHeight());
+    counts.resize(size_t(width) * height);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target.getFBO());
+    glReadBuffer(GL_COLOR_ATTACHMENT1);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RED, GL_FLOAT, counts.data());
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    // counts are whole numbers, a tally of each gives exact percentiles
+    histogram = StepHistogram();
+    histogram.pixels = int(counts.size());
+    histogram.budget = budget;
+    histogram.buckets.assign(std::max(size, 1), 0.0f);
+    std::vector<int> tally;
+    double sum = 0.0;
+    for (float count : counts)
+    {
+        if (count < 1.0f)
+            continue;
+        const int steps = int(count + 0.5f);
+        if (steps >= int(tally.size()))
+            tally.resize(steps + 1, 0);
+        ++tally[steps];
+        ++histogram.counted;
+        sum += steps;
+        const int bucket = std::min(int(histogram.buckets.size()) - 1, steps * int(histogram.buckets.size()) / budget);
+        histogram.buckets[bucket] += 1.0f;
+        if (steps >= budget)
+            histogram.overBudget += 1.0f;
+    }
+    if (histogram.counted == 0)
+        return histogram;
+
+    const float counted = float(histogram.counted);
+    for (float& bucket : histogram.buckets)
+        bucket /= counted;
+    histogram.overBudget /= counted;
+    histogram.mean = float(sum / counted);
+    histogram.max = float(tally.size() - 1);
+    int seen = 0;
+    for (size_t steps = 0; steps < tally.size(); ++steps)
+    {
+        seen += tally[steps];
+        if (histogram.p50 == 0.0f && seen >= histogram.counted / 2 + 1)
+            histogram.p50 = float(steps);
+        if (seen >= int(histogram.counted * 0.95f + 0.5f))
+        {
+            histogram.p95 = float(steps);
+            break;
+        }
+    }
+    return histogram;
+}
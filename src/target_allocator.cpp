@@ -0,0 +1,121 @@
+#include "myImplement/target_allocator.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
+const int TargetAllocator::PERSISTENT_FIRST = INT_MIN;
+const int TargetAllocator::PERSISTENT_LAST = INT_MAX;
+
+int TargetAllocator::request(int width, int height, GLenum format, bool withDepth, int first, int last)
+{
+    Request request{ width, height, format, withDepth, first, std::max(first, last), -1 };
+    requests.push_back(request);
+    return int(requests.size()) - 1;
+}
+
+int TargetAllocator::requestPersistent(int width, int height, GLenum format, bool withDepth)
+{
+    return request(width, height, format, withDepth, PERSISTENT_FIRST, PERSISTENT_LAST);
+}
+
+bool TargetAllocator::allocate()
+{
+    pool.clear();
+    // interval colouring: in order of first use, every request takes a
+    // compatible target that is free again by then, or a new one. per
+    // size and format this needs as many targets as lifetimes overlap
+    std::vector<int> order(requests.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = int(i);
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b)
+    {
+        return requests[a].first < requests[b].first;
+    });
+
+    std::vector<int> slotLast;
+    owners.clear();
+    for (int index : order)
+    {
+        Request& request = requests[index];
+        request.slot = -1;
+        for (size_t slot = 0; slot < slotLast.size() && request.slot < 0; ++slot)
+        {
+            const Request& owner = requests[owners[slot]];
+            if (slotLast[slot] < request.first && owner.width == request.width && owner.height == request.height &&
+                owner.format == request.format && owner.withDepth == request.withDepth)
+                request.slot = int(slot);
+        }
+        if (request.slot < 0)
+        {
+            request.slot = int(slotLast.size());
+            slotLast.push_back(request.last);
+            owners.push_back(index);
+        }
+        slotLast[request.slot] = request.last;
+    }
+
+    bool complete = true;
+    pool.resize(owners.size());
+    for (size_t slot = 0; slot < owners.size(); ++slot)
+    {
+        const Request& owner = requests[owners[slot]];
+        complete = pool[slot].create(owner.width, owner.height, owner.format, owner.withDepth) && complete;
+    }
+    return complete;
+}
+
+void TargetAllocator::clear()
+{
+    requests.clear();
+    owners.clear();
+    pool.clear();
+}
+
+size_t TargetAllocator::naiveBytes() const
+{
+    size_t bytes = 0;
+    for (const Request& request : requests)
+        bytes += bytesOf(request.width, request.height, request.format, request.withDepth);
+    return bytes;
+}
+
+size_t TargetAllocator::pooledBytes() const
+{
+    size_t bytes = 0;
+    for (int owner : owners)
+        bytes += bytesOf(requests[owner].width, requests[owner].height, requests[owner].format, requests[owner].withDepth);
+    return bytes;
+}
+
+std::string TargetAllocator::summary() const
+{
+    char text[128];
+    snprintf(text, sizeof(text), "%d targets for %d requests, %.1f MB instead of %.1f MB",
+             targetCount(), requestCount(), pooledBytes() / (1024.0 * 1024.0), naiveBytes() / (1024.0 * 1024.0));
+    return text;
+}
+
+size_t TargetAllocator::bytesOf(int width, int height, GLenum format, bool withDepth)
+{
+    size_t texel = 4;
+    switch (format)
+    {
+    case GL_RGBA16F:
+        texel = 8;
+        break;
+    case GL_RGBA32F:
+        texel = 16;
+        break;
+    case GL_R16F:
+        texel = 2;
+        break;
+    case GL_RGB8:
+        texel = 3;
+        break;
+    default:
+        break;
+    }
+    // the depth-stencil render buffer is 4 bytes a pixel too
+    return size_t(width) * size_t(height) * (texel + (withDepth ? 4 : 0));
+}
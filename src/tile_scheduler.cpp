@@ -0,0 +1,209 @@
+#include "myImplement/tile_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+std::string TileStats::summary() const
+{
+    float fastest = 0.0f, slowest = 0.0f;
+    for (size_t i = 0; i < tiles.size(); ++i)
+    {
+        fastest = i == 0 ? tiles[i].ms : std::min(fastest, tiles[i].ms);
+        slowest = std::max(slowest, tiles[i].ms);
+    }
+    double leastBusy = 0.0, mostBusy = 0.0;
+    for (size_t i = 0; i < busyMs.size(); ++i)
+    {
+        leastBusy = i == 0 ? busyMs[i] : std::min(leastBusy, busyMs[i]);
+        mostBusy = std::max(mostBusy, busyMs[i]);
+    }
+    char line[256];
+    snprintf(line, sizeof(line), "%.2f ms, %d tiles (%.3f - %.3f ms), %d steals, %d workers busy %.2f - %.2f ms",
+             frameMs, int(tiles.size()), fastest, slowest, steals, int(busyMs.size()), leastBusy, mostBusy);
+    return line;
+}
+
+TileScheduler::TileScheduler()
+    : tileWidth(64), tileHeight(16), threadCount(0), job(nullptr), generation(0), running(0), stopping(false), steals(0), bufferSize(0)
+{
+}
+
+TileScheduler::~TileScheduler()
+{
+    stopWorkers();
+}
+
+void TileScheduler::setThreadCount(int count)
+{
+    count = std::max(count, 0);
+    if (count == threadCount && !queues.empty())
+        return;
+    threadCount = count;
+    stopWorkers();
+}
+
+void TileScheduler::setTileSize(int width, int height)
+{
+    tileWidth = std::max(width, 1);
+    tileHeight = std::max(height, 1);
+}
+
+void TileScheduler::startWorkers()
+{
+    int count = threadCount > 0 ? threadCount : int(std::thread::hardware_concurrency());
+    count = std::max(count, 1);
+    stopping = false;
+    for (int i = 0; i < count; ++i)
+        queues.emplace_back(new Queue());
+    for (int i = 1; i < count; ++i)
+        workers.emplace_back(&TileScheduler::workerLoop, this, i, generation);
+}
+
+void TileScheduler::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+    workers.clear();
+    queues.clear();
+}
+
+void TileScheduler::workerLoop(int index, unsigned seen)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;)
+    {
+        wake.wait(guard, [&]() { return stopping || generation != seen; });
+        if (stopping)
+            return;
+        seen = generation;
+        const std::function<void(int)>* current = job;
+        guard.unlock();
+        (*current)(index);
+        guard.lock();
+        if (--running == 0)
+            finished.notify_one();
+    }
+}
+
+void TileScheduler::dispatch(const std::function<void(int)>& work)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        job = &work;
+        running = int(workers.size());
+        ++generation;
+    }
+    wake.notify_all();
+    work(0);
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [&]() { return running == 0; });
+}
+
+void TileScheduler::deal(int width, int height)
+{
+    if (queues.empty())
+        startWorkers();
+    tiles.clear();
+    for (int y = 0; y < height; y += tileHeight)
+        for (int x = 0; x < width; x += tileWidth)
+            tiles.push_back(Tile{ x, y, std::min(x + tileWidth, width), std::min(y + tileHeight, height) });
+
+    // contiguous runs keep each worker on the same rows, and the same pages, every frame
+    const int count = int(queues.size());
+    const int total = int(tiles.size());
+    for (int i = 0; i < count; ++i)
+    {
+        std::deque<int>& queue = queues[i]->tiles;
+        queue.clear();
+        for (int t = int(long(total) * i / count); t < int(long(total) * (i + 1) / count); ++t)
+            queue.push_back(t);
+    }
+}
+
+bool TileScheduler::next(int worker, int& tile)
+{
+    {
+        Queue& own = *queues[worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tiles.empty())
+        {
+            tile = own.tiles.front();
+            own.tiles.pop_front();
+            return true;
+        }
+    }
+    // take the back half of the first deque with work left, the owner is busy at its front
+    const int count = int(queues.size());
+    for (int i = 1; i < count; ++i)
+    {
+        std::vector<int> loot;
+        {
+            Queue& victim = *queues[(worker + i) % count];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            const size_t take = (victim.tiles.size() + 1) / 2;
+            loot.assign(victim.tiles.end() - take, victim.tiles.end());
+            victim.tiles.erase(victim.tiles.end() - take, victim.tiles.end());
+        }
+        if (loot.empty())
+            continue;
+        ++steals;
+        tile = loot[0];
+        Queue& own = *queues[worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        own.tiles.insert(own.tiles.end(), loot.begin() + 1, loot.end());
+        return true;
+    }
+    // tiles only ever leave the deques, so an empty sweep means this worker is done
+    return false;
+}
+
+unsigned char* TileScheduler::frameBuffer(int width, int height)
+{
+    const size_t size = size_t(width) * height * 4;
+    if (size != bufferSize)
+    {
+        // new[] without () leaves the pages untouched until a worker writes them
+        buffer.reset(new unsigned char[size]);
+        bufferSize = size;
+        unsigned char* pixels = buffer.get();
+        run(width, height, [=](const Tile& tile, int)
+        {
+            for (int y = tile.y0; y < tile.y1; ++y)
+                memset(pixels + (size_t(y) * width + tile.x0) * 4, 0, size_t(tile.x1 - tile.x0) * 4);
+        });
+    }
+    return buffer.get();
+}
+
+void TileScheduler::run(int width, int height, const std::function<void(const Tile&, int)>& shade)
+{
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    deal(width, height);
+    stats.tiles.resize(tiles.size());
+    stats.busyMs.assign(queues.size(), 0.0);
+    steals = 0;
+
+    const std::function<void(int)> work = [&](int worker)
+    {
+        int index;
+        while (next(worker, index))
+        {
+            const Clock::time_point begin = Clock::now();
+            shade(tiles[index], worker);
+            const float ms = std::chrono::duration<float, std::milli>(Clock::now() - begin).count();
+            stats.tiles[index] = TileTiming{ tiles[index], worker, ms };
+            stats.busyMs[worker] += ms;
+        }
+    };
+    dispatch(work);
+    stats.steals = steals;
+    stats.frameMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
@@ -0,0 +1,261 @@
+#include "myImplement/video_sink.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    // BT.601 limited range in 8 bit fixed point. chroma takes the sum of a
+    // 2x2 block; the +128 << 10 bias keeps the sums positive before the shift
+    inline unsigned char lumaOf(int r, int g, int b)
+    {
+        return (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+
+    inline unsigned char chromaUOf(int r4, int g4, int b4)
+    {
+        return (unsigned char)((-38 * r4 - 74 * g4 + 112 * b4 + (128 << 10) + 512) >> 10);
+    }
+
+    inline unsigned char chromaVOf(int r4, int g4, int b4)
+    {
+        return (unsigned char)((112 * r4 - 94 * g4 - 18 * b4 + (128 << 10) + 512) >> 10);
+    }
+
+#if defined(__GNUC__)
+    // 16 pixels at a time: one pixel per 32 bit lane for luma, two pixels
+    // per 64 bit lane for chroma, so no shuffles are needed to split them
+    const int BLOCK = 16;
+    typedef uint32_t pixel16 __attribute__((vector_size(64)));
+    typedef int32_t int16v __attribute__((vector_size(64)));
+    typedef uint64_t pair8 __attribute__((vector_size(64)));
+    typedef int32_t int8v __attribute__((vector_size(32)));
+
+    inline void lumaBlock(const unsigned char* rgba, unsigned char* y)
+    {
+        pixel16 p;
+        memcpy(&p, rgba, sizeof(p));
+        const int16v r = (int16v)(p & 0xffu);
+        const int16v g = (int16v)((p >> 8) & 0xffu);
+        const int16v b = (int16v)((p >> 16) & 0xffu);
+        const int16v luma = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+        for (int i = 0; i < BLOCK; ++i)
+            y[i] = (unsigned char)luma[i];
+    }
+
+    // vectors go by reference, by value their ABI depends on -mavx
+    inline void pairSum(const pair8& a, const pair8& b, int shift, int8v& sum)
+    {
+        const pair8 wide = ((a >> shift) & 0xffu) + ((a >> (shift + 32)) & 0xffu) +
+                           ((b >> shift) & 0xffu) + ((b >> (shift + 32)) & 0xffu);
+        sum = __builtin_convertvector(wide, int8v);
+    }
+
+    inline void chromaBlock(const unsigned char* row0, const unsigned char* row1, unsigned char* u, unsigned char* v, int step)
+    {
+        pair8 a, b;
+        memcpy(&a, row0, sizeof(a));
+        memcpy(&b, row1, sizeof(b));
+        int8v r4, g4, b4;
+        pairSum(a, b, 0, r4);
+        pairSum(a, b, 8, g4);
+        pairSum(a, b, 16, b4);
+        const int8v cu = (-38 * r4 - 74 * g4 + 112 * b4 + (128 << 10) + 512) >> 10;
+        const int8v cv = (112 * r4 - 94 * g4 - 18 * b4 + (128 << 10) + 512) >> 10;
+        for (int i = 0; i < BLOCK / 2; ++i)
+        {
+            u[i * step] = (unsigned char)cu[i];
+            v[i * step] = (unsigned char)cv[i];
+        }
+    }
+#else
+    const int BLOCK = 0;
+#endif
+}
+
+void rgbaToYuv420(const unsigned char* rgba, int width, int height, bool flipY,
+                  unsigned char* yPlane, unsigned char* uPlane, unsigned char* vPlane, int chromaStep)
+{
+    const int chromaWid = (width + 1) / 2;
+    const size_t stride = size_t(width) * 4;
+    for (int cy = 0; cy < (height + 1) / 2; ++cy)
+    {
+        const int y0 = cy * 2;
+        const int y1 = std::min(y0 + 1, height - 1);
+        const unsigned char* row0 = rgba + stride * (flipY ? height - 1 - y0 : y0);
+        const unsigned char* row1 = rgba + stride * (flipY ? height - 1 - y1 : y1);
+        unsigned char* luma0 = yPlane + size_t(width) * y0;
+        unsigned char* luma1 = yPlane + size_t(width) * y1;
+        unsigned char* u = uPlane + size_t(chromaWid) * chromaStep * cy;
+        unsigned char* v = vPlane + size_t(chromaWid) * chromaStep * cy;
+
+        int x = 0;
+#if defined(__GNUC__)
+        for (; x + BLOCK <= width; x += BLOCK)
+        {
+            lumaBlock(row0 + x * 4, luma0 + x);
+            lumaBlock(row1 + x * 4, luma1 + x);
+            chromaBlock(row0 + x * 4, row1 + x * 4, u + x / 2 * chromaStep, v + x / 2 * chromaStep, chromaStep);
+        }
+#endif
+        const int blockEnd = x;
+        for (; x < width; ++x)
+        {
+            luma0[x] = lumaOf(row0[x * 4], row0[x * 4 + 1], row0[x * 4 + 2]);
+            luma1[x] = lumaOf(row1[x * 4], row1[x * 4 + 1], row1[x * 4 + 2]);
+        }
+        for (int cx = blockEnd / 2; cx < chromaWid; ++cx)
+        {
+            const int x0 = cx * 2;
+            const int x1 = std::min(x0 + 1, width - 1);
+            int sum[3];
+            for (int c = 0; c < 3; ++c)
+                sum[c] = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+            u[cx * chromaStep] = chromaUOf(sum[0], sum[1], sum[2]);
+            v[cx * chromaStep] = chromaVOf(sum[0], sum[1], sum[2]);
+        }
+    }
+}
+
+std::string VideoStats::summary() const
+{
+    char text[160];
+    snprintf(text, sizeof(text), "%d frames, %.1f MB, convert %.2f ms/frame, write %.2f ms/frame, renderer stalled %.1f ms",
+             frames, megabytes, frames ? convertMs / frames : 0.0, frames ? writeMs / frames : 0.0, stallMs);
+    return text;
+}
+
+VideoSink::VideoSink()
+    : file(nullptr), ownsFile(false), nv12(false), width(0), height(0), closing(false), failed(false)
+{
+}
+
+VideoSink::~VideoSink()
+{
+    close();
+}
+
+bool VideoSink::open(const std::string& path, int width, int height, int fps, int queueDepth)
+{
+    close();
+    nv12 = path.size() > 5 && path.compare(path.size() - 5, 5, ".nv12") == 0;
+    ownsFile = path != "-";
+    file = ownsFile ? fopen(path.c_str(), "wb") : stdout;
+    if (!file)
+    {
+        std::cout << "ERROR::VIDEO_SINK:: cannot open " << path << std::endl;
+        return false;
+    }
+    this->width = width;
+    this->height = height;
+    closing = false;
+    failed = false;
+    stats = VideoStats();
+    if (!nv12)
+    {
+        // C420jpeg: chroma sited between the luma samples, like our 2x2 average
+        if (fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, std::max(fps, 1)) < 0)
+            failed = true;
+    }
+
+    buffers.assign(std::max(queueDepth, 1), std::vector<unsigned char>(size_t(width) * height * 4));
+    freeBuffers.clear();
+    queued.clear();
+    for (size_t i = 0; i < buffers.size(); ++i)
+        freeBuffers.push_back(int(i));
+    writer = std::thread(&VideoSink::writerLoop, this);
+    return !failed;
+}
+
+bool VideoSink::push(const unsigned char* rgba)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    if (freeBuffers.empty())
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        hasRoom.wait(guard, [this]() { return !freeBuffers.empty(); });
+        stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (failed)
+        return false;
+    const int index = freeBuffers.front();
+    freeBuffers.pop_front();
+    guard.unlock();
+
+    memcpy(buffers[index].data(), rgba, buffers[index].size());
+
+    guard.lock();
+    queued.push_back(index);
+    hasFrame.notify_one();
+    return true;
+}
+
+bool VideoSink::close()
+{
+    if (!file)
+        return !failed;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        closing = true;
+    }
+    hasFrame.notify_all();
+    writer.join();
+    if (fflush(file) != 0)
+        failed = true;
+    if (ownsFile && fclose(file) != 0)
+        failed = true;
+    file = nullptr;
+    buffers.clear();
+    return !failed;
+}
+
+void VideoSink::writerLoop()
+{
+    typedef std::chrono::steady_clock Clock;
+    const size_t lumaSize = size_t(width) * height;
+    const size_t chromaSize = size_t((width + 1) / 2) * ((height + 1) / 2);
+    std::vector<unsigned char> yuv(lumaSize + chromaSize * 2);
+    unsigned char* y = yuv.data();
+    unsigned char* u = y + lumaSize;
+    unsigned char* v = nv12 ? u + 1 : u + chromaSize;
+
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;)
+    {
+        hasFrame.wait(guard, [this]() { return closing || !queued.empty(); });
+        if (queued.empty())
+            return;
+        const int index = queued.front();
+        queued.pop_front();
+        guard.unlock();
+
+        const Clock::time_point start = Clock::now();
+        rgbaToYuv420(buffers[index].data(), width, height, true, y, u, v, nv12 ? 2 : 1);
+        const Clock::time_point converted = Clock::now();
+        bool written = nv12 || fwrite("FRAME\n", 1, 6, file) == 6;
+        written = written && fwrite(yuv.data(), 1, yuv.size(), file) == yuv.size();
+        const Clock::time_point done = Clock::now();
+
+        guard.lock();
+        if (!written && !failed)
+        {
+            std::cout << "ERROR::VIDEO_SINK:: write failed after " << stats.frames << " frames" << std::endl;
+            failed = true;
+        }
+        ++stats.frames;
+        stats.convertMs += std::chrono::duration<double, std::milli>(converted - start).count();
+        stats.writeMs += std::chrono::duration<double, std::milli>(done - converted).count();
+        stats.megabytes += yuv.size() / (1024.0 * 1024.0);
+        freeBuffers.push_back(index);
+        hasRoom.notify_one();
+    }
+}
+
+VideoStats VideoSink::getStats() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
@@ -0,0 +1,51 @@
+#include "myImplement/vm_shader.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+VmShader::VmShader(const char* fragmentPath, ShaderPreprocessor* preprocessor, const ShaderDefines& defines)
+    : valid(false)
+{
+    std::string fragmentCode;
+    if (preprocessor)
+    {
+        // the preprocessor has printed what it could not read
+        if (!preprocessor->expand(fragmentPath, fragmentCode))
+            return;
+    }
+    else
+    {
+        std::ifstream file(fragmentPath, std::ios::in | std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::VM_SHADER::FILE_NOT_SUCCESFULLY_READ: " << fragmentPath << std::endl;
+            return;
+        }
+        std::stringstream stream;
+        stream << file.rdbuf();
+        fragmentCode = stream.str();
+    }
+    std::vector<bool> found;
+    overrideDefines(fragmentCode, defines, found);
+
+    glsl::Program program;
+    std::string error;
+    if (!glsl::parse(fragmentCode, program))
+        error = program.error;
+    else
+        glsl::compileVm(program, vm, error);
+    if (!error.empty())
+    {
+        std::cout << "ERROR::VM_SHADER::COMPILATION_ERROR in " << fragmentPath << "\n" << error << std::endl;
+        return;
+    }
+
+    setLayout(program);
+    valid = true;
+}
+
+void VmShader::renderTile(const Tile& tile, int width, unsigned char* rgba) const
+{
+    glsl::runVm(vm, uniforms.data(), tile.x0, tile.y0, tile.x1, tile.y1, width, rgba);
+}